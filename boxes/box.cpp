@@ -179,14 +179,16 @@ class Box *Box::ParseBoxMarker(class Tables *tables,class Box *&boxlist,class By
     box->m_usEnumerator = en;
   }
   //
+  // Check the size before touching the data, a complete box may
+  // already be in use by the decoder.
+  if (box->m_uqParsedBytes + blen > box->m_uqBoxSize)
+    JPG_THROW(MALFORMED_STREAM,"Box::ParseBoxMarker","JPEG stream is invalid, more data in the application "
+              "marker than indicated and required by the box contained within.");
+  //
   // Add the data to the input stream.
   box->InputStreamOf()->Append(stream,blen,z);
   box->m_uqParsedBytes += blen;
   //
-  if (box->m_uqParsedBytes > box->m_uqBoxSize)
-    JPG_THROW(MALFORMED_STREAM,"Box::ParseBoxMarker","JPEG stream is invalid, more data in the application "
-              "marker than indicated and required by the box contained within.");
-  //
   // If the box is complete, start its second level parsing.
   if (box->m_uqParsedBytes == box->m_uqBoxSize) {
     if (box->ParseBoxContent(box->InputStreamOf(),box->m_uqBoxSize)) {
@@ -431,10 +433,10 @@ class Box *Box::CreateBox(class Tables *tables,class Box *&boxlist,ULONG tbox)
 
 /// Box::OutputStreamOf
 // Create the output stream we can write into, or return it.
-class MemoryStream *Box::OutputStreamOf(void)
+class MemoryStream *Box::OutputStreamOf(ULONG bufsize)
 {
   if (m_pOutputStream == NULL) {
-      m_pOutputStream = new(m_pEnviron) class MemoryStream(m_pEnviron);
+      m_pOutputStream = new(m_pEnviron) class MemoryStream(m_pEnviron,bufsize);
   }
 
   return m_pOutputStream;
@@ -124,7 +124,8 @@ protected:
   class DecoderStream *InputStreamOf(void);
   //
   // Create the output stream we can write into, or return it.
-  class MemoryStream *OutputStreamOf(void);
+  // The stream buffers data in chunks of the given size.
+  class MemoryStream *OutputStreamOf(ULONG bufsize = 2048);
   //
   // Write the box contents to the given stream, potentially breaking it up into
   // several APP11 markers.
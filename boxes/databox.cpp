@@ -59,6 +59,13 @@
 // on encoding.
 ByteStream *DataBox::EncoderBufferOf(void)
 {
+  // The residual codestream is the one that grows large. It is cut
+  // into APP11 markers carrying somewhat less than 64K of it each,
+  // hence buffer it in chunks of 64K instead of many small ones.
+  // Alpha and refinement data is typically small, keep the default.
+  if (BoxTypeOf() == ResidualType)
+    return OutputStreamOf(MAX_UWORD);
+
   return OutputStreamOf();
 }
 ///
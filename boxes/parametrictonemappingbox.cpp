@@ -65,19 +65,93 @@ ParametricToneMappingBox::~ParametricToneMappingBox(void)
     m_pImpls = impl->m_pNext;
     
     if (impl->m_plTable)
-      m_pEnviron->FreeMem(impl->m_plTable,impl->m_ulTableEntries * sizeof(LONG)); 
+      ReleaseTable(impl->m_plTable,impl->m_ulTableEntries * sizeof(LONG)); 
 
     if (impl->m_pfTable)
-      m_pEnviron->FreeMem(impl->m_pfTable,impl->m_ulTableEntries * sizeof(FLOAT));
+      ReleaseTable(impl->m_pfTable,impl->m_ulTableEntries * sizeof(FLOAT));
 
     if (impl->m_plInverseTable)
-      m_pEnviron->FreeMem(impl->m_plInverseTable,impl->m_ulInverseTableEntries * sizeof(LONG));
+      ReleaseTable(impl->m_plInverseTable,impl->m_ulInverseTableEntries * sizeof(LONG));
 
     delete impl;
   }
 }
 ///
 
+/// ParametricToneMappingBox::KeyOf
+// Fill in the key under which the table of the given kind is found
+// in the table cache.
+void ParametricToneMappingBox::KeyOf(const struct TableImpl *impl,UBYTE kind,
+                                     struct TableCache::CurveKey &key) const
+{
+  key.ck_ucKind         = kind;
+  key.ck_ucCurve        = m_Type;
+  key.ck_ucE            = m_ucE;
+  key.ck_fP1            = m_fP1;
+  key.ck_fP2            = m_fP2;
+  key.ck_fP3            = m_fP3;
+  key.ck_fP4            = m_fP4;
+  key.ck_ucInputBits    = impl->m_ucInputBits;
+  key.ck_ucOutputBits   = impl->m_ucOutputBits;
+  key.ck_ucInputFracts  = impl->m_ucInputFracts;
+  key.ck_ucOutputFracts = impl->m_ucOutputFracts;
+  key.ck_ucTableBits    = impl->m_ucTableBits;
+  key.ck_ulInputOffset  = impl->m_ulInputOffset;
+}
+///
+
+/// ParametricToneMappingBox::CachedTableOf
+// Return the table of the given kind for the implementation if
+// another box with the same curve computed it already, or NULL.
+void *ParametricToneMappingBox::CachedTableOf(const struct TableImpl *impl,UBYTE kind)
+{
+  class TableCache *cache = m_pEnviron->TableCacheOf();
+  struct TableCache::CurveKey key;
+
+  if (cache == NULL)
+    return NULL;
+
+  KeyOf(impl,kind,key);
+  
+  return cache->FindCurveTable(this,key);
+}
+///
+
+/// ParametricToneMappingBox::ShareTable
+// Offer a table just computed to the table cache and return the
+// table to be used from now on.
+void *ParametricToneMappingBox::ShareTable(const struct TableImpl *impl,UBYTE kind,
+                                           void *table,ULONG size)
+{
+  class TableCache *cache = m_pEnviron->TableCacheOf();
+  struct TableCache::CurveKey key;
+  void *result;
+
+  if (cache == NULL)
+    return table;
+
+  KeyOf(impl,kind,key);
+
+  result = cache->AddCurveTable(this,key,table,size);
+  if (result != table)
+    m_pEnviron->FreeMem(table,size);
+
+  return result;
+}
+///
+
+/// ParametricToneMappingBox::ReleaseTable
+// Release a table, either by returning it to the cache or by
+// releasing its memory.
+void ParametricToneMappingBox::ReleaseTable(void *table,ULONG size)
+{
+  class TableCache *cache = m_pEnviron->TableCacheOf();
+
+  if (cache == NULL || !cache->ReleaseCurveTable(table))
+    m_pEnviron->FreeMem(table,size);
+}
+///
+
 /// ParametricToneMappingBox::ParseBoxContent
 // Second level parsing stage: This is called from the first level
 // parser as soon as the data is complete. Must be implemented
@@ -398,6 +472,7 @@ const LONG *ParametricToneMappingBox::ScaledTableOf(UBYTE inputbits,UBYTE output
     ULONG i    = 0;
     ULONG max  = 1UL << (inputbits  + inputfract);
     //LONG omax  = 1UL << (outputbits + outputfract);
+    LONG *table;
     double inscale  = (inputbits  > 1)?(1.0 / (((1UL <<  inputbits) - m_ucE) <<  inputfract)):(1.0 / (1 <<  inputfract));
     double outscale = (outputbits > 1)?(1.0 * (((1UL << outputbits) - m_ucE) << outputfract)):(1.0 * (1 << outputfract));
     
@@ -406,7 +481,12 @@ const LONG *ParametricToneMappingBox::ScaledTableOf(UBYTE inputbits,UBYTE output
     assert(impl->m_ulTableEntries == 0 || impl->m_ulTableEntries == max);
     
     impl->m_ulTableEntries = max;
-    impl->m_plTable        = (LONG *)m_pEnviron->AllocMem(max * sizeof(LONG));
+    //
+    // Another box with the same curve may have computed it already.
+    if ((impl->m_plTable = (LONG *)CachedTableOf(impl,TableCache::ScaledCurve)))
+      return impl->m_plTable;
+    
+    table = (LONG *)m_pEnviron->AllocMem(max * sizeof(LONG));
 
     do {
       LONG out = LONG(floor(outscale * TableValue(i * inscale)+0.5));
@@ -418,8 +498,10 @@ const LONG *ParametricToneMappingBox::ScaledTableOf(UBYTE inputbits,UBYTE output
       if (out >= omax) out = omax - 1;
       **
       */
-      impl->m_plTable[i]   = out;
+      table[i]   = out;
     } while(++i < max);
+
+    impl->m_plTable = (LONG *)ShareTable(impl,TableCache::ScaledCurve,table,max * sizeof(LONG));
   } 
   
   return impl->m_plTable;
@@ -443,6 +525,7 @@ const FLOAT *ParametricToneMappingBox::FloatTableOf(UBYTE inputbits,UBYTE output
     ULONG max  = 1UL << (inputbits  + inputfract);
     //LONG omax  = 1UL << (outputbits + outputfract);
     //FLOAT fmax = FLOAT(omax - 1);
+    FLOAT *table;
     double inscale  = (inputbits  > 1)?(1.0 / (((1UL <<  inputbits) - m_ucE) <<  inputfract)):(1.0 / (1 <<  inputfract));
     double outscale = (outputbits > 1)?(1.0 * (((1UL << outputbits) - m_ucE) << outputfract)):(1.0 * (1 << outputfract));
     
@@ -451,7 +534,11 @@ const FLOAT *ParametricToneMappingBox::FloatTableOf(UBYTE inputbits,UBYTE output
     assert(impl->m_ulTableEntries == 0 || impl->m_ulTableEntries == max);
     
     impl->m_ulTableEntries = max;
-    impl->m_pfTable        = (FLOAT *)m_pEnviron->AllocMem(max * sizeof(FLOAT));
+    //
+    if ((impl->m_pfTable = (FLOAT *)CachedTableOf(impl,TableCache::FloatCurve)))
+      return impl->m_pfTable;
+    
+    table = (FLOAT *)m_pEnviron->AllocMem(max * sizeof(FLOAT));
 
     do {
       FLOAT out = outscale * TableValue(i * inscale);
@@ -460,8 +547,10 @@ const FLOAT *ParametricToneMappingBox::FloatTableOf(UBYTE inputbits,UBYTE output
       if (out < 0.0)   out = 0.0;
       if (out > fmax)  out = fmax;
       */
-      impl->m_pfTable[i]   = out;
+      table[i]   = out;
     } while(++i < max);
+
+    impl->m_pfTable = (FLOAT *)ShareTable(impl,TableCache::FloatCurve,table,max * sizeof(FLOAT));
   } 
   
   return impl->m_pfTable;
@@ -492,6 +581,7 @@ const LONG *ParametricToneMappingBox::ExtendedInverseScaledTableOf(UBYTE dctbits
     LONG i     = 0; 
     LONG max   = 1UL << (tablebits + spatialfract);
     LONG omax  = 1UL << (dctbits   + dctfract);
+    LONG *table;
     double inscale  = (spatialbits > 1)?(1.0 / (((1UL << spatialbits) - m_ucE) << spatialfract)):(1.0 / (1 << spatialfract));
     double outscale = (dctbits     > 1)?(1.0 * (((1UL << dctbits    ) - m_ucE) << dctfract    )):(1.0 * (1 << dctfract));
 
@@ -499,14 +589,20 @@ const LONG *ParametricToneMappingBox::ExtendedInverseScaledTableOf(UBYTE dctbits
     assert(spatialbits <= 16);
 
     impl->m_ulInverseTableEntries = max;
-    impl->m_plInverseTable        = (LONG *)m_pEnviron->AllocMem(max * sizeof(LONG));
+    //
+    if ((impl->m_plInverseTable = (LONG *)CachedTableOf(impl,TableCache::InverseCurve)))
+      return impl->m_plInverseTable;
+    
+    table = (LONG *)m_pEnviron->AllocMem(max * sizeof(LONG));
 
     do {
       LONG out = LONG(floor(outscale * InverseTableValue((i - LONG(offset)) * inscale)+0.5));
       if (out < 0)     out = 0;
       if (out >= omax) out = omax - 1;
-      impl->m_plInverseTable[i] = out;
+      table[i] = out;
     } while(++i < max);
+
+    impl->m_plInverseTable = (LONG *)ShareTable(impl,TableCache::InverseCurve,table,max * sizeof(LONG));
   }
 
   return impl->m_plInverseTable;
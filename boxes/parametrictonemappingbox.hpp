@@ -53,6 +53,7 @@
 /// Includes
 #include "box.hpp"
 #include "tonemapperbox.hpp"
+#include "coding/tablecache.hpp"
 ///
 
 /// class ParametricToneMappingBox
@@ -160,6 +161,22 @@ private:
   struct TableImpl *FindImpl(UBYTE dctbits,UBYTE spatialbits,UBYTE dctfract,UBYTE spatialfract,
                              ULONG offset,UBYTE tablebits) const;
   //
+  // Fill in the key under which the table of the given kind is found
+  // in the table cache.
+  void KeyOf(const struct TableImpl *impl,UBYTE kind,struct TableCache::CurveKey &key) const;
+  //
+  // Return the table of the given kind for the implementation if
+  // another box with the same curve computed it already, or NULL.
+  void *CachedTableOf(const struct TableImpl *impl,UBYTE kind);
+  //
+  // Offer a table just computed to the table cache and return the
+  // table to be used from now on.
+  void *ShareTable(const struct TableImpl *impl,UBYTE kind,void *table,ULONG size);
+  //
+  // Release a table, either by returning it to the cache or by
+  // releasing its memory.
+  void ReleaseTable(void *table,ULONG size);
+  //
 public:
   enum {
     Type = MAKE_ID('C','U','R','V')
@@ -631,7 +631,11 @@ void EncodeC(const char *source,const char *ldrsource,const char *target,const c
             JPG_EndTag
           };
           
-          class JPEG *jpeg = JPEG::Construct(NULL);
+          struct JPG_TagItem ctags[] = {
+            JPG_ValueTag(JPGTAG_THREAD_COUNT,workerthreads),
+            JPG_EndTag
+          };
+          class JPEG *jpeg = JPEG::Construct(ctags);
           if (jpeg) {
             UBYTE bytesperpixel = sizeof(UBYTE);
             UBYTE pixeltype     = CTYP_UBYTE;
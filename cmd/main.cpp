@@ -73,6 +73,7 @@
 ///
 
 bool oznew = false;
+int workerthreads = 0;
 
 /// Defines
 #define FIX_BITS 13
@@ -210,6 +211,12 @@ void PrintUsage(const char *progname)
           "-rR bits   : specify refinement bits for the residual image.\n"
           "-N         : enable noise shaping of the prediction residual\n"
           "-U         : disable automatic upsampling\n"
+          "-base      : decode the legacy codestream only, ignore all JPEG XT\n"
+          "             extensions\n"
+#if ACCUSOFT_CODE
+          "-dl levels : decode only the given number of resolution levels of a\n"
+          "             hierarchical image, starting from the smallest\n"
+#endif
           "-l         : enable lossless coding without a residual image by an\n"
           "             int-to-int DCT, also requires -c and -q 100 for true lossless\n"
 #if ACCUSOFT_CODE
@@ -268,6 +275,10 @@ void PrintUsage(const char *progname)
           "             in total, where h is the number of refinement bits. Each line contains\n"
           "             an (integer) output value the corresponding input is mapped to.\n"
           "-z mcus    : define the restart interval size, zero disables it\n"
+          "-mt n      : use n worker threads. These code arithmetically coded restart\n"
+          "             intervals, write the scans of a frame, quantize the residual\n"
+          "             image, and decode the residual codestream and the frames of\n"
+          "             hierarchical images\n"
 #if ACCUSOFT_CODE
           "-n         : indicate the image height by a DNL marker\n"
 #endif
@@ -400,6 +411,8 @@ int main(int argc,char **argv)
   bool noclamp      = false;
   bool setprofile   = false;
   bool upsample     = true;
+  bool legacyonly   = false;
+  int decodelevels  = 0;
   bool median       = true;
   int splitquality  = -1;
   int profile       = 2;    // profile C.
@@ -463,6 +476,8 @@ int main(int argc,char **argv)
       smooth = ParseInt(argc,argv);
     } else if (!strcmp(argv[1],"-z")) {
       restart = ParseInt(argc,argv);
+    } else if (!strcmp(argv[1],"-mt")) {
+      workerthreads = ParseInt(argc,argv);
     } else if (!strcmp(argv[1],"-r")) {
       residuals = true;
       argv++;
@@ -599,6 +614,14 @@ int main(int argc,char **argv)
       upsample = false;
       argv++;
       argc--;
+    } else if (!strcmp(argv[1],"-base")) {
+      legacyonly = true;
+      argv++;
+      argc--;
+#if ACCUSOFT_CODE
+    } else if (!strcmp(argv[1],"-dl")) {
+      decodelevels = ParseInt(argc,argv);
+#endif
     } else if (!strcmp(argv[1],"-dz")) {
       deadzone = true;
       argv++;
@@ -744,7 +767,7 @@ int main(int argc,char **argv)
   }
 
   if (quality < 0 && lossless == false && lsmode < 0) {
-    Reconstruct(argv[1],argv[2],colortrafo,alpha,upsample);
+    Reconstruct(argv[1],argv[2],colortrafo,alpha,upsample,legacyonly,decodelevels);
   } else {
     switch(profile) {
     case 0:
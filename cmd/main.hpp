@@ -60,5 +60,10 @@ extern int main(int argc,char **argv);
 extern void ParseSubsamplingFactors(UBYTE *sx,UBYTE *sy,const char *sub,int cnt);
 ///
 
+/// Globals
+// Number of threads for coding, zero or one for coding in the main thread.
+extern int workerthreads;
+///
+
 ///
 #endif
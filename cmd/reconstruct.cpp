@@ -53,6 +53,7 @@
 #include "cmd/reconstruct.hpp"
 #include "cmd/bitmaphook.hpp"
 #include "cmd/filehook.hpp"
+#include "cmd/main.hpp"
 #include "tools/environment.hpp"
 #include "tools/traits.hpp"
 #include "interface/types.hpp"
@@ -66,17 +67,23 @@
 // This reconstructs an image from the given input file
 // and writes the output ppm.
 void Reconstruct(const char *infile,const char *outfile,
-                 int colortrafo,const char *alpha,bool upsample)
+                 int colortrafo,const char *alpha,bool upsample,bool legacyonly,int levels)
 {  
   FILE *in = fopen(infile,"rb");
   if (in) {
     struct JPG_Hook filehook(FileHook,in);
-    class JPEG *jpeg = JPEG::Construct(NULL);
+    struct JPG_TagItem ctags[] = {
+      JPG_ValueTag(JPGTAG_THREAD_COUNT,workerthreads),
+      JPG_EndTag
+    };
+    class JPEG *jpeg = JPEG::Construct(ctags);
     if (jpeg) {
       int ok = 1;
       struct JPG_TagItem tags[] = {
         JPG_PointerTag(JPGTAG_HOOK_IOHOOK,&filehook),
         JPG_PointerTag(JPGTAG_HOOK_IOSTREAM,in), 
+        JPG_ValueTag(JPGTAG_DECODER_LEGACY_ONLY,legacyonly),
+        JPG_ValueTag(JPGTAG_DECODER_RESOLUTIONLEVELS,levels),
 #ifdef TEST_MARKER_INJECTION                
         // Stop after the image header...
         JPG_ValueTag(JPGTAG_DECODER_STOP,JPGFLAG_DECODER_STOP_FRAME),
@@ -52,7 +52,7 @@
 
 /// Prototypes
 extern void Reconstruct(const char *infile,const char *outfile,int colortrafo,const char *alpha,
-                        bool upsample);
+                        bool upsample,bool legacyonly,int levels);
 ///
 
 ///
@@ -49,6 +49,7 @@
 
 /// Includes
 #include "codestream/acrefinementscan.hpp"
+#include "codestream/intervalscheduler.hpp"
 #include "codestream/tables.hpp"
 #include "marker/frame.hpp"
 #include "marker/scan.hpp"
@@ -76,7 +77,7 @@ ACRefinementScan::ACRefinementScan(class Frame *frame,class Scan *scan,
 #if ACCUSOFT_CODE
   , m_pBlockCtrl(NULL),
     m_ucScanStart(start), m_ucScanStop(stop), m_ucLowBit(lowbit), m_ucHighBit(highbit),
-    m_bResidual(residual)
+    m_bResidual(residual), m_pScheduler(NULL), m_ulSkipMCUs(0)
 #endif
 {
 #if ACCUSOFT_CODE
@@ -92,9 +93,28 @@ ACRefinementScan::ACRefinementScan(class Frame *frame,class Scan *scan,
 }
 ///
 
+/// ACRefinementScan::ACRefinementScan
+// Create a copy of the given scan that codes restart intervals
+// within the given environment.
+ACRefinementScan::ACRefinementScan(class ACRefinementScan *master,class Environ *env)
+  : EntropyParser(master,env)
+#if ACCUSOFT_CODE
+  , m_pBlockCtrl(NULL),
+    m_ucScanStart(master->m_ucScanStart), m_ucScanStop(master->m_ucScanStop), 
+    m_ucLowBit(master->m_ucLowBit), m_ucHighBit(master->m_ucHighBit),
+    m_bMeasure(false), m_bResidual(master->m_bResidual), 
+    m_pScheduler(NULL), m_ulSkipMCUs(0)
+#endif
+{
+}
+///
+
 /// ACRefinementScan::~ACRefinementScan
 ACRefinementScan::~ACRefinementScan(void)
 {
+#if ACCUSOFT_CODE
+  delete m_pScheduler;
+#endif
 }
 ///
 
@@ -113,6 +133,15 @@ void ACRefinementScan::StartParseScan(class ByteStream *io,class Checksum *chk,c
   m_pBlockCtrl = dynamic_cast<BlockCtrl *>(ctrl);
   m_pBlockCtrl->ResetToStartOfScan(m_pScan);
   m_Coder.OpenForRead(io,chk);
+  //
+  // Restart intervals can be decoded in parallel if the checksum
+  // does not require to see the bytes in order.
+  if (m_pScheduler == NULL && chk == NULL && RestartIntervalOf() > 0) {
+    class WorkerPool *pool = m_pEnviron->WorkerPoolOf();
+    if (pool)
+      m_pScheduler = new(m_pEnviron) class IntervalScheduler(this,pool);
+  }
+  m_ulSkipMCUs = 0;
 #else
   NOREF(io);
   NOREF(chk);
@@ -145,6 +174,15 @@ void ACRefinementScan::StartWriteScan(class ByteStream *io,class Checksum *chk,c
 
   m_pScan->WriteMarker(io);
   m_Coder.OpenForWrite(io,chk);
+  //
+  // Restart intervals can be encoded in parallel.
+  if (m_pScheduler == NULL && RestartIntervalOf() > 0) {
+    class WorkerPool *pool = m_pEnviron->WorkerPoolOf();
+    if (pool)
+      m_pScheduler = new(m_pEnviron) class IntervalScheduler(this,pool);
+  }
+  if (m_pScheduler)
+    m_pScheduler->StartWrite(io,chk);
 #else
   NOREF(io);
   NOREF(chk);
@@ -190,19 +228,46 @@ bool ACRefinementScan::StartMCURow(void)
 bool ACRefinementScan::WriteMCU(void)
 { 
 #if ACCUSOFT_CODE
-  bool more = true;
+  class QuantizedRow *rows[4];
   int c;
 
   assert(m_pBlockCtrl);
 
-  BeginWriteMCU(m_Coder.ByteStreamOf());
+  if (m_pScheduler == NULL)
+    BeginWriteMCU(m_Coder.ByteStreamOf());
+
+  for(c = 0;c < m_ucCount;c++) {
+    rows[c] = m_pBlockCtrl->CurrentQuantizedRow(m_pComponent[c]->IndexOf());
+  }
+
+  if (m_pScheduler) {
+    // Just note the position, the scheduler encodes it later.
+    m_pScheduler->WriteMCU(rows,m_ulX);
+    return SkipMCU(rows,m_ulX);
+  }
+
+  return EncodeMCU(rows,m_ulX);
+#else
+  return false;
+#endif
+}
+///
+
+/// ACRefinementScan::EncodeMCU
+// Encode a single MCU at the given rows and block positions, advance
+// the positions. Returns true if there are more MCUs in this row.
+#if ACCUSOFT_CODE
+bool ACRefinementScan::EncodeMCU(class QuantizedRow *const *rows,ULONG *xpos)
+{
+  bool more = true;
+  int c;
 
   for(c = 0;c < m_ucCount;c++) {
     class Component *comp    = m_pComponent[c];
-    class QuantizedRow *q    = m_pBlockCtrl->CurrentQuantizedRow(comp->IndexOf());
+    class QuantizedRow *q    = rows[c];
     UBYTE mcux               = (m_ucCount > 1)?(comp->MCUWidthOf() ):(1);
     UBYTE mcuy               = (m_ucCount > 1)?(comp->MCUHeightOf()):(1);
-    ULONG xmin               = m_ulX[c];
+    ULONG xmin               = xpos[c];
     ULONG xmax               = xmin + mcux;
     ULONG x,y; 
     if (xmax >= q->WidthOf()) {
@@ -222,14 +287,12 @@ bool ACRefinementScan::WriteMCU(void)
       if (q) q = q->NextOf();
     }
     // Done with this component, advance the block.
-    m_ulX[c] = xmax;
+    xpos[c] = xmax;
   }
 
   return more;
-#else
-  return false;
-#endif
 }
+#endif
 ///
 
 /// ACRefinementScan::Restart
@@ -243,24 +306,67 @@ void ACRefinementScan::Restart(void)
 }
 ///
 
+/// ACRefinementScan::MaxMCUSizeOf
+// Return an upper bound for the number of bytes a single call of
+// ParseMCU() may read. See ACSequentialScan for the reasoning, the
+// refinement takes fewer decisions per coefficient.
+ULONG ACRefinementScan::MaxMCUSizeOf(void) const
+{
+  if (m_pScheduler)
+    return 0;
+  
+  return BlocksPerMCU() * 64 * 48 * 15 / 8 * 2 + 16;
+}
+///
+
 /// ACRefinementScan::ParseMCU
 // Parse a single MCU in this scan. Return true if there are more blocks in this row.
 bool ACRefinementScan::ParseMCU(void)
 {
 #if ACCUSOFT_CODE
-  bool more = true;
+  class QuantizedRow *rows[4];
   int c;
 
   assert(m_pBlockCtrl);
 
+  for(c = 0;c < m_ucCount;c++) {
+    rows[c] = m_pBlockCtrl->CurrentQuantizedRow(m_pComponent[c]->IndexOf());
+  }
+
+  if (m_pScheduler) {
+    // At the start of the row, let the scheduler decode what it can.
+    if (m_ulX[0] == 0)
+      m_ulSkipMCUs = m_pScheduler->ParseRow(m_Coder.ByteStreamOf(),rows);
+    if (m_ulSkipMCUs) {
+      m_ulSkipMCUs--;
+      return SkipMCU(rows,m_ulX);
+    }
+  }
+
   bool valid = BeginReadMCU(m_Coder.ByteStreamOf());
+
+  return DecodeMCU(rows,m_ulX,valid);
+#else
+  return false;
+#endif
+}
+///
+
+/// ACRefinementScan::DecodeMCU
+// Decode a single MCU at the given rows and block positions. If the
+// segment is not valid, leave the blocks alone.
+#if ACCUSOFT_CODE
+bool ACRefinementScan::DecodeMCU(class QuantizedRow *const *rows,ULONG *xpos,bool valid)
+{
+  bool more = true;
+  int c;
   
   for(c = 0;c < m_ucCount;c++) {
     class Component *comp    = m_pComponent[c];
-    class QuantizedRow *q    = m_pBlockCtrl->CurrentQuantizedRow(comp->IndexOf());
+    class QuantizedRow *q    = rows[c];
     UBYTE mcux               = (m_ucCount > 1)?(comp->MCUWidthOf() ):(1);
     UBYTE mcuy               = (m_ucCount > 1)?(comp->MCUHeightOf()):(1);
-    ULONG xmin               = m_ulX[c];
+    ULONG xmin               = xpos[c];
     ULONG xmax               = xmin + mcux;
     ULONG x,y;
     if (xmax >= q->WidthOf()) {
@@ -281,12 +387,63 @@ bool ACRefinementScan::ParseMCU(void)
       if (q) q = q->NextOf();
     }
     // Done with this component, advance the block.
-    m_ulX[c] = xmax;
+    xpos[c] = xmax;
   }
 
   return more;
+}
+#endif
+///
+
+/// ACRefinementScan::CreateIntervalParser
+// Create a copy of this scan for coding restart intervals on
+// a worker thread.
+class EntropyParser *ACRefinementScan::CreateIntervalParser(class Environ *env)
+{
+  return new(env) class ACRefinementScan(this,env);
+}
+///
+
+/// ACRefinementScan::WriteInterval
+// Encode the given number of MCUs as a single restart interval.
+void ACRefinementScan::WriteInterval(class ByteStream *io,class QuantizedRow **rows,ULONG *x,ULONG mcus)
+{
+#if ACCUSOFT_CODE
+  m_Context.Init();
+  m_Coder.OpenForWrite(io,NULL);
+  
+  while(mcus--) {
+    if (!EncodeMCU(rows,x))
+      NextMCURow(rows,x);
+  }
+
+  m_Coder.Flush();
 #else
-  return false;
+  NOREF(io);
+  NOREF(rows);
+  NOREF(x);
+  NOREF(mcus);
+#endif
+}
+///
+
+/// ACRefinementScan::ParseInterval
+// Decode the given number of MCUs as a single restart interval.
+void ACRefinementScan::ParseInterval(class ByteStream *io,class QuantizedRow **rows,ULONG *x,ULONG mcus)
+{
+#if ACCUSOFT_CODE
+  m_Context.Init();
+  m_Coder.OpenForRead(io,NULL);
+  
+  while(mcus--) {
+    if (!DecodeMCU(rows,x,true))
+      NextMCURow(rows,x);
+  }
+#else
+  NOREF(io);
+  NOREF(rows);
+  NOREF(x);
+  NOREF(mcus);
 #endif
 }
 ///
@@ -479,12 +636,20 @@ void ACRefinementScan::WriteFrameType(class ByteStream *io)
 
 /// ACRefinementScan::Flush
 // Flush the remaining bits out to the stream on writing.
-void ACRefinementScan::Flush(bool)
+void ACRefinementScan::Flush(bool final)
 {
 #if ACCUSOFT_CODE
+  if (m_pScheduler && final) {
+    // Everything went through the scheduler.
+    m_pScheduler->Flush();
+    return;
+  }
+  
   m_Coder.Flush();
   m_Context.Init();
   m_Coder.OpenForWrite(m_Coder.ByteStreamOf(),m_Coder.ChecksumOf());
+#else
+  NOREF(final);
 #endif
 }
 ///
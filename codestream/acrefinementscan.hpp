@@ -68,6 +68,7 @@ class Frame;
 struct RectangleRequest;
 class BufferCtrl;
 class BlockCtrl;
+class IntervalScheduler;
 ///
 
 /// class ACRefinementScan
@@ -154,6 +155,20 @@ protected:
   // Encode a residual scan?
   bool                        m_bResidual;
   //
+  // If restart intervals are coded in parallel, this schedules them.
+  class IntervalScheduler    *m_pScheduler;
+  //
+  // Number of MCUs in the current row already decoded by the scheduler.
+  ULONG                       m_ulSkipMCUs;
+  //
+  // Encode a single MCU at the given rows and block positions, advance
+  // the positions. Returns true if there are more MCUs in this row.
+  bool EncodeMCU(class QuantizedRow *const *rows,ULONG *x);
+  //
+  // Decode a single MCU at the given rows and block positions. If the
+  // segment is not valid, leave the blocks alone.
+  bool DecodeMCU(class QuantizedRow *const *rows,ULONG *x,bool valid);
+  //
   // Encode a single block
   void EncodeBlock(const LONG *block);
   //
@@ -168,6 +183,16 @@ protected:
   // Restart the parser at the next restart interval
   virtual void Restart(void);
   //
+  // Create a copy of this scan for coding restart intervals on
+  // a worker thread.
+  virtual class EntropyParser *CreateIntervalParser(class Environ *env);
+  //
+  // Encode the given number of MCUs as a single restart interval.
+  virtual void WriteInterval(class ByteStream *io,class QuantizedRow **rows,ULONG *x,ULONG mcus);
+  //
+  // Decode the given number of MCUs as a single restart interval.
+  virtual void ParseInterval(class ByteStream *io,class QuantizedRow **rows,ULONG *x,ULONG mcus);
+  //
 private:
   //
   // Write the marker that indicates the frame type fitting to this scan.
@@ -181,6 +206,10 @@ public:
                    UBYTE lowbit,UBYTE highbit,
                    bool differential = false,bool residual = false);
   //
+  // Create a copy of the given scan that codes restart intervals
+  // within the given environment.
+  ACRefinementScan(class ACRefinementScan *master,class Environ *env);
+  //
   ~ACRefinementScan(void);
   // 
   // Fill in the tables for decoding and decoding parameters in general.
@@ -203,6 +232,10 @@ public:
   // MCUs in this row.
   virtual bool ParseMCU(void);  
   //
+  // Return an upper bound for the number of bytes a single call of
+  // ParseMCU() may read.
+  virtual ULONG MaxMCUSizeOf(void) const;
+  //
   // Write a single MCU in this scan.
   virtual bool WriteMCU(void);  
   //
@@ -48,6 +48,7 @@
 
 /// Includes
 #include "codestream/acsequentialscan.hpp"
+#include "codestream/intervalscheduler.hpp"
 #include "codestream/tables.hpp"
 #include "marker/frame.hpp"
 #include "marker/scan.hpp"
@@ -75,7 +76,8 @@ ACSequentialScan::ACSequentialScan(class Frame *frame,class Scan *scan,
 #if ACCUSOFT_CODE
   , m_pBlockCtrl(NULL),
     m_ucScanStart(start), m_ucScanStop(stop), m_ucLowBit(lowbit),
-    m_bMeasure(false), m_bDifferential(differential), m_bResidual(residual), m_bLargeRange(large)
+    m_bMeasure(false), m_bDifferential(differential), m_bResidual(residual), m_bLargeRange(large),
+    m_pScheduler(NULL), m_ulSkipMCUs(0)
 #endif
 {
 #if ACCUSOFT_CODE
@@ -97,9 +99,38 @@ ACSequentialScan::ACSequentialScan(class Frame *frame,class Scan *scan,
 }
 ///
 
+/// ACSequentialScan::ACSequentialScan
+// Create a copy of the given scan that codes restart intervals
+// within the given environment.
+ACSequentialScan::ACSequentialScan(class ACSequentialScan *master,class Environ *env)
+  : EntropyParser(master,env)
+#if ACCUSOFT_CODE
+  , m_pBlockCtrl(NULL),
+    m_ucScanStart(master->m_ucScanStart), m_ucScanStop(master->m_ucScanStop), 
+    m_ucLowBit(master->m_ucLowBit),
+    m_bMeasure(false), m_bDifferential(master->m_bDifferential), 
+    m_bResidual(master->m_bResidual), m_bLargeRange(master->m_bLargeRange),
+    m_pScheduler(NULL), m_ulSkipMCUs(0)
+#endif
+{
+#if ACCUSOFT_CODE
+  for(UBYTE i = 0;i < m_ucCount;i++) {
+    m_ucDCContext[i] = master->m_ucDCContext[i];
+    m_ucACContext[i] = master->m_ucACContext[i];
+    m_ucSmall[i]     = master->m_ucSmall[i];
+    m_ucLarge[i]     = master->m_ucLarge[i];
+    m_ucBlockEnd[i]  = master->m_ucBlockEnd[i];
+  }
+#endif
+}
+///
+
 /// ACSequentialScan::~ACSequentialScan
 ACSequentialScan::~ACSequentialScan(void)
 {
+#if ACCUSOFT_CODE
+  delete m_pScheduler;
+#endif
 }
 ///
 
@@ -144,6 +175,15 @@ void ACSequentialScan::StartParseScan(class ByteStream *io,class Checksum *chk,c
   m_pBlockCtrl = dynamic_cast<BlockCtrl *>(ctrl);
   m_pBlockCtrl->ResetToStartOfScan(m_pScan);
   m_Coder.OpenForRead(io,chk);
+  //
+  // Restart intervals can be decoded in parallel if the checksum
+  // does not require to see the bytes in order.
+  if (m_pScheduler == NULL && chk == NULL && RestartIntervalOf() > 0) {
+    class WorkerPool *pool = m_pEnviron->WorkerPoolOf();
+    if (pool)
+      m_pScheduler = new(m_pEnviron) class IntervalScheduler(this,pool);
+  }
+  m_ulSkipMCUs = 0;
 #else
   NOREF(io);
   NOREF(chk);
@@ -198,6 +238,15 @@ void ACSequentialScan::StartWriteScan(class ByteStream *io,class Checksum *chk,c
 
   m_pScan->WriteMarker(io);
   m_Coder.OpenForWrite(io,chk);
+  //
+  // Restart intervals can be encoded in parallel.
+  if (m_pScheduler == NULL && RestartIntervalOf() > 0) {
+    class WorkerPool *pool = m_pEnviron->WorkerPoolOf();
+    if (pool)
+      m_pScheduler = new(m_pEnviron) class IntervalScheduler(this,pool);
+  }
+  if (m_pScheduler)
+    m_pScheduler->StartWrite(io,chk);
 #else
   NOREF(io);
   NOREF(chk);
@@ -243,16 +292,43 @@ bool ACSequentialScan::StartMCURow(void)
 bool ACSequentialScan::WriteMCU(void)
 { 
 #if ACCUSOFT_CODE
-  bool more = true;
+  class QuantizedRow *rows[4];
   int c;
 
   assert(m_pBlockCtrl);
-  
-  BeginWriteMCU(m_Coder.ByteStreamOf());
+
+  if (m_pScheduler == NULL)
+    BeginWriteMCU(m_Coder.ByteStreamOf());
+
+  for(c = 0;c < m_ucCount;c++) {
+    rows[c] = m_pBlockCtrl->CurrentQuantizedRow(m_pComponent[c]->IndexOf());
+  }
+
+  if (m_pScheduler) {
+    // Just note the position, the scheduler encodes it later.
+    m_pScheduler->WriteMCU(rows,m_ulX);
+    return SkipMCU(rows,m_ulX);
+  }
+
+  return EncodeMCU(rows,m_ulX);
+#else
+  return false;
+#endif
+}
+///
+
+/// ACSequentialScan::EncodeMCU
+// Encode a single MCU at the given rows and block positions, advance
+// the positions. Returns true if there are more MCUs in this row.
+#if ACCUSOFT_CODE
+bool ACSequentialScan::EncodeMCU(class QuantizedRow *const *rows,ULONG *xpos)
+{
+  bool more = true;
+  int c;
 
   for(c = 0;c < m_ucCount;c++) {
     class Component *comp    = m_pComponent[c];
-    class QuantizedRow *q    = m_pBlockCtrl->CurrentQuantizedRow(comp->IndexOf());
+    class QuantizedRow *q    = rows[c];
     LONG &prevdc             = m_lDC[c];
     LONG &prevdiff           = m_lDiff[c];
     UBYTE l                  = m_ucSmall[c];
@@ -260,7 +336,7 @@ bool ACSequentialScan::WriteMCU(void)
     UBYTE kx                 = m_ucBlockEnd[c];
     UBYTE mcux               = (m_ucCount > 1)?(comp->MCUWidthOf() ):(1);
     UBYTE mcuy               = (m_ucCount > 1)?(comp->MCUHeightOf()):(1);
-    ULONG xmin               = m_ulX[c];
+    ULONG xmin               = xpos[c];
     ULONG xmax               = xmin + mcux;
     ULONG x,y; 
     if (xmax >= q->WidthOf()) {
@@ -281,14 +357,12 @@ bool ACSequentialScan::WriteMCU(void)
       if (q) q = q->NextOf();
     }
     // Done with this component, advance the block.
-    m_ulX[c] = xmax;
+    xpos[c] = xmax;
   }
 
   return more;
-#else
-  return false;
-#endif
 }
+#endif
 ///
 
 /// ACSequentialScan::Restart
@@ -311,21 +385,100 @@ void ACSequentialScan::Restart(void)
 }
 ///
 
+/// ACSequentialScan::MaxMCUSizeOf
+// Return an upper bound for the number of bytes a single call of
+// ParseMCU() may read. A coefficient takes less than 48 binary
+// decisions, each of which may renormalize the coder by at most 15
+// bits, and byte stuffing may double this. If restart intervals are
+// decoded in parallel, a complete row is read at once, which is not
+// bounded.
+ULONG ACSequentialScan::MaxMCUSizeOf(void) const
+{
+  if (m_pScheduler)
+    return 0;
+  
+  return BlocksPerMCU() * 64 * 48 * 15 / 8 * 2 + 16;
+}
+///
+
 /// ACSequentialScan::ParseMCU
 // Parse a single MCU in this scan. Return true if there are more blocks in this row.
 bool ACSequentialScan::ParseMCU(void)
 {
 #if ACCUSOFT_CODE
-  bool more = true;
+  class QuantizedRow *rows[4];
   int c;
 
   assert(m_pBlockCtrl);
 
+  for(c = 0;c < m_ucCount;c++) {
+    rows[c] = m_pBlockCtrl->CurrentQuantizedRow(m_pComponent[c]->IndexOf());
+  }
+
+  if (m_pScheduler) {
+    // At the start of the row, let the scheduler decode what it can.
+    if (m_ulX[0] == 0)
+      m_ulSkipMCUs = m_pScheduler->ParseRow(m_Coder.ByteStreamOf(),rows);
+    if (m_ulSkipMCUs) {
+      m_ulSkipMCUs--;
+      return SkipMCU(rows,m_ulX);
+    }
+  }
+
   bool valid = BeginReadMCU(m_Coder.ByteStreamOf());
+
+  return DecodeMCU(rows,m_ulX,valid);
+#else
+  return false;
+#endif
+}
+///
+
+/// ACSequentialScan::ParseMCURow
+// Parse the remaining MCUs of the current MCU row. This is equivalent
+// to calling ParseMCU() until it returns false, except that the
+// quantized rows are looked up once per row.
+void ACSequentialScan::ParseMCURow(void)
+{
+#if ACCUSOFT_CODE
+  class QuantizedRow *rows[4];
+  bool more;
+  int c;
+
+  assert(m_pBlockCtrl);
+
+  for(c = 0;c < m_ucCount;c++) {
+    rows[c] = m_pBlockCtrl->CurrentQuantizedRow(m_pComponent[c]->IndexOf());
+  }
+
+  do {
+    if (m_pScheduler) {
+      if (m_ulX[0] == 0)
+        m_ulSkipMCUs = m_pScheduler->ParseRow(m_Coder.ByteStreamOf(),rows);
+      if (m_ulSkipMCUs) {
+        m_ulSkipMCUs--;
+        more = SkipMCU(rows,m_ulX);
+        continue;
+      }
+    }
+    more = DecodeMCU(rows,m_ulX,BeginReadMCU(m_Coder.ByteStreamOf()));
+  } while(more);
+#endif
+}
+///
+
+/// ACSequentialScan::DecodeMCU
+// Decode a single MCU at the given rows and block positions. If the
+// segment is not valid, clear the blocks instead.
+#if ACCUSOFT_CODE
+bool ACSequentialScan::DecodeMCU(class QuantizedRow *const *rows,ULONG *xpos,bool valid)
+{
+  bool more = true;
+  int c;
   
   for(c = 0;c < m_ucCount;c++) {
     class Component *comp    = m_pComponent[c];
-    class QuantizedRow *q    = m_pBlockCtrl->CurrentQuantizedRow(comp->IndexOf());
+    class QuantizedRow *q    = rows[c];
     LONG &prevdc             = m_lDC[c];
     LONG &prevdiff           = m_lDiff[c];
     UBYTE l                  = m_ucSmall[c];
@@ -333,7 +486,7 @@ bool ACSequentialScan::ParseMCU(void)
     UBYTE kx                 = m_ucBlockEnd[c];
     UBYTE mcux               = (m_ucCount > 1)?(comp->MCUWidthOf() ):(1);
     UBYTE mcuy               = (m_ucCount > 1)?(comp->MCUHeightOf()):(1);
-    ULONG xmin               = m_ulX[c];
+    ULONG xmin               = xpos[c];
     ULONG xmax               = xmin + mcux;
     ULONG x,y;
     if (xmax >= q->WidthOf()) {
@@ -358,12 +511,81 @@ bool ACSequentialScan::ParseMCU(void)
       if (q) q = q->NextOf();
     }
     // Done with this component, advance the block.
-    m_ulX[c] = xmax;
+    xpos[c] = xmax;
   }
 
   return more;
+}
+#endif
+///
+
+/// ACSequentialScan::CreateIntervalParser
+// Create a copy of this scan for coding restart intervals on
+// a worker thread.
+class EntropyParser *ACSequentialScan::CreateIntervalParser(class Environ *env)
+{
+  return new(env) class ACSequentialScan(this,env);
+}
+///
+
+/// ACSequentialScan::WriteInterval
+// Encode the given number of MCUs as a single restart interval.
+void ACSequentialScan::WriteInterval(class ByteStream *io,class QuantizedRow **rows,ULONG *x,ULONG mcus)
+{
+#if ACCUSOFT_CODE
+  int i;
+  
+  for(i = 0;i < m_ucCount;i++) {
+    m_lDC[i]         = 0; 
+    m_lDiff[i]       = 0;
+  }
+  for(i = 0;i < 4;i++) {
+    m_Context[i].Init();
+  }
+
+  m_Coder.OpenForWrite(io,NULL);
+  
+  while(mcus--) {
+    if (!EncodeMCU(rows,x))
+      NextMCURow(rows,x);
+  }
+
+  m_Coder.Flush();
 #else
-  return false;
+  NOREF(io);
+  NOREF(rows);
+  NOREF(x);
+  NOREF(mcus);
+#endif
+}
+///
+
+/// ACSequentialScan::ParseInterval
+// Decode the given number of MCUs as a single restart interval.
+void ACSequentialScan::ParseInterval(class ByteStream *io,class QuantizedRow **rows,ULONG *x,ULONG mcus)
+{
+#if ACCUSOFT_CODE
+  int i;
+  
+  for(i = 0;i < m_ucCount;i++) {
+    m_lDC[i]         = 0; 
+    m_lDiff[i]       = 0;
+  }
+  for(i = 0;i < 4;i++) {
+    m_Context[i].Init();
+  }
+
+  m_Coder.OpenForRead(io,NULL);
+  
+  while(mcus--) {
+    if (!DecodeMCU(rows,x,true))
+      NextMCURow(rows,x);
+  }
+#else
+  NOREF(io);
+  NOREF(rows);
+  NOREF(x);
+  NOREF(mcus);
 #endif
 }
 ///
@@ -725,10 +947,16 @@ void ACSequentialScan::WriteFrameType(class ByteStream *io)
 
 /// ACSequentialScan::Flush
 // Flush the remaining bits out to the stream on writing.
-void ACSequentialScan::Flush(bool)
+void ACSequentialScan::Flush(bool final)
 {
 #if ACCUSOFT_CODE
   int i;
+
+  if (m_pScheduler && final) {
+    // Everything went through the scheduler.
+    m_pScheduler->Flush();
+    return;
+  }
   
   m_Coder.Flush();
 
@@ -741,6 +969,8 @@ void ACSequentialScan::Flush(bool)
   }
   
   m_Coder.OpenForWrite(m_Coder.ByteStreamOf(),m_Coder.ChecksumOf());
+#else
+  NOREF(final);
 #endif
 }
 ///
@@ -68,6 +68,7 @@ class LineAdapter;
 class BufferCtrl;
 class BlockBuffer;
 class BlockCtrl;
+class IntervalScheduler;
 ///
 
 /// class ACSequentialScan
@@ -297,6 +298,20 @@ protected:
   // Set if this is a large range scan.
   bool                        m_bLargeRange;
   //
+  // If restart intervals are coded in parallel, this schedules them.
+  class IntervalScheduler    *m_pScheduler;
+  //
+  // Number of MCUs in the current row already decoded by the scheduler.
+  ULONG                       m_ulSkipMCUs;
+  //
+  // Encode a single MCU at the given rows and block positions, advance
+  // the positions. Returns true if there are more MCUs in this row.
+  bool EncodeMCU(class QuantizedRow *const *rows,ULONG *x);
+  //
+  // Decode a single MCU at the given rows and block positions. If the
+  // segment is not valid, clear the blocks instead.
+  bool DecodeMCU(class QuantizedRow *const *rows,ULONG *x,bool valid);
+  //
   // Encode a single block
   void EncodeBlock(const LONG *block,
                    LONG &prevdc,LONG &prevdiff,
@@ -317,6 +332,16 @@ protected:
   // Restart the parser at the next restart interval
   virtual void Restart(void);
   //
+  // Create a copy of this scan for coding restart intervals on
+  // a worker thread.
+  virtual class EntropyParser *CreateIntervalParser(class Environ *env);
+  //
+  // Encode the given number of MCUs as a single restart interval.
+  virtual void WriteInterval(class ByteStream *io,class QuantizedRow **rows,ULONG *x,ULONG mcus);
+  //
+  // Decode the given number of MCUs as a single restart interval.
+  virtual void ParseInterval(class ByteStream *io,class QuantizedRow **rows,ULONG *x,ULONG mcus);
+  //
 private:
   //
   // Write the marker that indicates the frame type fitting to this scan.
@@ -330,6 +355,10 @@ public:
                    UBYTE lowbit,UBYTE highbit,
                    bool differential = false,bool residual = false,bool largerange = false);
   //
+  // Create a copy of the given scan that codes restart intervals
+  // within the given environment.
+  ACSequentialScan(class ACSequentialScan *master,class Environ *env);
+  //
   ~ACSequentialScan(void);
   // 
   // Fill in the tables for decoding and decoding parameters in general.
@@ -352,6 +381,13 @@ public:
   // MCUs in this row.
   virtual bool ParseMCU(void);  
   //
+  // Parse the remaining MCUs of the current row in one go.
+  virtual void ParseMCURow(void);
+  //
+  // Return an upper bound for the number of bytes a single call of
+  // ParseMCU() may read.
+  virtual ULONG MaxMCUSizeOf(void) const;
+  //
   // Write a single MCU in this scan.
   virtual bool WriteMCU(void);
   //
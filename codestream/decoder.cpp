@@ -52,13 +52,14 @@
 #include "codestream/tables.hpp"
 #include "marker/frame.hpp"
 #include "codestream/image.hpp"
-
+#include "interface/tagitem.hpp"
+#include "interface/parameters.hpp"
 ///
 
 /// Decoder::Decoder
 // Construct the decoder
 Decoder::Decoder(class Environ *env)
-  : JKeeper(env), m_pImage(NULL)
+  : JKeeper(env), m_pImage(NULL), m_bLegacyOnly(false), m_ucResolutionLevels(0)
 {
 }
 ///
@@ -96,6 +97,10 @@ class Image *Decoder::ParseHeaderIncremental(class ByteStream *io)
                 "stream does not contain a JPEG file, SOI marker missing");
 
     m_pImage  = new(m_pEnviron) class Image(m_pEnviron);
+    if (m_bLegacyOnly)
+      m_pImage->TablesOf()->IgnoreExtensions();
+    if (m_ucResolutionLevels)
+      m_pImage->LimitResolutionLevels(m_ucResolutionLevels);
     //
     // The checksum is not going over the headers but starts at the SOF.
     m_pImage->TablesOf()->ParseTablesIncrementalInit(false);
@@ -107,7 +112,14 @@ class Image *Decoder::ParseHeaderIncremental(class ByteStream *io)
 
 /// Decoder::ParseTags
 // Accept decoder options.
-void Decoder::ParseTags(const struct JPG_TagItem *)
+void Decoder::ParseTags(const struct JPG_TagItem *tags)
 {
+  // This only has an effect before the header is parsed.
+  m_bLegacyOnly = tags->GetTagData(JPGTAG_DECODER_LEGACY_ONLY,m_bLegacyOnly)?true:false;
+  LONG levels   = tags->GetTagData(JPGTAG_DECODER_RESOLUTIONLEVELS,m_ucResolutionLevels);
+  if (levels < 0 || levels > MAX_UBYTE)
+    JPG_THROW(OVERFLOW_PARAMETER,"Decoder::ParseTags",
+              "number of resolution levels to decode is out of range");
+  m_ucResolutionLevels = levels;
 }
 ///
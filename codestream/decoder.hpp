@@ -68,6 +68,13 @@ class Decoder : public JKeeper {
   // The image object
   class Image        *m_pImage;
   //
+  // Set if only the legacy codestream shall be decoded.
+  bool                m_bLegacyOnly;
+  //
+  // Number of resolution levels of a hierarchical image to decode,
+  // zero for all of them.
+  UBYTE               m_ucResolutionLevels;
+  //
 public:
   Decoder(class Environ *env);
   //
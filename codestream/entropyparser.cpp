@@ -53,6 +53,8 @@
 #include "marker/frame.hpp"
 #include "codestream/tables.hpp"
 #include "codestream/entropyparser.hpp"
+#include "coding/quantizedrow.hpp"
+#include "marker/component.hpp"
 #include "io/bytestream.hpp"
 ///
 
@@ -81,6 +83,27 @@ EntropyParser::EntropyParser(class Frame *frame,class Scan *scan)
 }
 ///
 
+/// EntropyParser::EntropyParser
+// Create a parser for the same scan as the given parser, but allocated in
+// a different environment.
+EntropyParser::EntropyParser(class EntropyParser *master,class Environ *env)
+  : JKeeper(env), m_pScan(master->m_pScan), m_pFrame(master->m_pFrame)
+{
+  m_ucCount = master->m_ucCount;
+
+  for(UBYTE i = 0;i < m_ucCount && i < 4;i++) {
+    m_pComponent[i] = master->m_pComponent[i];
+  }
+
+  m_ulRestartInterval   = master->m_ulRestartInterval;
+  m_usNextRestartMarker = 0xffd0;
+  m_ulMCUsToGo          = m_ulRestartInterval;
+  m_bSegmentIsValid     = true;
+  m_bScanForDNL         = false;
+  m_bDNLFound           = false;
+}
+///
+
 /// EntropyParser::StartWriteScan
 // Write the marker to the stream.
 void EntropyParser::StartWriteScan(class ByteStream *,class Checksum *,class BufferCtrl *)
@@ -257,3 +280,135 @@ UBYTE EntropyParser::FractionalColorBitsOf(void) const
   return m_pFrame->TablesOf()->FractionalColorBitsOf(m_pFrame->DepthOf(),m_pFrame->isDCTBased());
 }
 ///
+
+/// EntropyParser::MCUWidthOf
+// Return the number of blocks a MCU of the given component in the scan
+// covers horizontally.
+UBYTE EntropyParser::MCUWidthOf(UBYTE c) const
+{
+  return (m_ucCount > 1)?(m_pComponent[c]->MCUWidthOf()):(1);
+}
+///
+
+/// EntropyParser::BlocksPerMCU
+// Return the number of blocks in a MCU of a block based scan.
+ULONG EntropyParser::BlocksPerMCU(void) const
+{
+  ULONG blocks = 0;
+
+  for(UBYTE c = 0;c < m_ucCount;c++) {
+    if (m_ucCount > 1) {
+      blocks += m_pComponent[c]->MCUWidthOf() * m_pComponent[c]->MCUHeightOf();
+    } else {
+      blocks++;
+    }
+  }
+
+  return blocks;
+}
+///
+
+/// EntropyParser::MCUsPerRow
+// Return the number of MCUs in a row of a block based scan, given the
+// quantized rows of the components in the scan.
+ULONG EntropyParser::MCUsPerRow(class QuantizedRow *const *rows) const
+{
+  ULONG mcus = 0;
+
+  for(UBYTE c = 0;c < m_ucCount;c++) {
+    UBYTE mcux = MCUWidthOf(c);
+    ULONG n    = (rows[c]->WidthOf() + mcux - 1) / mcux;
+    if (c == 0 || n < mcus)
+      mcus = n;
+  }
+
+  return mcus;
+}
+///
+
+/// EntropyParser::SkipMCU
+// Advance the block positions x of the components by one MCU without
+// coding anything. Returns false if this was the last MCU in the row.
+bool EntropyParser::SkipMCU(class QuantizedRow *const *rows,ULONG *x) const
+{
+  bool more = true;
+
+  for(UBYTE c = 0;c < m_ucCount;c++) {
+    x[c] += MCUWidthOf(c);
+    if (x[c] >= rows[c]->WidthOf())
+      more = false;
+  }
+
+  return more;
+}
+///
+
+/// EntropyParser::NextMCURow
+// Advance the quantized rows of the components to the next MCU row
+// and reset the block positions to the start of the row.
+void EntropyParser::NextMCURow(class QuantizedRow **rows,ULONG *x) const
+{
+  for(UBYTE c = 0;c < m_ucCount;c++) {
+    UBYTE mcuy = (m_ucCount > 1)?(m_pComponent[c]->MCUHeightOf()):(1);
+    while(mcuy && rows[c]) {
+      rows[c] = rows[c]->NextOf();
+      mcuy--;
+    }
+    x[c] = 0;
+  }
+}
+///
+
+/// EntropyParser::BeginReadInterval
+// Check whether the next MCU starts a restart interval that can be parsed
+// independently, i.e. whether the expected restart marker is next in the
+// stream. If so, remove the marker and return true.
+bool EntropyParser::BeginReadInterval(class ByteStream *io)
+{
+  LONG dt;
+  
+  if (m_ulRestartInterval == 0 || m_ulMCUsToGo > 0 || m_bScanForDNL)
+    return false;
+
+  dt = io->PeekWord();
+  while(dt == 0xffff) {
+    // Found a filler byte. Skip over and try again.
+    io->Get();
+    dt = io->PeekWord();
+  }
+
+  if (dt != m_usNextRestartMarker)
+    return false;
+
+  io->GetWord();
+  m_usNextRestartMarker = (m_usNextRestartMarker + 1) & 0xfff7;
+  m_ulMCUsToGo          = m_ulRestartInterval;
+  m_bSegmentIsValid     = true;
+
+  return true;
+}
+///
+
+/// EntropyParser::ReadInterval
+// Copy the entropy coded segment up to the next marker into the target
+// stream, and mark the restart interval as consumed.
+void EntropyParser::ReadInterval(class ByteStream *io,class ByteStream *target)
+{
+  LONG dt;
+
+  while((dt = io->Get()) != ByteStream::EOF) {
+    if (dt == 0xff) {
+      // Either a stuffed zero or the marker that ends the segment.
+      io->LastUnDo();
+      if (io->PeekWord() != 0xff00)
+        break;
+      io->GetWord();
+      target->PutWord(0xff00);
+    } else {
+      target->Put(dt);
+    }
+  }
+
+  m_ulMCUsToGo = 0;
+}
+///
@@ -66,12 +66,18 @@ class BitmapCtrl;
 class LineAdapter;
 class BufferCtrl;
 class Checksum;
+class QuantizedRow;
+class IntervalScheduler;
 ///
 
 /// class EntropyParser
 // This class represents the interface for parsing the
 // entropy coded data in JPEG as part of a single scan.
 class EntropyParser : public JKeeper {
+  //
+  // The scheduler for parallel restart intervals drives
+  // the interval related functions below.
+  friend class IntervalScheduler;
   // 
   // The restart interval in MCUs
   ULONG                 m_ulRestartInterval;
@@ -124,6 +130,11 @@ protected:
   // Create a new parser.
   EntropyParser(class Frame *frame,class Scan *scan);
   //
+  // Create a parser for the same scan as the given parser, but allocated in
+  // a different environment. This is used to code restart intervals on
+  // worker threads.
+  EntropyParser(class EntropyParser *master,class Environ *env);
+  //
   // Return the number of fractional bits due to color
   // transformation.
   UBYTE FractionalColorBitsOf(void) const;
@@ -170,6 +181,64 @@ protected:
   virtual void PostImageHeight(ULONG)
   { }
   //
+  // Return the restart interval in MCUs, zero if there is none.
+  ULONG RestartIntervalOf(void) const
+  {
+    return m_ulRestartInterval;
+  }
+  //
+  // Return the number of blocks a MCU of the given component in the scan
+  // covers horizontally.
+  UBYTE MCUWidthOf(UBYTE c) const;
+  //
+  // Return the number of blocks in a MCU of a block based scan.
+  ULONG BlocksPerMCU(void) const;
+  //
+  // Return the number of MCUs in a row of a block based scan, given the
+  // quantized rows of the components in the scan.
+  ULONG MCUsPerRow(class QuantizedRow *const *rows) const;
+  //
+  // Advance the block positions x of the components by one MCU without
+  // coding anything. Returns false if this was the last MCU in the row.
+  bool SkipMCU(class QuantizedRow *const *rows,ULONG *x) const;
+  //
+  // Advance the quantized rows of the components to the next MCU row
+  // and reset the block positions to the start of the row.
+  void NextMCURow(class QuantizedRow **rows,ULONG *x) const;
+  //
+  // Check whether the next MCU starts a restart interval that can be parsed
+  // independently, i.e. whether the expected restart marker is next in the
+  // stream. If so, remove the marker and return true. Otherwise, leave
+  // the stream alone such that the regular parser can resynchronize.
+  bool BeginReadInterval(class ByteStream *io);
+  //
+  // Copy the entropy coded segment up to the next marker into the target
+  // stream, and mark the restart interval as consumed.
+  void ReadInterval(class ByteStream *io,class ByteStream *target);
+  //
+  // Create a parser for this scan that codes restart intervals on
+  // a worker thread, allocated from the given environment. Returns NULL
+  // if the scan does not support this.
+  virtual class EntropyParser *CreateIntervalParser(class Environ *)
+  {
+    return NULL;
+  }
+  //
+  // Encode the given number of MCUs as a single restart interval into
+  // the target stream, starting at the given rows and block positions.
+  // The positions are advanced accordingly.
+  virtual void WriteInterval(class ByteStream *,class QuantizedRow **,ULONG *,ULONG)
+  {
+    assert(false);
+  }
+  //
+  // Decode the given number of MCUs as a single restart interval from
+  // the source stream, starting at the given rows and block positions.
+  virtual void ParseInterval(class ByteStream *,class QuantizedRow **,ULONG *,ULONG)
+  {
+    assert(false);
+  }
+  //
   //
 public:
   //
@@ -194,6 +263,15 @@ public:
     return m_ucCount;
   }
   //
+  // Return an upper bound for the number of bytes a single call of
+  // ParseMCU() may read from the stream, or zero if there is none and
+  // the complete entropy coded segment has to be available. This is
+  // used to suspend decoding on a push-style input.
+  virtual ULONG MaxMCUSizeOf(void) const
+  {
+    return 0;
+  }
+  //
   // Parse the marker contents.
   virtual void StartParseScan(class ByteStream *io,class Checksum *chk,class BufferCtrl *ctrl) = 0;
   //
@@ -216,6 +294,14 @@ public:
   // Parse a single MCU in this scan.
   virtual bool ParseMCU(void) = 0;
   //
+  // Parse the remaining MCUs of the current MCU row. Parsers that
+  // can decode a row faster than MCU by MCU override this.
+  virtual void ParseMCURow(void)
+  {
+    while(ParseMCU()) {
+    }
+  }
+  //
   // Write a single MCU in this scan.
   virtual bool WriteMCU(void) = 0; 
   //
@@ -64,6 +64,10 @@
 #include "control/residualbuffer.hpp"
 #include "control/hierarchicalbitmaprequester.hpp"
 #include "boxes/checksumbox.hpp"
+#include "boxes/databox.hpp"
+#include "control/blockbitmaprequester.hpp"
+#include "marker/scan.hpp"
+#include "tools/workerpool.hpp"
 ///
 
 /// Forwards
@@ -75,6 +79,87 @@ class BitmapCtrl;
 class Frame;
 ///
 
+/// class Image::ResidualJob
+// Decodes the scans of the residual codestream on a worker thread.
+class Image::ResidualJob : public WorkerPool::Job {
+  //
+  // The residual frame, with its tables and frame header
+  // already parsed.
+  class Frame      *m_pFrame;
+  //
+  // The residual codestream.
+  class ByteStream *m_pStream;
+  //
+public:
+  ResidualJob(class Frame *frame,class ByteStream *stream)
+    : m_pFrame(frame), m_pStream(stream)
+  { }
+  //
+  virtual ~ResidualJob(void)
+  { }
+  //
+  // Return the residual frame.
+  class Frame *FrameOf(void) const
+  {
+    return m_pFrame;
+  }
+  //
+  // Parse scans until the frame ends or something unusual
+  // shows up that needs the main thread.
+  virtual void Run(class Environ *env);
+};
+///
+
+/// class Image::ScanJob
+// Entropy decodes a single scan of a hierarchical image on a worker thread.
+class Image::ScanJob : public WorkerPool::Job {
+  //
+  // The next job in the list of the image.
+  class ScanJob    *m_pNextJob;
+  //
+  // The frame this scan belongs to.
+  class Frame      *m_pFrame;
+  //
+  // The scan, started on the stream below.
+  class Scan       *m_pScan;
+  //
+  // A copy of the entropy coded data of the scan, and the stream
+  // reading it back.
+  class MemoryStream *m_pData;
+  class MemoryStream *m_pStream;
+  //
+public:
+  ScanJob(class Frame *frame,class Scan *scan)
+    : m_pNextJob(NULL), m_pFrame(frame), m_pScan(scan), m_pData(NULL), m_pStream(NULL)
+  { }
+  //
+  virtual ~ScanJob(void)
+  {
+    delete m_pStream;
+    delete m_pData;
+  }
+  //
+  // The next job of the image.
+  class ScanJob *&NextOf(void)
+  {
+    return m_pNextJob;
+  }
+  //
+  // Return the frame of this scan.
+  class Frame *FrameOf(void) const
+  {
+    return m_pFrame;
+  }
+  //
+  // Copy the entropy coded segment up to the next marker off the input
+  // stream, and return a stream that reads it back.
+  class ByteStream *CollectData(class Environ *env,class ByteStream *io);
+  //
+  // Decode all MCU rows of the scan.
+  virtual void Run(class Environ *env);
+};
+///
+
 /// Image::Image
 // Create an image
 Image::Image(class Environ *env)
@@ -83,7 +168,8 @@ Image::Image(class Environ *env)
     m_pLast(NULL), m_pCurrent(NULL), m_pImageBuffer(NULL), 
     m_pResidualImage(NULL), m_pChecksum(NULL), 
     m_pLegacyStream(NULL), m_pAdapter(NULL), m_pBoxList(NULL),
-    m_bReceivedFrameHeader(false)
+    m_bReceivedFrameHeader(false), m_pResidualJob(NULL),
+    m_pScanJobs(NULL), m_bConcurrentScans(false), m_ucResolutionLevels(0)
 {
 }
 ///
@@ -93,6 +179,10 @@ Image::~Image(void)
 {
   class Frame *frame;
 
+  // The residual decoder must not work on anything released below.
+  JoinResidualDecoder(false);
+  JoinScanDecoders(NULL,false);
+
   delete m_pAlphaChannel;
 
   delete m_pResidual;
@@ -674,6 +764,9 @@ class Frame *Image::StartParseFrame(class ByteStream *io)
       //
       // Is now there.
       m_bReceivedFrameHeader = true;
+      //
+      // The residual can be decoded while the legacy codestream is parsed.
+      LaunchResidualDecoder();
     }
   }
   //
@@ -1090,12 +1183,19 @@ void Image::ReconstructRegion(class BitMapHook *bmh,const struct RectangleReques
   bool doalpha = m_pAlphaChannel && rr->rr_bIncludeAlpha;
   RectAngle<LONG> region;
   
+  //
+  // The residual must be complete before it can be merged, and all
+  // levels of a hierarchical image before they can be.
+  JoinResidualDecoder(true);
+  JoinScanDecoders(NULL,true);
   
   if (m_pDimensions == NULL || m_pImageBuffer == NULL)
     JPG_THROW(OBJECT_DOESNT_EXIST,"Image::ReconstructRegion","no image loaded that could be reconstructed");
   if (doalpha) {
     if (m_pAlphaChannel->m_pDimensions == NULL || m_pAlphaChannel->m_pImageBuffer == NULL)
       JPG_THROW(OBJECT_DOESNT_EXIST,"Image::ReconstructRegion","alpha channel not loaded, or not yet available");
+    if (rr->rr_bIncremental)
+      JPG_THROW(NOT_IMPLEMENTED,"Image::ReconstructRegion","incremental display is not available for the alpha channel");
   }
   
   region = rr->rr_Request;
@@ -1109,6 +1209,10 @@ void Image::ReconstructRegion(class BitMapHook *bmh,const struct RectangleReques
   m_pImageBuffer->CropDecodingRegion(region,rr);
   if (doalpha)
     m_pAlphaChannel->m_pImageBuffer->CropDecodingRegion(region,&rralpha);
+  //
+  // Nothing changed since the last incremental display?
+  if (rr->rr_bIncremental && region.IsEmpty())
+    return;
   m_pImageBuffer->RequestUserDataForDecoding(bmh,region,rr,false);
   if (doalpha)
     m_pAlphaChannel->m_pImageBuffer->RequestUserDataForDecoding(bmh,region,&rralpha,true);
@@ -1144,6 +1248,18 @@ void Image::EncodeRegion(class BitMapHook *bmh,const struct RectangleRequest *rr
   region.ra_MaxX = MAX_LONG;
   region.ra_MaxY = MAX_LONG; 
 
+  //
+  // Planar input bypasses the bitmap hook.
+  if (rr->rr_ppucPlanes) {
+    if (m_pAlphaChannel)
+      JPG_THROW(NOT_IMPLEMENTED,"Image::EncodeRegion","planar input is not available for images with an alpha channel");
+    m_pImageBuffer->CropEncodingRegion(region,rr);
+    if (rr->rr_Request.ra_MaxY < region.ra_MaxY)
+      region.ra_MaxY = rr->rr_Request.ra_MaxY;
+    m_pImageBuffer->EncodePlanes(region,rr);
+    return;
+  }
+
   // Fiddle a request for the alpha channel if we have that.
   if (doalpha) {
     rralpha.rr_usFirstComponent = 0; // There is only one component for alpha
@@ -1177,6 +1293,10 @@ ULONG Image::BufferedLines(const struct RectangleRequest *rr) const
   if (m_pImageBuffer == NULL)
     return 0;
 
+  // Nothing is final while the residual is decoded in the background.
+  if (m_pResidualJob || m_pScanJobs)
+    return 0;
+
   return m_pImageBuffer->BufferedLines(rr);
 }
 ///
@@ -1334,6 +1454,264 @@ class Frame *Image::ParseResidualStream(class DataBox *box)
 }
 ///
 
+/// Image::ResidualJob::Run
+// Parse scans until the frame ends or something unusual
+// shows up that needs the main thread.
+void Image::ResidualJob::Run(class Environ *)
+{
+  LONG marker;
+  //
+  // This follows the decoder loop in JPEG::ReadInternal, except that
+  // the worker stops in front of the frame trailer. Parsing the trailer
+  // may require refinement data the main thread is still collecting,
+  // and the main thread continues from there.
+  do {
+    class Scan *scan;
+    //
+    do {
+      scan = m_pFrame->StartParseScan(m_pStream,NULL);
+      if (scan == NULL && m_pFrame->isEndOfFrame())
+        return;
+    } while(scan == NULL);
+    //
+    while(scan->StartMCURow()) {
+      scan->ParseMCURow();
+    }
+    m_pFrame->EndParseScan();
+    //
+    // Only continue with tables and scan headers, everything else
+    // is for the frame trailer.
+    marker = m_pStream->PeekWord();
+  } while(marker == 0xffda || marker == 0xffc4 || marker == 0xffdb ||
+          marker == 0xffdd || marker == 0xffcc || marker == 0xfffe);
+}
+///
+
+/// Image::LaunchResidualDecoder
+// If worker threads are available, start decoding the residual codestream
+// in the background. This requires that the residual is completely
+// contained in the tables in front of the first scan.
+void Image::LaunchResidualDecoder(void)
+{
+#ifdef HAVE_WORKER_THREADS
+  class DataBox *box = m_pTables->ResidualDataOf();
+  class WorkerPool *pool;
+  class Frame *frame;
+  //
+  // Only for the legacy frame of a non-hierarchical image, and only if the
+  // residual is merged into a block buffer. Everything else is left to the
+  // regular decoder which also reports the errors.
+  if (box == NULL || !box->isComplete() || m_pResidual || m_pResidualJob)
+    return;
+  if (m_pParent || m_pMaster || m_pSmallest || m_pCurrent != m_pDimensions)
+    return;
+  if (m_pDimensions->HeightOf() == 0)
+    return;
+  if (dynamic_cast<class BlockBitmapRequester *>(m_pImageBuffer) == NULL)
+    return;
+  if ((pool = m_pEnviron->WorkerPoolOf()) == NULL)
+    return;
+  //
+  // Parse the residual headers now, the regular decoder would do this
+  // at the EOI of the legacy codestream. Tables must be attached to
+  // here, workers cannot do this.
+  frame = ParseResidualStream(box);
+  m_pEnviron->TableCacheOf();
+  //
+  if (frame) {
+    m_pResidualJob = new(m_pEnviron) class ResidualJob(frame,box->DecoderBufferOf());
+    m_pEnviron->BeginConcurrentJob();
+    pool->Launch(m_pResidualJob);
+  }
+#endif
+}
+///
+
+/// Image::JoinResidualDecoder
+// Wait for the background decoder of the residual codestream, and
+// return the residual frame it decoded.
+class Frame *Image::JoinResidualDecoder(bool rethrow)
+{
+  class ResidualJob *job = m_pResidualJob;
+  class Frame *frame;
+  //
+  if (job == NULL)
+    return NULL;
+  //
+  m_pResidualJob = NULL;
+  JPG_TRY {
+    class WorkerPool *pool = m_pEnviron->WorkerPoolOf();
+    //
+    assert(pool);
+    pool->Join(job,rethrow);
+  } JPG_CATCH {
+    m_pEnviron->EndConcurrentJob();
+    delete job;
+    JPG_RETHROW;
+  } JPG_ENDTRY;
+  //
+  m_pEnviron->EndConcurrentJob();
+  frame = job->FrameOf();
+  delete job;
+  //
+  return frame;
+}
+///
+
+/// Image::ScanJob::CollectData
+// Copy the entropy coded segment up to the next marker off the input
+// stream, and return a stream that reads it back.
+class ByteStream *Image::ScanJob::CollectData(class Environ *env,class ByteStream *io)
+{
+  LONG dt;
+  //
+  assert(m_pData == NULL && m_pStream == NULL);
+  m_pData = new(env) class MemoryStream(env);
+  //
+  // This works like EntropyParser::ReadInterval, except that the
+  // scan runs over all of the segment.
+  while((dt = io->Get()) != ByteStream::EOF) {
+    if (dt == 0xff) {
+      // Either a stuffed zero or the marker that ends the scan.
+      io->LastUnDo();
+      if (io->PeekWord() != 0xff00)
+        break;
+      io->GetWord();
+      m_pData->PutWord(0xff00);
+    } else {
+      m_pData->Put(dt);
+    }
+  }
+  //
+  m_pStream = new(env) class MemoryStream(env,m_pData,JPGFLAG_OFFSET_BEGINNING);
+  return m_pStream;
+}
+///
+
+/// Image::ScanJob::Run
+// Decode all MCU rows of the scan.
+void Image::ScanJob::Run(class Environ *)
+{
+  while(m_pScan->StartMCURow()) {
+    m_pScan->ParseMCURow();
+  }
+}
+///
+
+/// Image::LaunchScanDecoder
+// If possible, entropy decode the given scan, whose header has just been
+// parsed off, on a worker thread. Scans of differential frames do not
+// depend on each other, only the final merge of the levels does. This
+// copies the entropy coded data of the scan off the stream and returns
+// true if the scan was launched, in which case the stream continues
+// behind the scan. Otherwise, the caller has to decode the scan.
+bool Image::LaunchScanDecoder(class Frame *frame,class Scan *scan,
+                              class BufferCtrl *ctrl,class ByteStream *io)
+{
+#ifdef HAVE_WORKER_THREADS
+  class WorkerPool *pool;
+  class ScanJob *job,**last;
+  //
+  // Only for the main image of a hierarchical process.
+  if (!m_bConcurrentScans || m_pSmallest == NULL || m_pParent || m_pMaster)
+    return false;
+  //
+  // The data of the scan is copied up to the next marker, which requires
+  // that there are no restart markers and no DNL marker in it. Also, the
+  // scans that are split into restart intervals run on the pool already.
+  if (m_pTables->RestartIntervalOf() || frame->HeightOf() == 0)
+    return false;
+  //
+  // The Huffman decoders of a scan are owned by the tables, and would be
+  // released if the tables of the next frame redefine them. The
+  // arithmetic decoder copies what it needs on starting the scan.
+  switch(frame->ScanTypeOf()) {
+  case ACSequential:
+  case ACProgressive:
+  case ACLossless:
+  case ACDifferentialSequential:
+  case ACDifferentialProgressive:
+  case ACDifferentialLossless:
+    break;
+  default:
+    return false;
+  }
+  //
+  if ((pool = m_pEnviron->WorkerPoolOf()) == NULL)
+    return false;
+  //
+  // Scans of the same frame refine the same buffer, hence the previous
+  // one must be done before the next may start.
+  JoinScanDecoders(frame,true);
+  //
+  job = new(m_pEnviron) class ScanJob(frame,scan);
+  JPG_TRY {
+    scan->StartParseScan(job->CollectData(m_pEnviron,io),NULL,ctrl);
+  } JPG_CATCH {
+    delete job;
+    JPG_RETHROW;
+  } JPG_ENDTRY;
+  //
+  // Keep the jobs in the order they were started.
+  for(last = &m_pScanJobs;*last;last = &((*last)->NextOf())) {
+  }
+  *last = job;
+  //
+  m_pEnviron->BeginConcurrentJob();
+  pool->Launch(job);
+  //
+  return true;
+#else
+  NOREF(frame);
+  NOREF(scan);
+  NOREF(ctrl);
+  NOREF(io);
+  return false;
+#endif
+}
+///
+
+/// Image::JoinScanDecoder
+// Wait for a single background scan decoder that has already been
+// removed from the list, and release it.
+void Image::JoinScanDecoder(class ScanJob *job,bool rethrow)
+{
+  JPG_TRY {
+    class WorkerPool *pool = m_pEnviron->WorkerPoolOf();
+    //
+    assert(pool);
+    pool->Join(job,rethrow);
+  } JPG_CATCH {
+    m_pEnviron->EndConcurrentJob();
+    delete job;
+    // Nothing may continue to run on a failed image.
+    JoinScanDecoders(NULL,false);
+    JPG_RETHROW;
+  } JPG_ENDTRY;
+  //
+  m_pEnviron->EndConcurrentJob();
+  delete job;
+}
+///
+
+/// Image::JoinScanDecoders
+// Wait for the background decoders of the scans of the given frame,
+// or all of them if the frame is NULL.
+void Image::JoinScanDecoders(class Frame *frame,bool rethrow)
+{
+  class ScanJob *job,**last = &m_pScanJobs;
+  //
+  while((job = *last)) {
+    if (frame && job->FrameOf() != frame) {
+      last = &(job->NextOf());
+    } else {
+      *last = job->NextOf();
+      JoinScanDecoder(job,rethrow);
+    }
+  }
+}
+///
+
 /// Image::ParseAlphaChannel
 // Parse off the alpha channel. Returns the alpha frame if it is exists, or NULL
 // in case it does not or there are no more scans in this frame.
@@ -1402,6 +1780,37 @@ class Frame *Image::ParseAlphaChannel(class DataBox *box)
 }
 ///
 
+/// Image::StopAtResolutionLevel
+// Check whether decoding of a hierarchical image reached the requested
+// resolution level. If so, make this level the full image and return true.
+bool Image::StopAtResolutionLevel(void)
+{
+#if ACCUSOFT_CODE
+  class Frame *frame;
+  UBYTE levels = 0;
+  
+  if (m_ucResolutionLevels == 0 || m_pSmallest == NULL || m_pImageBuffer == NULL)
+    return false;
+  //
+  // Count the frames parsed so far, each is one level.
+  for(frame = m_pSmallest;frame;frame = frame->NextOf()) {
+    levels++;
+  }
+  //
+  // If this is already the full image, there is nothing to truncate.
+  if (levels < m_ucResolutionLevels || m_pLast->WidthOf() == m_pDimensions->WidthOf())
+    return false;
+  //
+  // The remaining differential frames are never parsed, and the
+  // largest scale built so far is delivered as the image.
+  ((class HierarchicalBitmapRequester *)m_pImageBuffer)->TruncateToLargestScale();
+  return true;
+#else
+  return false;
+#endif
+}
+///
+
 /// Image::ParseTrailer
 // Parse off the EOI marker at the end of the image. Return false
 // if there are no more frames in the file, true otherwise.
@@ -1411,6 +1820,10 @@ bool Image::ParseTrailer(class ByteStream *io)
   // First, note that the frame header is required again now.
   m_bReceivedFrameHeader = false;
   //
+  // Stop here if only a smaller resolution level is requested.
+  if (StopAtResolutionLevel())
+    return false;
+  //
   do {
     LONG marker = io->PeekWord();
     
@@ -1421,6 +1834,21 @@ bool Image::ParseTrailer(class ByteStream *io)
       // Is there a residual scan left that hasn't been
       // parsed off yet?
       if (box) {
+        // If the residual was decoded in the background, the worker
+        // stopped in front of the frame trailer. Continue from there
+        // as the regular decoder would.
+        if (m_pResidualJob) {
+          class Frame *frame    = JoinResidualDecoder(true);
+          class ByteStream *sio = box->DecoderBufferOf();
+          //
+          if (sio->PeekWord() == ByteStream::EOF)
+            sio = io;
+          if (frame->ParseTrailer(sio)) {
+            m_pCurrent             = frame;
+            m_bReceivedFrameHeader = true;
+            return true;
+          }
+        }
         // If there are more scans in the residual, continue there.
         if ((m_pCurrent = ParseResidualStream(box))) {
           // This has been parsed off from the boxed stream, hence, do not
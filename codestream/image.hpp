@@ -144,6 +144,28 @@ class Image : public JKeeper {
   // whether there is another frame.
   bool                   m_bReceivedFrameHeader;
   //
+  // The job decoding the residual codestream in the background while
+  // the legacy codestream is parsed, if any.
+  class ResidualJob;
+  class ResidualJob     *m_pResidualJob;
+  //
+  // The jobs entropy decoding scans of a hierarchical image in the
+  // background, linked by their frames in the order they were started.
+  class ScanJob;
+  class ScanJob         *m_pScanJobs;
+  //
+  // Set if the caller allows to decode scans in the background, i.e.
+  // does not need to stop within scans and the input cannot block.
+  bool                   m_bConcurrentScans;
+  //
+  // Number of resolution levels of a hierarchical image to decode, counting
+  // from the smallest frame. Zero if all frames are decoded.
+  UBYTE                  m_ucResolutionLevels;
+  //
+  // Check whether decoding of a hierarchical image reached the requested
+  // resolution level. If so, make this level the full image and return true.
+  bool StopAtResolutionLevel(void);
+  //
   // Create the buffer providing an access path to the residuals, if available.
   // This works only for block based modes, line based modes do not create 
   // residuals.
@@ -157,6 +179,14 @@ class Image : public JKeeper {
   // in case it does not or there are no more scans in this frame.
   class Frame *ParseAlphaChannel(class DataBox *box);
   //
+  // Wait for the background decoder of the residual codestream, and
+  // return the residual frame it decoded.
+  class Frame *JoinResidualDecoder(bool rethrow);
+  //
+  // Wait for a single background scan decoder that has already been
+  // removed from the list, and release it.
+  void JoinScanDecoder(class ScanJob *job,bool rethrow);
+  //
   // Convert a frame marker to a scan type, return it.
   ScanType FrameMarkerToScanType(LONG marker) const;
   //
@@ -202,6 +232,14 @@ public:
   // Return the side information of this image or create it.
   class Tables *TablesOf(void);
   //
+  // Decode only the given number of resolution levels of a hierarchical
+  // image, starting from the smallest frame. This must be set before
+  // the frame headers are parsed.
+  void LimitResolutionLevels(UBYTE levels)
+  {
+    m_ucResolutionLevels = levels;
+  }
+  //
   // Return an indicator whether this is possibly a hierarchical scan
   bool isHierarchical(void) const
   {
@@ -323,6 +361,32 @@ public:
   // in the tables is needed.
   class Checksum *CreateChecksumWhenNeeded(class Checksum *chk);
   //
+  // If worker threads are available, start decoding the residual codestream
+  // in the background. This requires that the residual is completely
+  // contained in the tables in front of the first scan.
+  void LaunchResidualDecoder(void);
+  //
+  // Allow or forbid entropy decoding scans of hierarchical images in the
+  // background. This requires that the caller neither stops within
+  // scans nor reads from a stream that may block.
+  void AllowConcurrentScans(bool allow)
+  {
+    m_bConcurrentScans = allow;
+  }
+  //
+  // If possible, entropy decode the given scan, whose header has just been
+  // parsed off, on a worker thread. Scans of differential frames do not
+  // depend on each other, only the final merge of the levels does. This
+  // copies the entropy coded data of the scan off the stream and returns
+  // true if the scan was launched, in which case the stream continues
+  // behind the scan. Otherwise, the caller has to decode the scan.
+  bool LaunchScanDecoder(class Frame *frame,class Scan *scan,
+                         class BufferCtrl *ctrl,class ByteStream *io);
+  //
+  // Wait for the background decoders of the scans of the given frame,
+  // or all of them if the frame is NULL.
+  void JoinScanDecoders(class Frame *frame,bool rethrow);
+  //
   // Write the header and header tables up to the SOS marker.
   void WriteHeader(class ByteStream *io) const;
   //
@@ -0,0 +1,347 @@
+/*************************************************************************
+
+    This project implements a complete(!) JPEG (Recommendation ITU-T
+    T.81 | ISO/IEC 10918-1) codec, plus a library that can be used to
+    encode and decode JPEG streams. 
+    It also implements ISO/IEC 18477 aka JPEG XT which is an extension
+    towards intermediate, high-dynamic-range lossy and lossless coding
+    of JPEG. In specific, it supports ISO/IEC 18477-3/-6/-7/-8 encoding.
+
+    Note that only Profiles C and D of ISO/IEC 18477-7 are supported
+    here. Check the JPEG XT reference software for a full implementation
+    of ISO/IEC 18477-7.
+
+    Copyright (C) 2012-2018 Thomas Richter, University of Stuttgart and
+    Accusoft. (C) 2019-2020 Thomas Richter, Fraunhofer IIS.
+
+    This program is available under two licenses, GPLv3 and the ITU
+    Software licence Annex A Option 2, RAND conditions.
+
+    For the full text of the GPU license option, see README.license.gpl.
+    For the full text of the ITU license option, see README.license.itu.
+    
+    You may freely select between these two options.
+
+    For the GPL option, please note the following:
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+/*
+**
+** This class schedules the restart intervals of a scan on the worker
+** threads of the environment, and stitches the results back together
+** in stream order.
+**
+** $Id$
+**
+*/
+
+/// Includes
+#include "codestream/intervalscheduler.hpp"
+#include "codestream/entropyparser.hpp"
+#include "coding/quantizedrow.hpp"
+#include "io/bytestream.hpp"
+#include "io/memorystream.hpp"
+#include "tools/checksum.hpp"
+#include "std/assert.hpp"
+///
+
+/// IntervalScheduler::EncodeJob::~EncodeJob
+IntervalScheduler::EncodeJob::~EncodeJob(void)
+{
+  // The stream was allocated by the worker, but this is fine
+  // as long as the pool exists.
+  delete m_pStream;
+}
+///
+
+/// IntervalScheduler::EncodeJob::Run
+// Encode the intervals of this job into a memory stream.
+void IntervalScheduler::EncodeJob::Run(class Environ *env)
+{
+  class Environ *m_pEnviron   = env; // for the macros
+  class EntropyParser *parser = m_pParser->CreateIntervalParser(env);
+  ULONG mcus                  = m_ulMCUs;
+  ULONG i                     = 0;
+
+  assert(parser);
+  
+  JPG_TRY {
+    m_pStream = new(env) class MemoryStream(env);
+    while(mcus) {
+      ULONG count = (mcus > m_ulInterval)?(m_ulInterval):(mcus);
+      UQUAD start = m_pStream->FilePosition();
+      parser->WriteInterval(m_pStream,m_pRows,m_ulX,count);
+      m_pulSizes[i++] = ULONG(m_pStream->FilePosition() - start);
+      mcus -= count;
+    }
+  } JPG_CATCH {
+    delete parser;
+    JPG_RETHROW;
+  } JPG_ENDTRY;
+
+  delete parser;
+}
+///
+
+/// IntervalScheduler::DecodeJob::Run
+// Decode the segments of this job.
+void IntervalScheduler::DecodeJob::Run(class Environ *env)
+{
+  class Environ *m_pEnviron   = env; // for the macros
+  class EntropyParser *parser = m_pParser->CreateIntervalParser(env);
+  
+  assert(parser);
+  
+  JPG_TRY {
+    for(ULONG i = 0;i < m_ulCount;i++) {
+      class MemoryStream in(env,m_ppSegments[i],JPGFLAG_OFFSET_BEGINNING);
+      parser->ParseInterval(&in,m_pRows,m_ulX,m_ulInterval);
+    }
+  } JPG_CATCH {
+    delete parser;
+    JPG_RETHROW;
+  } JPG_ENDTRY;
+
+  delete parser;
+}
+///
+
+/// IntervalScheduler::IntervalScheduler
+IntervalScheduler::IntervalScheduler(class EntropyParser *parser,class WorkerPool *pool)
+  : JKeeper(parser->EnvironOf()), m_pParser(parser), m_pPool(pool), 
+    m_ulInterval(parser->RestartIntervalOf()), m_pIO(NULL), m_pChk(NULL),
+    m_pCurrent(NULL), m_pFirst(NULL), m_pLast(NULL), m_ulOutstanding(0),
+    m_ulJobMCUs(0), m_ulWritten(0),
+    m_ppSegments(NULL), m_ulSegments(0), m_pDecodeJobs(NULL)
+{
+  assert(m_ulInterval > 0);
+}
+///
+
+/// IntervalScheduler::~IntervalScheduler
+IntervalScheduler::~IntervalScheduler(void)
+{
+  class EncodeJob *job;
+  
+  // Nothing may run anymore when the buffers go away.
+  m_pPool->Wait(false);
+
+  if (m_pCurrent) {
+    m_pEnviron->FreeMem(m_pCurrent->m_pulSizes,sizeof(ULONG) * (m_ulJobMCUs / m_ulInterval));
+    delete m_pCurrent;
+  }
+
+  while((job = m_pFirst)) {
+    m_pFirst = job->m_pNextJob;
+    m_pEnviron->FreeMem(job->m_pulSizes,sizeof(ULONG) * (m_ulJobMCUs / m_ulInterval));
+    delete job;
+  }
+
+  if (m_ppSegments) {
+    for(ULONG i = 0;i < m_ulSegments;i++) {
+      delete m_ppSegments[i];
+    }
+    m_pEnviron->FreeMem(m_ppSegments,sizeof(class MemoryStream *) * m_ulSegments);
+  }
+
+  delete[] m_pDecodeJobs;
+}
+///
+
+/// IntervalScheduler::StartWrite
+// Start encoding a scan into the given stream.
+void IntervalScheduler::StartWrite(class ByteStream *io,class Checksum *chk)
+{
+  assert(m_pFirst == NULL && m_pCurrent == NULL);
+  
+  m_pIO       = io;
+  m_pChk      = chk;
+  m_ulWritten = 0;
+}
+///
+
+/// IntervalScheduler::WriteMCU
+// Schedule the MCU at the given rows and block positions
+// for encoding.
+void IntervalScheduler::WriteMCU(class QuantizedRow *const *rows,const ULONG *x)
+{
+  if (m_ulJobMCUs == 0) {
+    // Distribute a MCU row over the threads, but keep intervals complete.
+    ULONG threads = m_pPool->ThreadsOf();
+    ULONG permcu  = m_pParser->MCUsPerRow(rows) / ((threads > 0)?(threads):(1));
+    ULONG count   = permcu / m_ulInterval;
+    //
+    if (count == 0)
+      count = 1;
+    m_ulJobMCUs   = count * m_ulInterval;
+  }
+
+  if (m_pCurrent == NULL) {
+    class EncodeJob *job = new(m_pEnviron) class EncodeJob;
+    //
+    job->m_pulSizes   = (ULONG *)m_pEnviron->AllocMem(sizeof(ULONG) * (m_ulJobMCUs / m_ulInterval));
+    job->m_pParser    = m_pParser;
+    job->m_ulMCUs     = 0;
+    job->m_ulInterval = m_ulInterval;
+    for(UBYTE c = 0;c < m_pParser->m_ucCount;c++) {
+      job->m_pRows[c] = rows[c];
+      job->m_ulX[c]   = x[c];
+    }
+    m_pCurrent = job;
+  }
+
+  if (++m_pCurrent->m_ulMCUs >= m_ulJobMCUs) {
+    // Job complete, queue it.
+    if (m_pLast) {
+      m_pLast->m_pNextJob = m_pCurrent;
+    } else {
+      m_pFirst = m_pCurrent;
+    }
+    m_pLast    = m_pCurrent;
+    m_pCurrent = NULL;
+    m_ulOutstanding++;
+    m_pPool->Submit(m_pLast);
+    //
+    // Do not let the output pile up.
+    if (m_ulOutstanding >= 4 * m_pPool->ThreadsOf())
+      Drain();
+  }
+}
+///
+
+/// IntervalScheduler::Drain
+// Wait for all submitted encoding jobs and write their output.
+void IntervalScheduler::Drain(void)
+{
+  class EncodeJob *job;
+  UBYTE buffer[256];
+  
+  m_pPool->Wait();
+
+  while((job = m_pFirst)) {
+    class MemoryStream in(m_pEnviron,job->m_pStream,JPGFLAG_OFFSET_BEGINNING);
+    ULONG intervals = (job->m_ulMCUs + m_ulInterval - 1) / m_ulInterval;
+    //
+    for(ULONG i = 0;i < intervals;i++) {
+      ULONG size = job->m_pulSizes[i];
+      //
+      if (m_ulWritten > 0)
+        m_pIO->PutWord(0xffd0 + ((m_ulWritten - 1) & 0x07));
+      while(size) {
+        LONG bytes = in.Read(buffer,(size > sizeof(buffer))?(sizeof(buffer)):(size));
+        assert(bytes > 0);
+        if (m_pChk)
+          m_pChk->Update(buffer,bytes);
+        m_pIO->Write(buffer,bytes);
+        size -= bytes;
+      }
+      m_ulWritten++;
+    }
+    //
+    m_pFirst = job->m_pNextJob;
+    m_pEnviron->FreeMem(job->m_pulSizes,sizeof(ULONG) * (m_ulJobMCUs / m_ulInterval));
+    delete job;
+  }
+  
+  m_pLast         = NULL;
+  m_ulOutstanding = 0;
+}
+///
+
+/// IntervalScheduler::Flush
+// Encode everything pending and write it out. This is
+// the end of the scan.
+void IntervalScheduler::Flush(void)
+{
+  if (m_pCurrent) {
+    if (m_pLast) {
+      m_pLast->m_pNextJob = m_pCurrent;
+    } else {
+      m_pFirst = m_pCurrent;
+    }
+    m_pLast    = m_pCurrent;
+    m_pCurrent = NULL;
+    m_pPool->Submit(m_pLast);
+  }
+  
+  Drain();
+}
+///
+
+/// IntervalScheduler::ParseRow
+// Decode the restart intervals of a MCU row, given the
+// current rows of the components. Returns the number of MCUs
+// decoded, the remaining MCUs of the row are up to the scan.
+ULONG IntervalScheduler::ParseRow(class ByteStream *io,class QuantizedRow *const *rows)
+{
+  ULONG mcus      = m_pParser->MCUsPerRow(rows);
+  ULONG intervals = mcus / m_ulInterval;
+  ULONG threads   = m_pPool->ThreadsOf();
+  ULONG count,first,i;
+
+  // Only if the intervals are aligned to the rows, and there is
+  // more than one of them.
+  if (intervals < 2 || intervals * m_ulInterval != mcus || threads == 0)
+    return 0;
+
+  if (m_ppSegments == NULL) {
+    m_ppSegments = (class MemoryStream **)m_pEnviron->AllocMem(sizeof(class MemoryStream *) * intervals);
+    m_ulSegments = intervals;
+    for(i = 0;i < intervals;i++) {
+      m_ppSegments[i] = NULL;
+    }
+    for(i = 0;i < intervals;i++) {
+      m_ppSegments[i] = new(m_pEnviron) class MemoryStream(m_pEnviron);
+    }
+    m_pDecodeJobs = new(m_pEnviron) class DecodeJob[threads];
+  }
+  assert(m_ulSegments == intervals);
+
+  //
+  // Split off the entropy coded segments. This stops at the first
+  // missing restart marker, the scan has then to resync.
+  for(count = 0;count < intervals;count++) {
+    if (!m_pParser->BeginReadInterval(io))
+      break;
+    m_ppSegments[count]->Clean();
+    m_pParser->ReadInterval(io,m_ppSegments[count]);
+  }
+
+  //
+  // Distribute the segments evenly over the threads.
+  for(i = 0,first = 0;i < threads && first < count;i++) {
+    class DecodeJob *job = m_pDecodeJobs + i;
+    ULONG last           = (count * (i + 1)) / threads;
+    //
+    if (last <= first)
+      continue;
+    job->m_pParser    = m_pParser;
+    job->m_ppSegments = m_ppSegments + first;
+    job->m_ulCount    = last - first;
+    job->m_ulInterval = m_ulInterval;
+    for(UBYTE c = 0;c < m_pParser->m_ucCount;c++) {
+      job->m_pRows[c] = rows[c];
+      job->m_ulX[c]   = first * m_ulInterval * m_pParser->MCUWidthOf(c);
+    }
+    m_pPool->Submit(job);
+    first = last;
+  }
+
+  m_pPool->Wait();
+
+  return count * m_ulInterval;
+}
+///
@@ -0,0 +1,212 @@
+/*************************************************************************
+
+    This project implements a complete(!) JPEG (Recommendation ITU-T
+    T.81 | ISO/IEC 10918-1) codec, plus a library that can be used to
+    encode and decode JPEG streams. 
+    It also implements ISO/IEC 18477 aka JPEG XT which is an extension
+    towards intermediate, high-dynamic-range lossy and lossless coding
+    of JPEG. In specific, it supports ISO/IEC 18477-3/-6/-7/-8 encoding.
+
+    Note that only Profiles C and D of ISO/IEC 18477-7 are supported
+    here. Check the JPEG XT reference software for a full implementation
+    of ISO/IEC 18477-7.
+
+    Copyright (C) 2012-2018 Thomas Richter, University of Stuttgart and
+    Accusoft. (C) 2019-2020 Thomas Richter, Fraunhofer IIS.
+
+    This program is available under two licenses, GPLv3 and the ITU
+    Software licence Annex A Option 2, RAND conditions.
+
+    For the full text of the GPU license option, see README.license.gpl.
+    For the full text of the ITU license option, see README.license.itu.
+    
+    You may freely select between these two options.
+
+    For the GPL option, please note the following:
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+/*
+**
+** This class schedules the restart intervals of a scan on the worker
+** threads of the environment, and stitches the results back together
+** in stream order.
+**
+** $Id$
+**
+*/
+
+#ifndef CODESTREAM_INTERVALSCHEDULER_HPP
+#define CODESTREAM_INTERVALSCHEDULER_HPP
+
+/// Includes
+#include "tools/environment.hpp"
+#include "tools/workerpool.hpp"
+///
+
+/// Forwards
+class ByteStream;
+class MemoryStream;
+class Checksum;
+class EntropyParser;
+class QuantizedRow;
+///
+
+/// Design
+/** Design
+******************************************************************
+** class IntervalScheduler                                      **
+** Super Class: JKeeper                                         **
+** Sub Classes: none                                            **
+** Friends:     none                                            **
+******************************************************************
+
+Restart intervals reset the statistics of the entropy coder, hence
+the intervals of a scan can be coded independently of each other.
+This class distributes them over the worker pool of the environment.
+
+On encoding, the scan reports the position of each MCU here instead
+of coding it. MCUs are collected into jobs of complete restart
+intervals, and each job codes its intervals into a memory stream of
+its own, using a copy of the scan created by the scan itself. The
+results are written to the output stream in order, separated by the
+restart markers, such that the output is identical to that of the
+sequential coder.
+
+On decoding, only intervals that start and end within a MCU row are
+handled because the rows of the block buffer are only allocated row
+by row. The entropy coded segments of a row are split off the input
+stream, and decoded in parallel. If anything looks suspicious, e.g.
+a restart marker is missing, the scan falls back to the sequential
+parser which then takes care of resynchronization.
+* */
+///
+
+/// class IntervalScheduler
+// Schedules restart intervals on the worker threads.
+class IntervalScheduler : public JKeeper {
+  //
+  // A job encoding a group of restart intervals.
+  class EncodeJob : public WorkerPool::Job {
+  public:
+    //
+    // The scan that codes the intervals.
+    class EntropyParser *m_pParser;
+    //
+    // The next job in stream order.
+    class EncodeJob     *m_pNextJob;
+    //
+    // The rows and block positions of the first MCU.
+    class QuantizedRow  *m_pRows[4];
+    ULONG                m_ulX[4];
+    //
+    // Number of MCUs in this job, and in an interval.
+    ULONG                m_ulMCUs;
+    ULONG                m_ulInterval;
+    //
+    // The output, and the size of each interval in it.
+    class MemoryStream  *m_pStream;
+    ULONG               *m_pulSizes;
+    //
+    EncodeJob(void)
+      : m_pNextJob(NULL), m_pStream(NULL), m_pulSizes(NULL)
+    { }
+    //
+    virtual ~EncodeJob(void);
+    //
+    virtual void Run(class Environ *env);
+  };
+  //
+  // A job decoding a group of restart intervals.
+  class DecodeJob : public WorkerPool::Job {
+  public:
+    //
+    // The scan that codes the intervals.
+    class EntropyParser *m_pParser;
+    //
+    // The rows and block positions of the first MCU.
+    class QuantizedRow  *m_pRows[4];
+    ULONG                m_ulX[4];
+    //
+    // The entropy coded segments to decode.
+    class MemoryStream **m_ppSegments;
+    ULONG                m_ulCount;
+    //
+    // Number of MCUs in an interval.
+    ULONG                m_ulInterval;
+    //
+    virtual void Run(class Environ *env);
+  };
+  //
+  // The scan whose intervals are scheduled.
+  class EntropyParser   *m_pParser;
+  //
+  // The pool running the jobs.
+  class WorkerPool      *m_pPool;
+  //
+  // The restart interval in MCUs.
+  ULONG                  m_ulInterval;
+  //
+  // The stream and checksum the output goes to on encoding.
+  class ByteStream      *m_pIO;
+  class Checksum        *m_pChk;
+  //
+  // The job currently collecting MCUs, and the jobs submitted but
+  // not yet written.
+  class EncodeJob       *m_pCurrent;
+  class EncodeJob       *m_pFirst;
+  class EncodeJob       *m_pLast;
+  ULONG                  m_ulOutstanding;
+  //
+  // Number of MCUs per job, a multiple of the interval.
+  ULONG                  m_ulJobMCUs;
+  //
+  // Number of intervals written so far.
+  ULONG                  m_ulWritten;
+  //
+  // The entropy coded segments of a row on decoding, and the
+  // decoding jobs.
+  class MemoryStream   **m_ppSegments;
+  ULONG                  m_ulSegments;
+  class DecodeJob       *m_pDecodeJobs;
+  //
+  // Wait for all submitted encoding jobs and write their output.
+  void Drain(void);
+  //
+public:
+  IntervalScheduler(class EntropyParser *parser,class WorkerPool *pool);
+  //
+  ~IntervalScheduler(void);
+  //
+  // Start encoding a scan into the given stream.
+  void StartWrite(class ByteStream *io,class Checksum *chk);
+  //
+  // Schedule the MCU at the given rows and block positions
+  // for encoding.
+  void WriteMCU(class QuantizedRow *const *rows,const ULONG *x);
+  //
+  // Encode everything pending and write it out. This is
+  // the end of the scan.
+  void Flush(void);
+  //
+  // Decode the restart intervals of a MCU row, given the
+  // current rows of the components. Returns the number of MCUs
+  // decoded, the remaining MCUs of the row are up to the scan.
+  ULONG ParseRow(class ByteStream *io,class QuantizedRow *const *rows);
+};
+///
+
+///
+#endif
@@ -0,0 +1,150 @@
+/*************************************************************************
+
+    This project implements a complete(!) JPEG (Recommendation ITU-T
+    T.81 | ISO/IEC 10918-1) codec, plus a library that can be used to
+    encode and decode JPEG streams. 
+    It also implements ISO/IEC 18477 aka JPEG XT which is an extension
+    towards intermediate, high-dynamic-range lossy and lossless coding
+    of JPEG. In specific, it supports ISO/IEC 18477-3/-6/-7/-8 encoding.
+
+    Note that only Profiles C and D of ISO/IEC 18477-7 are supported
+    here. Check the JPEG XT reference software for a full implementation
+    of ISO/IEC 18477-7.
+
+    Copyright (C) 2012-2018 Thomas Richter, University of Stuttgart and
+    Accusoft. (C) 2019-2020 Thomas Richter, Fraunhofer IIS.
+
+    This program is available under two licenses, GPLv3 and the ITU
+    Software licence Annex A Option 2, RAND conditions.
+
+    For the full text of the GPU license option, see README.license.gpl.
+    For the full text of the ITU license option, see README.license.itu.
+    
+    You may freely select between these two options.
+
+    For the GPL option, please note the following:
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+/*
+**
+** This class locates the markers of a codestream in memory without
+** decoding it, and reports their positions to the caller.
+**
+** $Id$
+**
+*/
+
+/// Includes
+#include "codestream/markerindex.hpp"
+#include "std/string.hpp"
+#include "std/assert.hpp"
+///
+
+/// MarkerIndex::MarkerIndex
+MarkerIndex::MarkerIndex(class Environ *env)
+  : JKeeper(env), m_pucBuffer(NULL), m_ulSize(0),
+    m_pEntries(NULL), m_ulAllocated(0), m_ulCount(0)
+{
+}
+///
+
+/// MarkerIndex::~MarkerIndex
+MarkerIndex::~MarkerIndex(void)
+{
+  if (m_pEntries)
+    m_pEnviron->FreeMem(m_pEntries,m_ulAllocated * sizeof(struct Entry));
+}
+///
+
+/// MarkerIndex::Add
+// Append an entry to the index.
+void MarkerIndex::Add(UWORD marker,ULONG offset,ULONG length,ULONG boxtype)
+{
+  if (m_ulCount >= m_ulAllocated) {
+    ULONG allocated       = (m_ulAllocated)?(m_ulAllocated << 1):(64);
+    struct Entry *entries = (struct Entry *)m_pEnviron->AllocMem(allocated * sizeof(struct Entry));
+    //
+    if (m_pEntries) {
+      memcpy(entries,m_pEntries,m_ulCount * sizeof(struct Entry));
+      m_pEnviron->FreeMem(m_pEntries,m_ulAllocated * sizeof(struct Entry));
+    }
+    m_pEntries    = entries;
+    m_ulAllocated = allocated;
+  }
+
+  m_pEntries[m_ulCount].me_ulOffset  = offset;
+  m_pEntries[m_ulCount].me_ulLength  = length;
+  m_pEntries[m_ulCount].me_ulBoxType = boxtype;
+  m_pEntries[m_ulCount].me_usMarker  = marker;
+  m_ulCount++;
+}
+///
+
+/// MarkerIndex::Build
+// Build the index of the codestream in the given buffer. This
+// replaces a previously built index.
+void MarkerIndex::Build(const UBYTE *buffer,ULONG size)
+{
+  const UBYTE *p   = buffer;
+  const UBYTE *end = buffer + size;
+
+  m_pucBuffer = buffer;
+  m_ulSize    = size;
+  m_ulCount   = 0;
+
+  while(p + 1 < end) {
+    UWORD marker;
+    ULONG length,boxtype;
+    //
+    if (*p != 0xff) {
+      // Entropy coded data or garbage, run to the next candidate.
+      p = (const UBYTE *)memchr(p,0xff,end - p);
+      if (p == NULL)
+        break;
+      continue;
+    }
+    //
+    // Stuffed bytes, JPEG-LS bit stuffing and fill bytes are not markers.
+    if (p[1] < 0x80 || p[1] == 0xff) {
+      p++;
+      continue;
+    }
+    //
+    marker = 0xff00 | p[1];
+    if (marker == 0xffd8 || marker == 0xffd9 || (marker >= 0xffd0 && marker <= 0xffd7)) {
+      // SOI, EOI and RSTn come without a marker segment.
+      Add(marker,p - buffer,0,0);
+      p += 2;
+      continue;
+    }
+    //
+    if (p + 4 > end)
+      break; // truncated
+    length  = (p[2] << 8) | p[3];
+    boxtype = 0;
+    //
+    // APP11 with the JPEG XT identifier: Le, CI, En, Z, LBox, TBox.
+    if (marker == 0xffeb && length >= 18 && p + 20 <= end && p[4] == 'J' && p[5] == 'P') {
+      boxtype = (ULONG(p[16]) << 24) | (ULONG(p[17]) << 16) | (ULONG(p[18]) << 8) | p[19];
+    }
+    Add(marker,p - buffer,length,boxtype);
+    //
+    if (length < 2 || ULONG(end - p) - 2 < length)
+      break; // corrupt or truncated
+    p += 2 + length;
+  }
+}
+///
@@ -0,0 +1,150 @@
+/*************************************************************************
+
+    This project implements a complete(!) JPEG (Recommendation ITU-T
+    T.81 | ISO/IEC 10918-1) codec, plus a library that can be used to
+    encode and decode JPEG streams. 
+    It also implements ISO/IEC 18477 aka JPEG XT which is an extension
+    towards intermediate, high-dynamic-range lossy and lossless coding
+    of JPEG. In specific, it supports ISO/IEC 18477-3/-6/-7/-8 encoding.
+
+    Note that only Profiles C and D of ISO/IEC 18477-7 are supported
+    here. Check the JPEG XT reference software for a full implementation
+    of ISO/IEC 18477-7.
+
+    Copyright (C) 2012-2018 Thomas Richter, University of Stuttgart and
+    Accusoft. (C) 2019-2020 Thomas Richter, Fraunhofer IIS.
+
+    This program is available under two licenses, GPLv3 and the ITU
+    Software licence Annex A Option 2, RAND conditions.
+
+    For the full text of the GPU license option, see README.license.gpl.
+    For the full text of the ITU license option, see README.license.itu.
+    
+    You may freely select between these two options.
+
+    For the GPL option, please note the following:
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+/*
+**
+** This class locates the markers of a codestream in memory without
+** decoding it, and reports their positions to the caller.
+**
+** $Id$
+**
+*/
+
+#ifndef CODESTREAM_MARKERINDEX_HPP
+#define CODESTREAM_MARKERINDEX_HPP
+
+/// Includes
+#include "tools/environment.hpp"
+///
+
+/// Design
+/** Design
+******************************************************************
+** class MarkerIndex                                            **
+** Super Class: JKeeper                                         **
+** Sub Classes: none                                            **
+** Friends:     none                                            **
+******************************************************************
+
+The marker index is a table of all markers of a codestream held in
+memory, with their offsets and segment sizes. It is built in a single
+pass: marker segments are skipped over by their length field, and
+entropy coded data is searched for the next 0xff byte by memchr().
+Stuffed bytes and fill bytes are passed over, as are the bit-stuffed
+bytes of JPEG-LS scans, which are always below 0x80.
+
+For APP11 segments that carry JPEG XT boxes, the box type is recorded
+as well. Nothing is decoded, and no tables or frames are built.
+
+The index is only reported to the application, which may use it to
+locate frames, scans or boxes in its buffer. The decoder itself does
+not consult it and still parses the codestream in stream order.
+* */
+///
+
+/// class MarkerIndex
+// Locates the markers of a codestream in memory.
+class MarkerIndex : public JKeeper {
+  //
+public:
+  //
+  // A single entry of the index.
+  struct Entry {
+    //
+    // Offset of the marker from the start of the buffer.
+    ULONG me_ulOffset;
+    //
+    // Size of the marker segment behind the marker, including
+    // the length field, or zero for markers without a segment.
+    ULONG me_ulLength;
+    //
+    // For JPEG XT boxes in APP11, the box type. Zero otherwise.
+    ULONG me_ulBoxType;
+    //
+    // The marker itself.
+    UWORD me_usMarker;
+  };
+  //
+private:
+  //
+  // The buffer the index was built from.
+  const UBYTE  *m_pucBuffer;
+  ULONG         m_ulSize;
+  //
+  // The entries, and the number of entries allocated and used.
+  struct Entry *m_pEntries;
+  ULONG         m_ulAllocated;
+  ULONG         m_ulCount;
+  //
+  // Append an entry to the index.
+  void Add(UWORD marker,ULONG offset,ULONG length,ULONG boxtype);
+  //
+public:
+  MarkerIndex(class Environ *env);
+  //
+  ~MarkerIndex(void);
+  //
+  // Build the index of the codestream in the given buffer. This
+  // replaces a previously built index.
+  void Build(const UBYTE *buffer,ULONG size);
+  //
+  // Return the buffer the index was built from.
+  const UBYTE *BufferOf(void) const
+  {
+    return m_pucBuffer;
+  }
+  //
+  // Return the number of markers found.
+  ULONG CountOf(void) const
+  {
+    return m_ulCount;
+  }
+  //
+  // Return the i-th marker in stream order.
+  const struct Entry *EntryOf(ULONG i) const
+  {
+    assert(i < m_ulCount);
+    return m_pEntries + i;
+  }
+};
+///
+
+///
+#endif
@@ -84,6 +84,9 @@ void RectangleRequest::ParseTags(const struct JPG_TagItem *tags,const class Imag
   rr_bUpsampling        = true;
   rr_bIncludeAlpha      = false;
   rr_bColorTrafo        = true;
+  rr_bIncremental       = false;
+  rr_ppucPlanes         = NULL;
+  rr_plBytesPerRow      = NULL;
   //
   // Changed a bit the reaction on coordinates: We no longer throw
   // errors, but rather clip into the valid coordinates. This goes
@@ -150,6 +153,15 @@ void RectangleRequest::ParseTags(const struct JPG_TagItem *tags,const class Imag
     case JPGTAG_MATRIX_LTRAFO:
       rr_bColorTrafo   = (coord != JPGFLAG_MATRIX_COLORTRANSFORMATION_NONE)?true:false;
       break;
+    case JPGTAG_DECODER_INCREMENTAL:
+      rr_bIncremental  = (coord != 0)?true:false;
+      break;
+    case JPGTAG_DECODER_PLANES:
+      rr_ppucPlanes    = (UBYTE *const *)tags->ti_Data.ti_pPtr;
+      break;
+    case JPGTAG_DECODER_PLANE_BYTESPERROW:
+      rr_plBytesPerRow = (const LONG *)tags->ti_Data.ti_pPtr;
+      break;
     }
     tags = tags->NextTagItem();
   }
@@ -157,6 +169,17 @@ void RectangleRequest::ParseTags(const struct JPG_TagItem *tags,const class Imag
   // If upsampling is disabled, disable the color transformation as well.
   if (!rr_bUpsampling)
     rr_bColorTrafo = FALSE;
+  //
+  // Planar output goes at native resolution without color transformation
+  // directly into the planes, and does not include alpha.
+  if (rr_ppucPlanes) {
+    if (rr_plBytesPerRow == NULL)
+      JPG_THROW(MISSING_PARAMETER,"RectangleRequest::ParseFromTagList",
+                "the bytes per row of the output planes are missing");
+    rr_bUpsampling   = false;
+    rr_bColorTrafo   = false;
+    rr_bIncludeAlpha = false;
+  }
   // Make a consistency check for the rectangle. Otherwise, the decoder
   // will fall over...
   if (rr_Request.IsEmpty())
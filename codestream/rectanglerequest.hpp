@@ -96,6 +96,9 @@ struct RectangleRequest : public JObject, private Explicit {
   bool                     rr_bIncludeAlpha;    // include the alpha channel in the request
   bool                     rr_bUpsampling;      // disable or enable upsampling. Default is to upsample
   bool                     rr_bColorTrafo;      // disable or enable the output color transformation. Default is to run it.
+  bool                     rr_bIncremental;     // only reconstruct what changed since the last incremental request
+  UBYTE            *const *rr_ppucPlanes;       // if non-NULL, reconstruct into these planes, one per component
+  const LONG              *rr_plBytesPerRow;    // bytes per row of the above planes
   //
   RectangleRequest(void)
     : rr_pNext(NULL)
@@ -114,6 +117,9 @@ struct RectangleRequest : public JObject, private Explicit {
     rr_bIncludeAlpha    = req.rr_bIncludeAlpha;
     rr_bUpsampling      = req.rr_bUpsampling;
     rr_bColorTrafo      = req.rr_bColorTrafo;
+    rr_bIncremental     = req.rr_bIncremental;
+    rr_ppucPlanes       = req.rr_ppucPlanes;
+    rr_plBytesPerRow    = req.rr_plBytesPerRow;
   }
   //
   // Assignment operator.
@@ -128,6 +134,9 @@ struct RectangleRequest : public JObject, private Explicit {
     rr_bIncludeAlpha    = req.rr_bIncludeAlpha;
     rr_bUpsampling      = req.rr_bUpsampling;
     rr_bColorTrafo      = req.rr_bColorTrafo;
+    rr_bIncremental     = req.rr_bIncremental;
+    rr_ppucPlanes       = req.rr_ppucPlanes;
+    rr_plBytesPerRow    = req.rr_plBytesPerRow;
     //
     return *this;
   }
@@ -282,6 +282,17 @@ bool RefinementScan::WriteMCU(void)
 }
 ///
 
+/// RefinementScan::MaxMCUSizeOf
+// Return an upper bound for the number of bytes a single call of
+// ParseMCU() may read. Code words, sign and correction bits take
+// less than 32 bits per coefficient, and byte stuffing may double
+// this. A restart marker and some fill bytes may come in front.
+ULONG RefinementScan::MaxMCUSizeOf(void) const
+{
+  return BlocksPerMCU() * 64 * 4 * 2 + 16;
+}
+///
+
 /// RefinementScan::ParseMCU
 // Parse a single MCU in this scan. Return true if there are more blocks in this row.
 bool RefinementScan::ParseMCU(void)
@@ -175,6 +175,10 @@ public:
   // MCUs in this row.
   virtual bool ParseMCU(void);  
   //
+  // Return an upper bound for the number of bytes a single call of
+  // ParseMCU() may read.
+  virtual ULONG MaxMCUSizeOf(void) const;
+  //
   // Write a single MCU in this scan.
   virtual bool WriteMCU(void); 
   //
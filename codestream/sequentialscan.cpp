@@ -376,27 +376,76 @@ bool SequentialScan::WriteMCU(void)
 }
 ///
 
+/// SequentialScan::MaxMCUSizeOf
+// Return an upper bound for the number of bytes a single call of
+// ParseMCU() may read. A Huffman code word and its magnitude bits
+// take at most 32 bits per coefficient, and byte stuffing may double
+// this. A restart marker and some fill bytes may come in front.
+ULONG SequentialScan::MaxMCUSizeOf(void) const
+{
+  return BlocksPerMCU() * 64 * 4 * 2 + 16;
+}
+///
+
 /// SequentialScan::ParseMCU
 // Parse a single MCU in this scan. Return true if there are more blocks in this row.
 bool SequentialScan::ParseMCU(void)
 {
-  bool more = true;
+  class QuantizedRow *rows[4];
   int c;
 
   assert(m_pBlockCtrl);
 
+  for(c = 0;c < m_ucCount;c++) {
+    rows[c] = m_pBlockCtrl->CurrentQuantizedRow(m_pComponent[c]->IndexOf());
+  }
+
   bool valid = BeginReadMCU(m_Stream.ByteStreamOf());
-  
+
+  return DecodeMCU(rows,m_ulX,valid);
+}
+///
+
+/// SequentialScan::ParseMCURow
+// Parse the remaining MCUs of the current MCU row. This is equivalent
+// to calling ParseMCU() until it returns false, except that the
+// quantized rows are looked up once per row.
+void SequentialScan::ParseMCURow(void)
+{
+  class QuantizedRow *rows[4];
+  bool more;
+  int c;
+
+  assert(m_pBlockCtrl);
+
+  for(c = 0;c < m_ucCount;c++) {
+    rows[c] = m_pBlockCtrl->CurrentQuantizedRow(m_pComponent[c]->IndexOf());
+  }
+
+  do {
+    more = DecodeMCU(rows,m_ulX,BeginReadMCU(m_Stream.ByteStreamOf()));
+  } while(more);
+}
+///
+
+/// SequentialScan::DecodeMCU
+// Decode a single MCU at the given rows and block positions. If the
+// segment is not valid, clear the blocks instead.
+bool SequentialScan::DecodeMCU(class QuantizedRow *const *rows,ULONG *xpos,bool valid)
+{
+  bool more = true;
+  int c;
+
   for(c = 0;c < m_ucCount;c++) {
     class Component *comp    = m_pComponent[c];
-    class QuantizedRow *q    = m_pBlockCtrl->CurrentQuantizedRow(comp->IndexOf());
+    class QuantizedRow *q    = rows[c];
     class HuffmanDecoder *dc = m_pDCDecoder[c];
     class HuffmanDecoder *ac = m_pACDecoder[c];
     UWORD &skip              = m_usSkip[c];
     LONG &prevdc             = m_lDC[c];
     UBYTE mcux               = (m_ucCount > 1)?(comp->MCUWidthOf() ):(1);
     UBYTE mcuy               = (m_ucCount > 1)?(comp->MCUHeightOf()):(1);
-    ULONG xmin               = m_ulX[c];
+    ULONG xmin               = xpos[c];
     ULONG xmax               = xmin + mcux;
     ULONG x,y;
     if (xmax >= q->WidthOf()) {
@@ -421,7 +470,7 @@ bool SequentialScan::ParseMCU(void)
       if (q) q = q->NextOf();
     }
     // Done with this component, advance the block.
-    m_ulX[c] = xmax;
+    xpos[c] = xmax;
   }
 
   return more;
@@ -150,6 +150,10 @@ class SequentialScan : public EntropyParser {
                    class HuffmanCoder *dc,class HuffmanCoder *ac,
                    LONG &prevdc,UWORD &skip);
   //
+  // Decode a single MCU at the given rows and block positions. If the
+  // segment is not valid, clear the blocks instead.
+  bool DecodeMCU(class QuantizedRow *const *rows,ULONG *x,bool valid);
+  //
   // Decode a single huffman block.
   void DecodeBlock(LONG *block,
                    class HuffmanDecoder *dc,class HuffmanDecoder *ac,
@@ -202,6 +206,13 @@ public:
   // MCUs in this row.
   virtual bool ParseMCU(void);  
   //
+  // Parse the remaining MCUs of the current row in one go.
+  virtual void ParseMCURow(void);
+  //
+  // Return an upper bound for the number of bytes a single call of
+  // ParseMCU() may read.
+  virtual ULONG MaxMCUSizeOf(void) const;
+  //
   // Write a single MCU in this scan.
   virtual bool WriteMCU(void);
   //
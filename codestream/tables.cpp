@@ -103,7 +103,8 @@ Tables::Tables(class Environ *env)
     m_pIdentityMapping(NULL), m_pChecksumBox(NULL),
     m_ucMaxError(0), m_bTruncateColor(false), m_bRefinement(false), 
     m_bOpenLoop(false), m_bDeadZone(false), m_bOptimize(false), m_bDeRing(false),
-    m_bFoundExp(false), m_bHorizontalExpansion(false), m_bVerticalExpansion(false)
+    m_bFoundExp(false), m_bHorizontalExpansion(false), m_bVerticalExpansion(false),
+    m_bLegacyOnly(false)
 {
   m_NameSpace.DefineSecondaryLookup(&m_pBoxList);
   m_AlphaNameSpace.DefineSecondaryLookup(&m_pBoxList);
@@ -1175,7 +1176,9 @@ bool Tables::ParseTablesIncremental(class ByteStream *io,class Checksum *chk,
        LONG len = io->GetWord();
        if (len >= 2 + 2 + 2 + 4 + 4 + 4) { // At least the box header must be present.
          LONG ci = io->PeekWord();
-         if (ci == 0x4a50) { 
+         // If only the legacy codestream is decoded, boxes are
+         // skipped below without buffering their contents.
+         if (ci == 0x4a50 && !m_bLegacyOnly) { 
            class Box *box;
            // Is the correct CI, assume it is a box.
            io->GetWord();
@@ -205,6 +205,9 @@ class Tables: public JKeeper {
   bool                           m_bHorizontalExpansion;
   bool                           m_bVerticalExpansion;
   //
+  // If set, JPEG XT boxes are skipped on parsing.
+  bool                           m_bLegacyOnly;
+  //
   // Build a tone mapping for the type (base-tag) and the given tag list
   // The base tag is the tag-id for the type of the box. All others are offsets.
   class ToneMapperBox *BuildToneMapping(const struct JPG_TagItem *tags,
@@ -514,6 +517,13 @@ public:
   {
     return m_bDeRing;
   }
+  //
+  // Skip all JPEG XT boxes on parsing such that only the legacy
+  // codestream is decoded.
+  void IgnoreExtensions(void)
+  {
+    m_bLegacyOnly = true;
+  }
 };
 ///
 
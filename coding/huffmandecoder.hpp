@@ -53,6 +53,7 @@
 #include "tools/environment.hpp"
 #include "io/bytestream.hpp"
 #include "std/string.hpp"
+#include "std/assert.hpp"
 ///
 
 /// class HuffmanDecoder
@@ -89,6 +90,15 @@ public:
     memset(m_pucLength,0   ,sizeof(m_pucLength));
   }
   //
+  // Create an empty decoder whose tables are filled by CopyFrom().
+  HuffmanDecoder(class Environ *env)
+    : JKeeper(env)
+  {
+    memset(m_ucLength ,0xff,sizeof(m_ucLength));
+    memset(m_pucSymbol,0   ,sizeof(m_pucSymbol));
+    memset(m_pucLength,0   ,sizeof(m_pucLength));
+  }
+  //
   ~HuffmanDecoder(void)
   { 
     int i;
@@ -99,6 +109,30 @@ public:
     }
   }
   //
+  // Copy the tables of another decoder. The extension tables are
+  // allocated from the environment of this decoder, which must be
+  // empty. If this throws, deleting this decoder releases what
+  // has been copied so far.
+  void CopyFrom(const class HuffmanDecoder *src)
+  {
+    int i;
+
+    memcpy(m_ucSymbol,src->m_ucSymbol,sizeof(m_ucSymbol));
+    memcpy(m_ucLength,src->m_ucLength,sizeof(m_ucLength));
+
+    for(i = 0;i < 256;i++) {
+      assert(m_pucSymbol[i] == NULL && m_pucLength[i] == NULL);
+      if (src->m_pucSymbol[i]) {
+        m_pucSymbol[i] = (UBYTE *)m_pEnviron->AllocMem(256 * sizeof(UBYTE));
+        memcpy(m_pucSymbol[i],src->m_pucSymbol[i],256 * sizeof(UBYTE));
+      }
+      if (src->m_pucLength[i]) {
+        m_pucLength[i] = (UBYTE *)m_pEnviron->AllocMem(256 * sizeof(UBYTE));
+        memcpy(m_pucLength[i],src->m_pucLength[i],256 * sizeof(UBYTE));
+      }
+    }
+  }
+  //
   // Decode the next symbol.
   UBYTE Get(BitStream<false> *io)
   {
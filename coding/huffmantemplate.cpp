@@ -52,6 +52,7 @@
 #include "coding/huffmancoder.hpp"
 #include "coding/huffmandecoder.hpp"
 #include "coding/huffmanstatistics.hpp"
+#include "coding/tablecache.hpp"
 #ifdef COLLECT_STATISTICS
 #include "std/stdio.hpp"
 #endif
@@ -70,8 +71,8 @@ HuffmanTemplate::~HuffmanTemplate(void)
   if (m_pucValues)
     m_pEnviron->FreeMem(m_pucValues,sizeof(UBYTE) * m_ulCodewords);
   
-  delete m_pDecoder;
-  delete m_pEncoder;
+  ReleaseDecoder();
+  ReleaseEncoder();
   delete m_pStatistics;
 }
 ///
@@ -125,8 +126,8 @@ void HuffmanTemplate::ResetEntries(ULONG count)
     m_pucValues = NULL;
   }
 
-  delete m_pDecoder;m_pDecoder = NULL;
-  delete m_pEncoder;m_pEncoder = NULL;
+  ReleaseDecoder();
+  ReleaseEncoder();
   // The statistics remains valid.
 
   m_ulCodewords = count;
@@ -776,13 +777,36 @@ void HuffmanTemplate::InitACChrominanceDefault(ScanType type,UBYTE depth,UBYTE,U
 // Build the huffman encoder given the template data.
 void HuffmanTemplate::BuildEncoder(void)
 {
+  class TableCache *cache = m_pEnviron->TableCacheOf();
+  
   assert(m_pEncoder == NULL);
   
   //
   // If the coder is not used, do not build it.
   if (m_pucValues) {
     assert(m_ucLengths);
-    m_pEncoder = new(m_pEnviron) class HuffmanCoder(m_ucLengths,m_pucValues);
+    if (cache)
+      m_pEncoder = cache->AcquireCoder(m_ucLengths,m_pucValues,m_ulCodewords);
+    if (m_pEncoder == NULL)
+      m_pEncoder = new(m_pEnviron) class HuffmanCoder(m_ucLengths,m_pucValues);
+  }
+}
+///
+
+/// HuffmanTemplate::ReleaseEncoder
+// Return the encoder to the table cache, or delete it.
+void HuffmanTemplate::ReleaseEncoder(void)
+{
+  if (m_pEncoder) {
+    // The cache exists already if the encoder came from there.
+    class TableCache *cache = m_pEnviron->TableCacheOf();
+    //
+    if (cache) {
+      cache->ReleaseCoder(m_pEncoder);
+    } else {
+      delete m_pEncoder;
+    }
+    m_pEncoder = NULL;
   }
 }
 ///
@@ -808,11 +832,19 @@ void HuffmanTemplate::BuildDecoder(void)
   UBYTE *sizptr;
   UBYTE **lsbsym;
   UBYTE **lsbsiz;
+  class TableCache *cache = m_pEnviron->TableCacheOf();
 
   assert(m_pDecoder == NULL);
 
   if (m_pucValues) {
     assert(m_ucLengths);
+    //
+    // Check whether another image used the same table.
+    if (cache) {
+      m_pDecoder = cache->FindDecoder(m_ucLengths,m_pucValues,m_ulCodewords);
+      if (m_pDecoder)
+        return;
+    }
     // If the decoder is not used, do not build it.
     m_pDecoder = new(m_pEnviron) class HuffmanDecoder(m_pEnviron,
                                                       symptr,sizptr,lsbsym,lsbsiz);
@@ -870,6 +902,28 @@ void HuffmanTemplate::BuildDecoder(void)
         }
       }
     }
+    //
+    // The table is valid, share the decoder with later images.
+    if (cache)
+      m_pDecoder = cache->AddDecoder(m_ucLengths,m_pucValues,m_ulCodewords,m_pDecoder);
+  }
+}
+///
+
+/// HuffmanTemplate::ReleaseDecoder
+// Return the decoder to the table cache, or delete it.
+void HuffmanTemplate::ReleaseDecoder(void)
+{
+  if (m_pDecoder) {
+    // The cache exists already if the decoder came from there.
+    class TableCache *cache = m_pEnviron->TableCacheOf();
+    //
+    if (cache) {
+      cache->ReleaseDecoder(m_pDecoder);
+    } else {
+      delete m_pDecoder;
+    }
+    m_pDecoder = NULL;
   }
 }
 ///
@@ -879,8 +933,8 @@ void HuffmanTemplate::ParseMarker(class ByteStream *io)
 {
   ULONG i,total = 0;
   // A new decoder chain is required here.
-  delete m_pDecoder;m_pDecoder = NULL;
-  delete m_pEncoder;m_pEncoder = NULL;
+  ReleaseDecoder();
+  ReleaseEncoder();
   
   // Read the number of huffman codes of length i-1
   for(i = 0;i < 16U;i++) {
@@ -104,12 +104,20 @@ class HuffmanTemplate : public JKeeper {
   // Reset the huffman table for an alphabet with N entries.
   void ResetEntries(ULONG count);
   //
-  // Build the huffman encoder given the template data.
+  // Build the huffman encoder given the template data, or pick
+  // it from the table cache.
   void BuildEncoder(void);
   //
-  // Build the huffman decoder given the template data.
+  // Return the encoder to the table cache, or delete it.
+  void ReleaseEncoder(void);
+  //
+  // Build the huffman decoder given the template data, or pick
+  // it from the table cache if an identical table was seen before.
   void BuildDecoder(void);
   //
+  // Return the decoder to the table cache, or delete it.
+  void ReleaseDecoder(void);
+  //
   // Build the huffman statistics.
   void BuildStatistics(bool fordc);
   //
@@ -0,0 +1,547 @@
+/*************************************************************************
+
+    This project implements a complete(!) JPEG (Recommendation ITU-T
+    T.81 | ISO/IEC 10918-1) codec, plus a library that can be used to
+    encode and decode JPEG streams. 
+    It also implements ISO/IEC 18477 aka JPEG XT which is an extension
+    towards intermediate, high-dynamic-range lossy and lossless coding
+    of JPEG. In specific, it supports ISO/IEC 18477-3/-6/-7/-8 encoding.
+
+    Note that only Profiles C and D of ISO/IEC 18477-7 are supported
+    here. Check the JPEG XT reference software for a full implementation
+    of ISO/IEC 18477-7.
+
+    Copyright (C) 2012-2018 Thomas Richter, University of Stuttgart and
+    Accusoft. (C) 2019-2020 Thomas Richter, Fraunhofer IIS.
+
+    This program is available under two licenses, GPLv3 and the ITU
+    Software licence Annex A Option 2, RAND conditions.
+
+    For the full text of the GPU license option, see README.license.gpl.
+    For the full text of the ITU license option, see README.license.itu.
+    
+    You may freely select between these two options.
+
+    For the GPL option, please note the following:
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+/*
+**
+** This class keeps Huffman coders and decoders built from DHT tables,
+** and lookup tables built from parametric tone mapping curves, such
+** that all JPEG objects of the process can share them.
+**
+** $Id$
+**
+*/
+
+/// Includes
+#include "coding/tablecache.hpp"
+#include "io/bitstream.hpp"
+#include "coding/huffmandecoder.hpp"
+#include "coding/huffmancoder.hpp"
+#include "boxes/parametrictonemappingbox.hpp"
+#include "std/string.hpp"
+#include "std/assert.hpp"
+///
+
+/// Statics
+#ifdef HAVE_WORKER_THREADS
+pthread_mutex_t   TableCache::m_Lock          = PTHREAD_MUTEX_INITIALIZER;
+class Environ     TableCache::m_SharedEnviron;
+class TableCache *TableCache::m_pShared       = NULL;
+ULONG             TableCache::m_ulSharedUsers = 0;
+#endif
+///
+
+/// TableCache::TableCache
+TableCache::TableCache(class Environ *env)
+  : JKeeper(env), m_pEntries(NULL), m_ulUnused(0), m_pCurves(NULL), m_ulUnusedCurves(0)
+{
+}
+///
+
+/// TableCache::~TableCache
+TableCache::~TableCache(void)
+{
+  struct Entry *entry;
+
+  while((entry = m_pEntries)) {
+    m_pEntries = entry->te_pNext;
+    // All tables should have been returned by now.
+    assert(entry->te_ulUsers == 0);
+    Dispose(entry);
+  }
+  
+  struct CurveEntry *curve;
+
+  while((curve = m_pCurves)) {
+    m_pCurves = curve->ce_pNext;
+    assert(curve->ce_ulUsers == 0);
+    DisposeCurve(curve);
+  }
+}
+///
+
+/// TableCache::Attach
+// Return the table cache for the given root environment, either
+// the one of the process or a private one.
+class TableCache *TableCache::Attach(class Environ *env)
+{
+#ifdef HAVE_WORKER_THREADS
+  class TableCache *cache;
+  
+  NOREF(env);
+  Lock();
+  if (m_pShared == NULL) {
+    class Environ *m_pEnviron = &m_SharedEnviron;
+    JPG_TRY {
+      m_pShared = new(m_pEnviron) class TableCache(m_pEnviron);
+    } JPG_CATCH {
+      m_pShared = NULL;
+    } JPG_ENDTRY;
+  }
+  if ((cache = m_pShared))
+    m_ulSharedUsers++;
+  Unlock();
+
+  return cache;
+#else
+  return new(env) class TableCache(env);
+#endif
+}
+///
+
+/// TableCache::Detach
+// Detach from the cache obtained by Attach().
+void TableCache::Detach(class TableCache *cache)
+{
+  if (cache) {
+#ifdef HAVE_WORKER_THREADS
+    Lock();
+    assert(cache == m_pShared && m_ulSharedUsers > 0);
+    if (--m_ulSharedUsers == 0) {
+      m_pShared = NULL;
+      delete cache;
+    }
+    Unlock();
+#else
+    delete cache;
+#endif
+  }
+}
+///
+
+/// TableCache::HashOf
+// Compute the hash of a huffman table.
+ULONG TableCache::HashOf(const UBYTE *lengths,const UBYTE *values,ULONG count)
+{
+  ULONG hash = count;
+  ULONG i;
+
+  for(i = 0;i < 16;i++) {
+    hash = (hash * 31) ^ lengths[i];
+  }
+  for(i = 0;i < count;i++) {
+    hash = (hash * 31) ^ values[i];
+  }
+
+  return hash;
+}
+///
+
+/// TableCache::FindEntry
+// Find the entry for the given table, or return NULL.
+struct TableCache::Entry *TableCache::FindEntry(const UBYTE *lengths,const UBYTE *values,
+                                                ULONG count,ULONG hash) const
+{
+  struct Entry *entry;
+
+  for(entry = m_pEntries;entry;entry = entry->te_pNext) {
+    if (entry->te_ulHash == hash && entry->te_ulCodewords == count &&
+        memcmp(entry->te_ucLengths,lengths,sizeof(entry->te_ucLengths)) == 0 &&
+        (count == 0 || memcmp(entry->te_pucValues,values,count) == 0))
+      return entry;
+  }
+
+  return NULL;
+}
+///
+
+/// TableCache::CreateEntry
+// Create a new, unused entry for the given table. May throw.
+struct TableCache::Entry *TableCache::CreateEntry(const UBYTE *lengths,const UBYTE *values,
+                                                  ULONG count,ULONG hash)
+{
+  struct Entry *entry = NULL;
+  UBYTE *volatile copy = NULL;
+  
+  if (count > 0) {
+    copy = (UBYTE *)m_pEnviron->AllocMem(sizeof(UBYTE) * count);
+    memcpy(copy,values,count);
+  }
+  JPG_TRY {
+    entry = new(m_pEnviron) struct Entry;
+  } JPG_CATCH {
+    if (copy)
+      m_pEnviron->FreeMem(copy,sizeof(UBYTE) * count);
+    JPG_RETHROW;
+  } JPG_ENDTRY;
+  
+  memcpy(entry->te_ucLengths,lengths,sizeof(entry->te_ucLengths));
+  entry->te_ulHash      = hash;
+  entry->te_ulCodewords = count;
+  entry->te_pucValues   = copy;
+  entry->te_pDecoder    = NULL;
+  entry->te_pCoder      = NULL;
+  entry->te_ulUsers     = 0;
+  entry->te_pNext       = m_pEntries;
+  m_pEntries            = entry;
+  m_ulUnused++;
+
+  return entry;
+}
+///
+
+/// TableCache::Dispose
+// Release an entry including its tables.
+void TableCache::Dispose(struct Entry *entry)
+{
+  if (entry->te_pucValues)
+    m_pEnviron->FreeMem(entry->te_pucValues,sizeof(UBYTE) * entry->te_ulCodewords);
+  delete entry->te_pDecoder;
+  delete entry->te_pCoder;
+  delete entry;
+}
+///
+
+/// TableCache::Unuse
+// Remove a user from the entry, and remove the oldest unused
+// entry if too many are kept.
+void TableCache::Unuse(struct Entry *entry)
+{
+  struct Entry **prev,**victim;
+  
+  assert(entry->te_ulUsers > 0);
+  if (--entry->te_ulUsers > 0)
+    return;
+
+  if (++m_ulUnused <= MaxUnused)
+    return;
+  //
+  // Too many tables kept, remove the oldest unused one.
+  victim = NULL;
+  for(prev = &m_pEntries;*prev;prev = &((*prev)->te_pNext)) {
+    if ((*prev)->te_ulUsers == 0)
+      victim = prev;
+  }
+  assert(victim);
+  entry   = *victim;
+  *victim = entry->te_pNext;
+  m_ulUnused--;
+  Dispose(entry);
+}
+///
+
+/// TableCache::FindDecoder
+// Find a decoder for the given huffman table. If found, it is
+// marked as used and returned, otherwise NULL is returned.
+class HuffmanDecoder *TableCache::FindDecoder(const UBYTE *lengths,const UBYTE *values,ULONG count)
+{
+  class HuffmanDecoder *decoder = NULL;
+  struct Entry *entry;
+
+  Lock();
+  entry = FindEntry(lengths,values,count,HashOf(lengths,values,count));
+  if (entry && entry->te_pDecoder) {
+    Use(entry);
+    decoder = entry->te_pDecoder;
+  }
+  Unlock();
+
+  return decoder;
+}
+///
+
+/// TableCache::AddDecoder
+// Offer a decoder the caller just built from the given table, and
+// return the decoder the caller shall use from now on.
+class HuffmanDecoder *TableCache::AddDecoder(const UBYTE *lengths,const UBYTE *values,ULONG count,
+                                             class HuffmanDecoder *decoder)
+{
+  class HuffmanDecoder *volatile result = decoder;
+  class HuffmanDecoder *volatile copy   = NULL;
+
+  Lock();
+  JPG_TRY {
+    ULONG hash          = HashOf(lengths,values,count);
+    struct Entry *entry = FindEntry(lengths,values,count,hash);
+    //
+    // Another object may have entered the table in the meantime.
+    if (entry == NULL)
+      entry = CreateEntry(lengths,values,count,hash);
+    if (entry->te_pDecoder == NULL) {
+#ifdef HAVE_WORKER_THREADS
+      // The decoder is allocated from the environment of its
+      // creator, but may outlive it. Keep a copy.
+      copy = new(m_pEnviron) class HuffmanDecoder(m_pEnviron);
+      copy->CopyFrom(decoder);
+      entry->te_pDecoder = copy;
+      copy               = NULL;
+#else
+      entry->te_pDecoder = decoder;
+#endif
+    }
+    Use(entry);
+    result = entry->te_pDecoder;
+  } JPG_CATCH {
+    // Could not enter the table, the caller keeps its decoder.
+    delete copy;
+    result = decoder;
+  } JPG_ENDTRY;
+  Unlock();
+
+  if (result != decoder)
+    delete decoder;
+
+  return result;
+}
+///
+
+/// TableCache::ReleaseDecoder
+// Return a decoder that is no longer used. Decoders that are not
+// in the cache are deleted.
+void TableCache::ReleaseDecoder(class HuffmanDecoder *decoder)
+{
+  struct Entry *entry;
+
+  Lock();
+  for(entry = m_pEntries;entry;entry = entry->te_pNext) {
+    if (entry->te_pDecoder == decoder) {
+      Unuse(entry);
+      break;
+    }
+  }
+  Unlock();
+  
+  if (entry == NULL)
+    delete decoder;
+}
+///
+
+/// TableCache::AcquireCoder
+// Return an encoder for the given huffman table, building it if
+// required. Returns NULL if no encoder could be provided.
+class HuffmanCoder *TableCache::AcquireCoder(const UBYTE *lengths,const UBYTE *values,ULONG count)
+{
+  class HuffmanCoder *volatile coder = NULL;
+
+  Lock();
+  JPG_TRY {
+    ULONG hash          = HashOf(lengths,values,count);
+    struct Entry *entry = FindEntry(lengths,values,count,hash);
+    //
+    if (entry == NULL)
+      entry = CreateEntry(lengths,values,count,hash);
+    //
+    // Building the encoder does not throw, thus it can be
+    // done here in the environment of the cache.
+    if (entry->te_pCoder == NULL)
+      entry->te_pCoder = new(m_pEnviron) class HuffmanCoder(entry->te_ucLengths,entry->te_pucValues);
+    Use(entry);
+    coder = entry->te_pCoder;
+  } JPG_CATCH {
+    coder = NULL;
+  } JPG_ENDTRY;
+  Unlock();
+
+  return coder;
+}
+///
+
+/// TableCache::ReleaseCoder
+// Return an encoder that is no longer used. Encoders that are not
+// in the cache are deleted.
+void TableCache::ReleaseCoder(class HuffmanCoder *coder)
+{
+  struct Entry *entry;
+
+  Lock();
+  for(entry = m_pEntries;entry;entry = entry->te_pNext) {
+    if (entry->te_pCoder == coder) {
+      Unuse(entry);
+      break;
+    }
+  }
+  Unlock();
+  
+  if (entry == NULL)
+    delete coder;
+}
+///
+
+/// TableCache::FindCurveEntry
+// Find the curve table for the given curve and key, or return NULL.
+struct TableCache::CurveEntry *TableCache::FindCurveEntry(const class ParametricToneMappingBox *curve,
+                                                          const struct CurveKey &key) const
+{
+  struct CurveEntry *entry;
+
+  for(entry = m_pCurves;entry;entry = entry->ce_pNext) {
+    const struct CurveKey &k = entry->ce_Key;
+    if (k.ck_ucKind         == key.ck_ucKind         &&
+        k.ck_ucInputBits    == key.ck_ucInputBits    &&
+        k.ck_ucOutputBits   == key.ck_ucOutputBits   &&
+        k.ck_ucInputFracts  == key.ck_ucInputFracts  &&
+        k.ck_ucOutputFracts == key.ck_ucOutputFracts &&
+        k.ck_ucTableBits    == key.ck_ucTableBits    &&
+        k.ck_ulInputOffset  == key.ck_ulInputOffset  &&
+        curve->CompareCurve(ParametricToneMappingBox::CurveType(k.ck_ucCurve),k.ck_ucE,
+                            k.ck_fP1,k.ck_fP2,k.ck_fP3,k.ck_fP4))
+      return entry;
+  }
+
+  return NULL;
+}
+///
+
+/// TableCache::DisposeCurve
+// Release a curve entry including its table.
+void TableCache::DisposeCurve(struct CurveEntry *entry)
+{
+  if (entry->ce_pTable)
+    m_pEnviron->FreeMem(entry->ce_pTable,entry->ce_ulSize);
+  delete entry;
+}
+///
+
+/// TableCache::UnuseCurve
+// Remove a user from a curve table, and remove the oldest unused
+// curve table if too many are kept.
+void TableCache::UnuseCurve(struct CurveEntry *entry)
+{
+  struct CurveEntry **prev,**victim;
+  
+  assert(entry->ce_ulUsers > 0);
+  if (--entry->ce_ulUsers > 0)
+    return;
+
+  if (++m_ulUnusedCurves <= MaxUnusedCurves)
+    return;
+  //
+  // Too many tables kept, remove the oldest unused one.
+  victim = NULL;
+  for(prev = &m_pCurves;*prev;prev = &((*prev)->ce_pNext)) {
+    if ((*prev)->ce_ulUsers == 0)
+      victim = prev;
+  }
+  assert(victim);
+  entry   = *victim;
+  *victim = entry->ce_pNext;
+  m_ulUnusedCurves--;
+  DisposeCurve(entry);
+}
+///
+
+/// TableCache::FindCurveTable
+// Find a table computed from the given curve with the parameters
+// in the key. If found, it is marked as used and returned.
+void *TableCache::FindCurveTable(const class ParametricToneMappingBox *curve,const struct CurveKey &key)
+{
+  struct CurveEntry *entry;
+  void *table = NULL;
+
+  Lock();
+  if ((entry = FindCurveEntry(curve,key))) {
+    if (entry->ce_ulUsers++ == 0)
+      m_ulUnusedCurves--;
+    table = entry->ce_pTable;
+  }
+  Unlock();
+
+  return table;
+}
+///
+
+/// TableCache::AddCurveTable
+// Offer a table the caller just computed from the curve, and
+// return the table the caller shall use from now on.
+void *TableCache::AddCurveTable(const class ParametricToneMappingBox *curve,const struct CurveKey &key,
+                                void *table,ULONG size)
+{
+  void *volatile result = table;
+  void *volatile copy   = NULL;
+
+  Lock();
+  JPG_TRY {
+    struct CurveEntry *entry = FindCurveEntry(curve,key);
+    //
+    // Another object may have computed the table in the meantime.
+    if (entry == NULL) {
+#ifdef HAVE_WORKER_THREADS
+      // The table is allocated from the environment of its
+      // creator, but may outlive it. Keep a copy.
+      copy = m_pEnviron->AllocMem(size);
+      memcpy(copy,table,size);
+#else
+      copy = table;
+#endif
+      entry             = new(m_pEnviron) struct CurveEntry;
+      entry->ce_Key     = key;
+      entry->ce_pTable  = copy;
+      entry->ce_ulSize  = size;
+      entry->ce_ulUsers = 0;
+      entry->ce_pNext   = m_pCurves;
+      m_pCurves         = entry;
+      m_ulUnusedCurves++;
+      copy              = NULL;
+    }
+    if (entry->ce_ulUsers++ == 0)
+      m_ulUnusedCurves--;
+    result = entry->ce_pTable;
+  } JPG_CATCH {
+    // Could not enter the table, the caller keeps its table.
+#ifdef HAVE_WORKER_THREADS
+    if (copy)
+      m_pEnviron->FreeMem(copy,size);
+#endif
+    result = table;
+  } JPG_ENDTRY;
+  Unlock();
+
+  return result;
+}
+///
+
+/// TableCache::ReleaseCurveTable
+// Return a curve table that is no longer used. Returns false if
+// the table is not owned by the cache.
+bool TableCache::ReleaseCurveTable(void *table)
+{
+  struct CurveEntry *entry;
+
+  Lock();
+  for(entry = m_pCurves;entry;entry = entry->ce_pNext) {
+    if (entry->ce_pTable == table) {
+      UnuseCurve(entry);
+      break;
+    }
+  }
+  Unlock();
+
+  return (entry != NULL);
+}
+///
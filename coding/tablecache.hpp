@@ -0,0 +1,322 @@
+/*************************************************************************
+
+    This project implements a complete(!) JPEG (Recommendation ITU-T
+    T.81 | ISO/IEC 10918-1) codec, plus a library that can be used to
+    encode and decode JPEG streams. 
+    It also implements ISO/IEC 18477 aka JPEG XT which is an extension
+    towards intermediate, high-dynamic-range lossy and lossless coding
+    of JPEG. In specific, it supports ISO/IEC 18477-3/-6/-7/-8 encoding.
+
+    Note that only Profiles C and D of ISO/IEC 18477-7 are supported
+    here. Check the JPEG XT reference software for a full implementation
+    of ISO/IEC 18477-7.
+
+    Copyright (C) 2012-2018 Thomas Richter, University of Stuttgart and
+    Accusoft. (C) 2019-2020 Thomas Richter, Fraunhofer IIS.
+
+    This program is available under two licenses, GPLv3 and the ITU
+    Software licence Annex A Option 2, RAND conditions.
+
+    For the full text of the GPU license option, see README.license.gpl.
+    For the full text of the ITU license option, see README.license.itu.
+    
+    You may freely select between these two options.
+
+    For the GPL option, please note the following:
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+/*
+**
+** This class keeps Huffman coders and decoders built from DHT tables,
+** and lookup tables built from parametric tone mapping curves, such
+** that all JPEG objects of the process can share them.
+**
+** $Id$
+**
+*/
+
+#ifndef CODING_TABLECACHE_HPP
+#define CODING_TABLECACHE_HPP
+
+/// Includes
+#include "tools/environment.hpp"
+#include "std/pthread.hpp"
+///
+
+/// Forwards
+class HuffmanDecoder;
+class HuffmanCoder;
+class ParametricToneMappingBox;
+///
+
+/// Design
+/** Design
+******************************************************************
+** class TableCache                                             **
+** Super Class: JKeeper                                         **
+** Sub Classes: none                                            **
+** Friends:     none                                            **
+******************************************************************
+
+The table cache collects Huffman decoders and encoders by the
+contents of the DHT table they were built from. A HuffmanTemplate
+first looks here before building a coder of its own, and returns it
+here instead of deleting it. Coders and decoders are only read from
+while coding, hence the same object may be used by several templates
+at once. Each entry counts its users, and a limited number of unused
+entries is kept for later images.
+
+If the library is configured for multithreading, there is only one
+cache for the entire process, shared by all JPEG objects and protected
+by a mutex. It owns an environment of its own from which all cached
+tables are allocated, such that they remain valid regardless of which
+object created them and which object releases them last. Since the
+environment of the cache must not throw into the environment of its
+clients, decoders are built by the client as before and then copied
+into the cache. The cache is released as soon as the last JPEG object
+detaches from it.
+
+The same holds for the lookup tables derived from parametric tone
+mapping curves. They are keyed by the curve parameters, which are
+compared by the curve box itself, and the bit depths and table size
+they were computed for. Computing them evaluates the curve for up to
+64K entries, which is far more expensive than copying the result into
+the cache. Since these tables are large, fewer of them are kept while
+not in use.
+
+Otherwise, the library cannot protect shared data, and each root
+environment gets a private cache allocating from this environment.
+Without multithreading, which is the default configuration, tables
+are therefore only shared between the images decoded or encoded by
+the same JPEG object, e.g. after JPEG::Reset(), but not between
+distinct JPEG objects. A process wide cache would require a lock,
+and the library must remain usable from several application threads
+with one JPEG object each even if built without thread support.
+* */
+///
+
+/// class TableCache
+// Keeps Huffman coders and decoders for re-use.
+class TableCache : public JKeeper {
+  //
+public:
+  //
+  // Kinds of tables derived from a tone mapping curve.
+  enum CurveTableKind {
+    ScaledCurve,  // integer table, see ScaledTableOf()
+    FloatCurve,   // floating point table, see FloatTableOf()
+    InverseCurve  // the extended inverse integer table
+  };
+  //
+  // Describes a table built from a tone mapping curve.
+  struct CurveKey {
+    //
+    // The kind of the table, see above.
+    UBYTE                  ck_ucKind;
+    //
+    // The curve parameters, the curve type is that of the
+    // ParametricToneMappingBox.
+    UBYTE                  ck_ucCurve;
+    UBYTE                  ck_ucE;
+    FLOAT                  ck_fP1;
+    FLOAT                  ck_fP2;
+    FLOAT                  ck_fP3;
+    FLOAT                  ck_fP4;
+    //
+    // The bit depths and the table size.
+    UBYTE                  ck_ucInputBits;
+    UBYTE                  ck_ucOutputBits;
+    UBYTE                  ck_ucInputFracts;
+    UBYTE                  ck_ucOutputFracts;
+    UBYTE                  ck_ucTableBits;
+    ULONG                  ck_ulInputOffset;
+  };
+  //
+private:
+  //
+  // Maximum number of tables kept while not in use.
+  enum {
+    MaxUnused       = 64,
+    MaxUnusedCurves = 16
+  };
+  //
+  // Cached tables, along with the DHT table they were built from.
+  struct Entry : public JObject {
+    //
+    // Next entry, most recently added first.
+    struct Entry          *te_pNext;
+    //
+    // Hash of the table for quick rejection.
+    ULONG                  te_ulHash;
+    //
+    // The table itself.
+    UBYTE                  te_ucLengths[16];
+    ULONG                  te_ulCodewords;
+    UBYTE                 *te_pucValues;
+    //
+    // The decoder and encoder built from it, if any.
+    class HuffmanDecoder  *te_pDecoder;
+    class HuffmanCoder    *te_pCoder;
+    //
+    // Number of templates using the decoder or encoder.
+    ULONG                  te_ulUsers;
+  }                       *m_pEntries;
+  //
+  // Number of entries without users.
+  ULONG                    m_ulUnused;
+  //
+  // Cached tables computed from tone mapping curves.
+  struct CurveEntry : public JObject {
+    //
+    // Next entry, most recently added first.
+    struct CurveEntry     *ce_pNext;
+    //
+    // Curve and parameters the table was built for.
+    struct CurveKey        ce_Key;
+    //
+    // The table and its size in bytes.
+    void                  *ce_pTable;
+    ULONG                  ce_ulSize;
+    //
+    // Number of boxes using the table.
+    ULONG                  ce_ulUsers;
+  }                       *m_pCurves;
+  //
+  // Number of curve tables without users.
+  ULONG                    m_ulUnusedCurves;
+  //
+#ifdef HAVE_WORKER_THREADS
+  // Protects the shared cache and its entries.
+  static pthread_mutex_t   m_Lock;
+  //
+  // The environment all shared tables are allocated from.
+  static class Environ     m_SharedEnviron;
+  //
+  // The cache of the process, if any.
+  static class TableCache *m_pShared;
+  //
+  // Number of root environments attached to it.
+  static ULONG             m_ulSharedUsers;
+#endif
+  //
+  // Lock and unlock the cache.
+  static void Lock(void)
+  {
+#ifdef HAVE_WORKER_THREADS
+    pthread_mutex_lock(&m_Lock);
+#endif
+  }
+  static void Unlock(void)
+  {
+#ifdef HAVE_WORKER_THREADS
+    pthread_mutex_unlock(&m_Lock);
+#endif
+  }
+  //
+  // Compute the hash of a huffman table.
+  static ULONG HashOf(const UBYTE *lengths,const UBYTE *values,ULONG count);
+  //
+  // Find the entry for the given table, or return NULL.
+  struct Entry *FindEntry(const UBYTE *lengths,const UBYTE *values,ULONG count,ULONG hash) const;
+  //
+  // Create a new, unused entry for the given table. May throw.
+  struct Entry *CreateEntry(const UBYTE *lengths,const UBYTE *values,ULONG count,ULONG hash);
+  //
+  // Mark an entry as used.
+  void Use(struct Entry *entry)
+  {
+    if (entry->te_ulUsers++ == 0)
+      m_ulUnused--;
+  }
+  //
+  // Remove a user from the entry, and remove the oldest unused
+  // entry if too many are kept.
+  void Unuse(struct Entry *entry);
+  //
+  // Release an entry including its tables.
+  void Dispose(struct Entry *entry);
+  //
+  // Find the curve table for the given curve and key, or return NULL.
+  struct CurveEntry *FindCurveEntry(const class ParametricToneMappingBox *curve,
+                                    const struct CurveKey &key) const;
+  //
+  // Remove a user from a curve table, and remove the oldest unused
+  // curve table if too many are kept.
+  void UnuseCurve(struct CurveEntry *entry);
+  //
+  // Release a curve entry including its table.
+  void DisposeCurve(struct CurveEntry *entry);
+  //
+  TableCache(class Environ *env);
+  //
+  ~TableCache(void);
+  //
+public:
+  //
+  // Return the table cache for the given root environment, either
+  // the one of the process or a private one. Returns NULL if no cache
+  // could be created, tables are then not shared.
+  static class TableCache *Attach(class Environ *env);
+  //
+  // Detach from the cache obtained by Attach().
+  static void Detach(class TableCache *cache);
+  //
+  // Find a decoder for the given huffman table. If found, it is
+  // marked as used and returned, otherwise NULL is returned.
+  class HuffmanDecoder *FindDecoder(const UBYTE *lengths,const UBYTE *values,ULONG count);
+  //
+  // Offer a decoder the caller just built from the given table, and
+  // return the decoder the caller shall use from now on. This is either
+  // a decoder owned by the cache, in which case the offered decoder is
+  // deleted, or the offered decoder if it could not be entered into
+  // the cache.
+  class HuffmanDecoder *AddDecoder(const UBYTE *lengths,const UBYTE *values,ULONG count,
+                                   class HuffmanDecoder *decoder);
+  //
+  // Return a decoder that is no longer used. Decoders that are not
+  // in the cache are deleted.
+  void ReleaseDecoder(class HuffmanDecoder *decoder);
+  //
+  // Return an encoder for the given huffman table, building it if
+  // required. Returns NULL if no encoder could be provided, the caller
+  // then has to build one itself.
+  class HuffmanCoder *AcquireCoder(const UBYTE *lengths,const UBYTE *values,ULONG count);
+  //
+  // Return an encoder that is no longer used. Encoders that are not
+  // in the cache are deleted.
+  void ReleaseCoder(class HuffmanCoder *coder);
+  //
+  // Find a table computed from the given curve with the parameters
+  // in the key. If found, it is marked as used and returned, otherwise
+  // NULL is returned. The table must not be altered.
+  void *FindCurveTable(const class ParametricToneMappingBox *curve,const struct CurveKey &key);
+  //
+  // Offer a table of the given size in bytes the caller just computed
+  // from the curve, and return the table the caller shall use from
+  // now on. If this is not the offered table, the caller still owns
+  // the offered table and shall release it.
+  void *AddCurveTable(const class ParametricToneMappingBox *curve,const struct CurveKey &key,
+                      void *table,ULONG size);
+  //
+  // Return a curve table that is no longer used. Returns false if
+  // the table is not owned by the cache, the caller shall then
+  // release it itself.
+  bool ReleaseCurveTable(void *table);
+};
+///
+
+///
+#endif
@@ -147,6 +147,13 @@ public:
   virtual void YCbCr2RGB(const RectAngle<LONG> &r,const struct ImageBitMap *const *dest,
                          Buffer source,Buffer residual) = 0;
   //
+  // Inverse transform a row of horizontally adjacent blocks from YCbCr to RGB in one go.
+  // The rectangle may extend over several blocks, but not over more than one block row.
+  // Block k of the row, counted from the block containing the left edge of the rectangle,
+  // is found at offset k << 6 of the source and residual buffers of each component.
+  virtual void YCbCr2RGBRow(const RectAngle<LONG> &r,const struct ImageBitMap *const *dest,
+                            Buffer source,Buffer residual) = 0;
+  //
   // Return the external pixel type of this trafo.
   virtual UBYTE PixelTypeOf(void) const = 0;
 };
@@ -162,6 +162,10 @@ public:
   virtual void YCbCr2RGB(const RectAngle<LONG> &r,const struct ImageBitMap *const *dest,
                          Buffer source,Buffer residual) = 0;
   //
+  // Inverse transform a row of blocks from YCbCr to RGB.
+  virtual void YCbCr2RGBRow(const RectAngle<LONG> &r,const struct ImageBitMap *const *dest,
+                            Buffer source,Buffer residual) = 0;
+  //
   // Return the external pixel type of this trafo.
   virtual UBYTE PixelTypeOf(void) const
   {
@@ -148,6 +148,10 @@ public:
   virtual void YCbCr2RGB(const RectAngle<LONG> &r,const struct ImageBitMap *const *dest,
                          Buffer source,Buffer residuals) = 0;
   //
+  // Inverse transform a row of blocks from YCbCr to RGB.
+  virtual void YCbCr2RGBRow(const RectAngle<LONG> &r,const struct ImageBitMap *const *dest,
+                            Buffer source,Buffer residuals) = 0;
+  //
   // Return the pixel type of this transformer.
   virtual UBYTE PixelTypeOf(void) const = 0;
   //
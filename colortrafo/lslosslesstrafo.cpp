@@ -366,30 +366,30 @@ void LSLosslessTrafo<external,count>::RGB2Residual(const RectAngle<LONG> &,const
 }
 ///
 
-/// LSLosslessTrafo::YCbCr2RGB
-// Inverse transform a block from YCbCr to RGB, including a clipping operation and a dc level
+/// LSLosslessTrafo::YCbCr2RGBRow
+// Inverse transform a row of blocks from YCbCr to RGB, including a clipping operation and a dc level
 // shift.
 template<typename external,int count>
-void LSLosslessTrafo<external,count>::YCbCr2RGB(const RectAngle<LONG> &r,
-                                                const struct ImageBitMap *const *dest,
-                                                Buffer source,Buffer)
+void LSLosslessTrafo<external,count>::YCbCr2RGBRow(const RectAngle<LONG> &r,
+                                                   const struct ImageBitMap *const *dest,
+                                                   Buffer source,Buffer)
 { 
   LONG x,y;
   LONG xmin   = r.ra_MinX & 7;
   LONG ymin   = r.ra_MinY & 7;
-  LONG xmax   = r.ra_MaxX & 7;
+  LONG xmax   = xmin + r.ra_MaxX - r.ra_MinX;
   LONG ymax   = r.ra_MaxY & 7;
   
   assert(m_lMax == m_lOutMax);
 
   if (m_lMax > TypeTrait<external>::Max) {
-    JPG_THROW(OVERFLOW_PARAMETER,"LSLosslessTrafo::YCbCr2RGB",
+    JPG_THROW(OVERFLOW_PARAMETER,"LSLosslessTrafo::YCbCr2RGBRow",
               "RGB maximum intensity for pixel type does not fit into the type");
   }
   
   for(x = 0;x < count;x++) {
     if (dest[0]->ibm_ucPixelType != dest[x]->ibm_ucPixelType) {
-      JPG_THROW(INVALID_PARAMETER,"LSLosslessTrafo::YCbCr2RGB",
+      JPG_THROW(INVALID_PARAMETER,"LSLosslessTrafo::YCbCr2RGBRow",
                 "pixel types of all components in a YCbCr to RGB conversion must be identical");
     }
   }
@@ -521,6 +521,19 @@ void LSLosslessTrafo<external,count>::YCbCr2RGB(const RectAngle<LONG> &r,
           b  = (external *)((UBYTE *)(b) + dest[2]->ibm_cBytesPerPixel);
           srcp[2]++;
         }
+        //
+        // At the end of a block, continue with the same line of the next block.
+        if ((x & 7) == 7) {
+          switch(count) {
+          case 4:
+            srcp[3] += 56;
+            // fall through
+          case 3:
+            srcp[0] += 56;
+            srcp[1] += 56;
+            srcp[2] += 56;
+          }
+        }
       }
       switch(count) {
       case 4:
@@ -146,7 +146,15 @@ public:
   // Inverse transform a block from YCbCr to RGB, incuding a clipping operation and a dc level
   // shift.
   virtual void YCbCr2RGB(const RectAngle<LONG> &r,const struct ImageBitMap *const *dest,
-                         Buffer source,Buffer residual);
+                         Buffer source,Buffer residual)
+  {
+    // A single block is just a short row.
+    YCbCr2RGBRow(r,dest,source,residual);
+  }
+  //
+  // Inverse transform a row of blocks from YCbCr to RGB.
+  virtual void YCbCr2RGBRow(const RectAngle<LONG> &r,const struct ImageBitMap *const *dest,
+                            Buffer source,Buffer residual);
   //
   // Return the number of fractional bits this color transformation requires.
   // None, this is integer to integer.
@@ -182,27 +182,27 @@ void TrivialTrafo<internal,external,count>::RGB2YCbCr(const RectAngle<LONG> &r,c
 }
 ///
 
-/// TrivialTrafo::YCbCr2RGB
-// Inverse transform a block from YCbCr to RGB, including a clipping operation and a dc level
+/// TrivialTrafo::YCbCr2RGBRow
+// Inverse transform a row of blocks from YCbCr to RGB, including a clipping operation and a dc level
 // shift.
 template<typename internal,typename external,int count>
-void TrivialTrafo<internal,external,count>::YCbCr2RGB(const RectAngle<LONG> &r,const struct ImageBitMap *const *dest,
-                                                      Buffer source,Buffer)
+void TrivialTrafo<internal,external,count>::YCbCr2RGBRow(const RectAngle<LONG> &r,const struct ImageBitMap *const *dest,
+                                                         Buffer source,Buffer)
 { 
   LONG x,y;
   LONG xmin   = r.ra_MinX & 7;
   LONG ymin   = r.ra_MinY & 7;
-  LONG xmax   = r.ra_MaxX & 7;
+  LONG xmax   = xmin + r.ra_MaxX - r.ra_MinX;
   LONG ymax   = r.ra_MaxY & 7;
   
   if (TypeTrait<external>::isFloat == false && m_lMax > TypeTrait<external>::Max) {
-    JPG_THROW(OVERFLOW_PARAMETER,"TrivialTrafo::YCbCr2RGB",
+    JPG_THROW(OVERFLOW_PARAMETER,"TrivialTrafo::YCbCr2RGBRow",
               "RGB maximum intensity for pixel type does not fit into the type");
   }
   
   for(x = 1;x < count;x++) {
     if (dest[0]->ibm_ucPixelType != dest[x]->ibm_ucPixelType) {
-      JPG_THROW(INVALID_PARAMETER,"TrivialTrafo::YCbCr2RGB",
+      JPG_THROW(INVALID_PARAMETER,"TrivialTrafo::YCbCr2RGBRow",
                 "pixel types of all three components in a RGB to RGB conversion must be identical");
     }
   }
@@ -283,6 +283,23 @@ void TrivialTrafo<internal,external,count>::YCbCr2RGB(const RectAngle<LONG> &r,c
           *r = rv;
           r  = (external *)((UBYTE *)(r) + dest[0]->ibm_cBytesPerPixel);
         }
+        //
+        // At the end of a block, continue with the same line of the next block.
+        if ((x & 7) == 7) {
+          switch(count) {
+          case 4:
+            ksrc  += 56;
+            /* fall through */
+          case 3:
+            crsrc += 56;
+            /* fall through */
+          case 2:
+            cbsrc += 56;
+            /* fall through */
+          case 1:
+            ysrc  += 56;
+          }
+        }
       }
       switch(count) {
       case 4:
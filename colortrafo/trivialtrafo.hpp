@@ -97,7 +97,15 @@ public:
   // Inverse transform a block from YCbCr to RGB, incuding a clipping operation and a dc level
   // shift. Additionally may integrate a residual stream.
   virtual void YCbCr2RGB(const RectAngle<LONG> &r,const struct ImageBitMap *const *dest,
-                         Buffer source,Buffer res); 
+                         Buffer source,Buffer res)
+  {
+    // A single block is just a short row.
+    YCbCr2RGBRow(r,dest,source,res);
+  }
+  //
+  // Inverse transform a row of blocks from YCbCr to RGB.
+  virtual void YCbCr2RGBRow(const RectAngle<LONG> &r,const struct ImageBitMap *const *dest,
+                            Buffer source,Buffer res);
   // 
   // Compute the residual from the original image and the decoded LDR image, place result in
   // the output buffer. This depends rather on the coding model.
@@ -672,28 +672,69 @@ void YCbCrTrafo<external,count,oc,trafo,rtrafo>::RGB2Residual(const RectAngle<LO
 }
 ///
  
-/// YCbCrTrafo::YCbCr2RGB
-// Inverse transform a block from YCbCr to RGB, including a clipping operation and a dc level
+/// YCbCrTrafo::YCbCr2RGBRow
+// Inverse transform a row of blocks from YCbCr to RGB, including a clipping operation and a dc level
 // shift.
 template<typename external,int count,UBYTE oc,int trafo,int rtrafo>
-void YCbCrTrafo<external,count,oc,trafo,rtrafo>::YCbCr2RGB(const RectAngle<LONG> &r,
-                                                           const struct ImageBitMap *const *dest,
-                                                           Buffer source,Buffer residual)
+void YCbCrTrafo<external,count,oc,trafo,rtrafo>::YCbCr2RGBRow(const RectAngle<LONG> &r,
+                                                              const struct ImageBitMap *const *dest,
+                                                              Buffer source,Buffer residual)
 { 
   LONG x,y;
   LONG xmin   = r.ra_MinX & 7;
   LONG ymin   = r.ra_MinY & 7;
-  LONG xmax   = r.ra_MaxX & 7;
+  LONG xmax   = xmin + r.ra_MaxX - r.ra_MinX;
   LONG ymax   = r.ra_MaxY & 7;
   
   assert(source);
   
   if (m_lOutMax > TypeTrait<external>::Max) {
-    JPG_THROW(OVERFLOW_PARAMETER,"YCbCrTrafo::YCbCr2RGB",
+    JPG_THROW(OVERFLOW_PARAMETER,"YCbCrTrafo::YCbCr2RGBRow",
               "RGB maximum intensity for pixel type does not fit into the type");
   }
 
   {
+    //
+    // Everything the loop below reads from this object or the bitmaps is
+    // pulled into locals first. The output is written through (possibly
+    // character) pointers which could otherwise alias all of it, forcing
+    // the compiler to reload it for every pixel. This keeps the tables,
+    // matrices and strides in registers, and allows the compiler to hoist
+    // the tests for absent tables out of the loop.
+    // The loop stays scalar on purpose: SSE2 has no gather for the table
+    // lookups, the matrices need signed 32x32->64 bit products which
+    // SSE2 lacks (it only multiplies unsigned), and the output is stored
+    // pixel by pixel through the bitmap strides. An SSE2 version would
+    // have to emulate all of this and would cost more than it saves.
+    const LONG *dlut[3],*rlut[3],*r2lut[3];
+    LONG lmat[9],rmat[9],cmat[9];
+    BYTE bpp[4];
+    LONG bpr[4];
+    const LONG outshift = m_lOutDCShift;
+    const LONG dcshift  = m_lDCShift;
+    const LONG lmax     = m_lMax;
+    const LONG rmax     = m_lRMax;
+    const LONG outmax   = m_lOutMax;
+    // For float output, avoid NANs. For that, compute the value of +INF and -INF.
+    const LONG pinf     = (outmax >> 1) - (outmax >> 6) - 1;
+    // The representation of -INF.
+    const LONG minf     = INVERT_NEGS(pinf | 0x8000);
+    //
+    for(x = 0;x < 3;x++) {
+      dlut[x]  = m_plDecodingLUT[x];
+      rlut[x]  = m_plResidualLUT[x];
+      r2lut[x] = m_plResidual2LUT[x];
+    }
+    for(x = 0;x < 9;x++) {
+      lmat[x]  = m_lL[x];
+      rmat[x]  = m_lR[x];
+      cmat[x]  = m_lC[x];
+    }
+    for(x = 0;x < count;x++) {
+      bpp[x]   = dest[x]->ibm_cBytesPerPixel;
+      bpr[x]   = dest[x]->ibm_lBytesPerRow;
+    }
+    //
     external *rptr,*gptr,*bptr,*kptr;
     switch(count) {
     case 4:
@@ -743,9 +784,9 @@ void YCbCrTrafo<external,count,oc,trafo,rtrafo>::YCbCr2RGB(const RectAngle<LONG>
       for(x = xmin;x <= xmax;x++) {
         LONG cr,y,cb,rv,gv,bv,kv;
         LONG rx,gx,bx;
-        LONG rr = m_lOutDCShift;
-        LONG rg = m_lOutDCShift;
-        LONG rb = m_lOutDCShift;
+        LONG rr = outshift;
+        LONG rg = outshift;
+        LONG rb = outshift;
 
         if (oc & Residual) {
           // Compute the residual. Note that the LUT is here applied *first*, then
@@ -761,50 +802,50 @@ void YCbCrTrafo<external,count,oc,trafo,rtrafo>::YCbCr2RGB(const RectAngle<LONG>
               y   = *rysrc++;
               cb  = *rcbsrc++;
               cr  = *rcrsrc++;
-              y   = APPLY_LUT(m_plResidualLUT[0],m_lRMax,y );
-              cb  = APPLY_LUT(m_plResidualLUT[1],m_lRMax,cb);
-              cr  = APPLY_LUT(m_plResidualLUT[2],m_lRMax,cr);
+              y   = APPLY_LUT(rlut[0],rmax,y );
+              cb  = APPLY_LUT(rlut[1],rmax,cb);
+              cr  = APPLY_LUT(rlut[2],rmax,cr);
               y   = y >> 1; // Remove the one bit preshift
-              cb  = cb - (m_lOutDCShift << 1);
-              cr  = cr - (m_lOutDCShift << 1);
-              rg  = (y  - ((cb + cr) >> 2)) & m_lOutMax;
-              rr  = (cr + rg)               & m_lOutMax;
-              rb  = (cb + rg)               & m_lOutMax;
+              cb  = cb - (outshift << 1);
+              cr  = cr - (outshift << 1);
+              rg  = (y  - ((cb + cr) >> 2)) & outmax;
+              rr  = (cr + rg)               & outmax;
+              rb  = (cb + rg)               & outmax;
               break;
             case MergingSpecBox::YCbCr:
               // Input data is here preshifted.
               y   = *rysrc++;
               cb  = *rcbsrc++;
               cr  = *rcrsrc++;
-              y   = APPLY_LUT(m_plResidualLUT[0],((m_lRMax + 1) << COLOR_BITS) - 1,y );
-              cb  = APPLY_LUT(m_plResidualLUT[1],((m_lRMax + 1) << COLOR_BITS) - 1,cb);
-              cr  = APPLY_LUT(m_plResidualLUT[2],((m_lRMax + 1) << COLOR_BITS) - 1,cr);
-              cb -= (m_lOutDCShift << COLOR_BITS);
-              cr -= (m_lOutDCShift << COLOR_BITS);
-              rr  = FIX_COLOR_TO_INTCOLOR(QUAD(y) * m_lR[0] + QUAD(cb) * m_lR[1] + QUAD(cr) * m_lR[2]);
-              rg  = FIX_COLOR_TO_INTCOLOR(QUAD(y) * m_lR[3] + QUAD(cb) * m_lR[4] + QUAD(cr) * m_lR[5]);
-              rb  = FIX_COLOR_TO_INTCOLOR(QUAD(y) * m_lR[6] + QUAD(cb) * m_lR[7] + QUAD(cr) * m_lR[8]);
+              y   = APPLY_LUT(rlut[0],((rmax + 1) << COLOR_BITS) - 1,y );
+              cb  = APPLY_LUT(rlut[1],((rmax + 1) << COLOR_BITS) - 1,cb);
+              cr  = APPLY_LUT(rlut[2],((rmax + 1) << COLOR_BITS) - 1,cr);
+              cb -= (outshift << COLOR_BITS);
+              cr -= (outshift << COLOR_BITS);
+              rr  = FIX_COLOR_TO_INTCOLOR(QUAD(y) * rmat[0] + QUAD(cb) * rmat[1] + QUAD(cr) * rmat[2]);
+              rg  = FIX_COLOR_TO_INTCOLOR(QUAD(y) * rmat[3] + QUAD(cb) * rmat[4] + QUAD(cr) * rmat[5]);
+              rb  = FIX_COLOR_TO_INTCOLOR(QUAD(y) * rmat[6] + QUAD(cb) * rmat[7] + QUAD(cr) * rmat[8]);
               // Apply the secondary LUT.
-              rr  = APPLY_LUT(m_plResidual2LUT[0],((m_lOutMax + 1) << COLOR_BITS) - 1,rr);
-              rg  = APPLY_LUT(m_plResidual2LUT[1],((m_lOutMax + 1) << COLOR_BITS) - 1,rg);
-              rb  = APPLY_LUT(m_plResidual2LUT[2],((m_lOutMax + 1) << COLOR_BITS) - 1,rb);
+              rr  = APPLY_LUT(r2lut[0],((outmax + 1) << COLOR_BITS) - 1,rr);
+              rg  = APPLY_LUT(r2lut[1],((outmax + 1) << COLOR_BITS) - 1,rg);
+              rb  = APPLY_LUT(r2lut[2],((outmax + 1) << COLOR_BITS) - 1,rb);
               break;
             case MergingSpecBox::Identity:
               y   = *rysrc++;
               cb  = *rcbsrc++;
               cr  = *rcrsrc++;
               if (oc & ClampFlag) {
-                rr  = APPLY_LUT(m_plResidualLUT[0] ,((m_lRMax + 1) << COLOR_BITS) - 1,y );
-                rg  = APPLY_LUT(m_plResidualLUT[1] ,((m_lRMax + 1) << COLOR_BITS) - 1,cb);
-                rb  = APPLY_LUT(m_plResidualLUT[2] ,((m_lRMax + 1) << COLOR_BITS) - 1,cr);
+                rr  = APPLY_LUT(rlut[0] ,((rmax + 1) << COLOR_BITS) - 1,y );
+                rg  = APPLY_LUT(rlut[1] ,((rmax + 1) << COLOR_BITS) - 1,cb);
+                rb  = APPLY_LUT(rlut[2] ,((rmax + 1) << COLOR_BITS) - 1,cr);
                 // Apply the secondary LUT.
-                rr  = APPLY_LUT(m_plResidual2LUT[0],((m_lOutMax + 1) << COLOR_BITS) - 1,rr);
-                rg  = APPLY_LUT(m_plResidual2LUT[1],((m_lOutMax + 1) << COLOR_BITS) - 1,rg);
-                rb  = APPLY_LUT(m_plResidual2LUT[2],((m_lOutMax + 1) << COLOR_BITS) - 1,rb);
+                rr  = APPLY_LUT(r2lut[0],((outmax + 1) << COLOR_BITS) - 1,rr);
+                rg  = APPLY_LUT(r2lut[1],((outmax + 1) << COLOR_BITS) - 1,rg);
+                rb  = APPLY_LUT(r2lut[2],((outmax + 1) << COLOR_BITS) - 1,rb);
               } else {
-                rr  = APPLY_LUT(m_plResidualLUT[0],m_lRMax,y );
-                rg  = APPLY_LUT(m_plResidualLUT[1],m_lRMax,cb);
-                rb  = APPLY_LUT(m_plResidualLUT[2],m_lRMax,cr);
+                rr  = APPLY_LUT(rlut[0],rmax,y );
+                rg  = APPLY_LUT(rlut[1],rmax,cb);
+                rb  = APPLY_LUT(rlut[2],rmax,cr);
               }
               break;
             default:
@@ -818,10 +859,10 @@ void YCbCrTrafo<external,count,oc,trafo,rtrafo>::YCbCr2RGB(const RectAngle<LONG>
           case 1: 
             y  = *rysrc++;
             if (oc & ClampFlag) {
-              rr = APPLY_LUT(m_plResidualLUT[0] ,((m_lRMax   + 1) << COLOR_BITS) - 1,y);
-              rr = APPLY_LUT(m_plResidual2LUT[0],((m_lOutMax + 1) << COLOR_BITS) - 1,rr);
+              rr = APPLY_LUT(rlut[0] ,((rmax   + 1) << COLOR_BITS) - 1,y);
+              rr = APPLY_LUT(r2lut[0],((outmax + 1) << COLOR_BITS) - 1,rr);
             } else {
-              rr = APPLY_LUT(m_plResidualLUT[0],m_lRMax,y );
+              rr = APPLY_LUT(rlut[0],rmax,y );
             }
             break;
           }
@@ -841,12 +882,12 @@ void YCbCrTrafo<external,count,oc,trafo,rtrafo>::YCbCr2RGB(const RectAngle<LONG>
           switch(trafo) {
           case MergingSpecBox::YCbCr:
             // Data arrives preshifted here.
-            cr = *crsrc++ - (m_lDCShift << COLOR_BITS);
-            cb = *cbsrc++ - (m_lDCShift << COLOR_BITS);
+            cr = *crsrc++ - (dcshift << COLOR_BITS);
+            cb = *cbsrc++ - (dcshift << COLOR_BITS);
             y  = *ysrc++;
-            rv = FIX_COLOR_TO_INT(QUAD(y) * m_lL[0] + QUAD(cb) * m_lL[1] + QUAD(cr) * m_lL[2]);
-            gv = FIX_COLOR_TO_INT(QUAD(y) * m_lL[3] + QUAD(cb) * m_lL[4] + QUAD(cr) * m_lL[5]);
-            bv = FIX_COLOR_TO_INT(QUAD(y) * m_lL[6] + QUAD(cb) * m_lL[7] + QUAD(cr) * m_lL[8]);
+            rv = FIX_COLOR_TO_INT(QUAD(y) * lmat[0] + QUAD(cb) * lmat[1] + QUAD(cr) * lmat[2]);
+            gv = FIX_COLOR_TO_INT(QUAD(y) * lmat[3] + QUAD(cb) * lmat[4] + QUAD(cr) * lmat[5]);
+            bv = FIX_COLOR_TO_INT(QUAD(y) * lmat[6] + QUAD(cb) * lmat[7] + QUAD(cr) * lmat[8]);
             break;
           case MergingSpecBox::Identity:
             rv = COLOR_TO_INT(*ysrc++);
@@ -860,34 +901,34 @@ void YCbCrTrafo<external,count,oc,trafo,rtrafo>::YCbCr2RGB(const RectAngle<LONG>
           // Only if there is something to merge.
           if (oc & Extended) {
             // Apply the L-Lut.
-            rv = APPLY_LUT(m_plDecodingLUT[0],m_lMax,rv);
-            gv = APPLY_LUT(m_plDecodingLUT[1],m_lMax,gv);
-            bv = APPLY_LUT(m_plDecodingLUT[2],m_lMax,bv);
+            rv = APPLY_LUT(dlut[0],lmax,rv);
+            gv = APPLY_LUT(dlut[1],lmax,gv);
+            bv = APPLY_LUT(dlut[2],lmax,bv);
             //
             // Apply the C-Transformation.
-            rx = FIX_TO_INT(QUAD(rv) * m_lC[0] + QUAD(gv) * m_lC[1] + QUAD(bv) * m_lC[2]);
-            gx = FIX_TO_INT(QUAD(rv) * m_lC[3] + QUAD(gv) * m_lC[4] + QUAD(bv) * m_lC[5]);
-            bx = FIX_TO_INT(QUAD(rv) * m_lC[6] + QUAD(gv) * m_lC[7] + QUAD(bv) * m_lC[8]);
+            rx = FIX_TO_INT(QUAD(rv) * cmat[0] + QUAD(gv) * cmat[1] + QUAD(bv) * cmat[2]);
+            gx = FIX_TO_INT(QUAD(rv) * cmat[3] + QUAD(gv) * cmat[4] + QUAD(bv) * cmat[5]);
+            bx = FIX_TO_INT(QUAD(rv) * cmat[6] + QUAD(gv) * cmat[7] + QUAD(bv) * cmat[8]);
             //
             // There is no clamping here.
             //
             // Merge LDR and HDR
-            rv = rx + rr - m_lOutDCShift;
-            gv = gx + rg - m_lOutDCShift;
-            bv = bx + rb - m_lOutDCShift;
+            rv = rx + rr - outshift;
+            gv = gx + rg - outshift;
+            bv = bx + rb - outshift;
           }
           break;
         case 2:
           gv = COLOR_TO_INT(*cbsrc++);
           if (oc & Extended) {
-            gv = APPLY_LUT(m_plDecodingLUT[1],m_lMax,gv) + rg - m_lOutDCShift;
+            gv = APPLY_LUT(dlut[1],lmax,gv) + rg - outshift;
           }
           // fall through
         case 1: 
           // Simple for one component.
           rv = COLOR_TO_INT(*ysrc++);
           if (oc & Extended) {
-            rv = APPLY_LUT(m_plDecodingLUT[0],m_lMax,rv) + rr - m_lOutDCShift;
+            rv = APPLY_LUT(dlut[0],lmax,rv) + rr - outshift;
           }
           break;
         }
@@ -896,11 +937,8 @@ void YCbCrTrafo<external,count,oc,trafo,rtrafo>::YCbCr2RGB(const RectAngle<LONG>
         // but does not hurt otherwise.
         if (oc & ClampFlag) {
           if (oc & Float) {
-            // Avoid NANs. For that, compute the value of +INF and -INF.
-            LONG pinf = (m_lOutMax >> 1) - (m_lOutMax >> 6) - 1;
-            // The representation of -INF.
-            LONG minf = INVERT_NEGS(pinf | 0x8000); 
-            // Also, convert from complement representation to sign
+            // Clamp to the infinities computed above, and
+            // convert from complement representation to sign
             // magnitude representation.
             switch(count) {
             case 4:
@@ -922,16 +960,16 @@ void YCbCrTrafo<external,count,oc,trafo,rtrafo>::YCbCr2RGB(const RectAngle<LONG>
             // For integers, clamp.
             switch(count) {
             case 4:
-              kv = CLAMP(m_lOutMax,kv);
+              kv = CLAMP(outmax,kv);
               // fall through
             case 3:
-              bv = CLAMP(m_lOutMax,bv);
+              bv = CLAMP(outmax,bv);
               // fall through
             case 2:
-              gv = CLAMP(m_lOutMax,gv);
+              gv = CLAMP(outmax,gv);
               // fall through
             case 1:
-              rv = CLAMP(m_lOutMax,rv);
+              rv = CLAMP(outmax,rv);
             }
           }
         } else {
@@ -957,16 +995,16 @@ void YCbCrTrafo<external,count,oc,trafo,rtrafo>::YCbCr2RGB(const RectAngle<LONG>
             // logic.
             switch(count) {
             case 4:
-              kv = WRAP(m_lOutMax,kv);
+              kv = WRAP(outmax,kv);
               // fall through
             case 3:
-              bv = WRAP(m_lOutMax,bv);
+              bv = WRAP(outmax,bv);
               // fall through
             case 2:
-              gv = WRAP(m_lOutMax,gv);
+              gv = WRAP(outmax,gv);
               // fall through
             case 1:
-              rv = WRAP(m_lOutMax,rv);
+              rv = WRAP(outmax,rv);
             }
           }
         }
@@ -975,33 +1013,54 @@ void YCbCrTrafo<external,count,oc,trafo,rtrafo>::YCbCr2RGB(const RectAngle<LONG>
         switch(count) {
         case 4:
           if (k) *k = kv;
-          k  = (external *)((UBYTE *)(k) + dest[3]->ibm_cBytesPerPixel);
+          k  = (external *)((UBYTE *)(k) + bpp[3]);
           // fall through
         case 3:
           if (b) *b = bv;
-          b  = (external *)((UBYTE *)(b) + dest[2]->ibm_cBytesPerPixel);
+          b  = (external *)((UBYTE *)(b) + bpp[2]);
           // fall through
         case 2:
           if (g) *g = gv;
-          g  = (external *)((UBYTE *)(g) + dest[1]->ibm_cBytesPerPixel);
+          g  = (external *)((UBYTE *)(g) + bpp[1]);
           // fall through
         case 1:
           if (r) *r = rv;
-          r  = (external *)((UBYTE *)(r) + dest[0]->ibm_cBytesPerPixel);
+          r  = (external *)((UBYTE *)(r) + bpp[0]);
+        }
+        //
+        // At the end of a block, skip its remaining lines to get to the
+        // same line of the next block.
+        if ((x & 7) == 7) {
+          switch(count) {
+          case 4:
+            ksrc    += 56;
+            // fall through
+          case 3:
+            crsrc   += 56;
+            if (residual) rcrsrc += 56;
+            // fall through
+          case 2:
+            cbsrc   += 56;
+            if (residual) rcbsrc += 56;
+            // fall through
+          case 1:
+            ysrc    += 56;
+            if (residual) rysrc  += 56;
+          }
         }
       } // Of loop over x
       switch(count) {
       case 4:
-        kptr  = (external *)((UBYTE *)(kptr) + dest[3]->ibm_lBytesPerRow);
+        kptr  = (external *)((UBYTE *)(kptr) + bpr[3]);
         // fall through
       case 3:
-        bptr  = (external *)((UBYTE *)(bptr) + dest[2]->ibm_lBytesPerRow);
+        bptr  = (external *)((UBYTE *)(bptr) + bpr[2]);
         // fall through
       case 2:
-        gptr  = (external *)((UBYTE *)(gptr) + dest[1]->ibm_lBytesPerRow);
+        gptr  = (external *)((UBYTE *)(gptr) + bpr[1]);
         // fall through
       case 1:
-        rptr  = (external *)((UBYTE *)(rptr) + dest[0]->ibm_lBytesPerRow);
+        rptr  = (external *)((UBYTE *)(rptr) + bpr[0]);
       }
     }
   }
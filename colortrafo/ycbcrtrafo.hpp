@@ -99,7 +99,15 @@ public:
   // Inverse transform a block from YCbCr to RGB, incuding a clipping operation and a dc level
   // shift.
   virtual void YCbCr2RGB(const RectAngle<LONG> &r,const struct ImageBitMap *const *dest,
-                         Buffer source,Buffer residuals);
+                         Buffer source,Buffer residuals)
+  {
+    // A single block is just a short row.
+    YCbCr2RGBRow(r,dest,source,residuals);
+  }
+  //
+  // Inverse transform a row of blocks from YCbCr to RGB.
+  virtual void YCbCr2RGBRow(const RectAngle<LONG> &r,const struct ImageBitMap *const *dest,
+                            Buffer source,Buffer residuals);
   //
   // Return the pixel type of this transformer.
   virtual UBYTE PixelTypeOf(void) const
@@ -383,5 +383,16 @@
 #endif // of if USE_AUTOCONF
 ///
 
+/// SIMD settings
+// Define HAVE_SSE2_INTRINSICS if the compiler provides the SSE2
+// intrinsics of emmintrin.h. Whether the CPU the code runs on
+// supports them is tested at run time, see tools/cpufeatures.hpp.
+#if !defined(USE_ASSEMBLY) || USE_ASSEMBLY
+# if defined(__SSE2__) || (defined(_MSC_VER) && (defined(_M_IX86) || defined(_M_X64)))
+#  define HAVE_SSE2_INTRINSICS 1
+# endif
+#endif
+///
+
 ///
 #endif
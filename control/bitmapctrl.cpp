@@ -60,7 +60,8 @@
 /// BitmapCtrl::BitmapCtrl
 BitmapCtrl::BitmapCtrl(class Frame *frame)
   : BufferCtrl(frame->EnvironOf()), m_pFrame(frame), 
-    m_ppBitmap(NULL), m_ppLDRBitmap(NULL), m_ppCTemp(NULL), m_pColorBuffer(NULL)
+    m_ppBitmap(NULL), m_ppLDRBitmap(NULL), m_ppCTemp(NULL), m_pColorBuffer(NULL),
+    m_ulColorBlocks(0)
 {
 }
 ///
@@ -76,8 +77,15 @@ void BitmapCtrl::BuildCommon(void)
   if (m_ppCTemp == NULL)
     m_ppCTemp     = (LONG **)m_pEnviron->AllocMem(m_ucCount * sizeof(LONG *));
 
-  if (m_pColorBuffer == NULL)
-    m_pColorBuffer = (LONG *)m_pEnviron->AllocMem(m_ucCount * 64 * sizeof(LONG));
+  //
+  // The color buffer covers a complete row of blocks such that the
+  // color transformation can run over the full width at once.
+  if (m_pColorBuffer == NULL) {
+    m_ulColorBlocks = (m_ulPixelWidth + 7) >> 3;
+    if (m_ulColorBlocks == 0)
+      m_ulColorBlocks = 1;
+    m_pColorBuffer  = (LONG *)m_pEnviron->AllocMem(m_ucCount * 64 * m_ulColorBlocks * sizeof(LONG));
+  }
 
   if (m_ppBitmap == NULL) {
     m_ppBitmap      = (struct ImageBitMap **)m_pEnviron->AllocMem(sizeof(struct ImageBitMap *) * m_ucCount);
@@ -85,7 +93,7 @@ void BitmapCtrl::BuildCommon(void)
     
     for(UBYTE i = 0;i < m_ucCount;i++) {
       m_ppBitmap[i] = new(m_pEnviron) struct ImageBitMap();
-      m_ppCTemp[i]  = m_pColorBuffer + i * 64;
+      m_ppCTemp[i]  = m_pColorBuffer + i * 64 * m_ulColorBlocks;
     }
   }
 }
@@ -100,7 +108,7 @@ BitmapCtrl::~BitmapCtrl(void)
     m_pEnviron->FreeMem(m_ppCTemp,m_ucCount * sizeof(LONG *));
   
   if (m_pColorBuffer)
-    m_pEnviron->FreeMem(m_pColorBuffer,m_ucCount * 64 * sizeof(LONG));
+    m_pEnviron->FreeMem(m_pColorBuffer,m_ucCount * 64 * m_ulColorBlocks * sizeof(LONG));
   
   if (m_ppBitmap) {
     for(i = 0;i < m_ucCount;i++) {
@@ -251,6 +259,10 @@ void BitmapCtrl::ReleaseUserDataFromEncoding(class BitMapHook *bmh,const RectAng
 void BitmapCtrl::ReleaseUserDataFromDecoding(class BitMapHook *bmh,const struct RectangleRequest *rr,bool alpha)
 {
   int i;
+  //
+  // Planar output did not request anything from the hook.
+  if (rr->rr_ppucPlanes)
+    return;
   
   for(i = rr->rr_usFirstComponent;i <=rr->rr_usLastComponent;i++) {
     ReleaseUserData(bmh,rr->rr_Request,i,alpha);
@@ -258,6 +270,16 @@ void BitmapCtrl::ReleaseUserDataFromDecoding(class BitMapHook *bmh,const struct
 }
 ///
 
+/// BitmapCtrl::EncodePlanes
+// Encode a region from the planes of the request rather than from
+// the user bitmap. Only available for DCT based images.
+void BitmapCtrl::EncodePlanes(const RectAngle<LONG> &,const struct RectangleRequest *)
+{
+  JPG_THROW(NOT_IMPLEMENTED,"BitmapCtrl::EncodePlanes",
+            "planar input is only available for DCT based images");
+}
+///
+
 /// BitmapCtrl::CropDecodingRegion
 // First step of a region decoder: Find the region that can be provided in the next step.
 void BitmapCtrl::CropDecodingRegion(RectAngle<LONG> &region,const struct RectangleRequest *)
@@ -79,10 +79,14 @@ protected:
   // If not, this remains NULL.
   struct ImageBitMap   **m_ppLDRBitmap;
   //
-  // Buffers for the color transformation.
+  // Buffers for the color transformation. Each component
+  // holds a full row of blocks.
   LONG                 **m_ppCTemp;
   LONG                  *m_pColorBuffer;
   //
+  // Number of blocks per component in the above.
+  ULONG                  m_ulColorBlocks;
+  //
   // Dimensions in pixels.
   ULONG                  m_ulPixelWidth;
   ULONG                  m_ulPixelHeight;
@@ -121,6 +125,19 @@ protected:
     return *m_ppBitmap[i];
   }
   //
+  // Return the last MCU row that can be reconstructed into the i'th
+  // bitmap on decoding. Only complete MCU rows can be delivered unless
+  // the bitmap extends to the bottom of the image.
+  ULONG LastMCUOf(UBYTE i) const
+  {
+    ULONG height = BitmapOf(i).ibm_ulHeight;
+    
+    if (m_ulPixelHeight && height >= m_ulPixelHeight)
+      return ((m_ulPixelHeight + 7) >> 3) - 1;
+    
+    return (height >> 3) - 1;
+  }
+  //
   // Ensure that unused bitmaps are cleared so we do overwrite memory that is
   // not requested.
   void ResetBitmaps(void);
@@ -156,7 +173,7 @@ public:
   // First step of a region decoder: Find the region that can be provided in the next step.
   // The region should be initialized to the region from the rectangle request before
   // calling here.
-  void CropDecodingRegion(RectAngle<LONG> &region,const struct RectangleRequest *rr);
+  virtual void CropDecodingRegion(RectAngle<LONG> &region,const struct RectangleRequest *rr);
   //
   // Request user data for encoding for the given region, potentially clip the region to the
   // data available from the user.
@@ -176,6 +193,10 @@ public:
   // prepare everything for coding.
   virtual void EncodeRegion(const RectAngle<LONG> &region) = 0;
   //
+  // Encode a region from the planes of the request rather than from
+  // the user bitmap. Only available for DCT based images.
+  virtual void EncodePlanes(const RectAngle<LONG> &region,const struct RectangleRequest *rr);
+  //
   // Reconstruct a block, or part of a block
   virtual void ReconstructRegion(const RectAngle<LONG> &region,const struct RectangleRequest *rr) = 0;
   //
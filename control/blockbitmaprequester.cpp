@@ -68,9 +68,38 @@
 #include "dct/dct.hpp"
 #include "dct/deringing.hpp"
 #include "colortrafo/colortrafo.hpp"
+#include "tools/workerpool.hpp"
 #include "std/string.hpp"
 ///
 
+/// class BlockBitmapRequester::EncodeJob
+// Encodes a stretch of blocks of a block row on a worker thread.
+class BlockBitmapRequester::EncodeJob : public WorkerPool::Job {
+public:
+  //
+  // The requester the blocks belong to.
+  class BlockBitmapRequester *m_pRequester;
+  //
+  // The color transformation, the region and the row to encode.
+  class ColorTrafo           *m_pTrafo;
+  const RectAngle<LONG>      *m_pRegion;
+  RectAngle<LONG>             m_Row;
+  ULONG                       m_ulY;
+  //
+  // The first and last block of the stretch.
+  ULONG                       m_ulFirst;
+  ULONG                       m_ulLast;
+  //
+  // Bitmaps and block pointers of this job.
+  struct ImageBitMap          m_IBM[4];
+  struct ImageBitMap         *m_pIBM[4];
+  LONG                       *m_plQ[4];
+  LONG                       *m_plR[4];
+  //
+  virtual void Run(class Environ *env);
+};
+///
+
 /// BlockBitmapRequester::BlockBitmapRequester
 BlockBitmapRequester::BlockBitmapRequester(class Frame *frame)
   : BlockBuffer(frame), BitmapCtrl(frame), m_pEnviron(frame->EnvironOf()), m_pFrame(frame),
@@ -81,8 +110,8 @@ BlockBitmapRequester::BlockBitmapRequester(class Frame *frame)
     m_ppQTemp(NULL), m_ppRTemp(NULL), m_ppDTemp(NULL),
     m_plResidualColorBuffer(NULL), m_plOriginalColorBuffer(NULL), 
     m_pppQImage(NULL), m_pppRImage(NULL),
-    m_pResidualHelper(NULL), m_ppDeRinger(NULL), 
-    m_bSubsampling(false), m_bOpenLoop(false), m_bDeRing(false)
+    m_pResidualHelper(NULL), m_ppDeRinger(NULL), m_pEncodeJobs(NULL), m_ulEncodeJobs(0),
+    m_pplPreview(NULL), m_bPreview(false), m_bSubsampling(false), m_bOpenLoop(false), m_bDeRing(false)
 {  
   m_ucCount       = frame->DepthOf(); 
   m_ulPixelWidth  = frame->WidthOf();
@@ -95,11 +124,24 @@ BlockBitmapRequester::~BlockBitmapRequester(void)
 {
   UBYTE i;
 
+  delete[] m_pEncodeJobs;
+
+  if (m_pplPreview) {
+    for(i = 0;i < m_ucCount;i++) {
+      if (m_pplPreview[i]) {
+        ULONG width,height;
+        BlockDimensionsOf(i,width,height);
+        m_pEnviron->FreeMem(m_pplPreview[i],sizeof(LONG) * 64 * width * height);
+      }
+    }
+    m_pEnviron->FreeMem(m_pplPreview,m_ucCount * sizeof(LONG *));
+  }
+
   if (m_ppDTemp)
     m_pEnviron->FreeMem(m_ppDTemp,m_ucCount * sizeof(LONG *));
   
   if (m_plResidualColorBuffer)
-    m_pEnviron->FreeMem(m_plResidualColorBuffer,m_ucCount * 64 * sizeof(LONG));
+    m_pEnviron->FreeMem(m_plResidualColorBuffer,m_ucCount * 64 * m_ulColorBlocks * sizeof(LONG));
 
   if (m_plOriginalColorBuffer)
     m_pEnviron->FreeMem(m_plOriginalColorBuffer,m_ucCount * 64 * sizeof(LONG));
@@ -375,15 +417,15 @@ void BlockBitmapRequester::SetBlockHelper(class ResidualBlockHelper *helper)
     }
     //
     // Build the residual color buffer which buffers the output of the 
-    // upsampler.
+    // upsampler. Like the legacy color buffer, it holds a row of blocks.
     if (m_ppDTemp == NULL)
       m_ppDTemp     = (LONG **)m_pEnviron->AllocMem(m_ucCount * sizeof(LONG *));
     
     if (m_plResidualColorBuffer == NULL)
-      m_plResidualColorBuffer = (LONG *)m_pEnviron->AllocMem(m_ucCount * 64 * sizeof(LONG));
+      m_plResidualColorBuffer = (LONG *)m_pEnviron->AllocMem(m_ucCount * 64 * m_ulColorBlocks * sizeof(LONG));
     
     for(i = 0;i < m_ucCount;i++) {
-      m_ppDTemp[i]  = m_plResidualColorBuffer + i * 64;
+      m_ppDTemp[i]  = m_plResidualColorBuffer + i * 64 * m_ulColorBlocks;
     }
 
     //
@@ -718,12 +760,11 @@ void BlockBitmapRequester::PullSourceData(const RectAngle<LONG> &region,class Co
   //
   // First part: Collect the data from
   // the user and push it into the color transformer buffer.
-  // For that first build the downsampler.
+  // The downsamplers are extended row by row below as otherwise
+  // they would consider lines complete that have not been delivered
+  // yet if the region extends to the end of the image.
   for(i = 0;i < m_ucCount;i++) {
-    if (m_ppDownsampler[i]) {
-      m_ppDownsampler[i]->SetBufferedRegion(region);
-    }   
-    // Ditto for the original image, but do not throw old stuff away.
+    // Do not throw old stuff away in the original image.
     if (m_pResidualHelper) {
       if (m_ppOriginalImage[i]) {
         m_ppOriginalImage[i]->ExtendBufferedRegion(region);
@@ -749,6 +790,16 @@ void BlockBitmapRequester::PullSourceData(const RectAngle<LONG> &region,class Co
     r.ra_MaxY = (r.ra_MinY & -8) + 7;
     if (r.ra_MaxY > region.ra_MaxY)
       r.ra_MaxY = region.ra_MaxY;
+    //
+    // Build the downsampler buffer for the lines of this row.
+    for(i = 0;i < m_ucCount;i++) {
+      if (m_ppDownsampler[i]) {
+        RectAngle<LONG> lines = region;
+        lines.ra_MinY = r.ra_MinY;
+        lines.ra_MaxY = r.ra_MaxY;
+        m_ppDownsampler[i]->SetBufferedRegion(lines);
+      }
+    }
     
     for(x = minx,r.ra_MinX = region.ra_MinX;x <= maxx;x++,r.ra_MinX = r.ra_MaxX + 1) {
       r.ra_MaxX = (r.ra_MinX & -8) + 7;
@@ -842,95 +893,206 @@ void BlockBitmapRequester::PullSourceData(const RectAngle<LONG> &region,class Co
 }
 ///
 
+/// BlockBitmapRequester::EncodeBlocks
+// Encode the blocks first to last of the block row y whose lines are
+// given by r, with the given bitmaps and block pointers as temporaries.
+void BlockBitmapRequester::EncodeBlocks(const RectAngle<LONG> &region,RectAngle<LONG> r,ULONG y,
+                                        ULONG first,ULONG last,class ColorTrafo *ctrafo,
+                                        struct ImageBitMap **ibm,LONG **qtemp,LONG **rtemp)
+{
+  ULONG maxval = (1UL << m_pFrame->HiddenPrecisionOf()) - 1;
+  ULONG minx   = region.ra_MinX >> 3;
+  LONG *ctemp[4];
+  LONG *dtemp[4];
+  ULONG x;
+  UBYTE i;
+
+  for(x = first;x <= last;x++) {
+    r.ra_MinX = x << 3;
+    if (r.ra_MinX < region.ra_MinX)
+      r.ra_MinX = region.ra_MinX;
+    r.ra_MaxX = (r.ra_MinX & -8) + 7;
+    if (r.ra_MaxX > region.ra_MaxX)
+      r.ra_MaxX = region.ra_MaxX;
+    //
+    // Each block of the row has its own slot in the color buffers,
+    // hence blocks may be encoded in any order.
+    for(i = 0;i < m_ucCount;i++) {
+      ctemp[i] = m_ppCTemp[i] + ((x - minx) << 6);
+      if (m_pResidualHelper)
+        dtemp[i] = m_ppDTemp[i] + ((x - minx) << 6);
+    }
+    //
+    // If the user supplied a dedicated LDR image.
+    if (hasLDRImage()) {
+      for(i = 0;i < m_ucCount;i++) {      
+        ExtractLDRBitmap(ibm[i],r,i);
+      }
+      
+      ctrafo->LDRRGB2YCbCr(r,ibm,ctemp); 
+      
+      // Extract the HDR image now.
+      for(i = 0;i < m_ucCount;i++) {      
+        ExtractBitmap(ibm[i],r,i);
+      }
+    } else {
+      for(i = 0;i < m_ucCount;i++) {      
+        ExtractBitmap(ibm[i],r,i);
+      }
+      
+      ctrafo->RGB2YCbCr(r,ibm,ctemp);
+    }
+    
+    for(i = 0;i < m_ucCount;i++) {
+      class QuantizedRow *qrow = *m_pppQImage[i];
+      LONG *dst = qrow->BlockAt(x)->m_Data;
+      LONG *src = ctemp[i];
+      
+      if (m_bDeRing) {
+        m_ppDeRinger[i]->DeRing(src,dst,(maxval + 1) >> 1);
+      } else {
+        m_ppDCT[i]->TransformBlock(src,dst,(maxval + 1) >> 1);
+      }
+      if (m_bOptimize) {
+        m_pFrame->OptimizeDCTBlock(x,y,i,m_ppDCT[i],dst);
+      }
+    }
+    //
+    // If any residuals are required, compute them now.
+    if (m_pResidualHelper) {
+      for(i = 0;i < m_ucCount;i++) { 
+        class QuantizedRow *qrow = *m_pppQImage[i];
+        class QuantizedRow *rrow = *m_pppRImage[i];
+        assert(qrow && rrow);
+        qtemp[i] = qrow->BlockAt(x)->m_Data;
+        rtemp[i] = rrow->BlockAt(x)->m_Data;
+        if (m_bOpenLoop) {
+          memcpy(dtemp[i],ctemp[i],64 * sizeof(LONG));
+        } else {
+          m_ppDCT[i]->InverseTransformBlock(dtemp[i],qtemp[i],(maxval + 1) >> 1);
+        }
+      }
+      // Step One:
+      // Feed now the color transformer with the residual data.
+      ctrafo->RGB2Residual(r,ibm,dtemp,rtemp);
+      //
+      // Step two: Compute the residuals by means of the color transformer.
+      // This also computes the forwards transformation of the residual.
+      // Quantization and DCT are still missing.
+      for(i = 0;i < m_ucCount;i++) { 
+        m_pResidualHelper->QuantizeResidual(dtemp[i],rtemp[i],i,x,y);
+      }
+    }
+  }
+}
+///
+
+/// BlockBitmapRequester::EncodeJob::Run
+// Encode the blocks of this job.
+void BlockBitmapRequester::EncodeJob::Run(class Environ *)
+{
+  m_pRequester->EncodeBlocks(*m_pRegion,m_Row,m_ulY,m_ulFirst,m_ulLast,m_pTrafo,
+                             m_pIBM,m_plQ,m_plR);
+}
+///
+
+/// BlockBitmapRequester::EncodeJobsOf
+// Return the number of jobs a block row can be split into for
+// encoding it on the worker threads, or zero if it has to be
+// encoded in the calling thread.
+ULONG BlockBitmapRequester::EncodeJobsOf(class WorkerPool *pool)
+{
+  //
+  // The deringing filter and the R/D optimization keep state
+  // per component, these cannot run concurrently.
+  if (pool == NULL || m_bDeRing || m_bOptimize)
+    return 0;
+  if (m_pResidualHelper && !m_pResidualHelper->PrepareConcurrentQuantization())
+    return 0;
+  //
+  if (m_pEncodeJobs == NULL) {
+    ULONG threads = pool->ThreadsOf();
+    UBYTE i;
+    //
+    m_pEncodeJobs = new(m_pEnviron) class EncodeJob[threads];
+    m_ulEncodeJobs = threads;
+    for(ULONG j = 0;j < threads;j++) {
+      class EncodeJob *job = m_pEncodeJobs + j;
+      job->m_pRequester    = this;
+      for(i = 0;i < m_ucCount;i++) {
+        job->m_pIBM[i] = job->m_IBM + i;
+      }
+    }
+  }
+
+  return m_ulEncodeJobs;
+}
+///
+
 /// BlockBitmapRequester::EncodeUnsampled
 // The encoding procedure without subsampling, which is the much simpler case.
+// Without the deringing filter and the R/D optimization, the blocks of a row
+// are independent of each other. If worker threads are available, the row is
+// then cut into one stretch of blocks per thread, each of which runs the
+// legacy transformation, its reconstruction, and the residual computation,
+// transformation and quantization.
 void BlockBitmapRequester::EncodeUnsampled(const RectAngle<LONG> &region,class ColorTrafo *ctrafo)
 {  
-  ULONG maxval = (1UL << m_pFrame->HiddenPrecisionOf()) - 1;
+  class WorkerPool *pool = m_pEnviron->WorkerPoolOf();
   RectAngle<LONG> r;
   ULONG minx   = region.ra_MinX >> 3;
   ULONG maxx   = region.ra_MaxX >> 3;
-  ULONG miny   = region.ra_MinY >> 3;
   ULONG maxy   = region.ra_MaxY >> 3;
-  ULONG x,y;
+  ULONG jobs   = EncodeJobsOf(pool);
+  ULONG y;
   UBYTE i;
+  //
+  // Not worth it for short rows.
+  if (maxx - minx + 1 < (jobs << 2))
+    jobs = 0;
   
-  for(y = miny,r.ra_MinY = region.ra_MinY;y <= maxy;y++,r.ra_MinY = r.ra_MaxY + 1) {
+  for(y = region.ra_MinY >> 3,r.ra_MinY = region.ra_MinY;y <= maxy;y++,r.ra_MinY = r.ra_MaxY + 1) {
     r.ra_MaxY = (r.ra_MinY & -8) + 7;
     if (r.ra_MaxY > region.ra_MaxY)
       r.ra_MaxY = region.ra_MaxY;
+    //
+    // Create the output rows up front, blocks are encoded in any order.
+    for(i = 0;i < m_ucCount;i++) {
+      BuildImageRow(m_pppQImage[i],m_pFrame,i);
+      if (m_pResidualHelper)
+        BuildImageRow(m_pppRImage[i],m_pResidualHelper->ResidualFrameOf(),i);
+    }
     
-    for(x = minx,r.ra_MinX = region.ra_MinX;x <= maxx;x++,r.ra_MinX = r.ra_MaxX + 1) {
-      r.ra_MaxX = (r.ra_MinX & -8) + 7;
-      if (r.ra_MaxX > region.ra_MaxX)
-        r.ra_MaxX = region.ra_MaxX;
-      
-      //
-      // If the user supplied a dedicated LDR image.
-      if (hasLDRImage()) {
-        for(i = 0;i < m_ucCount;i++) {      
-          ExtractLDRBitmap(m_ppTempIBM[i],r,i);
-        }
-        
-        ctrafo->LDRRGB2YCbCr(r,m_ppTempIBM,m_ppCTemp); 
-        
-        // Extract the HDR image now.
-        for(i = 0;i < m_ucCount;i++) {      
-          ExtractBitmap(m_ppTempIBM[i],r,i);
-        }
-      } else {
-        for(i = 0;i < m_ucCount;i++) {      
-          ExtractBitmap(m_ppTempIBM[i],r,i);
-        }
-        
-        //if (x == 245 && y == 126 && m_ucCount == 1)
-        //printf("gotcha");     
-        ctrafo->RGB2YCbCr(r,m_ppTempIBM,m_ppCTemp);
-      }
-      
-      for(i = 0;i < m_ucCount;i++) {
-        class QuantizedRow *qrow = BuildImageRow(m_pppQImage[i],m_pFrame,i);
-        LONG *dst = qrow->BlockAt(x)->m_Data;
-        LONG *src = m_ppCTemp[i];
-        
-        if (m_bDeRing) {
-          m_ppDeRinger[i]->DeRing(src,dst,(maxval + 1) >> 1);
-        } else {
-          m_ppDCT[i]->TransformBlock(src,dst,(maxval + 1) >> 1);
-        }
-        if (m_bOptimize) {
-          m_pFrame->OptimizeDCTBlock(x,y,i,m_ppDCT[i],dst);
-        }
-      }
+    if (jobs) {
+      ULONG first = minx;
+      ULONG j;
       //
-      // If any residuals are required, compute them now.
-      if (m_pResidualHelper) {
-        for(i = 0;i < m_ucCount;i++) { 
-          class QuantizedRow *qrow = *m_pppQImage[i];
-          class QuantizedRow *rrow = BuildImageRow(m_pppRImage[i],m_pResidualHelper->ResidualFrameOf(),i);
-          assert(qrow && rrow);
-          m_ppQTemp[i] = qrow->BlockAt(x)->m_Data;
-          m_ppRTemp[i] = rrow->BlockAt(x)->m_Data;
-          if (m_bOpenLoop) {
-            memcpy(m_ppDTemp[i],m_ppCTemp[i],64 * sizeof(LONG));
-          } else {
-            m_ppDCT[i]->InverseTransformBlock(m_ppDTemp[i],m_ppQTemp[i],(maxval + 1) >> 1);
-          }
-        }
-        // Step One:
-        // Feed now the color transformer with the residual data.
-        //if (x == 117 && y == 34)
-        //printf("gotcha");
-        ctrafo->RGB2Residual(r,m_ppTempIBM,m_ppDTemp,m_ppRTemp);
+      // The jobs act on objects of this environment.
+      m_pEnviron->BeginConcurrentJob();
+      for(j = 0;j < jobs;j++) {
+        class EncodeJob *job = m_pEncodeJobs + j;
+        ULONG last           = minx + ((maxx - minx + 1) * (j + 1)) / jobs - 1;
         //
-        // Step two: Compute the residuals by means of the color transformer.
-        // This also computes the forwards transformation of the residual.
-        // Quantization and DCT are still missing.
-        for(i = 0;i < m_ucCount;i++) { 
-          m_pResidualHelper->QuantizeResidual(m_ppDTemp[i],m_ppRTemp[i],i,x,y);
-        }
+        job->m_pTrafo  = ctrafo;
+        job->m_pRegion = &region;
+        job->m_Row     = r;
+        job->m_ulY     = y;
+        job->m_ulFirst = first;
+        job->m_ulLast  = last;
+        pool->Submit(job);
+        first = last + 1;
       }
+      JPG_TRY {
+        pool->Wait();
+      } JPG_CATCH {
+        m_pEnviron->EndConcurrentJob();
+        JPG_RETHROW;
+      } JPG_ENDTRY;
+      m_pEnviron->EndConcurrentJob();
+    } else {
+      EncodeBlocks(region,r,y,minx,maxx,ctrafo,m_ppTempIBM,m_ppQTemp,m_ppRTemp);
     }
+    
     for(i = 0;i < m_ucCount;i++) {
       class QuantizedRow *qrow = *m_pppQImage[i];
       class QuantizedRow *rrow = *m_pppRImage[i];
@@ -1008,12 +1170,214 @@ void BlockBitmapRequester::EncodeRegion(const RectAngle<LONG> &region)
 }
 ///
 
+/// BlockBitmapRequester::EncodePlanes
+// Encode the rows of blocks covered by the region from the planes of
+// the request. The samples are already at the resolution of their
+// component, hence go directly into the DCT. Blocks extending over the
+// edges of the image are padded by replicating the edge samples.
+void BlockBitmapRequester::EncodePlanes(const RectAngle<LONG> &region,const struct RectangleRequest *rr)
+{
+  LONG maxval = (1L << m_pFrame->HiddenPrecisionOf()) - 1;
+  UBYTE frac  = m_pFrame->TablesOf()->FractionalColorBitsOf(m_ucCount,true);
+  UBYTE i;
+
+  if (m_pResidualHelper || m_pFrame->HiddenPrecisionOf() > 8)
+    JPG_THROW(NOT_IMPLEMENTED,"BlockBitmapRequester::EncodePlanes",
+              "planar input is only available for 8 bit images without residual");
+  if (m_ulPixelHeight == 0)
+    JPG_THROW(NOT_IMPLEMENTED,"BlockBitmapRequester::EncodePlanes",
+              "planar input requires the image height to be known in advance");
+
+  for(i = 0;i < m_ucCount;i++) {
+    class Component *comp = m_pFrame->ComponentOf(i);
+    UBYTE subx            = comp->SubXOf();
+    UBYTE suby            = comp->SubYOf();
+    const UBYTE *plane    = rr->rr_ppucPlanes[i];
+    LONG bpr              = rr->rr_plBytesPerRow[i];
+    LONG width            = (m_ulPixelWidth  + subx - 1) / subx;
+    LONG height           = (m_ulPixelHeight + suby - 1) / suby;
+    LONG *src             = m_ppCTemp[i];
+    //
+    if (plane == NULL)
+      JPG_THROW(INVALID_PARAMETER,"BlockBitmapRequester::EncodePlanes",
+                "no input plane supplied for a component");
+    //
+    // Encode all rows of blocks of this component whose lines are
+    // covered by the region.
+    while(m_pulReadyLines[i] < m_ulPixelHeight) {
+      ULONG by   = m_pulReadyLines[i] / (suby << 3);
+      ULONG last = (by + 1) * (suby << 3);
+      class QuantizedRow *qrow;
+      ULONG bx;
+      //
+      if (last > m_ulPixelHeight)
+        last = m_ulPixelHeight;
+      if (LONG(last) - 1 > region.ra_MaxY)
+        break;
+      //
+      qrow = BuildImageRow(m_pppQImage[i],m_pFrame,i);
+      for(bx = 0;bx < qrow->WidthOf();bx++) {
+        LONG *dst = qrow->BlockAt(bx)->m_Data;
+        LONG x,y;
+        //
+        for(y = 0;y < 8;y++) {
+          LONG py         = (by << 3) + y;
+          const UBYTE *in = plane + ((py < height)?(py):(height - 1)) * bpr;
+          for(x = 0;x < 8;x++) {
+            LONG px = (bx << 3) + x;
+            src[x + (y << 3)] = LONG(in[(px < width)?(px):(width - 1)]) << frac;
+          }
+        }
+        //
+        if (m_bDeRing) {
+          m_ppDeRinger[i]->DeRing(src,dst,(maxval + 1) >> 1);
+        } else {
+          m_ppDCT[i]->TransformBlock(src,dst,(maxval + 1) >> 1);
+        }
+        if (m_bOptimize) {
+          m_pFrame->OptimizeDCTBlock(bx,by,i,m_ppDCT[i],dst);
+        }
+      }
+      m_pppQImage[i]     = &(qrow->NextOf());
+      m_pulReadyLines[i] = last;
+    }
+  }
+}
+///
+
+/// BlockBitmapRequester::BlockDimensionsOf
+// Return the number of blocks per row and the number of block rows
+// of the given component, at its native resolution.
+void BlockBitmapRequester::BlockDimensionsOf(UBYTE i,ULONG &width,ULONG &height) const
+{
+  class Component *comp = m_pFrame->ComponentOf(i);
+  UBYTE subx            = comp->SubXOf();
+  UBYTE suby            = comp->SubYOf();
+
+  width  = ((m_ulPixelWidth  + subx - 1) / subx + 7) >> 3;
+  height = ((m_ulPixelHeight + suby - 1) / suby + 7) >> 3;
+}
+///
+
+/// BlockBitmapRequester::CropDecodingRegion
+// First step of a region decoder: Find the region that can be provided in the next step.
+// For incremental display, this also updates the preview buffer and crops to the
+// lines that changed.
+void BlockBitmapRequester::CropDecodingRegion(RectAngle<LONG> &region,const struct RectangleRequest *rr)
+{
+  BitmapCtrl::CropDecodingRegion(region,rr);
+
+  m_bPreview = false;
+  //
+  // Without a known height, e.g. before the DNL marker, the preview
+  // buffer cannot be laid out. Display everything then.
+  if (rr->rr_bIncremental && m_ulPixelHeight > 0) {
+    if (m_pResidualHelper)
+      JPG_THROW(NOT_IMPLEMENTED,"BlockBitmapRequester::CropDecodingRegion",
+                "incremental display is not available for images with a residual codestream");
+    UpdatePreview(region,rr);
+    m_bPreview = true;
+  }
+}
+///
+
+/// BlockBitmapRequester::UpdatePreview
+// Recompute the preview buffer of all requested components for the
+// block rows the parsers touched since the last incremental display,
+// and crop the region vertically to the lines that changed.
+void BlockBitmapRequester::UpdatePreview(RectAngle<LONG> &region,const struct RectangleRequest *rr)
+{
+  ULONG maxval = (1UL << m_pFrame->HiddenPrecisionOf()) - 1;
+  LONG miny    = MAX_LONG;
+  LONG maxy    = -1;
+  UBYTE i;
+
+  if (m_pplPreview == NULL) {
+    m_pplPreview = (LONG **)m_pEnviron->AllocMem(sizeof(LONG *) * m_ucCount);
+    memset(m_pplPreview,0,sizeof(LONG *) * m_ucCount);
+  }
+
+  for(i = rr->rr_usFirstComponent;i <= rr->rr_usLastComponent;i++) {
+    class QuantizedRow *qrow = m_ppQTop[i];
+    LONG suby                = m_pFrame->ComponentOf(i)->SubYOf();
+    ULONG width,height,first,last,bx,by;
+    //
+    BlockDimensionsOf(i,width,height);
+    if (m_pplPreview[i] == NULL) {
+      // Nothing of this component has been displayed yet.
+      m_pplPreview[i] = (LONG *)m_pEnviron->AllocMem(sizeof(LONG) * 64 * width * height);
+      MarkModified(i);
+    }
+    if (!CollectModifiedLines(i,first,last))
+      continue;
+    //
+    // Convert to block rows.
+    if (last > (height << 3))
+      last = height << 3;
+    first >>= 3;
+    last    = (last + 7) >> 3;
+    //
+    for(by = 0;by < last;by++) {
+      if (by >= first) {
+        LONG *dst = m_pplPreview[i] + ((by * width) << 6);
+        for(bx = 0;bx < width;bx++,dst += 64) {
+          if (m_ppDCT[i]) {
+            m_ppDCT[i]->InverseTransformSparseBlock(dst,(qrow)?(qrow->BlockAt(bx)->m_Data):(NULL),
+                                                    (maxval + 1) >> 1);
+          } else {
+            memset(dst,0,sizeof(LONG) * 64);
+          }
+        }
+      }
+      if (qrow) qrow = qrow->NextOf();
+    }
+    //
+    // The upsampler holds outdated data of this component now.
+    if (m_ppUpsampler && m_ppUpsampler[i])
+      m_ppUpsampler[i]->ResetBufferedRegion();
+    //
+    // The lines of the image that changed, including the line above
+    // and below the upsampling filter interpolates from.
+    if (LONG(first << 3) * suby - suby < miny)
+      miny = LONG(first << 3) * suby - suby;
+    if (LONG(last << 3) * suby + suby - 1 > maxy)
+      maxy = LONG(last << 3) * suby + suby - 1;
+  }
+  //
+  // Crop to what changed. This leaves the region empty if nothing did.
+  // The upsamplers deliver full blocks, so start at a block boundary.
+  miny &= -8;
+  if (region.ra_MinY < miny)
+    region.ra_MinY = miny;
+  if (region.ra_MaxY > maxy)
+    region.ra_MaxY = maxy;
+}
+///
+
+/// BlockBitmapRequester::InverseTransform
+// Run the inverse DCT for the given block of a component, or take it
+// from the preview buffer if this is an incremental display.
+void BlockBitmapRequester::InverseTransform(UBYTE i,ULONG bx,ULONG by,const class QuantizedRow *qrow,LONG *dst)
+{
+  if (m_bPreview) {
+    ULONG width,height;
+    //
+    BlockDimensionsOf(i,width,height);
+    assert(m_pplPreview[i] && by < height);
+    memcpy(dst,m_pplPreview[i] + ((by * width + bx) << 6),sizeof(LONG) * 64);
+  } else {
+    ULONG maxval = (1UL << m_pFrame->HiddenPrecisionOf()) - 1;
+    //
+    m_ppDCT[i]->InverseTransformBlock(dst,(qrow)?(qrow->BlockAt(bx)->m_Data):(NULL),(maxval + 1) >> 1);
+  }
+}
+///
+
 /// BlockBitmapRequester::ReconstructUnsampled
 // Reconstruct a region not using any subsampling.
 void BlockBitmapRequester::ReconstructUnsampled(const struct RectangleRequest *rr,const RectAngle<LONG> &orgregion,
                                                 ULONG maxmcu,class ColorTrafo *ctrafo)
 {   
-  ULONG maxval  = (1UL << m_pFrame->HiddenPrecisionOf()) - 1;
   RectAngle<LONG> r;
   RectAngle<LONG> region = orgregion;
   SubsampledRegion(region,rr);
@@ -1031,38 +1395,39 @@ void BlockBitmapRequester::ReconstructUnsampled(const struct RectangleRequest *r
     r.ra_MaxY = (r.ra_MinY & -8) + 7;
     if (r.ra_MaxY > region.ra_MaxY)
       r.ra_MaxY = region.ra_MaxY;
-    
-    for(x = minx,r.ra_MinX = region.ra_MinX;x <= maxx;x++,r.ra_MinX = r.ra_MaxX + 1) {
-      r.ra_MaxX = (r.ra_MinX & -8) + 7;
-      if (r.ra_MaxX > region.ra_MaxX)
-        r.ra_MaxX = region.ra_MaxX;
-      
+    //
+    // Collect the blocks of the row in the color buffers.
+    for(x = minx;x <= maxx;x++) {
+      ULONG offset = (x - minx) << 6;
       for(i = 0;i < m_ucCount;i++) {      
-        LONG *dst = m_ppCTemp[i];
-        // Bitmap extraction must go here as the components requested
-        // refer to components in YUV space, and not in target RGB space.
-        ExtractBitmap(m_ppTempIBM[i],r,i);
+        LONG *dst = m_ppCTemp[i] + offset;
         if (i >= rr->rr_usFirstComponent && i <= rr->rr_usLastComponent && m_ppDCT[i]) {
-          class QuantizedRow *qrow = *m_pppQImage[i];
-          const LONG *src = (qrow)?(qrow->BlockAt(x)->m_Data):(NULL);
-          m_ppDCT[i]->InverseTransformBlock(dst,src,(maxval + 1) >> 1);
+          InverseTransform(i,x,y,*m_pppQImage[i],dst);
         } else {
           memset(dst,0,sizeof(LONG) * 64);
         }
       }
       //
-      // Perform the color transformation now.
       if (m_pResidualHelper) {
         for(i = rr->rr_usFirstComponent; i <= rr->rr_usLastComponent; i++) {
           class QuantizedRow *rrow = *m_pppRImage[i];
-          m_pResidualHelper->DequantizeResidual(m_ppCTemp[i],m_ppDTemp[i],rrow->BlockAt(x)->m_Data,i);
+          m_pResidualHelper->DequantizeResidual(m_ppCTemp[i] + offset,m_ppDTemp[i] + offset,
+                                                rrow->BlockAt(x)->m_Data,i);
         }
       }
-      //
-      // Otherwise, the residual remains unused.
-      ctrafo->YCbCr2RGB(r,m_ppTempIBM,m_ppCTemp,m_ppDTemp);
     } // of loop over x
     //
+    // Perform the color transformation of the row now. Bitmap extraction
+    // must go here as the components requested refer to components in
+    // YUV space, and not in target RGB space. Otherwise, the residual
+    // remains unused.
+    r.ra_MinX = region.ra_MinX;
+    r.ra_MaxX = region.ra_MaxX;
+    for(i = 0;i < m_ucCount;i++) {
+      ExtractBitmap(m_ppTempIBM[i],r,i);
+    }
+    ctrafo->YCbCr2RGBRow(r,m_ppTempIBM,m_ppCTemp,m_ppDTemp);
+    //
     // Advance the rows.
     for(i = rr->rr_usFirstComponent;i <= rr->rr_usLastComponent;i++) {
       class QuantizedRow *qrow = *m_pppQImage[i];
@@ -1074,11 +1439,78 @@ void BlockBitmapRequester::ReconstructUnsampled(const struct RectangleRequest *r
 }
 ///
 
+/// BlockBitmapRequester::ReconstructPlanes
+// Reconstruct a region directly into the planes supplied by the caller,
+// one per component at its native resolution. The output of the inverse
+// DCT is clamped and stored in the planes, bypassing upsampling, the
+// color transformation and the bitmap hook.
+void BlockBitmapRequester::ReconstructPlanes(const struct RectangleRequest *rr,const RectAngle<LONG> &orgregion)
+{
+  LONG maxval = (1L << m_pFrame->HiddenPrecisionOf()) - 1;
+  UBYTE frac  = m_pFrame->TablesOf()->FractionalColorBitsOf(m_ucCount,true);
+  LONG round  = (1L << frac) >> 1;
+  UBYTE i;
+
+  for(i = rr->rr_usFirstComponent;i <= rr->rr_usLastComponent;i++) {
+    class Component *comp = m_pFrame->ComponentOf(i);
+    UBYTE subx            = comp->SubXOf();
+    UBYTE suby            = comp->SubYOf();
+    UBYTE *plane          = rr->rr_ppucPlanes[i];
+    LONG bpr              = rr->rr_plBytesPerRow[i];
+    LONG *dst             = m_ppCTemp[i];
+    RectAngle<LONG> region;
+    LONG x,y;
+    //
+    // The region in coordinates of the subsampled component.
+    region.ra_MinX = (orgregion.ra_MinX + subx - 1) / subx;
+    region.ra_MaxX = (orgregion.ra_MaxX + subx    ) / subx - 1;
+    region.ra_MinY = (orgregion.ra_MinY + suby - 1) / suby;
+    region.ra_MaxY = (orgregion.ra_MaxY + suby    ) / suby - 1;
+    if (region.IsEmpty())
+      continue;
+    //
+    if (plane == NULL)
+      JPG_THROW(INVALID_PARAMETER,"BlockBitmapRequester::ReconstructPlanes",
+                "no output plane supplied for a requested component");
+    //
+    for(y = region.ra_MinY & -8;y <= region.ra_MaxY;y += 8) {
+      class QuantizedRow *qrow = *m_pppQImage[i];
+      LONG ymin = (y < region.ra_MinY)?(region.ra_MinY):(y);
+      LONG ymax = (y + 7 > region.ra_MaxY)?(region.ra_MaxY):(y + 7);
+      //
+      for(x = region.ra_MinX & -8;x <= region.ra_MaxX;x += 8) {
+        LONG xmin = (x < region.ra_MinX)?(region.ra_MinX):(x);
+        LONG xmax = (x + 7 > region.ra_MaxX)?(region.ra_MaxX):(x + 7);
+        LONG xx,yy;
+        //
+        if (m_ppDCT[i]) {
+          InverseTransform(i,x >> 3,y >> 3,qrow,dst);
+        } else {
+          memset(dst,0,sizeof(LONG) * 64);
+        }
+        //
+        for(yy = ymin;yy <= ymax;yy++) {
+          const LONG *in = dst + ((yy & 7) << 3);
+          UBYTE *out     = plane + yy * bpr;
+          for(xx = xmin;xx <= xmax;xx++) {
+            LONG v = (in[xx & 7] + round) >> frac;
+            if (v < 0)      v = 0;
+            if (v > maxval) v = maxval;
+            out[xx] = UBYTE(v);
+          }
+        }
+      }
+      //
+      if (qrow) m_pppQImage[i] = &(qrow->NextOf());
+    }
+  }
+}
+///
+
 /// BlockBitmapRequester::PullQData
 // Pull the quantized data into the upsampler if there is one.
 void BlockBitmapRequester::PullQData(const struct RectangleRequest *rr,const RectAngle<LONG> &region)
 {
-  ULONG maxval  = (1UL << m_pFrame->HiddenPrecisionOf()) - 1;
   UBYTE i;
 
   for(i = rr->rr_usFirstComponent;i <= rr->rr_usLastComponent;i++) {
@@ -1096,10 +1528,9 @@ void BlockBitmapRequester::PullQData(const struct RectangleRequest *rr,const Rec
       for(by = blocks.ra_MinY;by <= blocks.ra_MaxY;by++) {
         class QuantizedRow *qrow = *m_pppQImage[i];
         for(bx = blocks.ra_MinX;bx <= blocks.ra_MaxX;bx++) {
-          LONG *src = (qrow)?(qrow->BlockAt(bx)->m_Data):NULL;
           LONG dst[64];
           if (m_ppDCT[i]) {
-            m_ppDCT[i]->InverseTransformBlock(dst,src,(maxval + 1) >> 1);
+            InverseTransform(i,bx,by,qrow,dst);
           } else {
             memset(dst,0,sizeof(dst));
           }
@@ -1151,7 +1582,6 @@ void BlockBitmapRequester::PullRData(const struct RectangleRequest *rr,const Rec
 void BlockBitmapRequester::PushReconstructedData(const struct RectangleRequest *rr,const RectAngle<LONG> &region,
                                                  ULONG maxmcu,class ColorTrafo *ctrafo)
 {  
-  ULONG maxval = (1UL << m_pFrame->HiddenPrecisionOf()) - 1;
   RectAngle<LONG> r;
   ULONG minx   = region.ra_MinX >> 3;
   ULONG maxx   = region.ra_MaxX >> 3;
@@ -1167,47 +1597,54 @@ void BlockBitmapRequester::PushReconstructedData(const struct RectangleRequest *
     r.ra_MaxY = (r.ra_MinY & -8) + 7;
     if (r.ra_MaxY > region.ra_MaxY)
       r.ra_MaxY = region.ra_MaxY;
-    
+    //
+    // Collect the blocks of the row in the color buffers.
     for(x = minx,r.ra_MinX = region.ra_MinX;x <= maxx;x++,r.ra_MinX = r.ra_MaxX + 1) {
+      ULONG offset = (x - minx) << 6;
       r.ra_MaxX = (r.ra_MinX & -8) + 7;
       if (r.ra_MaxX > region.ra_MaxX)
         r.ra_MaxX = region.ra_MaxX;
       
       for(i = 0;i < m_ucCount;i++) {
-        ExtractBitmap(m_ppTempIBM[i],r,i);
+        LONG *dst = m_ppCTemp[i] + offset;
         if (i >= rr->rr_usFirstComponent && i <= rr->rr_usLastComponent) {
           if (m_ppUpsampler[i]) {
             // Upsampled case, take from the upsampler, transform
             // into the color buffer.
-            m_ppUpsampler[i]->UpsampleRegion(r,m_ppCTemp[i]);
+            m_ppUpsampler[i]->UpsampleRegion(r,dst);
           } else if (m_ppDCT[i]) {
-            class QuantizedRow *qrow = *m_pppQImage[i];
-            LONG *src = (qrow)?(qrow->BlockAt(x)->m_Data):NULL;
             // Plain case. Transform directly into the color buffer.
-            m_ppDCT[i]->InverseTransformBlock(m_ppCTemp[i],src,(maxval + 1) >> 1);
+            InverseTransform(i,x,y,*m_pppQImage[i],dst);
           } else {
-            memset(m_ppCTemp[i],0,sizeof(LONG) * 64);
+            memset(dst,0,sizeof(LONG) * 64);
           }
         } else {
           // Not requested, zero the buffer.
-          memset(m_ppCTemp[i],0,sizeof(LONG) * 64);
+          memset(dst,0,sizeof(LONG) * 64);
         }
         //
         // Now for the residual image.
         if (m_pResidualHelper) {
           if (i >= rr->rr_usFirstComponent && i <= rr->rr_usLastComponent) {
             if (m_ppResidualUpsampler[i]) {
-              m_ppResidualUpsampler[i]->UpsampleRegion(r,m_ppDTemp[i]);
+              m_ppResidualUpsampler[i]->UpsampleRegion(r,m_ppDTemp[i] + offset);
             } else {
               class QuantizedRow *rrow = *m_pppRImage[i];
-              m_pResidualHelper->DequantizeResidual(NULL,m_ppDTemp[i],rrow->BlockAt(x)->m_Data,i);
+              m_pResidualHelper->DequantizeResidual(NULL,m_ppDTemp[i] + offset,rrow->BlockAt(x)->m_Data,i);
             }
           }
         }
       }
-      ctrafo->YCbCr2RGB(r,m_ppTempIBM,m_ppCTemp,m_ppDTemp);
     }
     //
+    // Transform the complete row.
+    r.ra_MinX = region.ra_MinX;
+    r.ra_MaxX = region.ra_MaxX;
+    for(i = 0;i < m_ucCount;i++) {
+      ExtractBitmap(m_ppTempIBM[i],r,i);
+    }
+    ctrafo->YCbCr2RGBRow(r,m_ppTempIBM,m_ppCTemp,m_ppDTemp);
+    //
     // Advance the quantized rows for the non-subsampled components,
     // upsampled components have been advanced above.
     for(i = 0;i < m_ucCount;i++) {
@@ -1234,10 +1671,19 @@ void BlockBitmapRequester::RequestUserDataForDecoding(class BitMapHook *bmh,Rect
   m_ulMaxMCU = MAX_ULONG;
 
   ResetBitmaps();
+  //
+  // Planar output does not go through the hook, but requires that
+  // the IDCT output can be stored as is.
+  if (rr->rr_ppucPlanes) {
+    if (m_pResidualHelper || m_pFrame->HiddenPrecisionOf() > 8)
+      JPG_THROW(NOT_IMPLEMENTED,"BlockBitmapRequester::RequestUserDataForDecoding",
+                "planar output is only available for 8 bit images without residual");
+    return;
+  }
   
   for(i = rr->rr_usFirstComponent;i <= rr->rr_usLastComponent;i++) {
     RequestUserData(bmh,region,i,alpha);
-    ULONG max = (BitmapOf(i).ibm_ulHeight >> 3) - 1;
+    ULONG max = LastMCUOf(i);
     if (max < m_ulMaxMCU)
       m_ulMaxMCU = max;
   }
@@ -1248,8 +1694,15 @@ void BlockBitmapRequester::RequestUserDataForDecoding(class BitMapHook *bmh,Rect
 // Reconstruct a block, or part of a block
 void BlockBitmapRequester::ReconstructRegion(const RectAngle<LONG> &region,const struct RectangleRequest *rr)
 {
-  class ColorTrafo *ctrafo = ColorTrafoOf(false,!rr->rr_bColorTrafo);
+  class ColorTrafo *ctrafo;
+  //
+  // Planar output, no color transformation, no upsampling.
+  if (rr->rr_ppucPlanes) {
+    ReconstructPlanes(rr,region);
+    return;
+  }
 
+  ctrafo = ColorTrafoOf(false,!rr->rr_bColorTrafo);
   if (ctrafo == NULL)
     return;
   
@@ -63,6 +63,7 @@ class ColorTrafo;
 class QuantizedRow;
 class ResidualBlockHelper;
 class DeRinger;
+class WorkerPool;
 ///
 
 /// class BlockBitmapRequester
@@ -135,6 +136,20 @@ class BlockBitmapRequester : public BlockBuffer, public BitmapCtrl {
   // Deblocking filter (if any)
   class DeRinger           **m_ppDeRinger;
   //
+  // Encodes a stretch of blocks of a block row on a worker thread.
+  class EncodeJob;
+  //
+  // The jobs encoding a block row in parallel, one per thread.
+  class EncodeJob           *m_pEncodeJobs;
+  ULONG                      m_ulEncodeJobs;
+  //
+  // The output of the inverse DCT for all blocks of each component,
+  // kept for incremental display. Allocated on first use.
+  LONG                     **m_pplPreview;
+  //
+  // Set if the current display reconstructs from the above.
+  bool                       m_bPreview;
+  //
   // True if subsampling is required.
   bool                       m_bSubsampling;
   //
@@ -168,10 +183,38 @@ class BlockBitmapRequester : public BlockBuffer, public BitmapCtrl {
   // The encoding procedure without subsampling, which is the much simpler case.
   void EncodeUnsampled(const RectAngle<LONG> &region,class ColorTrafo *ctrafo);
   //
+  // Encode the blocks first to last of the block row y whose lines are
+  // given by r, with the given bitmaps and block pointers as temporaries.
+  void EncodeBlocks(const RectAngle<LONG> &region,RectAngle<LONG> r,ULONG y,
+                    ULONG first,ULONG last,class ColorTrafo *ctrafo,
+                    struct ImageBitMap **ibm,LONG **qtemp,LONG **rtemp);
+  //
+  // Return the number of jobs a block row can be split into for
+  // encoding it on the worker threads, or zero if it has to be
+  // encoded in the calling thread.
+  ULONG EncodeJobsOf(class WorkerPool *pool);
+  //
+  // Return the number of blocks per row and the number of block rows
+  // of the given component, at its native resolution.
+  void BlockDimensionsOf(UBYTE i,ULONG &width,ULONG &height) const;
+  //
+  // Recompute the preview buffer of all requested components for the
+  // block rows the parsers touched since the last incremental display,
+  // and crop the region vertically to the lines that changed.
+  void UpdatePreview(RectAngle<LONG> &region,const struct RectangleRequest *rr);
+  //
+  // Run the inverse DCT for the given block of a component, or take it
+  // from the preview buffer if this is an incremental display.
+  void InverseTransform(UBYTE i,ULONG bx,ULONG by,const class QuantizedRow *qrow,LONG *dst);
+  //
   // Reconstruct a region not using any subsampling.
   void ReconstructUnsampled(const struct RectangleRequest *rr,const RectAngle<LONG> &region,
                             ULONG maxmcu,class ColorTrafo *ctrafo);
   //
+  // Reconstruct a region directly into the planes of the request,
+  // component by component at their native resolution.
+  void ReconstructPlanes(const struct RectangleRequest *rr,const RectAngle<LONG> &region);
+  //
   // Pull the quantized data into the upsampler if there is one.
   void PullQData(const struct RectangleRequest *rr,const RectAngle<LONG> &region);
   //
@@ -210,6 +253,11 @@ public:
   // initialized to the full image.
   virtual void CropEncodingRegion(RectAngle<LONG> &region,const struct RectangleRequest *rr);
   //
+  // First step of a region decoder: Find the region that can be provided in the next step.
+  // For incremental display, this also updates the preview buffer and crops to the
+  // lines that changed.
+  virtual void CropDecodingRegion(RectAngle<LONG> &region,const struct RectangleRequest *rr);
+  //
   // Request user data for encoding for the given region, potentially clip the region to the
   // data available from the user.
   virtual void RequestUserDataForEncoding(class BitMapHook *bmh,RectAngle<LONG> &region,bool alpha);
@@ -222,6 +270,11 @@ public:
   // prepare everything for coding.
   virtual void EncodeRegion(const RectAngle<LONG> &region);
   //
+  // Encode the rows of blocks covered by the region from the
+  // planes of the request, without color transformation and
+  // downsampling.
+  virtual void EncodePlanes(const RectAngle<LONG> &region,const struct RectangleRequest *rr);
+  //
   // Reconstruct a block, or part of a block
   virtual void ReconstructRegion(const RectAngle<LONG> &region,const struct RectangleRequest *rr);
   //
@@ -68,7 +68,8 @@
 /// BlockBuffer::BlockBuffer
 BlockBuffer::BlockBuffer(class Frame *frame)
   : BlockCtrl(frame->EnvironOf()), m_pFrame(frame), m_pulY(NULL), m_pulCurrentY(NULL), 
-    m_ppDCT(NULL), 
+    m_pulResidualY(NULL), m_pulCurrentResidualY(NULL), 
+    m_pulModifiedMinY(NULL), m_pulModifiedMaxY(NULL), m_pOpenScan(NULL), m_ppDCT(NULL), 
     m_ppQTop(NULL), m_ppRTop(NULL), 
     m_pppQStream(NULL), m_pppRStream(NULL)
 {
@@ -97,6 +98,18 @@ BlockBuffer::~BlockBuffer(void)
   if (m_pulCurrentY)
     m_pEnviron->FreeMem(m_pulCurrentY,m_ucCount * sizeof(ULONG));
 
+  if (m_pulResidualY)
+    m_pEnviron->FreeMem(m_pulResidualY,m_ucCount * sizeof(ULONG));
+
+  if (m_pulCurrentResidualY)
+    m_pEnviron->FreeMem(m_pulCurrentResidualY,m_ucCount * sizeof(ULONG));
+
+  if (m_pulModifiedMinY)
+    m_pEnviron->FreeMem(m_pulModifiedMinY,m_ucCount * sizeof(ULONG));
+
+  if (m_pulModifiedMaxY)
+    m_pEnviron->FreeMem(m_pulModifiedMaxY,m_ucCount * sizeof(ULONG));
+
   if (m_ppQTop) {
     for(i = 0;i < m_ucCount;i++) {
       while((row = m_ppQTop[i])) {
@@ -144,6 +157,27 @@ void BlockBuffer::BuildCommon(void)
     memset(m_pulCurrentY,0,sizeof(ULONG) * m_ucCount);
   }
 
+  if (m_pulResidualY == NULL) {
+    m_pulResidualY        = (ULONG *)m_pEnviron->AllocMem(sizeof(ULONG) * m_ucCount);
+    memset(m_pulResidualY,0,sizeof(ULONG) * m_ucCount);
+  }
+  
+  if (m_pulCurrentResidualY == NULL) {
+    m_pulCurrentResidualY = (ULONG *)m_pEnviron->AllocMem(sizeof(ULONG) * m_ucCount);
+    memset(m_pulCurrentResidualY,0,sizeof(ULONG) * m_ucCount);
+  }
+
+  if (m_pulModifiedMinY == NULL) {
+    m_pulModifiedMinY = (ULONG *)m_pEnviron->AllocMem(sizeof(ULONG) * m_ucCount);
+    for(UBYTE i = 0;i < m_ucCount;i++)
+      m_pulModifiedMinY[i] = MAX_ULONG;
+  }
+
+  if (m_pulModifiedMaxY == NULL) {
+    m_pulModifiedMaxY = (ULONG *)m_pEnviron->AllocMem(sizeof(ULONG) * m_ucCount);
+    memset(m_pulModifiedMaxY,0,sizeof(ULONG) * m_ucCount);
+  }
+
   if (m_ppQTop == NULL) {
     m_ppQTop      = (class QuantizedRow **)m_pEnviron->AllocMem(sizeof(class QuantizedRow *) * 
                                                               m_ucCount);
@@ -188,7 +222,6 @@ void BlockBuffer::ResetToStartOfScan(class Scan *scan)
       m_pulY[idx]           = 0;
       m_pulCurrentY[idx]    = 0;
       m_pppQStream[idx]     = NULL;
-      m_pppRStream[idx]     = NULL;
     }
   } else {
     // All components.
@@ -200,7 +233,31 @@ void BlockBuffer::ResetToStartOfScan(class Scan *scan)
       m_pulY[idx]           = 0;
       m_pulCurrentY[idx]    = 0;
       m_pppQStream[idx]     = NULL;
-      m_pppRStream[idx]     = NULL;
+    }
+  }
+  m_pOpenScan = NULL;
+}
+///
+
+/// BlockBuffer::ResetResidualToStartOfScan
+// The same for a residual scan. This only resets the residual
+// rows and leaves the legacy rows and the DCTs alone.
+void BlockBuffer::ResetResidualToStartOfScan(class Scan *scan)
+{ 
+  if (scan) {
+    UBYTE ccnt = scan->ComponentsInScan();
+    
+    for(UBYTE i = 0;i < ccnt;i++) {
+      UBYTE idx                  = scan->ComponentOf(i)->IndexOf(); 
+      m_pulResidualY[idx]        = 0;
+      m_pulCurrentResidualY[idx] = 0;
+      m_pppRStream[idx]          = NULL;
+    }
+  } else {
+    for(UBYTE idx = 0;idx < m_ucCount;idx++) { 
+      m_pulResidualY[idx]        = 0;
+      m_pulCurrentResidualY[idx] = 0;
+      m_pppRStream[idx]          = NULL;
     }
   }
 }
@@ -233,6 +290,12 @@ bool BlockBuffer::StartMCUQuantizerRow(class Scan *scan)
 
     if (ymin < ymax) {
       m_pulCurrentY[idx] = m_pulY[idx];
+      //
+      // Keep track of what the parsers touch for incremental display.
+      if (ymin < m_pulModifiedMinY[idx])
+        m_pulModifiedMinY[idx] = ymin;
+      if (ymax > m_pulModifiedMaxY[idx])
+        m_pulModifiedMaxY[idx] = ymax;
   
       //
       // Skip all the lines in the MCU
@@ -261,10 +324,50 @@ bool BlockBuffer::StartMCUQuantizerRow(class Scan *scan)
     m_pulY[idx] = ymax;
   }
 
+  m_pOpenScan = (more)?(scan):(NULL);
+
   return more;
 }
 ///
 
+/// BlockBuffer::CollectModifiedLines
+// Return the range of lines of the given component the parsers
+// modified since the last call, in lines of the subsampled
+// component, and forget it, except for the MCU row currently being
+// parsed. The maximum is exclusive. Returns false if no line has
+// been modified.
+bool BlockBuffer::CollectModifiedLines(UBYTE comp,ULONG &miny,ULONG &maxy)
+{
+  assert(comp < m_ucCount);
+
+  if (m_pulModifiedMinY == NULL || m_pulModifiedMinY[comp] >= m_pulModifiedMaxY[comp])
+    return false;
+
+  miny = m_pulModifiedMinY[comp];
+  maxy = m_pulModifiedMaxY[comp];
+  
+  m_pulModifiedMinY[comp] = MAX_ULONG;
+  m_pulModifiedMaxY[comp] = 0;
+  //
+  // The row was marked when it was started, but the parser may have
+  // stopped anywhere within it, so it has to be collected again once
+  // it is complete.
+  if (m_pOpenScan) {
+    UBYTE ccnt = m_pOpenScan->ComponentsInScan();
+    
+    for(UBYTE i = 0;i < ccnt;i++) {
+      if (m_pOpenScan->ComponentOf(i)->IndexOf() == comp) {
+        m_pulModifiedMinY[comp] = m_pulCurrentY[comp];
+        m_pulModifiedMaxY[comp] = m_pulY[comp];
+        break;
+      }
+    }
+  }
+
+  return true;
+}
+///
+
 /// BlockBuffer::BufferedLines
 // Return the number of lines available for reconstruction from this scan.
 ULONG BlockBuffer::BufferedLines(const struct RectangleRequest *rr) const
@@ -274,7 +377,13 @@ ULONG BlockBuffer::BufferedLines(const struct RectangleRequest *rr) const
 
   for(i = rr->rr_usFirstComponent;i <= rr->rr_usLastComponent;i++) {
     class Component *comp = m_pFrame->ComponentOf(i);
-    ULONG curline = comp->SubYOf() * (m_pulCurrentY[i] + (comp->MCUHeightOf() << 3));
+    ULONG current = m_pulCurrentY[i];
+    //
+    // Once the residual is parsed, lines are only complete if
+    // the residual covers them as well.
+    if (m_ppRTop[i] && m_pulCurrentResidualY[i] < current)
+      current = m_pulCurrentResidualY[i];
+    ULONG curline = comp->SubYOf() * (current + (comp->MCUHeightOf() << 3));
     if (curline >= m_ulPixelHeight) { // end of image
       curline = m_ulPixelHeight;
     } else if (curline > 0 && comp->SubYOf() > 1) { // need one extra pixel at the end for subsampling expansion
@@ -306,14 +415,14 @@ bool BlockBuffer::StartMCUResidualRow(class Scan *scan)
     last            = m_pppRStream[i];
     width           = (m_ulPixelWidth  + subx - 1) / subx;
     height          = (m_ulPixelHeight + suby - 1) / suby;
-    ymin            = m_pulY[i];
+    ymin            = m_pulResidualY[i];
     ymax            = ymin + (mcuheight << 3);  
     
     if (m_ulPixelHeight > 0 && ymax > height)
       ymax = height;
 
     if (ymin < ymax) {
-      m_pulCurrentY[i] = m_pulY[i];
+      m_pulCurrentResidualY[i] = m_pulResidualY[i];
 
       if (last) {
         while(mcuheight) {
@@ -337,7 +446,7 @@ bool BlockBuffer::StartMCUResidualRow(class Scan *scan)
     } else {
       more = false;
     }
-    m_pulY[i] = ymax;
+    m_pulResidualY[i] = ymax;
   }
 
   return more;
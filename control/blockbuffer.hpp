@@ -62,6 +62,7 @@ class DownsamplerBase;
 class ColorTrafo;
 class QuantizedRow;
 class ResidualBlockHelper;
+class Scan;
 ///
 
 /// class BlockBuffer
@@ -87,6 +88,23 @@ protected:
   // quantizer buffer line.
   ULONG                     *m_pulCurrentY;
   //
+  // The same for the residual rows. These are kept separately
+  // such that the residual can be parsed concurrently to the
+  // legacy codestream.
+  ULONG                     *m_pulResidualY;
+  ULONG                     *m_pulCurrentResidualY;
+  //
+  // The range of lines, in lines of the subsampled component, the
+  // codestream parsers touched since they were last collected. The
+  // maximum is exclusive.
+  ULONG                     *m_pulModifiedMinY;
+  ULONG                     *m_pulModifiedMaxY;
+  //
+  // The scan whose current MCU row is still being parsed, or NULL
+  // if no row is open. The lines of this row remain modified until
+  // the row is complete.
+  class Scan                *m_pOpenScan;
+  //
   // The DCT for encoding or decoding, together with the quantizer.
   class DCT                **m_ppDCT; 
   //
@@ -111,6 +129,19 @@ protected:
   // Build common structures for encoding and decoding
   void BuildCommon(void);
   //
+  // Return the range of lines of the given component the parsers
+  // modified since the last call, in lines of the subsampled
+  // component, and forget it, except for the MCU row currently being
+  // parsed. The maximum is exclusive. Returns false if no line has
+  // been modified.
+  bool CollectModifiedLines(UBYTE comp,ULONG &miny,ULONG &maxy);
+  //
+  // Mark all lines of the given component as modified.
+  void MarkModified(UBYTE comp)
+  {
+    m_pulModifiedMinY[comp] = 0;
+    m_pulModifiedMaxY[comp] = MAX_ULONG;
+  }
   //
 public:
   //
@@ -131,6 +162,14 @@ public:
     return *m_pppQStream[comp];
   }
   //
+  // Return the first quantized row of the component, NULL if none
+  // has been created yet.
+  class QuantizedRow *TopQuantizedRow(UBYTE comp) const
+  {
+    assert(comp < m_ucCount);
+    return (m_ppQTop)?(m_ppQTop[comp]):(NULL);
+  }
+  //
   // Return the current top row of the residuals.
   class QuantizedRow *CurrentResidualRow(UBYTE comp)
   {
@@ -155,6 +194,10 @@ public:
   // required after collecting the statistics for this scan.
   virtual void ResetToStartOfScan(class Scan *scan);
   //
+  // The same for a residual scan. This only resets the residual
+  // rows and leaves the legacy rows and the DCTs alone.
+  void ResetResidualToStartOfScan(class Scan *scan);
+  //
   // Return true in case this buffer is organized in lines rather
   // than blocks.
   virtual bool isLineBased(void) const
@@ -0,0 +1,146 @@
+/*************************************************************************
+
+    This project implements a complete(!) JPEG (Recommendation ITU-T
+    T.81 | ISO/IEC 10918-1) codec, plus a library that can be used to
+    encode and decode JPEG streams. 
+    It also implements ISO/IEC 18477 aka JPEG XT which is an extension
+    towards intermediate, high-dynamic-range lossy and lossless coding
+    of JPEG. In specific, it supports ISO/IEC 18477-3/-6/-7/-8 encoding.
+
+    Note that only Profiles C and D of ISO/IEC 18477-7 are supported
+    here. Check the JPEG XT reference software for a full implementation
+    of ISO/IEC 18477-7.
+
+    Copyright (C) 2012-2018 Thomas Richter, University of Stuttgart and
+    Accusoft. (C) 2019-2020 Thomas Richter, Fraunhofer IIS.
+
+    This program is available under two licenses, GPLv3 and the ITU
+    Software licence Annex A Option 2, RAND conditions.
+
+    For the full text of the GPU license option, see README.license.gpl.
+    For the full text of the ITU license option, see README.license.itu.
+    
+    You may freely select between these two options.
+
+    For the GPL option, please note the following:
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+/*
+** This class provides a private read position into the quantized
+** rows of a block buffer. It allows several scans to walk over the
+** same coefficients concurrently on encoding.
+**
+** $Id$
+**
+*/
+
+/// Includes
+#include "control/blockcursor.hpp"
+#include "coding/quantizedrow.hpp"
+#include "marker/frame.hpp"
+#include "marker/scan.hpp"
+#include "marker/component.hpp"
+///
+
+/// BlockCursor::BlockCursor
+BlockCursor::BlockCursor(class Frame *frame,class BlockBuffer *buffer,class BufferCtrl *parent)
+  : BlockCtrl(frame->EnvironOf()), BufferCtrl(frame->EnvironOf()),
+    m_pEnviron(frame->EnvironOf()), m_pFrame(frame), m_pBuffer(buffer), m_pParent(parent),
+    m_ucCount(frame->DepthOf()),
+    m_pulY(NULL), m_ppCurrent(NULL), m_ppNext(NULL)
+{
+  UBYTE i;
+  
+  m_pulY      = (ULONG *)m_pEnviron->AllocMem(sizeof(ULONG) * m_ucCount);
+  m_ppCurrent = (class QuantizedRow **)m_pEnviron->AllocMem(sizeof(class QuantizedRow *) * m_ucCount);
+  m_ppNext    = (class QuantizedRow **)m_pEnviron->AllocMem(sizeof(class QuantizedRow *) * m_ucCount);
+
+  for(i = 0;i < m_ucCount;i++) {
+    m_pulY[i]      = 0;
+    m_ppCurrent[i] = NULL;
+    m_ppNext[i]    = NULL;
+  }
+}
+///
+
+/// BlockCursor::~BlockCursor
+BlockCursor::~BlockCursor(void)
+{
+  if (m_pulY)
+    m_pEnviron->FreeMem(m_pulY,sizeof(ULONG) * m_ucCount);
+  if (m_ppCurrent)
+    m_pEnviron->FreeMem(m_ppCurrent,sizeof(class QuantizedRow *) * m_ucCount);
+  if (m_ppNext)
+    m_pEnviron->FreeMem(m_ppNext,sizeof(class QuantizedRow *) * m_ucCount);
+}
+///
+
+/// BlockCursor::ResetToStartOfScan
+// Reset the private position of the components in the
+// scan to the start of the image.
+void BlockCursor::ResetToStartOfScan(class Scan *scan)
+{
+  UBYTE ccnt = (scan)?(scan->ComponentsInScan()):(m_ucCount);
+
+  for(UBYTE i = 0;i < ccnt;i++) {
+    UBYTE idx        = (scan)?(scan->ComponentOf(i)->IndexOf()):(i);
+    m_pulY[idx]      = 0;
+    m_ppCurrent[idx] = NULL;
+    m_ppNext[idx]    = m_pBuffer->TopQuantizedRow(idx);
+  }
+}
+///
+
+/// BlockCursor::StartMCUQuantizerRow
+// Start a MCU scan by advancing the private position to the
+// next MCU row of the scan.
+bool BlockCursor::StartMCUQuantizerRow(class Scan *scan)
+{
+  bool more  = true;
+  UBYTE ccnt = scan->ComponentsInScan();
+  
+  for(UBYTE i = 0;i < ccnt;i++) {
+    class Component *comp = scan->ComponentOf(i);
+    UBYTE mcuheight = (ccnt > 1)?(comp->MCUHeightOf()):(1);
+    UBYTE suby      = comp->SubYOf();
+    UBYTE idx       = comp->IndexOf();
+    ULONG height    = (m_pFrame->HeightOf() + suby - 1) / suby;
+    ULONG ymin      = m_pulY[idx];
+    ULONG ymax      = ymin + (mcuheight << 3);
+    
+    if (ymax > height)
+      ymax = height;
+
+    if (ymin < ymax) {
+      class QuantizedRow *row = m_ppNext[idx];
+      //
+      m_ppCurrent[idx] = row;
+      for(ULONG y = ymin;y < ymax;y += 8) {
+        if (row == NULL)
+          JPG_THROW(OBJECT_DOESNT_EXIST,"BlockCursor::StartMCUQuantizerRow",
+                    "image data is not yet complete, cannot write the scan");
+        row = row->NextOf();
+      }
+      m_ppNext[idx] = row;
+    } else {
+      more = false;
+    }
+    m_pulY[idx] = ymax;
+  }
+
+  return more;
+}
+///
@@ -0,0 +1,152 @@
+/*************************************************************************
+
+    This project implements a complete(!) JPEG (Recommendation ITU-T
+    T.81 | ISO/IEC 10918-1) codec, plus a library that can be used to
+    encode and decode JPEG streams. 
+    It also implements ISO/IEC 18477 aka JPEG XT which is an extension
+    towards intermediate, high-dynamic-range lossy and lossless coding
+    of JPEG. In specific, it supports ISO/IEC 18477-3/-6/-7/-8 encoding.
+
+    Note that only Profiles C and D of ISO/IEC 18477-7 are supported
+    here. Check the JPEG XT reference software for a full implementation
+    of ISO/IEC 18477-7.
+
+    Copyright (C) 2012-2018 Thomas Richter, University of Stuttgart and
+    Accusoft. (C) 2019-2020 Thomas Richter, Fraunhofer IIS.
+
+    This program is available under two licenses, GPLv3 and the ITU
+    Software licence Annex A Option 2, RAND conditions.
+
+    For the full text of the GPU license option, see README.license.gpl.
+    For the full text of the ITU license option, see README.license.itu.
+    
+    You may freely select between these two options.
+
+    For the GPL option, please note the following:
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+/*
+** This class provides a private read position into the quantized
+** rows of a block buffer. It allows several scans to walk over the
+** same coefficients concurrently on encoding.
+**
+** $Id$
+**
+*/
+
+#ifndef CONTROL_BLOCKCURSOR_HPP
+#define CONTROL_BLOCKCURSOR_HPP
+
+/// Includes
+#include "control/bufferctrl.hpp"
+#include "control/blockctrl.hpp"
+#include "control/blockbuffer.hpp"
+///
+
+/// Forwards
+class Frame;
+class Scan;
+class QuantizedRow;
+///
+
+/// class BlockCursor
+// This class implements the block control interface on top of the
+// quantized rows of a block buffer, but keeps the scan position of
+// its own. It does not allocate rows, hence all rows the scan touches
+// must exist already, i.e. it is only useful for encoding. All
+// remaining requests go to the buffer control it was created for.
+class BlockCursor : public BlockCtrl, public BufferCtrl {
+  //
+  // Resolve the ambiguity between the two base classes.
+  class Environ       *m_pEnviron;
+  //
+  // The frame the scans belong to.
+  class Frame         *m_pFrame;
+  //
+  // The buffer holding the quantized data.
+  class BlockBuffer   *m_pBuffer;
+  //
+  // The buffer control all other requests are forwarded to.
+  class BufferCtrl    *m_pParent;
+  //
+  // Number of components in the frame.
+  UBYTE                m_ucCount;
+  //
+  // Next line to be processed, per component.
+  ULONG               *m_pulY;
+  //
+  // The top row of the current MCU, and the row following
+  // it, per component.
+  class QuantizedRow **m_ppCurrent;
+  class QuantizedRow **m_ppNext;
+  //
+public:
+  //
+  // Create a cursor into the given buffer which is the block
+  // buffer of the given buffer control.
+  BlockCursor(class Frame *frame,class BlockBuffer *buffer,class BufferCtrl *parent);
+  //
+  virtual ~BlockCursor(void);
+  //
+  // Buffer control interface:
+  //
+  // Return true in case this buffer is organized in lines rather
+  // than blocks.
+  virtual bool isLineBased(void) const
+  {
+    return false;
+  }
+  //
+  // First time usage: Collect all the information for encoding.
+  virtual void PrepareForEncoding(void)
+  {
+    m_pParent->PrepareForEncoding();
+  }
+  //
+  // First time usage: Collect all the information for decoding.
+  virtual void PrepareForDecoding(void)
+  {
+    m_pParent->PrepareForDecoding();
+  }
+  //
+  // Indicate the frame height after the frame has already been
+  // started.
+  virtual void PostImageHeight(ULONG height)
+  {
+    m_pParent->PostImageHeight(height);
+  }
+  //
+  // Block control interface:
+  //
+  // Return the current top MCU quantized line.
+  virtual class QuantizedRow *CurrentQuantizedRow(UBYTE comp)
+  {
+    assert(comp < m_ucCount);
+    return m_ppCurrent[comp];
+  }
+  //
+  // Start a MCU scan by advancing the private position to the
+  // next MCU row of the scan.
+  virtual bool StartMCUQuantizerRow(class Scan *scan);
+  //
+  // Reset the private position of the components in the
+  // scan to the start of the image.
+  virtual void ResetToStartOfScan(class Scan *scan);
+};
+///
+
+///
+#endif
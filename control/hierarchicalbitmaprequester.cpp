@@ -319,6 +319,42 @@ void HierarchicalBitmapRequester::AddImageScale(class Frame *frame,bool expandh,
 }
 ///
 
+/// HierarchicalBitmapRequester::TruncateToLargestScale
+// Decoding stopped after the frame of the current largest scale. Make
+// this scale the full image, i.e. shrink the image dimensions to it.
+void HierarchicalBitmapRequester::TruncateToLargestScale(void)
+{
+#if ACCUSOFT_CODE
+  class Frame *frame = m_pLargestScale->FrameOf();
+  UBYTE i;
+
+  assert(m_pulHeight && m_ppUpsampler);
+  //
+  // The dimensions marker now describes the reduced image, all the rest
+  // follows from there.
+  m_pFrame->ReduceDimensions(frame->WidthOf(),frame->HeightOf());
+  m_ulPixelWidth  = m_pFrame->WidthOf();
+  m_ulPixelHeight = m_pFrame->HeightOf();
+  //
+  for(i = 0;i < m_ucCount;i++) {
+    class Component *comp = m_pFrame->ComponentOf(i);
+    UBYTE sx              = comp->SubXOf();
+    UBYTE sy              = comp->SubYOf();
+    m_pulHeight[i]        = (m_ulPixelHeight + sy - 1) / sy;
+    //
+    // The upsamplers were built for the full image, rebuild them
+    // for the smaller one.
+    if (m_ppUpsampler[i]) {
+      delete m_ppUpsampler[i];
+      m_ppUpsampler[i] = UpsamplerBase::CreateUpsampler(m_pEnviron,sx,sy,
+                                                        m_ulPixelWidth,m_ulPixelHeight,
+                                                        m_pFrame->TablesOf()->isChromaCentered());
+    }
+  }
+#endif
+}
+///
+
 /// HierarchicalBitmapRequester::GenerateDifferentialImage
 // After having written the previous image, compute the differential from the downscaled
 // and-re-upscaled version and push it into the next frame, collect the
@@ -529,6 +565,10 @@ void HierarchicalBitmapRequester::RequestUserDataForDecoding(class BitMapHook *b
 #if ACCUSOFT_CODE
   int i;
 
+  if (rr->rr_ppucPlanes)
+    JPG_THROW(NOT_IMPLEMENTED,"HierarchicalBitmapRequester::RequestUserDataForDecoding",
+              "planar output is not available for hierarchical images");
+
   ResetBitmaps();
   
   if (m_pLargestScale->FrameOf()->WidthOf()   != m_pFrame->WidthOf() ||
@@ -554,7 +594,7 @@ void HierarchicalBitmapRequester::RequestUserDataForDecoding(class BitMapHook *b
   
   for(i = rr->rr_usFirstComponent;i <= rr->rr_usLastComponent;i++) {
     RequestUserData(bmh,region,i,alpha);
-    ULONG max = (BitmapOf(i).ibm_ulHeight >> 3) - 1;
+    ULONG max = LastMCUOf(i);
     if (max < m_ulMaxMCU)
       m_ulMaxMCU = max;
   }
@@ -586,17 +626,21 @@ void HierarchicalBitmapRequester::EncodeRegion(const RectAngle<LONG> &region)
     
     // First part: Collect the data from
     // the user and push it into the color transformer buffer.
-    // For that first build the downsampler.
-    for(i = 0;i < m_ucCount;i++) {
-      if (m_ppDownsampler[i]) {
-        m_ppDownsampler[i]->SetBufferedRegion(region);
-      }
-    }
-    
     for(y = miny,r.ra_MinY = region.ra_MinY;y <= maxy;y++,r.ra_MinY = r.ra_MaxY + 1) {
       r.ra_MaxY = (r.ra_MinY & -8) + 7;
       if (r.ra_MaxY > region.ra_MaxY)
         r.ra_MaxY = region.ra_MaxY;
+      //
+      // Build the downsampler buffer for the lines of this row only,
+      // lines not yet delivered must not be considered complete.
+      for(i = 0;i < m_ucCount;i++) {
+        if (m_ppDownsampler[i]) {
+          RectAngle<LONG> lines = region;
+          lines.ra_MinY = r.ra_MinY;
+          lines.ra_MaxY = r.ra_MaxY;
+          m_ppDownsampler[i]->SetBufferedRegion(lines);
+        }
+      }
 
       for(i = 0;i < m_ucCount;i++) {
         if (m_ppDownsampler[i] == NULL) {
@@ -747,9 +791,6 @@ void HierarchicalBitmapRequester::ReconstructRegion(const RectAngle<LONG> &orgre
           }
           Release8Lines(i);
         }
-      } else {
-        // Load into the decoding MCU
-        Pull8Lines(i);
       }
     }
     // Now push blocks into the color transformer from the upsampler.
@@ -768,6 +809,13 @@ void HierarchicalBitmapRequester::ReconstructRegion(const RectAngle<LONG> &orgre
         r.ra_MaxY = (r.ra_MinY & -8) + 7;
         if (r.ra_MaxY > orgregion.ra_MaxY)
           r.ra_MaxY = orgregion.ra_MaxY;
+        //
+        // Load the non-subsampled components of this row into the
+        // decoding MCU, the region may cover more than one row.
+        for(i = rr->rr_usFirstComponent;i <= rr->rr_usLastComponent;i++) {
+          if (m_ppUpsampler[i] == NULL)
+            Pull8Lines(i);
+        }
         
         for(x = minx,r.ra_MinX = orgregion.ra_MinX;x <= maxx;x++,r.ra_MinX = r.ra_MaxX + 1) {
           r.ra_MaxX = (r.ra_MinX & -8) + 7;
@@ -815,15 +863,17 @@ void HierarchicalBitmapRequester::ReconstructRegion(const RectAngle<LONG> &orgre
       
     if (maxy > m_ulMaxMCU)
       maxy = m_ulMaxMCU;
-
-    for(i = rr->rr_usFirstComponent;i <= rr->rr_usLastComponent;i++) {
-      Pull8Lines(i);
-    }
     
     for(y = miny,r.ra_MinY = region.ra_MinY;y <= maxy;y++,r.ra_MinY = r.ra_MaxY + 1) {
       r.ra_MaxY = (r.ra_MinY & -8) + 7;
       if (r.ra_MaxY > region.ra_MaxY)
         r.ra_MaxY = region.ra_MaxY;
+      //
+      // Load the lines of this row into the decoding MCU, the region
+      // may cover more than one row.
+      for(i = rr->rr_usFirstComponent;i <= rr->rr_usLastComponent;i++) {
+        Pull8Lines(i);
+      }
         
       for(x = minx,r.ra_MinX = region.ra_MinX;x <= maxx;x++,r.ra_MinX = r.ra_MaxX + 1) {
         r.ra_MaxX = (r.ra_MinX & -8) + 7;
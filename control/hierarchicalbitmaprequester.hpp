@@ -170,6 +170,10 @@ public:
   // data available from the user.
   virtual void RequestUserDataForEncoding(class BitMapHook *bmh,RectAngle<LONG> &region,bool alpha);
   //
+  // Decoding stopped after the frame of the current largest scale. Make
+  // this scale the full image, i.e. shrink the image dimensions to it.
+  void TruncateToLargestScale(void);
+  //
   // Pull data buffers from the user data bitmap hook
   virtual void RequestUserDataForDecoding(class BitMapHook *bmh,RectAngle<LONG> &region,
                                           const struct RectangleRequest *rr,bool alpha);
@@ -316,17 +316,21 @@ void LineBitmapRequester::EncodeRegion(const RectAngle<LONG> &region)
 
     // First part: Collect the data from
     // the user and push it into the color transformer buffer.
-    // For that first build the downsampler.
-    for(i = 0;i < m_ucCount;i++) {
-      if (m_ppDownsampler[i]) {
-        m_ppDownsampler[i]->SetBufferedRegion(region);
-      }
-    }
-    
     for(y = miny,r.ra_MinY = region.ra_MinY;y <= maxy;y++,r.ra_MinY = r.ra_MaxY + 1) {
       r.ra_MaxY = (r.ra_MinY & -8) + 7;
       if (r.ra_MaxY > region.ra_MaxY)
         r.ra_MaxY = region.ra_MaxY;
+      //
+      // Build the downsampler buffer for the lines of this row only,
+      // lines not yet delivered must not be considered complete.
+      for(i = 0;i < m_ucCount;i++) {
+        if (m_ppDownsampler[i]) {
+          RectAngle<LONG> lines = region;
+          lines.ra_MinY = r.ra_MinY;
+          lines.ra_MaxY = r.ra_MaxY;
+          m_ppDownsampler[i]->SetBufferedRegion(lines);
+        }
+      }
         
       for(x = minx,r.ra_MinX = region.ra_MinX;x <= maxx;x++,r.ra_MinX = r.ra_MaxX + 1) {
         r.ra_MaxX = (r.ra_MinX & -8) + 7;
@@ -423,13 +427,17 @@ void LineBitmapRequester::RequestUserDataForDecoding(class BitMapHook *bmh,RectA
 { 
   int i;
 
+  if (rr->rr_ppucPlanes)
+    JPG_THROW(NOT_IMPLEMENTED,"LineBitmapRequester::RequestUserDataForDecoding",
+              "planar output is only available for DCT based images");
+
   ResetBitmaps();
   
   m_ulMaxMCU = MAX_ULONG;
   
   for(i = rr->rr_usFirstComponent;i <= rr->rr_usLastComponent;i++) {
     RequestUserData(bmh,region,i,alpha);
-    ULONG max = (BitmapOf(i).ibm_ulHeight >> 3) - 1;
+    ULONG max = LastMCUOf(i);
     if (max < m_ulMaxMCU)
       m_ulMaxMCU = max;
   }
@@ -505,34 +513,43 @@ void LineBitmapRequester::ReconstructRegion(const RectAngle<LONG> &orgregion,con
         if (r.ra_MaxY > orgregion.ra_MaxY)
           r.ra_MaxY = orgregion.ra_MaxY;
         
+        //
+        // Collect the blocks of the row in the color buffers.
         for(x = minx,r.ra_MinX = orgregion.ra_MinX;x <= maxx;x++,r.ra_MinX = r.ra_MaxX + 1) {
+          ULONG offset = (x - minx) << 6;
           r.ra_MaxX = (r.ra_MinX & -8) + 7;
           if (r.ra_MaxX > orgregion.ra_MaxX)
             r.ra_MaxX = orgregion.ra_MaxX;
           
           for(i = 0;i < m_ucCount;i++) {
-            // ExtractBitMap must go here, noting that the requested components
-            // correspond to transformed components in YUV space, not to components
-            // in RGB space.
-            ExtractBitmap(m_ppTempIBM[i],r,i);
+            LONG *dst = m_ppCTemp[i] + offset;
             if (i >= rr->rr_usFirstComponent && i <= rr->rr_usLastComponent) {
               if (m_ppUpsampler[i]) {
                 // Upsampled case, take from the upsampler, transform
                 // into the color buffer.
-                m_ppUpsampler[i]->UpsampleRegion(r,m_ppCTemp[i]);
+                m_ppUpsampler[i]->UpsampleRegion(r,dst);
               } else if (*m_pppImage[i]) {
-                FetchRegion(x,*m_pppImage[i],m_ppCTemp[i]);
+                FetchRegion(x,*m_pppImage[i],dst);
               } else {
-                memset(m_ppCTemp[0],0,sizeof(LONG) * 64);
+                memset(dst,0,sizeof(LONG) * 64);
               }
             } else {
               // Not requested, zero the buffer.
-              memset(m_ppCTemp[i],0,sizeof(LONG) * 64);
+              memset(dst,0,sizeof(LONG) * 64);
             }
           }
-          ctrafo->YCbCr2RGB(r,m_ppTempIBM,m_ppCTemp,NULL);
         }
         //
+        // ExtractBitMap must go here, noting that the requested components
+        // correspond to transformed components in YUV space, not to components
+        // in RGB space.
+        r.ra_MinX = orgregion.ra_MinX;
+        r.ra_MaxX = orgregion.ra_MaxX;
+        for(i = 0;i < m_ucCount;i++) {
+          ExtractBitmap(m_ppTempIBM[i],r,i);
+        }
+        ctrafo->YCbCr2RGBRow(r,m_ppTempIBM,m_ppCTemp,NULL);
+        //
         // Advance the quantized rows for the non-subsampled components,
         // upsampled components have been advanced above.
         for(i = rr->rr_usFirstComponent;i <= rr->rr_usLastComponent;i++) {
@@ -559,14 +576,10 @@ void LineBitmapRequester::ReconstructRegion(const RectAngle<LONG> &orgregion,con
       if (r.ra_MaxY > region.ra_MaxY)
         r.ra_MaxY = region.ra_MaxY;
         
-      for(x = minx,r.ra_MinX = region.ra_MinX;x <= maxx;x++,r.ra_MinX = r.ra_MaxX + 1) {
-        r.ra_MaxX = (r.ra_MinX & -8) + 7;
-        if (r.ra_MaxX > region.ra_MaxX)
-          r.ra_MaxX = region.ra_MaxX;
-
+      for(x = minx;x <= maxx;x++) {
+        ULONG offset = (x - minx) << 6;
         for(i = 0;i < m_ucCount;i++) {      
-          LONG *dst = m_ppCTemp[i];
-          ExtractBitmap(m_ppTempIBM[i],r,i);
+          LONG *dst = m_ppCTemp[i] + offset;
           if (i >= rr->rr_usFirstComponent && i <= rr->rr_usLastComponent) {
             if (*m_pppImage[i]) {
               FetchRegion(x,*m_pppImage[i],dst);
@@ -577,11 +590,16 @@ void LineBitmapRequester::ReconstructRegion(const RectAngle<LONG> &orgregion,con
             memset(dst,0,sizeof(LONG) * 64);
           }
         }
-        //
-        // Perform the color transformation now.
-        ctrafo->YCbCr2RGB(r,m_ppTempIBM,m_ppCTemp,NULL);
       } // of loop over x
       //
+      // Perform the color transformation of the row now.
+      r.ra_MinX = region.ra_MinX;
+      r.ra_MaxX = region.ra_MaxX;
+      for(i = 0;i < m_ucCount;i++) {
+        ExtractBitmap(m_ppTempIBM[i],r,i);
+      }
+      ctrafo->YCbCr2RGBRow(r,m_ppTempIBM,m_ppCTemp,NULL);
+      //
       // Advance the rows.
       for(i = rr->rr_usFirstComponent;i <= rr->rr_usLastComponent;i++) {
         Next8Lines(i);
@@ -388,6 +388,17 @@ void ResidualBlockHelper::AllocateBuffers(void)
 }
 ///
 
+/// ResidualBlockHelper::PrepareConcurrentQuantization
+// Prepare the quantizers and return whether QuantizeResidual() may
+// run concurrently on distinct blocks.
+bool ResidualBlockHelper::PrepareConcurrentQuantization(void)
+{
+  AllocateBuffers();
+  //
+  return !m_pResidualFrame->TablesOf()->Optimization();
+}
+///
+
 /// ResidualBlockHelper::QuantizeResidual
 // Compute the residuals of a block given the DCT data
 void ResidualBlockHelper::QuantizeResidual(const LONG *legacy,LONG *residual,UBYTE i,LONG bx,LONG by)
@@ -125,6 +125,11 @@ public:
   // Quantize the residuals of a block given the DCT data
   void QuantizeResidual(const LONG *legacy,LONG *residual,UBYTE i,LONG bx,LONG by);
   //
+  // Prepare the quantizers and return whether QuantizeResidual() may
+  // run concurrently on distinct blocks. This is not the case if the
+  // residual is R/D optimized.
+  bool PrepareConcurrentQuantization(void);
+  //
   // Return the frame this is part of which is extended by a residual
   class Frame *FrameOf(void) const
   {
@@ -135,7 +135,9 @@ public:
   // required after collecting the statistics for this scan.
   virtual void ResetToStartOfScan(class Scan *scan)
   {
-    m_pParent->ResetToStartOfScan(scan);
+    // Only the residual rows, the legacy rows are not touched
+    // such that the legacy scans may run at the same time.
+    m_pParent->ResetResidualToStartOfScan(scan);
   }
 };
 ///
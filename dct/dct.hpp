@@ -87,6 +87,14 @@ public:
   // Run the inverse DCT on an 8x8 block reconstructing the data.
   virtual void InverseTransformBlock(LONG *target,const LONG *source,LONG dcoffset) = 0;
   //
+  // Run the inverse DCT on a block that is likely to carry coefficients
+  // in its first row only. Implementations may take a shortcut here,
+  // but the result must be identical to that of InverseTransformBlock.
+  virtual void InverseTransformSparseBlock(LONG *target,const LONG *source,LONG dcoffset)
+  {
+    InverseTransformBlock(target,source,dcoffset);
+  }
+  //
   // Estimate a critical slope (lambda) from the unquantized data.
   // Or to be precise, estimate lambda/delta^2, the constant in front of
   // delta^2.
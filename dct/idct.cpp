@@ -220,6 +220,67 @@ void IDCT<preshift,T,deadzone,optimize>::TransformBlock(const LONG *source,LONG
 }
 ///
 
+/// IDCT::InverseTransformRow
+// Run the first pass of the inverse DCT over one row of eight
+// coefficients, writing the intermediate result to dptr.
+template<int preshift,typename T,bool deadzone,bool optimize>
+inline void IDCT<preshift,T,deadzone,optimize>::InverseTransformRow(LONG *dptr,const LONG *source,
+                                                                    const LONG *qnt,LONG dcoffset)
+{
+  // Even part.
+  T  tz2       = source[2] * qnt[2];
+  T  tz3       = source[6] * qnt[6];
+  FIXED z1     = (tz2 + tz3) *  TO_FIX(0.541196100);
+  FIXED tmp2   = z1 + tz3    * -TO_FIX(1.847759065);
+  FIXED tmp3   = z1 + tz2    *  TO_FIX(0.765366865);
+  
+  tz2          = source[0] * qnt[0] + dcoffset;
+  tz3          = source[4] * qnt[4];
+  
+  FIXED tmp0   = (tz2 + tz3) << FIX_BITS;
+  FIXED tmp1   = (tz2 - tz3) << FIX_BITS;
+  FIXED tmp10  = tmp0 + tmp3;
+  FIXED tmp13  = tmp0 - tmp3;
+  FIXED tmp11  = tmp1 + tmp2;
+  FIXED tmp12  = tmp1 - tmp2;
+  
+  // Odd part.
+  T ttmp0      = source[7] * qnt[7];
+  T ttmp1      = source[5] * qnt[5];
+  T ttmp2      = source[3] * qnt[3];
+  T ttmp3      = source[1] * qnt[1];
+  
+  T tz1        = ttmp0 + ttmp3;
+  tz2          = ttmp1 + ttmp2;
+  tz3          = ttmp0 + ttmp2;
+  T tz4        = ttmp1 + ttmp3;
+  FIXED z5     = (tz3 + tz4) * TO_FIX(1.175875602);
+  
+  tmp0         = ttmp0 * TO_FIX(0.298631336);
+  tmp1         = ttmp1 * TO_FIX(2.053119869);
+  tmp2         = ttmp2 * TO_FIX(3.072711026);
+  tmp3         = ttmp3 * TO_FIX(1.501321110);
+  z1           = tz1   *-TO_FIX(0.899976223);
+  FIXED z2     = tz2   *-TO_FIX(2.562915447);
+  FIXED z3     = tz3   *-TO_FIX(1.961570560) + z5;
+  FIXED z4     = tz4   *-TO_FIX(0.390180644) + z5;
+  
+  tmp0        += z1 + z3;
+  tmp1        += z2 + z4;
+  tmp2        += z2 + z3;
+  tmp3        += z1 + z4;
+  
+  dptr[0]      = FIXED_TO_INTERMEDIATE(tmp10 + tmp3);
+  dptr[7]      = FIXED_TO_INTERMEDIATE(tmp10 - tmp3);
+  dptr[1]      = FIXED_TO_INTERMEDIATE(tmp11 + tmp2);
+  dptr[6]      = FIXED_TO_INTERMEDIATE(tmp11 - tmp2);
+  dptr[2]      = FIXED_TO_INTERMEDIATE(tmp12 + tmp1);
+  dptr[5]      = FIXED_TO_INTERMEDIATE(tmp12 - tmp1);
+  dptr[3]      = FIXED_TO_INTERMEDIATE(tmp13 + tmp0);
+  dptr[4]      = FIXED_TO_INTERMEDIATE(tmp13 - tmp0);
+}
+///
+
 /// IDCT::InverseTransformBlock
 // Run the inverse DCT on an 8x8 block reconstructing the data.
 template<int preshift,typename T,bool deadzone,bool optimize>
@@ -234,57 +295,7 @@ void IDCT<preshift,T,deadzone,optimize>::InverseTransformBlock(LONG *target,cons
 
   if (source) {
     for(dptr = target,dend = target + (8 << 3);dptr < dend;dptr +=8,source += 8,qnt += 8) {
-      // Even part.
-      T  tz2       = source[2] * qnt[2];
-      T  tz3       = source[6] * qnt[6];
-      FIXED z1     = (tz2 + tz3) *  TO_FIX(0.541196100);
-      FIXED tmp2   = z1 + tz3    * -TO_FIX(1.847759065);
-      FIXED tmp3   = z1 + tz2    *  TO_FIX(0.765366865);
-      
-      tz2          = source[0] * qnt[0] + dcoffset;
-      tz3          = source[4] * qnt[4];
-      
-      FIXED tmp0   = (tz2 + tz3) << FIX_BITS;
-      FIXED tmp1   = (tz2 - tz3) << FIX_BITS;
-      FIXED tmp10  = tmp0 + tmp3;
-      FIXED tmp13  = tmp0 - tmp3;
-      FIXED tmp11  = tmp1 + tmp2;
-      FIXED tmp12  = tmp1 - tmp2;
-      
-      // Odd part.
-      T ttmp0      = source[7] * qnt[7];
-      T ttmp1      = source[5] * qnt[5];
-      T ttmp2      = source[3] * qnt[3];
-      T ttmp3      = source[1] * qnt[1];
-      
-      T tz1        = ttmp0 + ttmp3;
-      tz2          = ttmp1 + ttmp2;
-      tz3          = ttmp0 + ttmp2;
-      T tz4        = ttmp1 + ttmp3;
-      FIXED z5     = (tz3 + tz4) * TO_FIX(1.175875602);
-      
-      tmp0         = ttmp0 * TO_FIX(0.298631336);
-      tmp1         = ttmp1 * TO_FIX(2.053119869);
-      tmp2         = ttmp2 * TO_FIX(3.072711026);
-      tmp3         = ttmp3 * TO_FIX(1.501321110);
-      z1           = tz1   *-TO_FIX(0.899976223);
-      FIXED z2     = tz2   *-TO_FIX(2.562915447);
-      FIXED z3     = tz3   *-TO_FIX(1.961570560) + z5;
-      FIXED z4     = tz4   *-TO_FIX(0.390180644) + z5;
-      
-      tmp0        += z1 + z3;
-      tmp1        += z2 + z4;
-      tmp2        += z2 + z3;
-      tmp3        += z1 + z4;
-      
-      dptr[0]      = FIXED_TO_INTERMEDIATE(tmp10 + tmp3);
-      dptr[7]      = FIXED_TO_INTERMEDIATE(tmp10 - tmp3);
-      dptr[1]      = FIXED_TO_INTERMEDIATE(tmp11 + tmp2);
-      dptr[6]      = FIXED_TO_INTERMEDIATE(tmp11 - tmp2);
-      dptr[2]      = FIXED_TO_INTERMEDIATE(tmp12 + tmp1);
-      dptr[5]      = FIXED_TO_INTERMEDIATE(tmp12 - tmp1);
-      dptr[3]      = FIXED_TO_INTERMEDIATE(tmp13 + tmp0);
-      dptr[4]      = FIXED_TO_INTERMEDIATE(tmp13 - tmp0);
+      InverseTransformRow(dptr,source,qnt,dcoffset);
       dcoffset     = 0;
     }
     
@@ -339,6 +350,43 @@ void IDCT<preshift,T,deadzone,optimize>::InverseTransformBlock(LONG *target,cons
 }
 ///
 
+/// IDCT::InverseTransformSparseBlock
+// Run the inverse DCT on an 8x8 block, taking a shortcut if only the first
+// row carries coefficients. As the first coefficient of the second row
+// is already the third in zig-zag order, this is in practice a block
+// holding only its DC coefficient, as after the DC scan of a progressive
+// image. The result is identical to that of InverseTransformBlock.
+template<int preshift,typename T,bool deadzone,bool optimize>
+void IDCT<preshift,T,deadzone,optimize>::InverseTransformSparseBlock(LONG *target,const LONG *source,
+                                                                     LONG dcoffset)
+{
+  LONG *dptr,*dend;
+  int i;
+
+  if (source == NULL) {
+    InverseTransformBlock(target,source,dcoffset);
+    return;
+  }
+
+  for(i = 8;i < 64;i++) {
+    if (source[i]) {
+      InverseTransformBlock(target,source,dcoffset);
+      return;
+    }
+  }
+  //
+  // Only the first row is populated, so the second pass is
+  // constant over each column.
+  InverseTransformRow(target,source,m_plQuant,dcoffset << (preshift + 3));
+  for(dptr = target,dend = target + 8;dptr < dend;dptr++) {
+    INTER_FIXED tmp0  = dptr[0 << 3] << FIX_BITS;
+    LONG v            = INTER_FIXED_TO_INT(tmp0);
+    dptr[0 << 3] = dptr[1 << 3] = dptr[2 << 3] = dptr[3 << 3] = v;
+    dptr[4 << 3] = dptr[5 << 3] = dptr[6 << 3] = dptr[7 << 3] = v;
+  }
+}
+///
+
 /// IDCT::EstimateCriticalSlope
 // Estimate a critical slope (lambda) from the unquantized data.
 // Or to be precise, estimate lambda/delta^2, the constant in front of
@@ -110,6 +110,9 @@ class IDCT : public DCT {
     }
   }
   //
+  // Run the first pass of the inverse DCT over one row of coefficients.
+  inline void InverseTransformRow(LONG *dptr,const LONG *source,const LONG *qnt,LONG dcoffset);
+  //
 public:
   IDCT(class Environ *env);
   //
@@ -125,6 +128,10 @@ public:
   // Run the inverse DCT on an 8x8 block reconstructing the data.
   virtual void InverseTransformBlock(LONG *target,const LONG *source,LONG dcoffset);
   //
+  // Run the inverse DCT on a block, with a shortcut for blocks that
+  // carry coefficients in their first row only, i.e. DC-only blocks.
+  virtual void InverseTransformSparseBlock(LONG *target,const LONG *source,LONG dcoffset);
+  //
   // Estimate a critical slope (lambda) from the unquantized data.
   // Or to be precise, estimate lambda/delta^2, the constant in front of
   // delta^2.
@@ -59,7 +59,7 @@
 
 /// BitMapHook::BitMapHook
 BitMapHook::BitMapHook(const struct JPG_TagItem *tags)
-  : m_pHook(NULL), m_pLDRHook(NULL), m_pAlphaHook(NULL)
+  : m_pHook(NULL), m_pLDRHook(NULL), m_pAlphaHook(NULL), m_bFullFrame(false)
 {
   // Fill in use useful defaults. This really depends on the user
   // As the following tags are all optional.
@@ -110,6 +110,9 @@ void BitMapHook::ParseTags(const struct JPG_TagItem *tag)
     case JPGTAG_BIO_USERDATA:
       m_DefaultImageLayout.ibm_pUserData       = tag->ti_Data.ti_pPtr;
       break;
+    case JPGTAG_BIO_FULLFRAME:
+      m_bFullFrame                             = (tag->ti_Data.ti_lData)?(true):(false);
+      break;
     case JPGTAG_BIH_HOOK:
       m_pHook                                  = (struct JPG_Hook *)tag->ti_Data.ti_pPtr;
       break;
@@ -255,6 +258,19 @@ void BitMapHook::Release(struct JPG_Hook *hook,struct JPG_TagItem *tags,UBYTE pi
 void BitMapHook::RequestClientData(const RectAngle<LONG> &rect,struct ImageBitMap *ibm,
                                    const class Component *comp)
 {
+  if (m_bFullFrame) {
+    // The client registered the complete image, hence no need to
+    // ask. Just offset the canvas to the requested component. The
+    // library adds the rectangle offset itself.
+    if (m_DefaultImageLayout.ibm_pData == NULL || m_DefaultImageLayout.ibm_ucPixelType == 0)
+      comp->EnvironOf()->Throw(JPGERR_MISSING_PARAMETER,"BitmapHook::RequestClientData",__LINE__,__FILE__,
+                               "full frame image layout requires the memory and the pixel type");
+    //
+    *ibm           = m_DefaultImageLayout;
+    ibm->ibm_pData = (UBYTE *)(m_DefaultImageLayout.ibm_pData) + 
+      comp->IndexOf() * (m_DefaultImageLayout.ibm_ucPixelType & CTYP_SIZE_MASK);
+    return;
+  }
   Request(m_pHook,m_BitmapTags,m_DefaultImageLayout.ibm_ucPixelType,rect,ibm,comp,false);
 }
 ///
@@ -266,6 +282,8 @@ void BitMapHook::RequestClientData(const RectAngle<LONG> &rect,struct ImageBitMa
 void BitMapHook::ReleaseClientData(const RectAngle<LONG> &rect,const struct ImageBitMap *ibm,
                                    const class Component *comp)
 {
+  if (m_bFullFrame)
+    return;
   Release(m_pHook,m_BitmapTags,m_DefaultImageLayout.ibm_ucPixelType,rect,ibm,comp,false);
 }
 ///
@@ -124,6 +124,10 @@ class BitMapHook : public JObject {
   // The following keep default data for lazy applications:
   struct ImageBitMap m_DefaultImageLayout;
   //
+  // Set if the default layout describes the full image with all
+  // components interleaved, in which case the hook is bypassed.
+  bool               m_bFullFrame;
+  //
   // Prepared tags for requesting usual bitmap tags.
   struct JPG_TagItem m_BitmapTags[25];
   //
@@ -61,13 +61,18 @@
 #include "codestream/decoder.hpp"
 #include "codestream/image.hpp"
 #include "codestream/tables.hpp"
+#include "codestream/markerindex.hpp"
 #include "marker/frame.hpp"
 #include "marker/scan.hpp"
 #include "marker/component.hpp"
 #include "boxes/mergingspecbox.hpp"
+#include "boxes/filetypebox.hpp"
+#include "boxes/alphabox.hpp"
 #include "boxes/checksumbox.hpp"
 #include "tools/checksum.hpp"
 #include "io/iostream.hpp"
+#include "io/bufferstream.hpp"
+#include "io/suspendablestream.hpp"
 #include "std/assert.hpp"
 ///
 
@@ -106,10 +111,16 @@ void JPEG::doConstruct(class Environ *env)
   //
   // State variables.
   m_pIOStream          = NULL;
+  m_pSuspendable       = NULL;
+  m_pInput             = NULL;
+  m_ulInputSize        = 0;
+  m_pIndex             = NULL;
   m_pImage             = NULL;
   m_pFrame             = NULL;
   m_pScan              = NULL;
   m_bRow               = false;
+  m_bTrailer           = false;
+  m_bSuspended         = false;
   m_bDecoding          = false;
   m_bEncoding          = false;
   m_bHeaderWritten     = false;
@@ -124,6 +135,27 @@ void JPEG::doConstruct(class Environ *env)
 // NEW to allocate objects, but MALLOC.
 void JPEG::doDestruct(void)
 {
+  InternalReset();
+
+  // Terminate the worker threads, if any.
+  m_pEnviron->DisposeWorkerPool();
+
+  // Release the tables kept for later images.
+  m_pEnviron->DisposeTableCache();
+
+  // Nothing is allocated anymore, release the slabs in one go.
+  m_pEnviron->DisposePool();
+
+  m_pEnviron = NULL; // Deleted elsewhere
+}
+///
+
+/// JPEG::InternalReset
+// Release the encoder, decoder and stream of the current image
+// and bring the object back into its initial state.
+void JPEG::InternalReset(void)
+{
+  // The image is owned by the encoder or decoder.
   delete m_pEncoder;
   m_pEncoder = NULL;
 
@@ -131,9 +163,26 @@ void JPEG::doDestruct(void)
   m_pDecoder = NULL;
 
   delete m_pIOStream;
-  m_pIOStream = NULL;
+  m_pIOStream    = NULL;
+  m_pSuspendable = NULL;
+  m_pInput       = NULL;
+  m_ulInputSize  = 0;
 
-  m_pEnviron = NULL; // Deleted elsewhere
+  delete m_pIndex;
+  m_pIndex       = NULL;
+
+  m_pImage             = NULL;
+  m_pFrame             = NULL;
+  m_pScan              = NULL;
+  m_bRow               = false;
+  m_bTrailer           = false;
+  m_bSuspended         = false;
+  m_bDecoding          = false;
+  m_bEncoding          = false;
+  m_bHeaderWritten     = false;
+  m_bOptimized         = false;
+  m_bOptimizeHuffman   = false;
+  m_bOptimizeQuantizer = false;
 }
 ///
 
@@ -151,6 +200,7 @@ class JPEG *JPEG::Construct(struct JPG_TagItem *tags)
     h_jpeg = (struct JPEG_Helper *)JPG_MALLOC(sizeof(struct JPEG_Helper));
     env    = &(h_jpeg->m_Env);
     *env   = ev; // Copy the temporary environment over.
+    env->BuildPool();
     h_jpeg->doConstruct(env);
 
   } JPG_CATCH {
@@ -199,6 +249,23 @@ void JPEG::Destruct(class JPEG *o)
 }
 ///
 
+/// JPEG::Reset
+// Release all data of the image currently read or written and make
+// the object available for the next image.
+JPG_LONG JPEG::Reset(struct JPG_TagItem *)
+{
+  volatile JPG_LONG ret = TRUE;
+
+  JPG_TRY {
+    InternalReset();
+  } JPG_CATCH {
+    ret = JPG_FALSE;
+  } JPG_ENDTRY;
+
+  return ret;
+}
+///
+
 /// JPEG::Read
 // This is a slim wrapper around the reader which handles
 // errors.
@@ -208,6 +275,8 @@ JPG_LONG JPEG::Read(struct JPG_TagItem *tags)
 
   JPG_TRY {
     ReadInternal(tags);
+    if (m_bSuspended)
+      ret = JPGFLAG_DECODER_WOULDBLOCK;
   } JPG_CATCH {
     ret = JPG_FALSE;
   } JPG_ENDTRY;
@@ -216,6 +285,39 @@ JPG_LONG JPEG::Read(struct JPG_TagItem *tags)
 }
 ///
 
+/// JPEG::StageInput
+// On a suspendable input, make sure that the data the decoder needs
+// next is available, either the marker segments up to the next scan,
+// or the next MCU of the current scan. Returns false and marks the
+// decoder as suspended if not.
+bool JPEG::StageInput(bool markers)
+{
+  if (m_pSuspendable) {
+    class ByteStream *in = m_pIOStream;
+    bool available;
+    //
+    if (m_pFrame) {
+      // Side channels are parsed from memory.
+      if (m_pImage->InputStreamOf(m_pIOStream) != m_pIOStream)
+        return true;
+      // A checksummed scan reads ahead of the stream.
+      in = m_pFrame->ScanInputOf(in);
+    }
+    //
+    if (markers) {
+      available = m_pSuspendable->StageMarkers(in->FilePosition());
+    } else {
+      available = m_pSuspendable->StageSegment(in->FilePosition(),m_pScan->MaxMCUSizeOf());
+    }
+    if (!available) {
+      m_bSuspended = true;
+      return false;
+    }
+  }
+  return true;
+}
+///
+
 /// JPEG::StopDecoding
 // Complete the decoding, test for the checksum,
 // then exit.
@@ -224,6 +326,8 @@ void JPEG::StopDecoding(void)
   if (m_pImage) {
     class ChecksumBox *box;
     class Checksum    *sum;
+    // Scans still decoded in the background must be complete.
+    m_pImage->JoinScanDecoders(NULL,true);
     // Make sure we don't get the residual, but the legacy image.
     m_pImage->ResetToFirstFrame();
     box = m_pImage->TablesOf()->ChecksumOf();
@@ -250,22 +354,41 @@ void JPEG::ReadInternal(struct JPG_TagItem *tags)
 
   if (m_pDecoder == NULL) {
     m_pDecoder       = new(m_pEnviron) class Decoder(m_pEnviron);
+    m_pDecoder->ParseTags(tags);
     m_bDecoding      = true; 
     m_pFrame         = NULL;
     m_pScan          = NULL;
     m_bRow           = false;
+    m_bTrailer       = false;
     m_bEncoding      = false;
   }
 
+  m_bSuspended = false;
+  
   if (!m_bDecoding)
     return;
 
   if (m_pIOStream == NULL) {
-    struct JPG_Hook *iohook = (struct JPG_Hook *)(tags->GetTagPtr(JPGTAG_HOOK_IOHOOK));
-    if (iohook == NULL)
-      JPG_THROW(OBJECT_DOESNT_EXIST,"JPEG::ReadInternal","no IOHook defined to read the data from");
-
-    m_pIOStream = new(m_pEnviron) class IOStream(m_pEnviron,tags);
+    const UBYTE *input = (const UBYTE *)(tags->GetTagPtr(JPGTAG_HOOK_INPUTBUFFER));
+    //
+    if (input) {
+      // Read directly from the memory of the caller.
+      m_pInput      = input;
+      m_ulInputSize = tags->GetTagData(JPGTAG_HOOK_INPUTSIZE);
+      m_pIOStream   = new(m_pEnviron) class BufferStream(m_pEnviron,input,m_ulInputSize);
+    } else {
+      struct JPG_Hook *iohook = (struct JPG_Hook *)(tags->GetTagPtr(JPGTAG_HOOK_IOHOOK));
+      if (iohook == NULL)
+        JPG_THROW(OBJECT_DOESNT_EXIST,"JPEG::ReadInternal","no IOHook defined to read the data from");
+      
+      if (tags->GetTagData(JPGTAG_DECODER_SUSPENDABLE)) {
+        // The hook may not always have data, stage it.
+        m_pSuspendable = new(m_pEnviron) class SuspendableStream(m_pEnviron,tags);
+        m_pIOStream    = m_pSuspendable;
+      } else {
+        m_pIOStream    = new(m_pEnviron) class IOStream(m_pEnviron,tags);
+      }
+    }
   }
 
   assert(m_pIOStream);
@@ -274,15 +397,26 @@ void JPEG::ReadInternal(struct JPG_TagItem *tags)
     // Several iterations may be necessary to parse
     // off the header, each taking one marker of the
     // header.
+    if (!StageInput(true))
+      return;
     m_pImage = m_pDecoder->ParseHeaderIncremental(m_pIOStream);
     if (stopflags & JPGFLAG_DECODER_STOP_IMAGE)
       return;
   }
 
   assert(m_pImage);
+  //
+  // Scans of hierarchical images may be decoded in the background
+  // unless the caller needs to see them or the input may block.
+  m_pImage->AllowConcurrentScans(m_pSuspendable == NULL &&
+                                 (stopflags & (JPGFLAG_DECODER_STOP_SCAN |
+                                               JPGFLAG_DECODER_STOP_ROW  |
+                                               JPGFLAG_DECODER_STOP_MCU)) == 0);
 
   while(m_bDecoding) {
     if (m_pFrame == NULL) {
+      if (!StageInput(true))
+        return;
       m_pFrame = m_pImage->StartParseFrame(m_pIOStream);
       if (m_pFrame) {
         m_pDecoder->ParseTags(tags);
@@ -292,7 +426,25 @@ void JPEG::ReadInternal(struct JPG_TagItem *tags)
     }
 
     if (m_pFrame) {
+      if (m_bTrailer) {
+        if (!StageInput(true))
+          return;
+        m_bTrailer = false;
+        if (!m_pFrame->ParseTrailer(m_pImage->InputStreamOf(m_pIOStream))) {
+          // Frame done, advance to the next frame.
+          m_pFrame = NULL;
+          if (!m_pImage->ParseTrailer(m_pIOStream)) {
+            // Image done, stop decoding, image is now loaded.
+            StopDecoding();
+            return;
+          }
+          continue;
+        }
+      }
+      
       while (m_pScan == NULL) {
+        if (!StageInput(true))
+          return;
         m_pScan = m_pFrame->StartParseScan(m_pImage->InputStreamOf(m_pIOStream),m_pImage->ChecksumOf());
         //
         if (m_pScan == NULL) {
@@ -307,6 +459,8 @@ void JPEG::ReadInternal(struct JPG_TagItem *tags)
                 StopDecoding();
                 return;
               }
+              // Continue with the next frame.
+              break;
             }
           } else {
             if (stopflags & JPGFLAG_DECODER_STOP_FRAME)
@@ -321,31 +475,33 @@ void JPEG::ReadInternal(struct JPG_TagItem *tags)
 
       if (m_pScan) {
         if (m_bRow == false) {
+          if (!StageInput(false))
+            return;
           m_bRow = m_pScan->StartMCURow();
           if (m_bRow) {
             if (stopflags & JPGFLAG_DECODER_STOP_ROW)
               return;
           } else {
-            // Scan done, advance to the next scan.
+            // Scan done, advance to the next scan once the
+            // frame trailer has been parsed.
             m_pFrame->EndParseScan();
-            m_pScan = NULL;
-            if (!m_pFrame->ParseTrailer(m_pImage->InputStreamOf(m_pIOStream))) {
-              // Frame done, advance to the next frame.
-              m_pFrame = NULL;
-              if (!m_pImage->ParseTrailer(m_pIOStream)) {
-                // Image done, stop decoding, image is now loaded.
-                StopDecoding();
-                return;
-              }
-            }
+            m_pScan    = NULL;
+            m_bTrailer = true;
           }
         }
         
         if (m_bRow) {
-          while (m_pScan->ParseMCU()) {
-            if (stopflags & JPGFLAG_DECODER_STOP_MCU)
+          if (m_pSuspendable == NULL && (stopflags & JPGFLAG_DECODER_STOP_MCU) == 0) {
+            // Nothing to stop for within the row, decode it in one go.
+            m_pScan->ParseMCURow();
+          } else {
+            while (StageInput(false) && m_pScan->ParseMCU()) {
+              if (stopflags & JPGFLAG_DECODER_STOP_MCU)
+                return;
+            } 
+            if (m_bSuspended)
               return;
-          } 
+          }
           m_bRow = false;
         }
       }
@@ -436,15 +592,20 @@ void JPEG::WriteInternal(struct JPG_TagItem *tags)
     if (m_bOptimizeHuffman) {
       do {
         class Frame *frame = m_pImage->StartMeasureFrame();
-        do {
-          class Scan *scan = frame->StartMeasureScan();
-          while(scan->StartMCURow()) { 
-            while(scan->WriteMCU()) {
-              ;
+        //
+        // All scans see the same coefficients, hence may measure
+        // concurrently if worker threads are available.
+        if (!frame->MeasureConcurrentScans()) {
+          do {
+            class Scan *scan = frame->StartMeasureScan();
+            while(scan->StartMCURow()) { 
+              while(scan->WriteMCU()) {
+                ;
+              }
             }
-          }
-          scan->Flush();
-        } while(frame->NextScan());
+            scan->Flush();
+          } while(frame->NextScan());
+        }
       } while(m_pImage->NextFrame());
     }
     m_bOptimized = true;
@@ -460,6 +621,21 @@ void JPEG::WriteInternal(struct JPG_TagItem *tags)
     assert(m_pFrame);
 
     if (m_pScan == NULL) {
+      //
+      // Unless the caller wants to stop in between, all scans of the frame
+      // may be coded at once on worker threads.
+      if ((stopflags & (JPGFLAG_ENCODER_STOP_SCAN | JPGFLAG_ENCODER_STOP_ROW | JPGFLAG_ENCODER_STOP_MCU)) == 0 &&
+          m_pFrame->WriteConcurrentScans(m_pImage->OutputStreamOf(m_pIOStream),m_pIOStream,
+                                         m_pImage->ChecksumOf())) {
+        m_pFrame = NULL;
+        if (!m_pImage->NextFrame()) {
+          m_pImage->WriteTrailer(m_pIOStream);
+          m_pIOStream->Flush();
+          m_bEncoding = false;
+          return;
+        }
+        continue;
+      }
       m_pScan = m_pFrame->StartWriteScan(m_pImage->OutputStreamOf(m_pIOStream),m_pImage->ChecksumOf());
       if (stopflags & JPGFLAG_ENCODER_STOP_SCAN)
         return;
@@ -786,10 +962,13 @@ void JPEG::InternalProvideImage(struct JPG_TagItem *tags)
     delete m_pImage;m_pImage = NULL;
 
     delete m_pIOStream;m_pIOStream = NULL;
+    m_pSuspendable       = NULL;
 
     m_pFrame             = NULL;
     m_pScan              = NULL;
     m_bRow               = false;
+    m_bTrailer           = false;
+    m_bSuspended         = false;
     m_bDecoding          = false;
     m_bEncoding          = false;
     m_bHeaderWritten     = false;
@@ -833,6 +1012,226 @@ JPG_LONG JPEG::GetInformation(struct JPG_TagItem *tags)
 }
 ///
 
+/// JPEG::Probe
+// Read the header of a codestream up to the frame header and return
+// its basic properties, without decoding it.
+JPG_LONG JPEG::Probe(struct JPG_TagItem *tags)
+{
+  volatile JPG_LONG ret = JPG_TRUE;
+  class ByteStream *volatile io = NULL;
+
+  JPG_TRY {
+    const UBYTE *input = (const UBYTE *)(tags->GetTagPtr(JPGTAG_HOOK_INPUTBUFFER));
+    //
+    if (input) {
+      io = new(m_pEnviron) class BufferStream(m_pEnviron,input,tags->GetTagData(JPGTAG_HOOK_INPUTSIZE));
+    } else {
+      if (tags->GetTagPtr(JPGTAG_HOOK_IOHOOK) == NULL)
+        JPG_THROW(OBJECT_DOESNT_EXIST,"JPEG::Probe","no IOHook defined to read the data from");
+      io = new(m_pEnviron) class IOStream(m_pEnviron,tags);
+    }
+    InternalProbe(io,tags);
+  } JPG_CATCH {
+    ret = JPG_FALSE;
+  } JPG_ENDTRY;
+
+  delete io;
+
+  return ret;
+}
+///
+
+/// JPEG::InternalProbe
+// Parse the header from the given stream up to the frame header and
+// fill in the probe results. Only the marker segments and boxes that
+// carry the requested properties are looked into, everything else is
+// skipped.
+void JPEG::InternalProbe(class ByteStream *io,struct JPG_TagItem *tags)
+{
+  struct JPG_TagItem *alphatag = tags->FindTagItem(JPGTAG_ALPHA_MODE);
+  bool  pyramidal = false;
+  bool  alpha     = false;
+  LONG  mode      = -1;
+  ULONG profile   = 0;
+  ULONG matte[3]  = {0,0,0};
+  LONG  marker,type = -1;
+
+  if (io->GetWord() != 0xffd8)
+    JPG_THROW(MALFORMED_STREAM,"JPEG::InternalProbe","stream does not contain a JPEG file, SOI marker missing");
+
+  for(;;) {
+    LONG len,byte = io->Get();
+    //
+    if (byte != 0xff) {
+      if (byte == ByteStream::EOF)
+        JPG_THROW(UNEXPECTED_EOF,"JPEG::InternalProbe","stream ended before the frame header");
+      JPG_THROW(MALFORMED_STREAM,"JPEG::InternalProbe","expected a marker in front of the frame header");
+    }
+    // Skip fill bytes.
+    do {
+      byte = io->Get();
+    } while(byte == 0xff);
+    if (byte == ByteStream::EOF)
+      JPG_THROW(UNEXPECTED_EOF,"JPEG::InternalProbe","stream ended before the frame header");
+    marker = 0xff00 | byte;
+    //
+    // Markers without a segment.
+    if ((marker >= 0xffd0 && marker <= 0xffd7) || marker == 0xff01)
+      continue;
+    if (marker == 0xffd9 || marker == 0xffda || marker == 0xffd8)
+      JPG_THROW(MALFORMED_STREAM,"JPEG::InternalProbe","found no frame header in front of the image data");
+    //
+    len = io->GetWord();
+    if (len == ByteStream::EOF)
+      JPG_THROW(UNEXPECTED_EOF,"JPEG::InternalProbe","stream ended before the frame header");
+    if (len < 2)
+      JPG_THROW(MALFORMED_STREAM,"JPEG::InternalProbe","marker segment size is invalid");
+    len -= 2;
+    //
+    switch(marker) {
+    case 0xffc0: // baseline
+      type = JPGFLAG_BASELINE;
+      break;
+    case 0xffc1: // sequential
+    case 0xffc5: // differential sequential
+      type = JPGFLAG_SEQUENTIAL;
+      break;
+    case 0xffc2: // progressive
+    case 0xffc6: // differential progressive
+      type = JPGFLAG_PROGRESSIVE;
+      break;
+    case 0xffc3: // lossless
+    case 0xffc7: // differential lossless
+      type = JPGFLAG_LOSSLESS;
+      break;
+    case 0xffc9: // sequential, arithmetic
+    case 0xffcd: // differential sequential, arithmetic
+      type = JPGFLAG_SEQUENTIAL | JPGFLAG_ARITHMETIC;
+      break;
+    case 0xffca: // progressive, arithmetic
+    case 0xffce: // differential progressive, arithmetic
+      type = JPGFLAG_PROGRESSIVE | JPGFLAG_ARITHMETIC;
+      break;
+    case 0xffcb: // lossless, arithmetic
+    case 0xffcf: // differential lossless, arithmetic
+      type = JPGFLAG_LOSSLESS | JPGFLAG_ARITHMETIC;
+      break;
+    case 0xfff7: // JPEG LS
+      type = JPGFLAG_JPEG_LS;
+      break;
+    case 0xffde: // DHP, the dimensions of the full image follow
+      pyramidal = true;
+      type      = -1;
+      break;
+    case 0xffeb: // APP11, may carry JPEG XT boxes
+      if (len >= 2 + 2 + 4 + 4 + 4) {
+        LONG id = io->GetWord();
+        len    -= 2;
+        if (id == (('J' << 8) | 'P')) {
+          ULONG seq,lbox,tbox;
+          io->GetWord(); // box instance
+          seq   = ULONG(io->GetWord()) << 16;
+          seq  |= io->GetWord();
+          lbox  = ULONG(io->GetWord()) << 16;
+          lbox |= io->GetWord();
+          tbox  = ULONG(io->GetWord()) << 16;
+          tbox |= io->GetWord();
+          len  -= 2 + 4 + 4 + 4;
+          //
+          // Only the first segment of a box holds its start, and only
+          // short boxes are of interest here.
+          if (seq == 1 && lbox > 8 && lbox - 8 <= ULONG(len)) {
+            len -= lbox - 8;
+            if (tbox == FileTypeBox::Type && lbox >= 8 + 8) {
+              ULONG cnt = (lbox - 8 - 8) >> 2;
+              io->SkipBytes(8); // brand and minor version
+              while(cnt--) {
+                ULONG compat = ULONG(io->GetWord()) << 16;
+                compat |= io->GetWord();
+                if (profile == 0 && (compat == JPGFLAG_PROFILE_IDR || compat == JPGFLAG_PROFILE_HDR_ADDITIVE ||
+                                     compat == JPGFLAG_PROFILE_HDR_REFINEMENT || compat == JPGFLAG_PROFILE_LOSSLESS))
+                  profile = compat;
+              }
+              io->SkipBytes((lbox - 8 - 8) & 3);
+            } else if (tbox == MergingSpecBox::AlphaType) {
+              ULONG left = lbox - 8;
+              //
+              // The alpha channel is present. Its composition is in a sub-box.
+              alpha = true;
+              while(left >= 8) {
+                ULONG sublen  = ULONG(io->GetWord()) << 16;
+                sublen       |= io->GetWord();
+                ULONG subtype = ULONG(io->GetWord()) << 16;
+                subtype      |= io->GetWord();
+                left         -= 8;
+                if (sublen < 8 || sublen - 8 > left)
+                  break;
+                if (subtype == AlphaBox::Type && sublen == 8 + 2 + 4 * 2) {
+                  mode     = io->Get() >> 4;
+                  io->Get();
+                  matte[0] = io->GetWord();
+                  matte[1] = io->GetWord();
+                  matte[2] = io->GetWord();
+                  io->GetWord();
+                } else {
+                  io->SkipBytes(sublen - 8);
+                }
+                left -= sublen - 8;
+              }
+              io->SkipBytes(left);
+            } else {
+              io->SkipBytes(lbox - 8);
+            }
+          }
+        }
+      }
+      io->SkipBytes(len);
+      continue;
+    default:
+      io->SkipBytes(len);
+      continue;
+    }
+    //
+    // A frame header or DHP. Both start with precision and dimensions.
+    {
+      LONG precision = io->Get();
+      LONG height    = io->GetWord();
+      LONG width     = io->GetWord();
+      LONG depth     = io->Get();
+      //
+      if (depth == ByteStream::EOF)
+        JPG_THROW(UNEXPECTED_EOF,"JPEG::InternalProbe","stream ended within the frame header");
+      if (len < 6)
+        JPG_THROW(MALFORMED_STREAM,"JPEG::InternalProbe","frame header is too short");
+      //
+      // The DHP comes first and has the dimensions of the full image.
+      if (type < 0 || !pyramidal) {
+        tags->SetTagData(JPGTAG_IMAGE_WIDTH    ,width);
+        tags->SetTagData(JPGTAG_IMAGE_HEIGHT   ,height);
+        tags->SetTagData(JPGTAG_IMAGE_DEPTH    ,depth);
+        tags->SetTagData(JPGTAG_IMAGE_PRECISION,precision);
+      }
+      if (type >= 0)
+        break;
+      io->SkipBytes(len - 6);
+    }
+  }
+  //
+  tags->SetTagData(JPGTAG_IMAGE_FRAMETYPE,type | ((pyramidal)?(JPGFLAG_PYRAMIDAL):(0)));
+  tags->SetTagData(JPGTAG_PROFILE,profile);
+  //
+  if (alpha && mode >= 0) {
+    if (alphatag)
+      alphatag->ti_Data.ti_lData = mode;
+    tags->SetTagData(JPGTAG_ALPHA_MATTE(0),matte[0]);
+    tags->SetTagData(JPGTAG_ALPHA_MATTE(1),matte[1]);
+    tags->SetTagData(JPGTAG_ALPHA_MATTE(2),matte[2]);
+  } else if (alphatag) {
+    alphatag->ti_Tag = JPGTAG_TAG_IGNORE;
+  }
+}
+///
+
 /// JPEG::GetOutputInformation
 // Return layout information about floating point and conversion from the specs
 // and insert it into the given tag list.
@@ -870,6 +1269,13 @@ void JPEG::InternalGetInformation(struct JPG_TagItem *tags)
   struct JPG_TagItem *alphatag  = tags->FindTagItem(JPGTAG_ALPHA_MODE);
   struct JPG_TagItem *alphalist = tags->FindTagItem(JPGTAG_ALPHA_TAGLIST);
 
+  if (tags->FindTagItem(JPGTAG_INDEX_LENGTH)) {
+    GetIndexInformation(tags);
+    // The index does not require the image.
+    if (m_pImage == NULL)
+      return;
+  }
+
   if (m_pImage == NULL)
     JPG_THROW(OBJECT_DOESNT_EXIST,"JPEG::InternalGetInformation","no image loaded to request information from");
 
@@ -954,6 +1360,60 @@ void JPEG::InternalGetInformation(struct JPG_TagItem *tags)
 }
 ///
 
+/// JPEG::GetIndexInformation
+// Fill in the marker index tags, building the index if required.
+void JPEG::GetIndexInformation(struct JPG_TagItem *tags)
+{
+  struct JPG_TagItem *lentag = tags->FindTagItem(JPGTAG_INDEX_LENGTH);
+  JPG_ULONG *markers         = (JPG_ULONG *)tags->GetTagPtr(JPGTAG_INDEX_MARKERS);
+  JPG_ULONG *offsets         = (JPG_ULONG *)tags->GetTagPtr(JPGTAG_INDEX_OFFSETS);
+  JPG_ULONG *sizes           = (JPG_ULONG *)tags->GetTagPtr(JPGTAG_INDEX_SIZES);
+  JPG_ULONG *boxtypes        = (JPG_ULONG *)tags->GetTagPtr(JPGTAG_INDEX_BOXTYPES);
+  const UBYTE *input         = (const UBYTE *)tags->GetTagPtr(JPGTAG_HOOK_INPUTBUFFER);
+  ULONG size                 = tags->GetTagData(JPGTAG_HOOK_INPUTSIZE);
+  LONG room;
+  ULONG i,count;
+
+  assert(lentag);
+  room = lentag->ti_Data.ti_lData;
+
+  if (m_pIndex == NULL)
+    m_pIndex = new(m_pEnviron) class MarkerIndex(m_pEnviron);
+
+  if (input) {
+    // The caller may reuse the buffer for the next file, index it again.
+    m_pIndex->Build(input,size);
+  } else if (m_pInput) {
+    // The image read from memory, which stays the same until Reset().
+    if (m_pIndex->BufferOf() != m_pInput)
+      m_pIndex->Build((const UBYTE *)m_pInput,m_ulInputSize);
+  } else {
+    JPG_THROW(OBJECT_DOESNT_EXIST,"JPEG::GetIndexInformation",
+              "the marker index requires the codestream in memory, provide JPGTAG_HOOK_INPUTBUFFER");
+  }
+
+  count = m_pIndex->CountOf();
+  if (room < 0)
+    room = 0;
+  if (count > ULONG(room))
+    count = room;
+
+  for(i = 0;i < count;i++) {
+    const struct MarkerIndex::Entry *e = m_pIndex->EntryOf(i);
+    if (markers)
+      markers[i]  = e->me_usMarker;
+    if (offsets)
+      offsets[i]  = e->me_ulOffset;
+    if (sizes)
+      sizes[i]    = e->me_ulLength;
+    if (boxtypes)
+      boxtypes[i] = e->me_ulBoxType;
+  }
+
+  lentag->ti_Data.ti_lData = m_pIndex->CountOf();
+}
+///
+
 /// JPEG::LastError
 // Return the last exception - the error code, if present - in
 // the primary result code, a pointer to the error string in the
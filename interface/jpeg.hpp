@@ -62,9 +62,13 @@ class Environment;
 class Encoder;
 class Decoder;
 class IOStream;
+class RandomAccessStream;
+class SuspendableStream;
 class Image;
 class Frame;
 class Scan;
+class MarkerIndex;
+class ByteStream;
 ///
 
 /// Defines
@@ -97,8 +101,20 @@ class JPG_EXPORT JPEG {
   // The decoder
   class Decoder  *m_pDecoder; 
   //
-  // Currently active IOHook to read and write data to the filing system.
-  class IOStream *m_pIOStream;
+  // Currently active IOHook to read and write data to the filing system,
+  // or the memory buffer the data is decoded from.
+  class RandomAccessStream *m_pIOStream;
+  //
+  // The above if it is a suspendable stream reading from a
+  // non-blocking hook, otherwise NULL.
+  class SuspendableStream *m_pSuspendable;
+  //
+  // The caller's memory the image is read from, if any.
+  const void   *m_pInput;
+  JPG_ULONG     m_ulInputSize;
+  //
+  // The marker index of the codestream in memory, built on request.
+  class MarkerIndex *m_pIndex;
   //
   // Currently loaded image, if any.
   class Image  *m_pImage;
@@ -112,6 +128,13 @@ class JPG_EXPORT JPEG {
   // Currently in parsing an MCU row?
   bool          m_bRow;
   //
+  // Set if the frame trailer behind the last scan is still to be parsed.
+  bool          m_bTrailer;
+  //
+  // Set if the last call to Read() was suspended because the input
+  // hook would block.
+  bool          m_bSuspended;
+  //
   // Currently decoding active?
   bool          m_bDecoding;
   //
@@ -138,6 +161,10 @@ class JPG_EXPORT JPEG {
   // NEW to allocate objects, but MALLOC.
   void doDestruct(void);
   //
+  // Release the encoder, decoder and stream of the current image
+  // and bring the object back into its initial state.
+  void InternalReset(void);
+  //
   // Read a file. Exceptions are thrown here and captured outside.
   void ReadInternal(struct JPG_TagItem *tags);
   //
@@ -155,9 +182,22 @@ class JPG_EXPORT JPEG {
   // Request information from the JPEG object - the internal version that creates exceptions.
   void InternalGetInformation(struct JPG_TagItem *tags);
   //
+  // Fill in the marker index tags, building the index if required.
+  void GetIndexInformation(struct JPG_TagItem *tags);
+  //
+  // Parse the header from the given stream up to the frame header and
+  // fill in the probe results.
+  void InternalProbe(class ByteStream *io,struct JPG_TagItem *tags);
+  //
   // Stop decoding, then return. Also tests the checksum if there is one.
   void StopDecoding(void);
   //
+  // On a suspendable input, make sure that the data the decoder needs
+  // next is available, either the marker segments up to the next scan,
+  // or the next MCU of the current scan. Returns false and marks the
+  // decoder as suspended if not.
+  bool StageInput(bool markers);
+  //
   // Check whether any of the scans is optimized Huffman and thus requires a two-pass
   // go over the data.
   bool RequiresTwoPassEncoding(const struct JPG_TagItem *tags) const;
@@ -187,7 +227,18 @@ public:
   // Destroy a previously created instance.
   static void Destruct(class JPEG *);
   //
+  // Release all data of the image currently read or written and make
+  // the object available for the next image, as if it had been freshly
+  // constructed. Worker threads, pooled memory and tables that can be
+  // shared between images are kept, which makes coding a sequence of
+  // images with a single object cheaper than constructing one object
+  // per image. The tags argument is currently unused and should be
+  // set to NULL.
+  JPG_LONG Reset(struct JPG_TagItem *);
+  //
   // Read a file. This takes all of the tags, class Decode takes.
+  // Returns JPGFLAG_DECODER_WOULDBLOCK if the input is suspendable
+  // and more data is required to continue.
   JPG_LONG Read(struct JPG_TagItem *);
   //
   // Write a file. This takes all of the tags, class Encode takes.
@@ -202,6 +253,17 @@ public:
   // Request information from the JPEG object.
   JPG_LONG GetInformation(struct JPG_TagItem *);
   //
+  // Read the header of a codestream up to the frame header and return
+  // its basic properties, without decoding it or building any of the
+  // decoder structures. The input is given as for Read(), and the
+  // results are returned as for GetInformation(), plus the frame type
+  // and the JPEG XT profile. The precision is that of the frame header,
+  // not that of a JPEG XT extension. This does not interfere with an
+  // image currently read or written. If the height is defined by a DNL
+  // marker behind the first scan, the reported height is zero and only
+  // known once the image has been read.
+  JPG_LONG Probe(struct JPG_TagItem *);
+  //
   // In case reading was interrupted by a JPGTAG_DECODER_STOP mask
   // at some point in the codestream, this call returns the next
   // 16 bits at the current stop position without removing them
@@ -73,7 +73,8 @@
 // Width of the image in pixels
 #define JPGTAG_IMAGE_WIDTH    (JPGTAG_IMAGE_BASE + 0x01)
 //
-// Height of the image in pixels.
+// Height of the image in pixels. JPEG::Probe() reports zero if the
+// height is defined by a DNL marker.
 #define JPGTAG_IMAGE_HEIGHT   (JPGTAG_IMAGE_BASE + 0x02)
 //
 // Depth of the image in components. Valid are values between 1 and 256,
@@ -281,7 +282,9 @@
 // Profile information. 
 #define JPGTAG_PROFILE_BASE  (JPGTAG_IMAGE_BASE + 0x50)
 // 
-// This defines the profile the codestream complies to.
+// This defines the profile the codestream complies to. JPEG::Probe()
+// returns here the profile listed in the file type box, or zero for
+// a codestream that is not JPEG XT.
 #define JPGTAG_PROFILE       (JPGTAG_PROFILE_BASE + 0x01)
 // 
 // Various predefined profiles.
@@ -797,6 +800,19 @@
 // the last one.
 #define JPGTAG_BIO_RANGE (JPGTAG_BIO_BASE + 36) 
 
+// This tag is not passed to the hook, but to JPEG::ProvideImage() or
+// JPEG::DisplayRectangle() along with the BIO_MEMORY, BIO_WIDTH,
+// BIO_HEIGHT, BIO_BYTESPERROW, BIO_BYTESPERPIXEL and BIO_PIXELTYPE tags.
+// If set to TRUE, these tags describe a buffer that holds the full
+// image with all its components interleaved pixel by pixel, i.e.
+// component c of a pixel is found c samples behind the first component.
+// The library then reads from or writes to this buffer directly and
+// does not call the BIH_HOOK for the image data at all, saving the
+// request and release round trips per component and stripe. The
+// BIH_LDRHOOK and BIH_ALPHAHOOK are unaffected, and the buffer must
+// remain valid until the call returns.
+#define JPGTAG_BIO_FULLFRAME (JPGTAG_BIO_BASE + 37)
+
 // The next item is purely for your own use. Since you have to ensure
 // that the requested rectangle stays available as long as the j2lib
 // scans the image, this item can be used to hold a "lock" on the
@@ -868,7 +884,7 @@
 // Define the hook function to be called. This tag item
 // takes a pointer to a hook structure as tag data.
 // See hooks.hpp for details.
-// This here is *mandatory*
+// This here is *mandatory* unless BIO_FULLFRAME is given.
 #define JPGTAG_BIH_HOOK      (JPGTAG_BIH_BASE + 0x01)
 
 // On encoding, you may not only feed the HDR image to compress, but may
@@ -932,6 +948,12 @@
 // This passes the offset, i.e. how many bytes should be skipped
 // or seek'd.
 #define JPGTAG_FIO_OFFSET   (JPGTAG_FIO_BASE + 6)
+
+// If the decoder runs with JPGTAG_DECODER_SUSPENDABLE set, a read
+// request that cannot deliver data right now may return the
+// following instead of blocking. The request will be repeated on a
+// later call of JPEG::Read(). Returning zero still indicates the EOF.
+#define JPGFLAG_FIO_WOULDBLOCK (-2)
 ///
 /// Parameters for passing the various hooks to the library
 #define JPGTAG_HOOK_BASE       (JPGTAG_TAG_USER + 0xb00)
@@ -969,6 +991,17 @@
 // of the above.
 #define JPGTAG_HOOK_BUFFER    (JPGTAG_HOOK_BASE + 0x04)
 
+// Instead of reading the data to be decoded through the IOHook,
+// the library may also read it directly from a contiguous block
+// of memory, e.g. a memory mapped file or data already received.
+// No data is then copied. This tag takes a pointer to the first
+// byte of the data, the following its size in bytes. The memory
+// must remain valid and unchanged until the JPEG object is reset
+// or destroyed. If present, the IOHook tags are not used for
+// decoding. Not available for encoding.
+#define JPGTAG_HOOK_INPUTBUFFER (JPGTAG_HOOK_BASE + 0x05)
+#define JPGTAG_HOOK_INPUTSIZE   (JPGTAG_HOOK_BASE + 0x06)
+
 // Only for GetInformation(): This tag returns the number of
 // bytes that are still waiting in the input buffer of the
 // library and that haven't been read off so far. This 
@@ -1016,6 +1049,14 @@
 // overhead for some allocations.
 #define JPGTAG_MIO_KEEPSIZE     (JPGTAG_MEMORY_BASE + 0x30)
 //
+// If this tag is set to TRUE on JPEG::Construct, small memory
+// blocks are served from larger slabs owned by the JPEG object
+// rather than requested one by one through the allocation hook.
+// Released blocks are kept for re-use by the next image handled
+// by the same object, and all slabs are released at once when the
+// object is destroyed. The default is FALSE.
+#define JPGTAG_MIO_POOLED       (JPGTAG_MEMORY_BASE + 0x40)
+//
 ///
 
 /// Parameters for the decoder
@@ -1048,6 +1089,75 @@
 // this allows to disable upsampling.
 #define JPGTAG_DECODER_UPSAMPLE        (JPGTAG_DECODER_BASE + 0x08)
 
+//
+// Set this to TRUE to decode the legacy codestream only and to ignore
+// all JPEG XT extensions, i.e. residual, refinement and alpha data and
+// the boxes describing how they are merged into the image. Their APP11
+// markers are skipped without buffering their contents, and the image
+// is reconstructed as a legacy decoder would. This tag must be present
+// on the first call of JPEG::Read(). The default is FALSE.
+#define JPGTAG_DECODER_LEGACY_ONLY     (JPGTAG_DECODER_BASE + 0x09)
+
+//
+// Planar output. If this tag is present, JPEG::DisplayRectangle()
+// does not call the bitmap hook, but writes the requested components
+// as 8 bit samples at their native, i.e. not upsampled resolution into
+// the planes given here, without running any color transformation.
+// This is a pointer to an array of UBYTE pointers, one per component.
+// Sample (x,y) of component i, in coordinates of the subsampled
+// component, goes to planes[i] + y * bytesperrow[i] + x. Regions have
+// to be requested top-down in units of MCU rows, or the full image at
+// once. The alpha channel is not included. This is only available for
+// 8 bit DCT based images without a residual codestream.
+#define JPGTAG_DECODER_PLANES          (JPGTAG_DECODER_BASE + 0x0a)
+//
+// The number of bytes per row of the above planes, a pointer to an
+// array of JPG_LONG, one per component. Required if the above is set.
+#define JPGTAG_DECODER_PLANE_BYTESPERROW (JPGTAG_DECODER_BASE + 0x0b)
+
+//
+// Set this to TRUE on the first call of JPEG::Read() to decode from
+// an IOHook that may return JPGFLAG_FIO_WOULDBLOCK, e.g. one reading
+// from a non-blocking socket. If the decoder cannot continue without
+// more data, JPEG::Read() then returns JPGFLAG_DECODER_WOULDBLOCK with
+// its state intact, and continues from the same point when called
+// again. Input is staged internally, and the decoder only starts an
+// MCU once an upper bound of its size or the end of its entropy coded
+// segment has been received. Lossless and JPEG-LS scans only proceed
+// once their entropy coded segment is complete. Not available with
+// JPGTAG_HOOK_INPUTBUFFER. The default is FALSE.
+#define JPGTAG_DECODER_SUSPENDABLE     (JPGTAG_DECODER_BASE + 0x0c)
+//
+// The return code of JPEG::Read() if the hook would block.
+#define JPGFLAG_DECODER_WOULDBLOCK     (-1)
+
+//
+// Incremental display, e.g. for previewing a progressive image after
+// each scan. If set to TRUE, JPEG::DisplayRectangle() only reconstructs
+// and requests from the bitmap hook the lines of the rectangle that
+// changed since the last incremental display, which is nothing if no
+// data arrived in between. An MCU row the decoder started but did not
+// complete, e.g. due to JPGFLAG_DECODER_STOP_ROW, is reconstructed
+// again by the next incremental display. The output of the inverse DCT
+// is kept per component, and only recomputed for the block rows the
+// scans touched since. The first incremental display covers everything decoded so
+// far. Only available for DCT based images without residual or alpha
+// channel, and ignored for lossless, JPEG-LS and hierarchical images.
+// The default is FALSE.
+#define JPGTAG_DECODER_INCREMENTAL     (JPGTAG_DECODER_BASE + 0x0d)
+
+//
+// Number of resolution levels of a hierarchical image to decode,
+// counting from the smallest frame upwards. If non-zero, decoding stops
+// as soon as the frame of this level is complete, the remaining
+// differential frames are not parsed, and the image is delivered in
+// the dimensions of this level, i.e. JPGTAG_IMAGE_WIDTH and
+// JPGTAG_IMAGE_HEIGHT report the reduced size once decoding is done.
+// The alpha channel is not decoded if decoding stops early. Must be
+// given on the first call of JPEG::Read(), and is ignored for
+// non-hierarchical images. The default is zero, decode all levels.
+#define JPGTAG_DECODER_RESOLUTIONLEVELS (JPGTAG_DECODER_BASE + 0x0e)
+
 //
 // Parsing flags - these define when the decoder (or encoder) stop, i.e.
 // after which syntax elements the call returns. If it does, the code needs
@@ -1096,6 +1206,17 @@
 // Define this to automatically loop in provide image when the image is not
 // yet complete
 #define JPGTAG_ENCODER_LOOP_ON_INCOMPLETE (JPGTAG_ENCODER_BASE + 0x02)
+//
+// Planar input. If present, JPEG::ProvideImage() does not call the
+// bitmap hook, but takes 8 bit samples of all components at their
+// native, i.e. already subsampled resolution from these planes, and
+// feeds them into the DCT without color transformation or downsampling.
+// The layout is as for planar output on decoding. Rows are consumed
+// top-down, a component row of blocks is encoded as soon as the
+// requested rectangle covers it completely. This is only available for
+// 8 bit DCT based images without residual coding or alpha channel.
+#define JPGTAG_ENCODER_PLANES JPGTAG_DECODER_PLANES
+#define JPGTAG_ENCODER_PLANE_BYTESPERROW JPGTAG_DECODER_PLANE_BYTESPERROW
 ///
 
 /// Exception related hooks
@@ -1140,6 +1261,45 @@
 // multiple warnings of the same origin.
 #define JPGTAG_EXC_SUPPRESS_IDENTICAL (JPGTAG_EXCEPTION_BASE + 0x30)
 ///
+
+/// Multithreading related tags
+// The following tags are passed into the constructor of the
+// library and configure its use of worker threads.
+#define JPGTAG_THREAD_BASE     (JPGTAG_TAG_USER + 0x2200)
+// The number of worker threads the library may use for entropy
+// coding. The default is zero, i.e. all work is performed in the
+// calling thread. This tag has no effect if the library was not
+// configured for multithreading.
+#define JPGTAG_THREAD_COUNT    (JPGTAG_THREAD_BASE + 0x01)
+///
+
+/// Marker index tags
+// The following tags are filled in by JPEG::GetInformation() and
+// return a table of all markers in the codestream, found without
+// decoding it. This requires the codestream in memory: either pass
+// JPGTAG_HOOK_INPUTBUFFER and JPGTAG_HOOK_INPUTSIZE along with these
+// tags, which works even before or without calling Read(), or read
+// the image from a memory buffer. The arrays are provided by the
+// caller. The index is for the application only, the decoder still
+// parses the codestream in stream order.
+#define JPGTAG_INDEX_BASE      (JPGTAG_TAG_USER + 0x2300)
+// On input, the number of entries in the arrays below. On output, the
+// number of markers in the codestream, which may be larger. Only
+// as many entries as fit are filled in.
+#define JPGTAG_INDEX_LENGTH    (JPGTAG_INDEX_BASE + 0x01)
+// A pointer to a JPG_ULONG array receiving the markers, e.g. 0xffc0.
+#define JPGTAG_INDEX_MARKERS   (JPGTAG_INDEX_BASE + 0x02)
+// A pointer to a JPG_ULONG array receiving the byte offsets of the
+// markers from the start of the buffer.
+#define JPGTAG_INDEX_OFFSETS   (JPGTAG_INDEX_BASE + 0x03)
+// A pointer to a JPG_ULONG array receiving the sizes of the marker
+// segments including the length field, zero for SOI, EOI and RSTn.
+// The entropy coded data behind SOS is not included.
+#define JPGTAG_INDEX_SIZES     (JPGTAG_INDEX_BASE + 0x04)
+// A pointer to a JPG_ULONG array receiving for APP11 segments that
+// carry JPEG XT boxes the four-character box type, zero otherwise.
+#define JPGTAG_INDEX_BOXTYPES  (JPGTAG_INDEX_BASE + 0x05)
+///
 /// Application Program Base
 // If your application needs to use custom tags that are passed to the
 // libjpeg, you have to make sure that the libjpeg does not use and will
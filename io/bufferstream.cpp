@@ -0,0 +1,101 @@
+/*************************************************************************
+
+    This project implements a complete(!) JPEG (Recommendation ITU-T
+    T.81 | ISO/IEC 10918-1) codec, plus a library that can be used to
+    encode and decode JPEG streams. 
+    It also implements ISO/IEC 18477 aka JPEG XT which is an extension
+    towards intermediate, high-dynamic-range lossy and lossless coding
+    of JPEG. In specific, it supports ISO/IEC 18477-3/-6/-7/-8 encoding.
+
+    Note that only Profiles C and D of ISO/IEC 18477-7 are supported
+    here. Check the JPEG XT reference software for a full implementation
+    of ISO/IEC 18477-7.
+
+    Copyright (C) 2012-2018 Thomas Richter, University of Stuttgart and
+    Accusoft. (C) 2019-2020 Thomas Richter, Fraunhofer IIS.
+
+    This program is available under two licenses, GPLv3 and the ITU
+    Software licence Annex A Option 2, RAND conditions.
+
+    For the full text of the GPU license option, see README.license.gpl.
+    For the full text of the ITU license option, see README.license.itu.
+    
+    You may freely select between these two options.
+
+    For the GPL option, please note the following:
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+/*
+**
+** An implementation of the random access stream that reads
+** directly from a memory buffer provided by the caller, without
+** copying the data.
+**
+** $Id$
+**
+*/
+
+/// Includes
+#include "io/bufferstream.hpp"
+///
+
+/// BufferStream::BufferStream
+// Construct the stream from the buffer and its size.
+BufferStream::BufferStream(class Environ *env,const UBYTE *buffer,ULONG size)
+  : RandomAccessStream(env,size)
+{
+  // The buffer is only read from, Flush() prevents writing.
+  m_pucBuffer = const_cast<UBYTE *>(buffer);
+  m_pucBufPtr = m_pucBuffer;
+  m_pucBufEnd = m_pucBuffer + size;
+}
+///
+
+/// BufferStream::Flush
+// The stream is read-only.
+void BufferStream::Flush(void)
+{
+  JPG_THROW(NOT_IMPLEMENTED,"BufferStream::Flush","memory buffer streams are read-only");
+}
+///
+
+/// BufferStream::SkipBytes
+// Skip over the given number of bytes by moving the buffer pointer.
+void BufferStream::SkipBytes(ULONG skip)
+{
+  ULONG avail = m_pucBufEnd - m_pucBufPtr;
+
+  if (skip > avail) {
+    m_pucBufPtr = m_pucBufEnd;
+    JPG_THROW(UNEXPECTED_EOF,"BufferStream::SkipBytes",
+              "unexpectedly hit the end of the stream while skipping bytes");
+  }
+
+  m_pucBufPtr += skip;
+}
+///
+
+/// BufferStream::SetFilePointer
+// Set the file pointer to the indicated position, relative to the
+// start of the buffer. Positions beyond the end are at the EOF.
+void BufferStream::SetFilePointer(UQUAD newpos)
+{
+  if (newpos > UQUAD(m_pucBufEnd - m_pucBuffer))
+    newpos = m_pucBufEnd - m_pucBuffer;
+
+  m_pucBufPtr = m_pucBuffer + newpos;
+}
+///
@@ -0,0 +1,128 @@
+/*************************************************************************
+
+    This project implements a complete(!) JPEG (Recommendation ITU-T
+    T.81 | ISO/IEC 10918-1) codec, plus a library that can be used to
+    encode and decode JPEG streams. 
+    It also implements ISO/IEC 18477 aka JPEG XT which is an extension
+    towards intermediate, high-dynamic-range lossy and lossless coding
+    of JPEG. In specific, it supports ISO/IEC 18477-3/-6/-7/-8 encoding.
+
+    Note that only Profiles C and D of ISO/IEC 18477-7 are supported
+    here. Check the JPEG XT reference software for a full implementation
+    of ISO/IEC 18477-7.
+
+    Copyright (C) 2012-2018 Thomas Richter, University of Stuttgart and
+    Accusoft. (C) 2019-2020 Thomas Richter, Fraunhofer IIS.
+
+    This program is available under two licenses, GPLv3 and the ITU
+    Software licence Annex A Option 2, RAND conditions.
+
+    For the full text of the GPU license option, see README.license.gpl.
+    For the full text of the ITU license option, see README.license.itu.
+    
+    You may freely select between these two options.
+
+    For the GPL option, please note the following:
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+/*
+**
+** An implementation of the random access stream that reads
+** directly from a memory buffer provided by the caller, without
+** copying the data.
+**
+** $Id$
+**
+*/
+
+#ifndef BUFFERSTREAM_HPP
+#define BUFFERSTREAM_HPP
+
+/// Includes
+#include "randomaccessstream.hpp"
+///
+
+/// Design
+/** Design
+******************************************************************
+** class BufferStream                                           **
+** Super Class: RandomAccessStream                              **
+** Sub Classes: none                                            **
+** Friends:     none                                            **
+******************************************************************
+
+A read-only stream over a contiguous block of memory that is owned
+by the caller and remains valid while the stream is in use, e.g.
+a memory-mapped file. Unlike the IOStream, the buffer pointers of
+the ByteStream point directly into this memory, so no data is ever
+copied and Fill() never finds anything new. Seeking just moves the
+buffer pointer.
+
+* */
+///
+
+/// class BufferStream
+// A random access stream reading from a caller-owned memory block.
+class BufferStream : public RandomAccessStream {
+  //
+public:
+  //
+  // Construct the stream from the buffer and its size. The buffer is
+  // never written to.
+  BufferStream(class Environ *env,const UBYTE *buffer,ULONG size);
+  //
+  // Nothing to release, the buffer is owned by the caller.
+  virtual ~BufferStream(void)
+  {
+  }
+  //
+  // Implementation of the abstract functions: All data is already
+  // in the buffer, hence filling always finds an EOF.
+  virtual LONG Fill(void)
+  {
+    return 0;
+  }
+  //
+  // The stream is read-only.
+  virtual void Flush(void);
+  //
+  virtual LONG Query(void)
+  {
+    return 0;
+  }
+  //
+  // Peek the next word in the stream, deliver the marker without
+  // advancing the file pointer. Deliver EOF in case we run into
+  // the end of the stream.
+  virtual LONG PeekWord(void)
+  {
+    if (m_pucBufPtr + 1 < m_pucBufEnd) {
+      return (m_pucBufPtr[0] << 8) | m_pucBufPtr[1];
+    }
+    return ByteStream::EOF;
+  }
+  //
+  // Skip over the given number of bytes by moving the buffer pointer.
+  virtual void SkipBytes(ULONG skip);
+  //
+  // Set the file pointer to the indicated position, relative to the
+  // start of the buffer.
+  virtual void SetFilePointer(UQUAD newpos);
+};
+///
+
+///
+#endif
@@ -85,7 +85,7 @@ LONG ByteStream::Read(UBYTE *buffer,ULONG size)
   // only a partial read from the buffer
   // now is size <= avail, guaranteed.
   if (size) {
-    assert(m_pucBufPtr >= buffer + avail || buffer >= m_pucBufPtr + avail);
+    assert(m_pucBufPtr >= buffer + size || buffer >= m_pucBufPtr + size);
     memcpy(buffer,m_pucBufPtr,size);
     m_pucBufPtr  += size;
     // buffer    += size;  // not needed
@@ -0,0 +1,458 @@
+/*************************************************************************
+
+    This project implements a complete(!) JPEG (Recommendation ITU-T
+    T.81 | ISO/IEC 10918-1) codec, plus a library that can be used to
+    encode and decode JPEG streams. 
+    It also implements ISO/IEC 18477 aka JPEG XT which is an extension
+    towards intermediate, high-dynamic-range lossy and lossless coding
+    of JPEG. In specific, it supports ISO/IEC 18477-3/-6/-7/-8 encoding.
+
+    Note that only Profiles C and D of ISO/IEC 18477-7 are supported
+    here. Check the JPEG XT reference software for a full implementation
+    of ISO/IEC 18477-7.
+
+    Copyright (C) 2012-2018 Thomas Richter, University of Stuttgart and
+    Accusoft. (C) 2019-2020 Thomas Richter, Fraunhofer IIS.
+
+    This program is available under two licenses, GPLv3 and the ITU
+    Software licence Annex A Option 2, RAND conditions.
+
+    For the full text of the GPU license option, see README.license.gpl.
+    For the full text of the ITU license option, see README.license.itu.
+    
+    You may freely select between these two options.
+
+    For the GPL option, please note the following:
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+/*
+**
+** An implementation of the random access stream that reads from the
+** IOHook in a non-blocking way. Data is staged in memory until the
+** decoder can make progress without ever running dry.
+**
+** $Id$
+**
+*/
+
+/// Includes
+#include "tools/environment.hpp"
+#include "io/suspendablestream.hpp"
+#include "interface/parameters.hpp"
+#include "interface/tagitem.hpp"
+#include "std/string.hpp"
+///
+
+/// SuspendableStream::SuspendableStream
+// Build the stream from the hook tags.
+SuspendableStream::SuspendableStream(class Environ *env,const struct JPG_TagItem *tags)
+  : RandomAccessStream(env), m_pHandle(NULL), m_lUserData(0),
+    m_pChunks(NULL), m_pLast(NULL), m_uqStaged(0), m_uqMarkers(0),
+    m_uqSearched(0), m_uqMarker(0), m_bMarker(false), m_bEOF(false)
+{
+  while(tags) {
+    switch(tags->ti_Tag) {
+    case JPGTAG_HOOK_IOHOOK:
+      if (tags->ti_Data.ti_pPtr) 
+        m_Hook = *(struct JPG_Hook *)(tags->ti_Data.ti_pPtr);
+      break;
+    case JPGTAG_HOOK_IOSTREAM:
+      m_pHandle     = tags->ti_Data.ti_pPtr;
+      break;
+    case JPGTAG_HOOK_BUFFERSIZE:
+      if (tags->ti_Data.ti_lData > 0)
+        m_ulBufSize = tags->ti_Data.ti_lData;
+      break;
+    case JPGTAG_FIO_USERDATA:
+      m_lUserData   = tags->ti_Data.ti_lData;
+      break;
+    }
+    tags = tags->NextTagItem();
+  }
+}
+///
+
+/// SuspendableStream::~SuspendableStream
+// Release all staged data.
+SuspendableStream::~SuspendableStream(void)
+{
+  struct Chunk *chunk;
+
+  while((chunk = m_pChunks)) {
+    m_pChunks = chunk->ch_pNext;
+    if (chunk->ch_pucData)
+      m_pEnviron->FreeMem(chunk->ch_pucData,m_ulBufSize);
+    delete chunk;
+  }
+}
+///
+
+/// SuspendableStream::Pull
+// Read another block of data from the hook and append it to the
+// chunk list. Returns false if the hook would block, true if data
+// was appended or the EOF was reached.
+bool SuspendableStream::Pull(void)
+{
+  struct Chunk *chunk = m_pLast;
+  LONG bytes;
+
+  if (m_bEOF)
+    return true;
+  //
+  // Data must not be appended to the chunk the buffer pointers refer
+  // to, or to a full chunk. Start a new one then.
+  if (chunk == NULL || chunk->ch_ulFill >= m_ulBufSize ||
+      (chunk == m_pChunks && m_pucBuffer)) {
+    chunk = new(m_pEnviron) struct Chunk;
+    chunk->ch_pucData = (UBYTE *)m_pEnviron->AllocMem(m_ulBufSize);
+    if (m_pLast) {
+      m_pLast->ch_pNext = chunk;
+    } else {
+      m_pChunks = chunk;
+    }
+    m_pLast = chunk;
+  }
+  //
+  {
+    JPG_TagItem tags[] = {
+      JPG_PointerTag(JPGTAG_FIO_BUFFER,chunk->ch_pucData + chunk->ch_ulFill),
+      JPG_ValueTag(JPGTAG_FIO_SIZE,m_ulBufSize - chunk->ch_ulFill),
+      JPG_PointerTag(JPGTAG_FIO_HANDLE,m_pHandle),
+      JPG_ValueTag(JPGTAG_FIO_ACTION,JPGFLAG_ACTION_READ),
+      JPG_ValueTag(JPGTAG_FIO_USERDATA,m_lUserData),
+      JPG_EndTag
+    };
+    //
+    bytes       = m_Hook.CallLong(tags);
+    m_lUserData = tags[4].ti_Data.ti_lData;
+    //
+    if (bytes == JPGFLAG_FIO_WOULDBLOCK)
+      return false;
+    if (bytes < 0)
+      JPG_THROW_INT(Query(), "SuspendableStream::Pull", 
+                    "Client signalled an error on reading from the file hook");
+    if (bytes == 0) {
+      m_bEOF = true;
+      return true;
+    }
+    if (ULONG(bytes) > m_ulBufSize - chunk->ch_ulFill)
+      JPG_THROW(OVERFLOW_PARAMETER,"SuspendableStream::Pull",
+                "Client delivered more data than requested");
+    //
+    // The hook may have delivered the data in a buffer of its own.
+    if (tags[0].ti_Data.ti_pPtr != chunk->ch_pucData + chunk->ch_ulFill)
+      memcpy(chunk->ch_pucData + chunk->ch_ulFill,tags[0].ti_Data.ti_pPtr,bytes);
+  }
+  //
+  chunk->ch_ulFill += bytes;
+  m_uqStaged       += bytes;
+
+  return true;
+}
+///
+
+/// SuspendableStream::Stage
+// Pull data until at least the given number of bytes from the given
+// file position on is staged. Returns false if the hook would block.
+bool SuspendableStream::Stage(UQUAD pos,ULONG bytes)
+{
+  while(m_uqStaged < pos + bytes && !m_bEOF) {
+    if (!Pull())
+      return false;
+  }
+  return true;
+}
+///
+
+/// SuspendableStream::ByteAt
+// Return the staged byte at the given file position, or EOF if it is
+// not available.
+LONG SuspendableStream::ByteAt(UQUAD pos) const
+{
+  struct Chunk *chunk = m_pChunks;
+  // The first chunk starts at the counter if it is current, otherwise
+  // nothing has been read yet.
+  UQUAD start         = m_uqCounter;
+
+  while(chunk) {
+    if (pos < start + chunk->ch_ulFill) {
+      assert(pos >= start);
+      return chunk->ch_pucData[pos - start];
+    }
+    start += chunk->ch_ulFill;
+    chunk  = chunk->ch_pNext;
+  }
+
+  return EOF;
+}
+///
+
+/// SuspendableStream::FindMarker
+// Search the staged data from the given file position on for a marker
+// that ends an entropy coded segment, i.e. any marker but RST. Returns
+// true if one was found.
+bool SuspendableStream::FindMarker(UQUAD pos)
+{
+  struct Chunk *chunk = m_pChunks;
+  UQUAD start         = m_uqCounter;
+  UQUAD at;
+  bool ff             = false;
+  
+  if (m_bMarker && m_uqMarker >= pos)
+    return true;
+  //
+  // Do not search the same data twice.
+  at = (m_uqSearched > pos)?(m_uqSearched):(pos);
+  //
+  while(chunk) {
+    if (at < start + chunk->ch_ulFill) {
+      const UBYTE *data = chunk->ch_pucData + (at - start);
+      const UBYTE *end  = chunk->ch_pucData + chunk->ch_ulFill;
+      //
+      do {
+        UBYTE b = *data++;
+        // A marker is 0xff followed by a byte with the MSB set, except
+        // for fill bytes. In JPEG, 0xff is otherwise followed by zero,
+        // in JPEG-LS by a byte with the MSB cleared.
+        if (ff && b >= 0x80 && b != 0xff && (b < 0xd0 || b > 0xd7)) {
+          m_uqMarker   = at - 1;
+          m_uqSearched = at + 1;
+          m_bMarker    = true;
+          return true;
+        }
+        ff = (b == 0xff);
+        at++;
+      } while(data < end);
+    }
+    start += chunk->ch_ulFill;
+    chunk  = chunk->ch_pNext;
+  }
+  //
+  // A trailing 0xff has to be looked at again once more data is there.
+  m_uqSearched = (ff)?(at - 1):(at);
+
+  return false;
+}
+///
+
+/// SuspendableStream::Fill
+// Advance to the next staged chunk. Pulls from the hook only if no data
+// is staged, which is an error if the hook would block.
+LONG SuspendableStream::Fill(void)
+{
+  if (m_pucBufPtr < m_pucBufEnd)
+    return m_pucBufEnd - m_pucBufPtr;
+  
+  do {
+    struct Chunk *next = (m_pucBuffer)?(m_pChunks->ch_pNext):(m_pChunks);
+    //
+    if (next && next->ch_ulFill > 0) {
+      // Release the chunk completely read.
+      if (m_pucBuffer) {
+        struct Chunk *chunk = m_pChunks;
+        //
+        m_uqCounter += m_pucBufPtr - m_pucBuffer;
+        m_pChunks    = next;
+        m_pEnviron->FreeMem(chunk->ch_pucData,m_ulBufSize);
+        delete chunk;
+      }
+      m_pucBuffer = next->ch_pucData;
+      m_pucBufPtr = m_pucBuffer;
+      m_pucBufEnd = m_pucBuffer + next->ch_ulFill;
+      //
+      return next->ch_ulFill;
+    }
+    //
+    if (m_bEOF)
+      return 0;
+    //
+    if (!Pull())
+      JPG_THROW(UNEXPECTED_EOF,"SuspendableStream::Fill",
+                "input ran dry at a position the decoder cannot resume from");
+  } while(true);
+}
+///
+
+/// SuspendableStream::Flush
+// The stream is read-only.
+void SuspendableStream::Flush(void)
+{
+  JPG_THROW(NOT_IMPLEMENTED,"SuspendableStream::Flush","suspendable streams are read-only");
+}
+///
+
+/// SuspendableStream::Query
+// Return the status of the client hook.
+LONG SuspendableStream::Query(void)
+{
+  LONG result;
+  //
+  JPG_TagItem tags[] = {
+    JPG_PointerTag(JPGTAG_FIO_HANDLE,m_pHandle),
+    JPG_ValueTag(JPGTAG_FIO_ACTION,JPGFLAG_ACTION_QUERY),
+    JPG_ValueTag(JPGTAG_FIO_USERDATA,m_lUserData),
+    JPG_EndTag
+  };
+
+  result = m_Hook.CallLong(tags);
+  //
+  // Update user data
+  m_lUserData = tags[2].ti_Data.ti_lData;
+  //
+  return result;
+}
+///
+
+/// SuspendableStream::PeekWord
+// Peek the next word in the stream, deliver the marker without
+// advancing the file pointer. Deliver EOF in case we run into
+// the end of the stream, or the hook would block.
+LONG SuspendableStream::PeekWord(void)
+{
+  UQUAD pos = FilePosition();
+  LONG byte1,byte2;
+
+  if (m_pucBufPtr + 1 < m_pucBufEnd)
+    return (m_pucBufPtr[0] << 8) | m_pucBufPtr[1];
+
+  if (!Stage(pos,2))
+    return EOF;
+
+  byte1 = ByteAt(pos);
+  byte2 = ByteAt(pos + 1);
+  if (byte1 == EOF || byte2 == EOF)
+    return EOF;
+
+  return (byte1 << 8) | byte2;
+}
+///
+
+/// SuspendableStream::SkipBytes
+// Skip over the given number of bytes.
+void SuspendableStream::SkipBytes(ULONG skip)
+{
+  ByteStream::SkipBytes(skip);
+}
+///
+
+/// SuspendableStream::SetFilePointer
+// Set the file pointer to the indicated position. This may only
+// seek backwards within the current chunk.
+void SuspendableStream::SetFilePointer(UQUAD newpos)
+{
+  UQUAD current = FilePosition();
+
+  if (newpos >= current) {
+    UQUAD skip = newpos - current;
+    //
+    if (skip > MAX_ULONG)
+      JPG_THROW(OVERFLOW_PARAMETER,"SuspendableStream::SetFilePointer",
+                "seek distance too large");
+    SkipBytes(ULONG(skip));
+  } else if (m_pucBuffer && newpos >= m_uqCounter) {
+    m_pucBufPtr = m_pucBuffer + (newpos - m_uqCounter);
+  } else {
+    JPG_THROW(NOT_AVAILABLE,"SuspendableStream::SetFilePointer",
+              "cannot seek backwards over data already released");
+  }
+}
+///
+
+/// SuspendableStream::StageMarkers
+// Make sure that all marker segments from the given file position
+// up to and including the next start of scan or the end of image are
+// staged. Returns false if the hook would block before.
+bool SuspendableStream::StageMarkers(UQUAD pos)
+{
+  //
+  // Already staged by a former call?
+  if (pos < m_uqMarkers)
+    return true;
+  //
+  do {
+    LONG b0,b1,len;
+    //
+    if (!Stage(pos,2))
+      return false;
+    b0 = ByteAt(pos);
+    b1 = ByteAt(pos + 1);
+    if (b0 == EOF || b1 == EOF)
+      return true; // The decoder will find the truncated stream.
+    //
+    if (b0 != 0xff || b1 == 0xff) {
+      // Not a marker, or a fill byte. The decoder will resync.
+      pos++;
+      continue;
+    }
+    if (b1 < 0x80 && b1 != 0x01) {
+      // Stuffed data of the entropy coded segment.
+      pos += 2;
+      continue;
+    }
+    if (b1 == 0x01 || b1 == 0xd8 || (b1 >= 0xd0 && b1 <= 0xd7)) {
+      // TEM, SOI and RST do not have a length.
+      pos += 2;
+      continue;
+    }
+    if (b1 == 0xd9) {
+      // EOI. Nothing behind it is parsed.
+      m_uqMarkers = pos + 2;
+      return true;
+    }
+    //
+    // A marker segment with a length.
+    if (!Stage(pos,4))
+      return false;
+    if (ByteAt(pos + 3) == EOF)
+      return true;
+    len = (ByteAt(pos + 2) << 8) | ByteAt(pos + 3);
+    if (!Stage(pos,2 + len))
+      return false;
+    pos += 2 + len;
+    if (b1 == 0xda) {
+      // SOS. The entropy coded data follows. Starting the scan
+      // already primes the arithmetic coder with its first bytes.
+      if (!StageSegment(pos,8))
+        return false;
+      m_uqMarkers = pos;
+      return true;
+    }
+  } while(true);
+}
+///
+
+/// SuspendableStream::StageSegment
+// Make sure that either the given number of bytes from the given file
+// position on is staged, or the entropy coded segment containing this
+// position is complete. A bound of zero always requires the complete
+// segment. Returns false if the hook would block before.
+bool SuspendableStream::StageSegment(UQUAD pos,ULONG bound)
+{
+  do {
+    if (bound && m_uqStaged >= pos + bound)
+      return true;
+    if (m_bEOF)
+      return true;
+    if (FindMarker(pos)) {
+      // The marker and its length field, e.g. a DNL marker, must also
+      // be available.
+      return Stage(m_uqMarker,6);
+    }
+    if (!Pull())
+      return false;
+  } while(true);
+}
+///
@@ -0,0 +1,204 @@
+/*************************************************************************
+
+    This project implements a complete(!) JPEG (Recommendation ITU-T
+    T.81 | ISO/IEC 10918-1) codec, plus a library that can be used to
+    encode and decode JPEG streams. 
+    It also implements ISO/IEC 18477 aka JPEG XT which is an extension
+    towards intermediate, high-dynamic-range lossy and lossless coding
+    of JPEG. In specific, it supports ISO/IEC 18477-3/-6/-7/-8 encoding.
+
+    Note that only Profiles C and D of ISO/IEC 18477-7 are supported
+    here. Check the JPEG XT reference software for a full implementation
+    of ISO/IEC 18477-7.
+
+    Copyright (C) 2012-2018 Thomas Richter, University of Stuttgart and
+    Accusoft. (C) 2019-2020 Thomas Richter, Fraunhofer IIS.
+
+    This program is available under two licenses, GPLv3 and the ITU
+    Software licence Annex A Option 2, RAND conditions.
+
+    For the full text of the GPU license option, see README.license.gpl.
+    For the full text of the ITU license option, see README.license.itu.
+    
+    You may freely select between these two options.
+
+    For the GPL option, please note the following:
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+/*
+**
+** An implementation of the random access stream that reads from the
+** IOHook in a non-blocking way. Data is staged in memory until the
+** decoder can make progress without ever running dry.
+**
+** $Id$
+**
+*/
+
+#ifndef SUSPENDABLESTREAM_HPP
+#define SUSPENDABLESTREAM_HPP
+
+/// Includes
+#include "randomaccessstream.hpp"
+///
+
+/// Design
+/** Design
+******************************************************************
+** class SuspendableStream                                      **
+** Super Class: RandomAccessStream                              **
+** Sub Classes: none                                            **
+** Friends:     none                                            **
+******************************************************************
+
+An input stream for push-style sources, e.g. non-blocking sockets,
+whose IOHook may return JPGFLAG_FIO_WOULDBLOCK instead of data. 
+
+The decoder cannot stop in the middle of a marker segment or an MCU
+since its state is spread over many objects. Instead, the stream
+stages data received from the hook in a list of chunks and the
+decoder asks, before each step, whether enough data is available
+to complete it: either a complete run of marker segments up to the
+next start of scan, or an upper bound of the bytes a single MCU may
+take, or the end of the entropy coded segment. If not, and the hook
+would block, the decoder returns to the caller with its state
+untouched and resumes from the same point on the next call.
+
+Chunks are never resized or moved once data has been read from them,
+hence checksum adapters holding pointers into the current chunk
+remain valid while new data is staged. A chunk is only released when
+all its data has been read.
+
+* */
+///
+
+/// class SuspendableStream
+// A random access stream reading from a non-blocking IOHook.
+class SuspendableStream : public RandomAccessStream {
+  //
+  // A chunk of staged data.
+  struct Chunk : public JObject {
+    // The next chunk in the list.
+    struct Chunk *ch_pNext;
+    // The data of this chunk, m_ulBufSize bytes large.
+    UBYTE        *ch_pucData;
+    // The number of valid bytes in the chunk.
+    ULONG         ch_ulFill;
+    //
+    Chunk(void)
+      : ch_pNext(NULL), ch_pucData(NULL), ch_ulFill(0)
+    { }
+  };
+  //
+  // The hook we get data from.
+  struct JPG_Hook m_Hook;
+  //
+  // The thing the client uses for the IO management
+  APTR            m_pHandle;
+  //
+  // For internal management of the user.
+  LONG            m_lUserData;
+  //
+  // The list of staged chunks. If the buffer pointers of the
+  // byte stream are valid, the first chunk is the one they
+  // point into.
+  struct Chunk   *m_pChunks;
+  //
+  // The last chunk of the list, where data is appended.
+  struct Chunk   *m_pLast;
+  //
+  // The file position behind the last staged byte.
+  UQUAD           m_uqStaged;
+  //
+  // Marker segments are complete up to this file position.
+  UQUAD           m_uqMarkers;
+  //
+  // Staged data has been searched for a marker up to this position.
+  UQUAD           m_uqSearched;
+  //
+  // The position of the last marker found by the above search.
+  UQUAD           m_uqMarker;
+  //
+  // Set if the above is valid.
+  bool            m_bMarker;
+  //
+  // Set if the hook signalled the end of the stream.
+  bool            m_bEOF;
+  //
+  // Read another block of data from the hook and append it to the
+  // chunk list. Returns false if the hook would block, true if data
+  // was appended or the EOF was reached.
+  bool Pull(void);
+  //
+  // Pull data until at least the given number of bytes from the given
+  // file position on is staged. Returns false if the hook would block.
+  bool Stage(UQUAD pos,ULONG bytes);
+  //
+  // Return the staged byte at the given file position, or EOF if it is
+  // not available.
+  LONG ByteAt(UQUAD pos) const;
+  //
+  // Search the staged data from the given file position on for a marker
+  // that ends an entropy coded segment, i.e. any marker but RST. Returns
+  // true if one was found.
+  bool FindMarker(UQUAD pos);
+  //
+public:
+  //
+  // Build the stream from the hook tags.
+  SuspendableStream(class Environ *env,const struct JPG_TagItem *tags);
+  //
+  // Release all staged data.
+  virtual ~SuspendableStream(void);
+  //
+  // Implementation of the abstract functions. Fill() advances to the
+  // next staged chunk, and only pulls from the hook if no data is
+  // staged. If the hook would block then, this is an error since the
+  // decoder cannot be resumed.
+  virtual LONG Fill(void);
+  //
+  // The stream is read-only.
+  virtual void Flush(void);
+  //
+  virtual LONG Query(void);
+  //
+  // Peek the next word in the stream, deliver the marker without
+  // advancing the file pointer. Deliver EOF in case we run into
+  // the end of the stream, or the hook would block.
+  virtual LONG PeekWord(void);
+  //
+  // Skip over the given number of bytes.
+  virtual void SkipBytes(ULONG skip);
+  //
+  // Set the file pointer to the indicated position. This may only
+  // seek backwards within the current chunk.
+  virtual void SetFilePointer(UQUAD newpos);
+  //
+  // Make sure that all marker segments from the given file position
+  // up to and including the next start of scan or the end of image are
+  // staged. Returns false if the hook would block before.
+  bool StageMarkers(UQUAD pos);
+  //
+  // Make sure that either the given number of bytes from the given file
+  // position on is staged, or the entropy coded segment containing this
+  // position is complete. A bound of zero always requires the complete
+  // segment. Returns false if the hook would block before.
+  bool StageSegment(UQUAD pos,ULONG bound);
+};
+///
+
+///
+#endif
@@ -65,9 +65,55 @@
 #include "control/blocklineadapter.hpp"
 #include "control/linelineadapter.hpp"
 #include "control/residualblockhelper.hpp"
+#include "control/blockcursor.hpp"
 #include "boxes/databox.hpp"
 #include "boxes/checksumbox.hpp"
 #include "dct/dct.hpp"
+#include "io/memorystream.hpp"
+#include "tools/workerpool.hpp"
+///
+
+/// class Frame::ScanJob
+// Codes a complete scan on a worker thread. The scan reads the quantized
+// data through a cursor of its own and writes into a memory stream of its
+// own, or only collects statistics if the scan measures.
+class Frame::ScanJob : public WorkerPool::Job {
+public:
+  //
+  // The scan to code, already started.
+  class Scan         *m_pScan;
+  //
+  // The private position of the scan in the block buffer.
+  class BlockCursor  *m_pCursor;
+  //
+  // The output of the scan, NULL for measurement scans.
+  class MemoryStream *m_pStream;
+  //
+  ScanJob(void)
+    : m_pScan(NULL), m_pCursor(NULL), m_pStream(NULL)
+  { }
+  //
+  virtual ~ScanJob(void)
+  {
+    delete m_pStream;
+    delete m_pCursor;
+  }
+  //
+  virtual void Run(class Environ *env);
+};
+///
+
+/// Frame::ScanJob::Run
+// Run all MCUs of the scan and flush it.
+void Frame::ScanJob::Run(class Environ *)
+{
+  while(m_pScan->StartMCURow()) {
+    while(m_pScan->WriteMCU()) {
+      ;
+    }
+  }
+  m_pScan->Flush();
+}
 ///
 
 /// Frame::Frame
@@ -830,6 +876,10 @@ class Scan *Frame::StartParseScan(class ByteStream *io,class Checksum *chk)
       return NULL;
     }
     //
+    // The residual boxes are complete now if they come in front of
+    // the first scan. If so, they can be decoded in the background.
+    m_pParent->LaunchResidualDecoder();
+    //
     // The checksum could also come here, i.e. in the scan header.
     chk = m_pParent->CreateChecksumWhenNeeded(chk);
     // 
@@ -850,6 +900,15 @@ class Scan *Frame::StartParseScan(class ByteStream *io,class Checksum *chk)
       if (ScanForScanHeader(io)) {
         class Scan *scan = AttachScan();
         scan->ParseMarker(io);
+        //
+        // The entropy coded data of a hierarchical scan may be decoded
+        // in the background. For the caller, the scan is then complete,
+        // and the frame trailer follows.
+        if (chk == NULL && m_pParent->LaunchScanDecoder(this,scan,m_pImage,io)) {
+          m_bEndOfFrame    = true;
+          m_bStartedTables = false;
+          return NULL;
+        }
         scan->StartParseScan(io,chk,m_pImage);
         return scan;
       }
@@ -937,6 +996,180 @@ class Scan *Frame::StartWriteScan(class ByteStream *io,class Checksum *chk)
 }
 ///
 
+/// Frame::ConcurrentScanBuffer
+// Return the block buffer if all scans of this frame can be coded
+// concurrently from it, or NULL if they have to go one by one.
+class BlockBuffer *Frame::ConcurrentScanBuffer(void)
+{
+#ifdef HAVE_WORKER_THREADS
+  class BlockBitmapRequester *bb = dynamic_cast<class BlockBitmapRequester *>(m_pImage);
+  //
+  // Only the block buffer of a flat image keeps all quantized data around,
+  // and scans need to know how many rows there are.
+  if (bb == NULL || m_ulHeight == 0)
+    return NULL;
+  //
+  // Nothing to gain for a single scan, and all scans must be pending.
+  if (m_pScan == NULL || m_pScan->NextOf() == NULL || m_pCurrent != m_pScan)
+    return NULL;
+  //
+  // Arithmetic coded scans distribute their restart intervals over the
+  // worker pool themselves, which must not happen from within a job.
+  if (m_pTables->RestartIntervalOf() > 0) {
+    switch(m_Type) {
+    case ACSequential:
+    case ACProgressive:
+    case ACDifferentialSequential:
+    case ACDifferentialProgressive:
+    case ACResidual:
+    case ACResidualProgressive:
+    case ACResidualDCT:
+      return NULL;
+    default:
+      break;
+    }
+  }
+  //
+  if (m_pEnviron->WorkerPoolOf() == NULL)
+    return NULL;
+  
+  return bb;
+#else
+  return NULL;
+#endif
+}
+///
+
+/// Frame::RunScanJobs
+// Run the scans of the given jobs on the worker pool and wait for them.
+void Frame::RunScanJobs(class ScanJob *jobs,ULONG count)
+{
+  class WorkerPool *pool = m_pEnviron->WorkerPoolOf();
+  ULONG i;
+  
+  assert(pool);
+  //
+  // The jobs act on objects of this environment.
+  m_pEnviron->BeginConcurrentJob();
+  for(i = 0;i < count;i++) {
+    pool->Submit(jobs + i);
+  }
+  JPG_TRY {
+    pool->Wait();
+  } JPG_CATCH {
+    m_pEnviron->EndConcurrentJob();
+    JPG_RETHROW;
+  } JPG_ENDTRY;
+  m_pEnviron->EndConcurrentJob();
+}
+///
+
+/// Frame::WriteConcurrentScans
+// Write all scans of this frame, each into a memory stream of its own
+// on a worker thread, and concatenate them in scan order. Scan data goes
+// to target, refinement data to io. Returns false without writing
+// anything if this is not possible, the scans must then be written
+// one after another.
+bool Frame::WriteConcurrentScans(class ByteStream *target,class ByteStream *io,class Checksum *chk)
+{
+  class BlockBuffer *buffer = ConcurrentScanBuffer();
+  class ScanJob *jobs;
+  class Scan *scan;
+  ULONG count = 0;
+  
+  if (buffer == NULL)
+    return false;
+  //
+  // A checksum over the scan data requires to see the bytes in order.
+  if (chk && !m_pTables->ChecksumTables())
+    return false;
+
+  for(scan = m_pScan;scan;scan = scan->NextOf())
+    count++;
+
+  jobs = new(m_pEnviron) class ScanJob[count];
+  JPG_TRY {
+    ULONG i;
+    //
+    // Start all scans here, this writes their headers into the
+    // streams, and fetches the coding tables.
+    for(scan = m_pScan,i = 0;scan;scan = scan->NextOf(),i++) {
+      jobs[i].m_pScan   = scan;
+      jobs[i].m_pCursor = new(m_pEnviron) class BlockCursor(this,buffer,m_pImage);
+      jobs[i].m_pStream = new(m_pEnviron) class MemoryStream(m_pEnviron);
+      scan->StartWriteScan(jobs[i].m_pStream,NULL,jobs[i].m_pCursor);
+    }
+    //
+    RunScanJobs(jobs,count);
+    //
+    // Now concatenate the output in scan order, exactly as if the scans
+    // had been written one after another.
+    for(i = 0;i < count;i++) {
+      class MemoryStream in(m_pEnviron,jobs[i].m_pStream,JPGFLAG_OFFSET_BEGINNING);
+      ULONG size = ULONG(jobs[i].m_pStream->FilePosition());
+      //
+      m_pCurrent = jobs[i].m_pScan;
+      if (m_pCurrent->isHidden()) {
+        assert(m_pCurrentRefinement == NULL);
+        m_pCurrentRefinement = m_pTables->AppendRefinementData();
+        in.Push(m_pCurrentRefinement->EncoderBufferOf(),size);
+      } else {
+        in.Push(target,size);
+      }
+      CompleteRefimentScan(io);
+      WriteTrailer(target);
+    }
+  } JPG_CATCH {
+    delete[] jobs;
+    JPG_RETHROW;
+  } JPG_ENDTRY;
+
+  delete[] jobs;
+  m_pCurrent = NULL;
+  
+  return true;
+}
+///
+
+/// Frame::MeasureConcurrentScans
+// Run the measurement scans of this frame concurrently. Returns false
+// if this is not possible.
+bool Frame::MeasureConcurrentScans(void)
+{
+  class BlockBuffer *buffer = ConcurrentScanBuffer();
+  class ScanJob *jobs;
+  class Scan *scan;
+  ULONG count = 0;
+  
+  if (buffer == NULL)
+    return false;
+
+  for(scan = m_pScan;scan;scan = scan->NextOf())
+    count++;
+
+  jobs = new(m_pEnviron) class ScanJob[count];
+  JPG_TRY {
+    ULONG i;
+    //
+    for(scan = m_pScan,i = 0;scan;scan = scan->NextOf(),i++) {
+      jobs[i].m_pScan   = scan;
+      jobs[i].m_pCursor = new(m_pEnviron) class BlockCursor(this,buffer,m_pImage);
+      scan->StartMeasureScan(jobs[i].m_pCursor);
+    }
+    //
+    RunScanJobs(jobs,count);
+  } JPG_CATCH {
+    delete[] jobs;
+    JPG_RETHROW;
+  } JPG_ENDTRY;
+
+  delete[] jobs;
+  m_pCurrent = NULL;
+  
+  return true;
+}
+///
+
 /// Frame::StartMeasureScan
 // Start a measurement scan
 class Scan *Frame::StartMeasureScan(void)
@@ -972,6 +1205,19 @@ void Frame::EndParseScan(void)
 }
 ///
 
+/// Frame::ScanInputOf
+// Return the stream the current scan reads from, given the stream
+// passed into StartParseScan(). This is different if the scan is
+// checksummed.
+class ByteStream *Frame::ScanInputOf(class ByteStream *io) const
+{
+  if (m_pAdapter)
+    return m_pAdapter;
+
+  return io;
+}
+///
+
 /// Frame::EndWriteScan
 // End writing the current scan
 void Frame::EndWriteScan(void)
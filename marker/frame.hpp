@@ -68,6 +68,7 @@ class ResidualBlockHelper;
 class Checksum;
 class ChecksumAdapter;
 class DCT;
+class BlockBuffer;
 ///
 
 /// class Frame
@@ -143,6 +144,9 @@ class Frame : public JKeeper {
   // Counts the refinement scans.
   UWORD                  m_usRefinementCount;
   //
+  // Codes a complete scan on a worker thread.
+  class ScanJob;
+  //
   // Compute the largest common denominator of a and b.
   static int gcd(int a,int b)
   {
@@ -171,6 +175,13 @@ class Frame : public JKeeper {
   // and make this the current scan.
   class Scan *AttachScan(void);
   //
+  // Return the block buffer if all scans of this frame can be coded
+  // concurrently from it, or NULL if they have to go one by one.
+  class BlockBuffer *ConcurrentScanBuffer(void);
+  //
+  // Run the scans of the given jobs on the worker pool and wait for them.
+  void RunScanJobs(class ScanJob *jobs,ULONG count);
+  //
   // Helper function to create a regular scan from the tags.
   // There are no scan tags here, instead all components are included.
   // If breakup is set, then each component gets its own scan, otherwise
@@ -246,6 +257,15 @@ public:
     return m_ulHeight;
   }
   //
+  // Shrink the dimensions of the DHP marker to that of a smaller
+  // resolution level at which hierarchical decoding stopped.
+  void ReduceDimensions(ULONG width,ULONG height)
+  {
+    assert(width <= m_ulWidth);
+    m_ulWidth  = width;
+    m_ulHeight = height;
+  }
+  //
   // Return the number of components.
   UBYTE DepthOf(void) const
   {
@@ -292,9 +312,25 @@ public:
   // End parsing the current scan.
   void EndParseScan(void);
   //
+  // Return the stream the current scan reads from, given the stream
+  // passed into StartParseScan(). This is different if the scan is
+  // checksummed.
+  class ByteStream *ScanInputOf(class ByteStream *io) const;
+  //
   // End writing the current scan
   void EndWriteScan(void);
   //
+  // Write all scans of this frame, each into a memory stream of its own
+  // on a worker thread, and concatenate them in scan order. Scan data goes
+  // to target, refinement data to io. Returns false without writing
+  // anything if this is not possible, the scans must then be written
+  // one after another.
+  bool WriteConcurrentScans(class ByteStream *target,class ByteStream *io,class Checksum *chk);
+  //
+  // Run the measurement scans of this frame concurrently. Returns false
+  // if this is not possible.
+  bool MeasureConcurrentScans(void);
+  //
   // Return the scan.
   class Scan *FirstScanOf(void) const
   {
@@ -1051,6 +1051,27 @@ bool Scan::ParseMCU(void)
 }
 ///
 
+/// Scan::ParseMCURow
+// Parse the remaining MCUs of the current MCU row.
+void Scan::ParseMCURow(void)
+{
+  assert(m_pParser);
+
+  m_pParser->ParseMCURow();
+}
+///
+
+/// Scan::MaxMCUSizeOf
+// Return an upper bound for the number of bytes a single ParseMCU()
+// may read, or zero if the entropy coded segment must be complete.
+ULONG Scan::MaxMCUSizeOf(void) const
+{
+  assert(m_pParser);
+
+  return m_pParser->MaxMCUSizeOf();
+}
+///
+
 /// Scan::WriteMCU
 // Write a single MCU in this scan.
 bool Scan::WriteMCU(void)
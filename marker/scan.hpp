@@ -259,6 +259,13 @@ public:
   // Parse a single MCU in this scan.
   bool ParseMCU(void);
   //
+  // Parse the remaining MCUs of the current MCU row.
+  void ParseMCURow(void);
+  //
+  // Return an upper bound for the number of bytes a single ParseMCU()
+  // may read, or zero if the entropy coded segment must be complete.
+  ULONG MaxMCUSizeOf(void) const;
+  //
   // Write a single MCU in this scan.
   bool WriteMCU(void);
   //
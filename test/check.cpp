@@ -0,0 +1,707 @@
+/*************************************************************************
+
+    This project implements a complete(!) JPEG (Recommendation ITU-T
+    T.81 | ISO/IEC 10918-1) codec, plus a library that can be used to
+    encode and decode JPEG streams. 
+    It also implements ISO/IEC 18477 aka JPEG XT which is an extension
+    towards intermediate, high-dynamic-range lossy and lossless coding
+    of JPEG. In specific, it supports ISO/IEC 18477-3/-6/-7/-8 encoding.
+
+    Note that only Profiles C and D of ISO/IEC 18477-7 are supported
+    here. Check the JPEG XT reference software for a full implementation
+    of ISO/IEC 18477-7.
+
+    Copyright (C) 2012-2018 Thomas Richter, University of Stuttgart and
+    Accusoft. (C) 2019-2020 Thomas Richter, Fraunhofer IIS.
+
+    This program is available under two licenses, GPLv3 and the ITU
+    Software licence Annex A Option 2, RAND conditions.
+
+    For the full text of the GPU license option, see README.license.gpl.
+    For the full text of the ITU license option, see README.license.itu.
+    
+    You may freely select between these two options.
+
+    For the GPL option, please note the following:
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+/*
+** This file runs the regression checks. They are not part of the
+** libjpeg code. A synthetic image is encoded in several modes, and
+** for each codestream the image is decoded along several paths of
+** the library whose results must agree.
+**
+** $Id$
+**
+*/
+
+/// Includes
+#include "test/check.hpp"
+#include "std/stdio.hpp"
+#include "std/stdlib.hpp"
+#include "std/string.hpp"
+#include "tools/traits.hpp"
+#include "interface/types.hpp"
+#include "interface/hooks.hpp"
+#include "interface/tagitem.hpp"
+#include "interface/parameters.hpp"
+#include "interface/jpeg.hpp"
+///
+
+/// Defines
+// Dimensions of the test image. These are deliberately not
+// multiples of the MCU size.
+#define CHECK_WIDTH  203
+#define CHECK_HEIGHT 157
+///
+
+/// struct MemoryStream
+// A codestream held in memory, written and read by the MemoryHook.
+struct MemoryStream {
+  UBYTE *ms_pData;
+  ULONG  ms_ulSize;
+  ULONG  ms_ulAlloc;
+  ULONG  ms_ulPos;
+};
+///
+
+/// struct Frame
+// An image with all components interleaved pixel by pixel, one byte
+// per sample.
+struct Frame {
+  UBYTE *fr_pData;
+  ULONG  fr_ulWidth;
+  ULONG  fr_ulHeight;
+  UBYTE  fr_ucDepth;
+};
+///
+
+/// struct Configuration
+// A coding mode the checks are run for.
+struct Configuration {
+  const char *cf_pName;
+  UBYTE       cf_ucDepth;
+  int         cf_iFrameType;
+  int         cf_iLevels;
+  UBYTE       cf_ucSubX;
+  UBYTE       cf_ucSubY;
+};
+///
+
+/// Configurations
+static const struct Configuration Configurations[] = {
+  {"sequential 4:4:4"       ,3,JPGFLAG_SEQUENTIAL                                    ,0,1,1},
+  {"sequential 4:2:0"       ,3,JPGFLAG_SEQUENTIAL                                    ,0,2,2},
+  {"sequential 4:2:2"       ,3,JPGFLAG_SEQUENTIAL | JPGFLAG_OPTIMIZE_HUFFMAN         ,0,2,1},
+  {"sequential grey"        ,1,JPGFLAG_SEQUENTIAL                                    ,0,1,1},
+  {"arithmetic 4:2:0"       ,3,JPGFLAG_SEQUENTIAL | JPGFLAG_ARITHMETIC               ,0,2,2},
+  {"progressive 4:4:4"      ,3,JPGFLAG_PROGRESSIVE                                   ,0,1,1},
+  {"progressive 4:2:0"      ,3,JPGFLAG_PROGRESSIVE | JPGFLAG_OPTIMIZE_HUFFMAN        ,0,2,2},
+  {"arith. progressive 1:2" ,3,JPGFLAG_PROGRESSIVE | JPGFLAG_ARITHMETIC              ,0,1,2},
+  {"hierarchical 4:4:4"     ,3,JPGFLAG_SEQUENTIAL | JPGFLAG_PYRAMIDAL | JPGFLAG_OPTIMIZE_HUFFMAN,3,1,1},
+  {"hierarchical 4:2:0"     ,3,JPGFLAG_SEQUENTIAL | JPGFLAG_PYRAMIDAL | JPGFLAG_OPTIMIZE_HUFFMAN,2,2,2},
+  {NULL                     ,0,0                                                     ,0,0,0}
+};
+///
+
+/// MemoryHook
+// The IO hook function that reads and writes a codestream in memory.
+static JPG_LONG MemoryHook(struct JPG_Hook *hook, struct JPG_TagItem *tags)
+{
+  struct MemoryStream *ms = (struct MemoryStream *)(hook->hk_pData);
+
+  switch(tags->GetTagData(JPGTAG_FIO_ACTION)) {
+  case JPGFLAG_ACTION_READ:
+    {
+      UBYTE *buffer = (UBYTE *)tags->GetTagPtr(JPGTAG_FIO_BUFFER);
+      ULONG  size   = (ULONG  )tags->GetTagData(JPGTAG_FIO_SIZE);
+
+      if (size > ms->ms_ulSize - ms->ms_ulPos)
+        size = ms->ms_ulSize - ms->ms_ulPos;
+      memcpy(buffer,ms->ms_pData + ms->ms_ulPos,size);
+      ms->ms_ulPos += size;
+      return size;
+    }
+    break;
+  case JPGFLAG_ACTION_WRITE:
+    {
+      UBYTE *buffer = (UBYTE *)tags->GetTagPtr(JPGTAG_FIO_BUFFER);
+      ULONG  size   = (ULONG  )tags->GetTagData(JPGTAG_FIO_SIZE);
+
+      if (ms->ms_ulPos + size > ms->ms_ulAlloc) {
+        ULONG alloc = 2 * (ms->ms_ulPos + size);
+        UBYTE *data = (UBYTE *)realloc(ms->ms_pData,alloc);
+        if (data == NULL)
+          return -1;
+        ms->ms_pData  = data;
+        ms->ms_ulAlloc = alloc;
+      }
+      memcpy(ms->ms_pData + ms->ms_ulPos,buffer,size);
+      ms->ms_ulPos += size;
+      if (ms->ms_ulPos > ms->ms_ulSize)
+        ms->ms_ulSize = ms->ms_ulPos;
+      return size;
+    }
+    break;
+  case JPGFLAG_ACTION_SEEK:
+    {
+      LONG mode   = tags->GetTagData(JPGTAG_FIO_SEEKMODE);
+      LONG offset = tags->GetTagData(JPGTAG_FIO_OFFSET);
+
+      switch(mode) {
+      case JPGFLAG_OFFSET_CURRENT:
+        offset += ms->ms_ulPos;
+        break;
+      case JPGFLAG_OFFSET_END:
+        offset += ms->ms_ulSize;
+        break;
+      }
+      if (offset < 0 || ULONG(offset) > ms->ms_ulSize)
+        return -1;
+      ms->ms_ulPos = offset;
+      return 0;
+    }
+    break;
+  case JPGFLAG_ACTION_QUERY:
+    return 0;
+  }
+  return -1;
+}
+///
+
+/// FrameHook
+// The bitmap hook function. As the complete image is in memory, it
+// always delivers the full frame and lets the library pick the
+// requested rectangle from it.
+static JPG_LONG FrameHook(struct JPG_Hook *hook, struct JPG_TagItem *tags)
+{
+  struct Frame *frame = (struct Frame *)(hook->hk_pData);
+  UWORD comp          = tags->GetTagData(JPGTAG_BIO_COMPONENT);
+
+  if (tags->GetTagData(JPGTAG_BIO_ACTION) == JPGFLAG_BIO_REQUEST) {
+    tags->SetTagPtr(JPGTAG_BIO_MEMORY        ,frame->fr_pData + comp);
+    tags->SetTagData(JPGTAG_BIO_WIDTH        ,frame->fr_ulWidth);
+    tags->SetTagData(JPGTAG_BIO_HEIGHT       ,frame->fr_ulHeight);
+    tags->SetTagData(JPGTAG_BIO_BYTESPERROW  ,frame->fr_ulWidth * frame->fr_ucDepth);
+    tags->SetTagData(JPGTAG_BIO_BYTESPERPIXEL,frame->fr_ucDepth);
+    tags->SetTagData(JPGTAG_BIO_PIXELTYPE    ,CTYP_UBYTE);
+  }
+  return 0;
+}
+///
+
+/// CreateFrame
+// Allocate an image of the given dimensions, and fill it with a pattern
+// of smooth gradients, edges and noise if requested.
+static bool CreateFrame(struct Frame *frame,ULONG width,ULONG height,UBYTE depth,bool fill)
+{
+  frame->fr_ulWidth  = width;
+  frame->fr_ulHeight = height;
+  frame->fr_ucDepth  = depth;
+  frame->fr_pData    = (UBYTE *)calloc(size_t(width) * height * depth,1);
+
+  if (frame->fr_pData && fill) {
+    ULONG seed = 1;
+    ULONG x,y;
+    UBYTE c;
+    UBYTE *p   = frame->fr_pData;
+    for(y = 0;y < height;y++) {
+      for(x = 0;x < width;x++) {
+        for(c = 0;c < depth;c++) {
+          LONG v = (x * 255) / width * (c + 1) / depth + (y * 128) / height;
+          seed   = seed * 1103515245UL + 12345UL;
+          v     += ((seed >> 16) & 15) - 8;
+          if (((x >> 4) + (y >> 4) + c) & 1)
+            v   ^= 0x40;
+          *p++   = (v < 0)?(0):((v > 255)?(255):(v));
+        }
+      }
+    }
+  }
+
+  return (frame->fr_pData != NULL);
+}
+///
+
+/// SameFrame
+// Check whether two frames are identical.
+static bool SameFrame(const struct Frame *a,const struct Frame *b)
+{
+  return !memcmp(a->fr_pData,b->fr_pData,size_t(a->fr_ulWidth) * a->fr_ulHeight * a->fr_ucDepth);
+}
+///
+
+/// ReportError
+// Print the last error of the library.
+static void ReportError(class JPEG *jpeg,const char *what)
+{
+  const char *error;
+  int code = jpeg->LastError(error);
+  fprintf(stderr,"%s failed - error %d - %s\n",what,code,error);
+}
+///
+
+/// Encode
+// Encode the image in the given configuration into the memory stream,
+// possibly serving small allocations from the memory pool.
+static bool Encode(const struct Configuration *cf,struct Frame *frame,struct MemoryStream *ms,bool pooled)
+{
+  bool ok = false;
+  struct JPG_Hook bmhook(FrameHook,frame);
+  struct JPG_Hook iohook(MemoryHook,ms);
+  UBYTE subx[3] = {1,cf->cf_ucSubX,cf->cf_ucSubX};
+  UBYTE suby[3] = {1,cf->cf_ucSubY,cf->cf_ucSubY};
+  struct JPG_TagItem pscan1[] = { // The DC scan.
+    JPG_ValueTag(JPGTAG_SCAN_SPECTRUM_START,0),
+    JPG_ValueTag(JPGTAG_SCAN_SPECTRUM_STOP,0),
+    JPG_EndTag
+  };
+  struct JPG_TagItem pscan2[] = {
+    JPG_ValueTag(JPGTAG_SCAN_COMPONENT0,0),
+    JPG_ValueTag(JPGTAG_SCAN_SPECTRUM_START,1),
+    JPG_ValueTag(JPGTAG_SCAN_SPECTRUM_STOP,5),
+    JPG_EndTag
+  };
+  struct JPG_TagItem pscan3[] = {
+    JPG_ValueTag(JPGTAG_SCAN_COMPONENTS_CHROMA,0),
+    JPG_ValueTag(JPGTAG_SCAN_SPECTRUM_START,1),
+    JPG_ValueTag(JPGTAG_SCAN_SPECTRUM_STOP,63),
+    JPG_EndTag
+  };
+  struct JPG_TagItem pscan4[] = {
+    JPG_ValueTag(JPGTAG_SCAN_COMPONENT0,0),
+    JPG_ValueTag(JPGTAG_SCAN_SPECTRUM_START,6),
+    JPG_ValueTag(JPGTAG_SCAN_SPECTRUM_STOP,63),
+    JPG_EndTag
+  };
+  bool progressive = (cf->cf_iFrameType & 7) == JPGFLAG_PROGRESSIVE;
+  struct JPG_TagItem tags[] = {
+    JPG_PointerTag(JPGTAG_BIH_HOOK,&bmhook),
+    JPG_ValueTag(JPGTAG_ENCODER_LOOP_ON_INCOMPLETE,true),
+    JPG_ValueTag(JPGTAG_IMAGE_WIDTH,frame->fr_ulWidth),
+    JPG_ValueTag(JPGTAG_IMAGE_HEIGHT,frame->fr_ulHeight),
+    JPG_ValueTag(JPGTAG_IMAGE_DEPTH,frame->fr_ucDepth),
+    JPG_ValueTag(JPGTAG_IMAGE_PRECISION,8),
+    JPG_ValueTag(JPGTAG_IMAGE_FRAMETYPE,cf->cf_iFrameType),
+    JPG_ValueTag(JPGTAG_IMAGE_QUALITY,85),
+    JPG_ValueTag(JPGTAG_IMAGE_RESOLUTIONLEVELS,cf->cf_iLevels),
+    JPG_ValueTag(JPGTAG_MATRIX_LTRAFO,JPGFLAG_MATRIX_COLORTRANSFORMATION_YCBCR),
+    JPG_PointerTag(JPGTAG_IMAGE_SUBX,subx),
+    JPG_PointerTag(JPGTAG_IMAGE_SUBY,suby),
+    JPG_PointerTag(progressive?JPGTAG_IMAGE_SCAN:JPGTAG_TAG_IGNORE,pscan1),
+    JPG_PointerTag(progressive?JPGTAG_IMAGE_SCAN:JPGTAG_TAG_IGNORE,pscan2),
+    JPG_PointerTag(progressive?JPGTAG_IMAGE_SCAN:JPGTAG_TAG_IGNORE,pscan3),
+    JPG_PointerTag(progressive?JPGTAG_IMAGE_SCAN:JPGTAG_TAG_IGNORE,pscan4),
+    JPG_EndTag
+  };
+  struct JPG_TagItem iotags[] = {
+    JPG_PointerTag(JPGTAG_HOOK_IOHOOK,&iohook),
+    JPG_PointerTag(JPGTAG_HOOK_IOSTREAM,ms),
+    JPG_EndTag
+  };
+  struct JPG_TagItem ctags[] = {
+    JPG_ValueTag(JPGTAG_MIO_POOLED,pooled),
+    JPG_EndTag
+  };
+  class JPEG *jpeg = JPEG::Construct(ctags);
+
+  if (jpeg) {
+    ms->ms_ulSize = 0;
+    ms->ms_ulPos  = 0;
+    ok = jpeg->ProvideImage(tags) && jpeg->Write(iotags);
+    if (!ok)
+      ReportError(jpeg,"encoding");
+    JPEG::Destruct(jpeg);
+  }
+
+  return ok;
+}
+///
+
+/// Decode
+// Decode the codestream in the memory stream into the frame, delivering
+// the image in stripes of eight lines through the bitmap hook. The
+// codestream is either read through the IO hook or handed over to the
+// library as a buffer, and small allocations possibly come from the
+// memory pool.
+static bool Decode(struct MemoryStream *ms,struct Frame *frame,bool pooled,bool buffered)
+{
+  bool ok = false;
+  struct JPG_Hook bmhook(FrameHook,frame);
+  struct JPG_Hook iohook(MemoryHook,ms);
+  struct JPG_TagItem iotags[] = {
+    JPG_PointerTag((buffered)?(JPGTAG_TAG_IGNORE):(JPGTAG_HOOK_IOHOOK),&iohook),
+    JPG_PointerTag((buffered)?(JPGTAG_TAG_IGNORE):(JPGTAG_HOOK_IOSTREAM),ms),
+    JPG_PointerTag((buffered)?(JPGTAG_HOOK_INPUTBUFFER):(JPGTAG_TAG_IGNORE),ms->ms_pData),
+    JPG_ValueTag((buffered)?(JPGTAG_HOOK_INPUTSIZE):(JPGTAG_TAG_IGNORE),ms->ms_ulSize),
+    JPG_EndTag
+  };
+  struct JPG_TagItem ctags[] = {
+    JPG_ValueTag(JPGTAG_MIO_POOLED,pooled),
+    JPG_EndTag
+  };
+  struct JPG_TagItem tags[] = {
+    JPG_PointerTag(JPGTAG_BIH_HOOK,&bmhook),
+    JPG_ValueTag(JPGTAG_DECODER_MINY,0),
+    JPG_ValueTag(JPGTAG_DECODER_MAXY,7),
+    JPG_ValueTag(JPGTAG_DECODER_UPSAMPLE,true),
+    JPG_EndTag
+  };
+  class JPEG *jpeg = JPEG::Construct(ctags);
+
+  if (jpeg) {
+    ms->ms_ulPos = 0;
+    ok = jpeg->Read(iotags);
+    if (ok) {
+      ULONG y;
+      for(y = 0;y < frame->fr_ulHeight && ok;y += 8) {
+        tags[1].ti_Data.ti_lData = y;
+        tags[2].ti_Data.ti_lData = y + 7;
+        ok = jpeg->DisplayRectangle(tags);
+      }
+    }
+    if (!ok)
+      ReportError(jpeg,"decoding");
+    JPEG::Destruct(jpeg);
+  }
+
+  return ok;
+}
+///
+
+/// DisplayAfterSteps
+// Decode the given number of MCU rows on a fresh decoder and display
+// the image as a whole into the frame. This is the reference of the
+// incremental display check. Sets done if the codestream is exhausted
+// afterwards.
+static bool DisplayAfterSteps(struct MemoryStream *ms,ULONG steps,struct Frame *frame,bool &done)
+{
+  bool ok = false;
+  struct JPG_Hook iohook(MemoryHook,ms);
+  struct JPG_TagItem tags[] = {
+    JPG_PointerTag(JPGTAG_HOOK_IOHOOK,&iohook),
+    JPG_PointerTag(JPGTAG_HOOK_IOSTREAM,ms),
+    JPG_ValueTag(JPGTAG_DECODER_STOP,JPGFLAG_DECODER_STOP_ROW),
+    JPG_EndTag
+  };
+  struct JPG_TagItem dtags[] = {
+    JPG_PointerTag(JPGTAG_BIO_MEMORY,frame->fr_pData),
+    JPG_ValueTag(JPGTAG_BIO_FULLFRAME,true),
+    JPG_ValueTag(JPGTAG_BIO_WIDTH,frame->fr_ulWidth),
+    JPG_ValueTag(JPGTAG_BIO_HEIGHT,frame->fr_ulHeight),
+    JPG_ValueTag(JPGTAG_BIO_BYTESPERROW,frame->fr_ulWidth * frame->fr_ucDepth),
+    JPG_ValueTag(JPGTAG_BIO_BYTESPERPIXEL,frame->fr_ucDepth),
+    JPG_ValueTag(JPGTAG_BIO_PIXELTYPE,CTYP_UBYTE),
+    JPG_ValueTag(JPGTAG_DECODER_MINY,0),
+    JPG_ValueTag(JPGTAG_DECODER_MAXY,frame->fr_ulHeight - 1),
+    JPG_ValueTag(JPGTAG_DECODER_UPSAMPLE,true),
+    JPG_EndTag
+  };
+  class JPEG *jpeg = JPEG::Construct(NULL);
+
+  if (jpeg) {
+    ULONG i;
+    //
+    ms->ms_ulPos = 0;
+    ok = true;
+    for(i = 0;i < steps && ok;i++)
+      ok = jpeg->Read(tags);
+    if (ok)
+      ok = jpeg->DisplayRectangle(dtags);
+    if (ok)
+      done = (jpeg->PeekMarker(NULL) == -1);
+    if (!ok)
+      ReportError(jpeg,"decoding the reference image");
+    JPEG::Destruct(jpeg);
+  }
+
+  return ok;
+}
+///
+
+/// CheckPooled
+// Encode and decode again with small allocations served from the
+// memory pool. Neither the codestream nor the image may change.
+// Returns the number of mismatches.
+static int CheckPooled(const struct Configuration *cf,struct Frame *source,
+                       struct MemoryStream *ms,const struct Frame *reference)
+{
+  struct MemoryStream pms = {NULL,0,0,0};
+  struct Frame decoded;
+  int errors = 0;
+
+  if (!CreateFrame(&decoded,reference->fr_ulWidth,reference->fr_ulHeight,reference->fr_ucDepth,false)) {
+    fprintf(stderr,"unable to allocate memory to buffer the image\n");
+    return 1;
+  }
+  //
+  if (!Encode(cf,source,&pms,true)) {
+    errors++;
+  } else if (pms.ms_ulSize != ms->ms_ulSize || memcmp(pms.ms_pData,ms->ms_pData,ms->ms_ulSize)) {
+    fprintf(stderr,"pooled encoding differs from the regular encoding\n");
+    errors++;
+  }
+  //
+  if (!Decode(ms,&decoded,true,false)) {
+    errors++;
+  } else if (!SameFrame(&decoded,reference)) {
+    fprintf(stderr,"pooled decoding differs from the regular decoding\n");
+    errors++;
+  }
+  //
+  free(pms.ms_pData);
+  free(decoded.fr_pData);
+
+  return errors;
+}
+///
+
+/// CheckBuffered
+// Decode the codestream handed over as a buffer rather than through
+// the IO hook, with and without the memory pool. The image may not
+// change. Returns the number of mismatches.
+static int CheckBuffered(struct MemoryStream *ms,const struct Frame *reference)
+{
+  struct Frame decoded;
+  int errors = 0;
+  int pooled;
+
+  if (!CreateFrame(&decoded,reference->fr_ulWidth,reference->fr_ulHeight,reference->fr_ucDepth,false)) {
+    fprintf(stderr,"unable to allocate memory to buffer the image\n");
+    return 1;
+  }
+  //
+  for(pooled = 0;pooled < 2;pooled++) {
+    memset(decoded.fr_pData,0,size_t(decoded.fr_ulWidth) * decoded.fr_ulHeight * decoded.fr_ucDepth);
+    if (!Decode(ms,&decoded,pooled != 0,true)) {
+      errors++;
+    } else if (!SameFrame(&decoded,reference)) {
+      fprintf(stderr,"decoding from the buffer differs from the regular decoding\n");
+      errors++;
+    }
+  }
+  //
+  free(decoded.fr_pData);
+
+  return errors;
+}
+///
+
+/// CheckFullFrame
+// Decode the codestream completely and display the image with a single
+// full frame request. The image may not differ from the stripe-wise
+// decoding. Returns the number of mismatches.
+static int CheckFullFrame(struct MemoryStream *ms,const struct Frame *reference)
+{
+  struct Frame decoded;
+  struct JPG_Hook iohook(MemoryHook,ms);
+  struct JPG_TagItem tags[] = {
+    JPG_PointerTag(JPGTAG_HOOK_IOHOOK,&iohook),
+    JPG_PointerTag(JPGTAG_HOOK_IOSTREAM,ms),
+    JPG_EndTag
+  };
+  class JPEG *jpeg;
+  int errors = 0;
+
+  if (!CreateFrame(&decoded,reference->fr_ulWidth,reference->fr_ulHeight,reference->fr_ucDepth,false)) {
+    fprintf(stderr,"unable to allocate memory to buffer the image\n");
+    return 1;
+  }
+  //
+  jpeg = JPEG::Construct(NULL);
+  if (jpeg) {
+    struct JPG_TagItem dtags[] = {
+      JPG_PointerTag(JPGTAG_BIO_MEMORY,decoded.fr_pData),
+      JPG_ValueTag(JPGTAG_BIO_FULLFRAME,true),
+      JPG_ValueTag(JPGTAG_BIO_WIDTH,decoded.fr_ulWidth),
+      JPG_ValueTag(JPGTAG_BIO_HEIGHT,decoded.fr_ulHeight),
+      JPG_ValueTag(JPGTAG_BIO_BYTESPERROW,decoded.fr_ulWidth * decoded.fr_ucDepth),
+      JPG_ValueTag(JPGTAG_BIO_BYTESPERPIXEL,decoded.fr_ucDepth),
+      JPG_ValueTag(JPGTAG_BIO_PIXELTYPE,CTYP_UBYTE),
+      JPG_ValueTag(JPGTAG_DECODER_MINY,0),
+      JPG_ValueTag(JPGTAG_DECODER_MAXY,decoded.fr_ulHeight - 1),
+      JPG_ValueTag(JPGTAG_DECODER_UPSAMPLE,true),
+      JPG_EndTag
+    };
+    //
+    ms->ms_ulPos = 0;
+    if (!jpeg->Read(tags) || !jpeg->DisplayRectangle(dtags)) {
+      ReportError(jpeg,"full frame decoding");
+      errors++;
+    } else if (!SameFrame(&decoded,reference)) {
+      fprintf(stderr,"full frame display differs from the regular decoding\n");
+      errors++;
+    }
+    JPEG::Destruct(jpeg);
+  } else {
+    errors++;
+  }
+  //
+  free(decoded.fr_pData);
+
+  return errors;
+}
+///
+
+/// CheckIncremental
+// Decode the image MCU row by MCU row, display it incrementally after
+// each row and compare the result to a full display of a fresh decoder
+// stopped at the same row. The final incremental display must also
+// match the regular decoding. Returns the number of mismatches.
+// The references are all computed upfront as the memory bookkeeping of
+// debug builds does not allow two JPEG objects at once.
+static int CheckIncremental(struct MemoryStream *ms,const struct Frame *reference)
+{
+  int errors = 0;
+  ULONG width  = reference->fr_ulWidth;
+  ULONG height = reference->fr_ulHeight;
+  UBYTE depth  = reference->fr_ucDepth;
+  ULONG steps  = 0;
+  struct Frame *full = NULL;
+  struct Frame inc;
+  bool done = false;
+  class JPEG *jpeg;
+
+  if (!CreateFrame(&inc,width,height,depth,false)) {
+    fprintf(stderr,"unable to allocate memory to buffer the image\n");
+    return 1;
+  }
+  //
+  // First collect the references, one per step.
+  while(!done) {
+    struct Frame *grown = (struct Frame *)realloc(full,(steps + 1) * sizeof(struct Frame));
+    if (grown == NULL) {
+      errors++;
+      break;
+    }
+    full = grown;
+    if (!CreateFrame(full + steps,width,height,depth,false)) {
+      errors++;
+      break;
+    }
+    steps++;
+    if (!DisplayAfterSteps(ms,steps,full + steps - 1,done)) {
+      errors++;
+      break;
+    }
+  }
+  //
+  if (errors == 0) {
+    jpeg = JPEG::Construct(NULL);
+    if (jpeg) {
+      struct JPG_Hook iohook(MemoryHook,ms);
+      struct JPG_TagItem tags[] = {
+        JPG_PointerTag(JPGTAG_HOOK_IOHOOK,&iohook),
+        JPG_PointerTag(JPGTAG_HOOK_IOSTREAM,ms),
+        JPG_ValueTag(JPGTAG_DECODER_STOP,JPGFLAG_DECODER_STOP_ROW),
+        JPG_EndTag
+      };
+      struct JPG_TagItem dtags[] = {
+        JPG_PointerTag(JPGTAG_BIO_MEMORY,inc.fr_pData),
+        JPG_ValueTag(JPGTAG_DECODER_INCREMENTAL,true),
+        JPG_ValueTag(JPGTAG_BIO_FULLFRAME,true),
+        JPG_ValueTag(JPGTAG_BIO_WIDTH,width),
+        JPG_ValueTag(JPGTAG_BIO_HEIGHT,height),
+        JPG_ValueTag(JPGTAG_BIO_BYTESPERROW,width * depth),
+        JPG_ValueTag(JPGTAG_BIO_BYTESPERPIXEL,depth),
+        JPG_ValueTag(JPGTAG_BIO_PIXELTYPE,CTYP_UBYTE),
+        JPG_ValueTag(JPGTAG_DECODER_MINY,0),
+        JPG_ValueTag(JPGTAG_DECODER_MAXY,height - 1),
+        JPG_ValueTag(JPGTAG_DECODER_UPSAMPLE,true),
+        JPG_EndTag
+      };
+      ULONG i;
+      bool ok = true;
+      //
+      ms->ms_ulPos = 0;
+      for(i = 0;i < steps && ok;i++) {
+        ok = jpeg->Read(tags) && jpeg->DisplayRectangle(dtags);
+        if (ok && !SameFrame(&inc,full + i)) {
+          fprintf(stderr,"incremental display differs from the full display after row %lu\n",
+                  (unsigned long)(i + 1));
+          errors++;
+        }
+      }
+      if (!ok) {
+        ReportError(jpeg,"incremental decoding");
+        errors++;
+      } else if (jpeg->PeekMarker(NULL) != -1) {
+        fprintf(stderr,"incremental decoding did not reach the end of the codestream\n");
+        errors++;
+      } else if (!SameFrame(&inc,reference)) {
+        fprintf(stderr,"final incremental display differs from the decoded image\n");
+        errors++;
+      }
+      JPEG::Destruct(jpeg);
+    } else {
+      errors++;
+    }
+  }
+
+  while(steps--)
+    free(full[steps].fr_pData);
+  free(full);
+  free(inc.fr_pData);
+
+  return errors;
+}
+///
+
+/// main
+// Run all checks on all configurations, return non-zero if any fails.
+int main(int,char **)
+{
+  const struct Configuration *cf;
+  int failures = 0;
+
+  for(cf = Configurations;cf->cf_pName;cf++) {
+    struct MemoryStream ms = {NULL,0,0,0};
+    struct Frame source,decoded;
+    int errors = 0;
+    //
+    if (!CreateFrame(&source,CHECK_WIDTH,CHECK_HEIGHT,cf->cf_ucDepth,true) ||
+        !CreateFrame(&decoded,CHECK_WIDTH,CHECK_HEIGHT,cf->cf_ucDepth,false)) {
+      fprintf(stderr,"unable to allocate memory to buffer the image\n");
+      return 1;
+    }
+    //
+    if (!Encode(cf,&source,&ms,false) || !Decode(&ms,&decoded,false,false)) {
+      errors++;
+    } else {
+      errors += CheckPooled(cf,&source,&ms,&decoded);
+      errors += CheckBuffered(&ms,&decoded);
+      errors += CheckFullFrame(&ms,&decoded);
+      // Incremental display is not available for hierarchical frames.
+      if ((cf->cf_iFrameType & JPGFLAG_PYRAMIDAL) == 0)
+        errors += CheckIncremental(&ms,&decoded);
+    }
+    //
+    printf("%-24s: %s\n",cf->cf_pName,(errors)?("FAILED"):("ok"));
+    if (errors)
+      failures++;
+    //
+    free(ms.ms_pData);
+    free(source.fr_pData);
+    free(decoded.fr_pData);
+  }
+
+  if (failures) {
+    printf("%d of the configurations failed\n",failures);
+    return 1;
+  }
+  return 0;
+}
+///
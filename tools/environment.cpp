@@ -57,6 +57,9 @@
 #include "std/stddef.hpp"
 #include "std/string.hpp"
 #include "tools/debug.hpp"
+#include "tools/workerpool.hpp"
+#include "tools/memorypool.hpp"
+#include "coding/tablecache.hpp"
 ///
 
 /// Defines
@@ -167,7 +170,7 @@ static void PrintHist(void)
 // Tag-List constructor of the environment
 Environ::Environ(struct JPG_TagItem *tags)
   : m_First(), m_Root(&m_First), m_WarnRoot(&m_First), 
-    m_pParent(NULL)
+    m_pPool(NULL), m_pParent(NULL)
 {
   // Now fill in the hooks from the supplied tag list
   if (tags) {
@@ -178,14 +181,21 @@ Environ::Environ(struct JPG_TagItem *tags)
     m_pWarningHook      = (struct JPG_Hook *)tags->GetTagPtr(JPGTAG_EXC_WARNING_HOOK); 
     m_bSuppressMultiple = tags->GetTagData(JPGTAG_EXC_SUPPRESS_IDENTICAL)?true:false;
     //
+    m_ulWorkerThreads   = tags->GetTagData(JPGTAG_THREAD_COUNT);
+    m_bUsePool          = tags->GetTagData(JPGTAG_MIO_POOLED)?true:false;
   } else {
     m_pAllocationHook   = NULL;
     m_pReleaseHook      = NULL;
     m_pExceptionHook    = NULL;
     m_pWarningHook      = NULL; 
     m_bSuppressMultiple = true;
+    m_ulWorkerThreads   = 0;
+    m_bUsePool          = false;
   }
+  m_pWorkerPool         = NULL;
+  m_pTableCache         = NULL;
   //
+  BuildConcurrencyLock();
   //
   // Now fill in the tags for the allocator
   m_AllocationTags[0].ti_Tag = JPGTAG_MIO_SIZE;
@@ -261,6 +271,21 @@ class Environ &Environ::operator=(class Environ &env)
   m_pExceptionHook           = env.m_pExceptionHook;
   m_pWarningHook             = env.m_pWarningHook;
   //
+  // The pool remains with the source, it is only built on demand.
+  m_ulWorkerThreads          = env.m_ulWorkerThreads;
+  m_pWorkerPool              = NULL;
+  m_pTableCache              = NULL;
+  //
+  // The target is not necessarily constructed, see JPEG::Construct(),
+  // hence the lock is built here and not in the constructor.
+  BuildConcurrencyLock();
+  //
+  // The memory pool moves over, the source must no longer allocate.
+  // As above, whatever the target held here is garbage.
+  m_bUsePool                 = env.m_bUsePool;
+  m_pPool                    = env.m_pPool;
+  env.m_pPool                = NULL;
+  //
   // Now fill in the tags for the allocator
   m_AllocationTags[0].ti_Tag = JPGTAG_MIO_SIZE;
   m_AllocationTags[1].ti_Tag = JPGTAG_MIO_TYPE;
@@ -307,7 +332,8 @@ class Environ &Environ::operator=(class Environ &env)
 // Clone the exception from another exception to create an identically working
 // copy for a side-thread, but with an empty exception stack.
 Environ::Environ(class Environ *env)
-  : m_First(), m_Root(&m_First), m_WarnRoot(&m_First), m_pParent(env)
+  : m_First(), m_Root(&m_First), m_WarnRoot(&m_First), m_pPool(NULL), m_bUsePool(false),
+    m_pParent(env)
 {  
   //
   // Check whether we are creating environment trees, i.e. the
@@ -326,6 +352,13 @@ Environ::Environ(class Environ *env)
   //
   m_bSuppressMultiple        = env->m_bSuppressMultiple;
   //
+  // Threads do not create threads on their own.
+  m_ulWorkerThreads          = 0;
+  m_pWorkerPool              = NULL;
+  m_pTableCache              = NULL;
+  //
+  BuildConcurrencyLock();
+  //
   // Now fill in the tags for the allocator
   m_AllocationTags[0].ti_Tag = JPGTAG_MIO_SIZE;
   m_AllocationTags[1].ti_Tag = JPGTAG_MIO_TYPE;
@@ -386,6 +419,15 @@ Environ::~Environ(void)
     // Merge the warnings.
     m_pParent->MergeWarningQueueFrom(this);
   }
+  //
+  // Release cached tables and the slabs unless this happened already.
+  DisposeTableCache();
+  DisposePool();
+  //
+#ifdef HAVE_WORKER_THREADS
+  assert(m_ulConcurrentJobs == 0);
+  pthread_mutex_destroy(&m_ConcurrencyLock);
+#endif
   //
   // Check if this was a copy that was made for a side-thread.
   if (m_Root.m_pActive && m_pParent == NULL) {
@@ -416,6 +458,145 @@ Environ::~Environ(void)
 }
 ///
 
+/// Environ::BuildPool
+// This is part of the delayed construction: Provide the memory pool if
+// requested. Child environments of worker threads never use the pool.
+void Environ::BuildPool(void)
+{
+  if (m_bUsePool && m_pPool == NULL && m_pParent == NULL) {
+    class Environ *m_pEnviron = this;
+    //
+    m_pPool = new(m_pEnviron) class MemoryPool(m_pEnviron);
+  }
+}
+///
+
+/// Environ::DisposePool
+// Release the memory pool and all memory it keeps. This must
+// only be called if no pooled memory is in use anymore.
+void Environ::DisposePool(void)
+{
+  class MemoryPool *pool = m_pPool;
+  //
+  // The pool itself and its slabs are not pooled.
+  m_pPool = NULL;
+  delete pool;
+}
+///
+
+/// Environ::WorkerPoolOf
+// Return the pool of worker threads for parallel coding, or NULL
+// if all work has to be done in the calling thread.
+class WorkerPool *Environ::WorkerPoolOf(void)
+{
+  // Jobs do not start jobs on their own, they run in the calling thread.
+  if (DelegateOf() != this)
+    return NULL;
+  //
+  if (m_pWorkerPool == NULL && m_ulWorkerThreads > 1 && m_pParent == NULL) {
+    class Environ *m_pEnviron = this;
+    //
+    m_pWorkerPool = new(m_pEnviron) class WorkerPool(m_pEnviron,m_ulWorkerThreads);
+    if (m_pWorkerPool->ThreadsOf() == 0) {
+      // Threading is either not available or the system
+      // refused to create threads. Do not try again.
+      delete m_pWorkerPool;
+      m_pWorkerPool     = NULL;
+      m_ulWorkerThreads = 0;
+    }
+  }
+
+  return m_pWorkerPool;
+}
+///
+
+/// Environ::DisposeWorkerPool
+// Release the worker pool and terminate its threads.
+void Environ::DisposeWorkerPool(void)
+{
+  delete m_pWorkerPool;
+  m_pWorkerPool = NULL;
+}
+///
+
+/// Environ::TableCacheOf
+// Return the cache of tables that may be shared between images,
+// possibly between all objects of the process.
+class TableCache *Environ::TableCacheOf(void)
+{
+  if (m_pTableCache == NULL && m_pParent == NULL && DelegateOf() == this)
+    m_pTableCache = TableCache::Attach(this);
+
+  return m_pTableCache;
+}
+///
+
+/// Environ::DisposeTableCache
+// Detach from the table cache.
+void Environ::DisposeTableCache(void)
+{
+  TableCache::Detach(m_pTableCache);
+  m_pTableCache = NULL;
+}
+///
+
+/// Environ::BuildConcurrencyLock
+// Create the lock for concurrent jobs, if there is one.
+void Environ::BuildConcurrencyLock(void)
+{
+#ifdef HAVE_WORKER_THREADS
+  pthread_mutexattr_t attr;
+  //
+  // Allocating memory may require the memory pool to allocate a new
+  // slab, hence the lock must be recursive.
+  pthread_mutexattr_init(&attr);
+  pthread_mutexattr_settype(&attr,PTHREAD_MUTEX_RECURSIVE);
+  pthread_mutex_init(&m_ConcurrencyLock,&attr);
+  pthread_mutexattr_destroy(&attr);
+  m_ulConcurrentJobs = 0;
+#endif
+}
+///
+
+/// Environ::BeginConcurrentJob
+// Start a job that acts on objects of this environment from
+// a worker thread. Must be called from the thread owning this environment.
+void Environ::BeginConcurrentJob(void)
+{
+#ifdef HAVE_WORKER_THREADS
+  assert(m_pParent == NULL && m_pWorkerPool);
+  m_ulConcurrentJobs++;
+#endif
+}
+///
+
+/// Environ::EndConcurrentJob
+// The job started by the above completed.
+void Environ::EndConcurrentJob(void)
+{
+#ifdef HAVE_WORKER_THREADS
+  assert(m_ulConcurrentJobs > 0);
+  m_ulConcurrentJobs--;
+#endif
+}
+///
+
+/// Environ::ThreadEnvironOf
+// Find the environment of the calling thread, or return this
+// environment if the caller is not a worker.
+class Environ *Environ::ThreadEnvironOf(void)
+{
+#ifdef HAVE_WORKER_THREADS
+  if (m_pWorkerPool) {
+    class Environ *env = m_pWorkerPool->EnvironOfCaller();
+    if (env)
+      return env;
+  }
+#endif
+  return this;
+}
+///
+
 /// Environ::MergeWarningQueueFrom
 // Merge the contents of our warning queue from the
 // warning queue of the given environment.
@@ -453,6 +634,11 @@ void Environ::Throw(const LONG error,const char *what,const LONG line,
 void Environ::Throw(const class Exception &exc)
 {
   class ExceptionStack *es = m_Root.m_pActive;
+  class Environ *env       = DelegateOf();
+  //
+  // If this is called from a worker, the exception goes there.
+  if (env != this)
+    env->Throw(exc);
   //
   assert(es);
   assert(es->m_pPrevious);
@@ -482,6 +668,10 @@ void Environ::Throw(const class Exception &exc)
 void Environ::ReThrow(void)
 {
   class ExceptionStack *es = m_Root.m_pActive;
+  class Environ *env       = DelegateOf();
+  //
+  if (env != this)
+    env->ReThrow();
   //
   assert(es);
   assert(es->m_pPrevious);
@@ -557,7 +747,7 @@ void Environ::LowerToWarning(void)
 {
   // Just grab the data from the exception root and place it into
   // the warn root.
-  Warn(m_Root.m_Exception);
+  Warn(DelegateOf()->m_Root.m_Exception);
 }
 ///
 
@@ -575,6 +765,12 @@ void Environ::Warn(const LONG error,const char *what,const LONG line,
 /// Environ::Warn
 void Environ::Warn(const class Exception &exc)
 {  
+#ifdef HAVE_WORKER_THREADS
+  bool serialize = (m_ulConcurrentJobs > 0);
+  //
+  if (serialize)
+    pthread_mutex_lock(&m_ConcurrencyLock);
+#endif
   m_WarnRoot.m_Exception    = exc;
   //
   // Is the user warned about this exception already? If so,
@@ -586,6 +782,10 @@ void Environ::Warn(const class Exception &exc)
     // On debugging, print out the warning immediately
     PrintWarning();
   }
+#ifdef HAVE_WORKER_THREADS
+  if (serialize)
+    pthread_mutex_unlock(&m_ConcurrencyLock);
+#endif
 }
 ///
 
@@ -634,8 +834,8 @@ void Environ::NextWarning(void)
 }
 ///
 
-/// Environ::CoreAllocMem
-inline void *Environ::CoreAllocMem(ULONG bytesize,ULONG reqments)
+/// Environ::RawAllocMem
+inline void *Environ::RawAllocMem(ULONG bytesize,ULONG reqments)
 {
   // This is only thread-safe only if the user supplied
   // allocation hook is thread-safe. The HIST option is not,
@@ -653,7 +853,11 @@ inline void *Environ::CoreAllocMem(ULONG bytesize,ULONG reqments)
     bytesize += 2 * sizeof(Align);
 #endif
     //
-    if (m_pAllocationHook) {
+    if (m_pPool && bytesize <= MemoryPool::MaxChunkSize) {
+      // Small blocks come from the slabs. They are munged and
+      // accounted for below as any other block.
+      mem = m_pPool->Alloc(bytesize);
+    } else if (m_pAllocationHook) {
       // Fill in the tags by hand. This must be rather fast, so we
       // do it the nasty way.
       m_AllocationTags[0].ti_Data.ti_lData = bytesize;
@@ -713,9 +917,9 @@ inline void *Environ::CoreAllocMem(ULONG bytesize,ULONG reqments)
 }
 ///
 
-/// Environ::CoreFreeMem
+/// Environ::RawFreeMem
 // Free a memory block
-inline void Environ::CoreFreeMem(void *mem,ULONG bytesize)
+inline void Environ::RawFreeMem(void *mem,ULONG bytesize)
 {
   // This is only thread-safe only if the user supplied
   // allocation hook is thread-safe. The HIST option is not,
@@ -756,7 +960,10 @@ inline void Environ::CoreFreeMem(void *mem,ULONG bytesize)
 #endif
     //
     //
-    if (m_pReleaseHook) {
+    if (m_pPool && bytesize <= MemoryPool::MaxChunkSize) {
+      // Return small blocks to their slab.
+      m_pPool->Free(mem,bytesize);
+    } else if (m_pReleaseHook) {
       struct JPG_TagItem release[4];
       // Fill in the tags by hand. This must be rather fast, so we
       // do it the nasty way.
@@ -778,6 +985,65 @@ inline void Environ::CoreFreeMem(void *mem,ULONG bytesize)
 }
 ///
 
+/// Environ::SerializedAllocMem
+// Allocate memory while worker threads may do the same.
+#ifdef HAVE_WORKER_THREADS
+void *Environ::SerializedAllocMem(ULONG bytesize,ULONG reqments)
+{
+  class Environ *m_pEnviron = this; // for the macros.
+  void *volatile mem        = NULL;
+  //
+  pthread_mutex_lock(&m_ConcurrencyLock);
+  JPG_TRY {
+    mem = RawAllocMem(bytesize,reqments);
+  } JPG_CATCH {
+    pthread_mutex_unlock(&m_ConcurrencyLock);
+    JPG_RETHROW;
+  } JPG_ENDTRY;
+  pthread_mutex_unlock(&m_ConcurrencyLock);
+  //
+  return mem;
+}
+#endif
+///
+
+/// Environ::SerializedFreeMem
+// Release memory while worker threads may allocate or release as well.
+#ifdef HAVE_WORKER_THREADS
+void Environ::SerializedFreeMem(void *mem,ULONG bytesize)
+{
+  pthread_mutex_lock(&m_ConcurrencyLock);
+  RawFreeMem(mem,bytesize);
+  pthread_mutex_unlock(&m_ConcurrencyLock);
+}
+#endif
+///
+
+/// Environ::CoreAllocMem
+inline void *Environ::CoreAllocMem(ULONG bytesize,ULONG reqments)
+{
+#ifdef HAVE_WORKER_THREADS
+  if (unlikely(m_ulConcurrentJobs))
+    return SerializedAllocMem(bytesize,reqments);
+#endif
+  return RawAllocMem(bytesize,reqments);
+}
+///
+
+/// Environ::CoreFreeMem
+// Free a memory block
+inline void Environ::CoreFreeMem(void *mem,ULONG bytesize)
+{
+#ifdef HAVE_WORKER_THREADS
+  if (unlikely(m_ulConcurrentJobs)) {
+    SerializedFreeMem(mem,bytesize);
+    return;
+  }
+#endif
+  RawFreeMem(mem,bytesize);
+}
+///
+
 /// Environ::AllocVec
 void *Environ::AllocVec(size_t bytesize,ULONG requirements)
 {
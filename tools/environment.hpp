@@ -62,6 +62,7 @@
 #include "interface/parameters.hpp"
 #include "std/stdlib.hpp"
 #include "std/setjmp.hpp"
+#include "std/pthread.hpp"
 #include "debug.hpp"
 #define NOREF(x) do {const void *y = &x;y=y;} while(0)
 ///
@@ -69,6 +70,8 @@
 /// Forward declarations
 class Environ;
 class ExceptionRoot;
+class WorkerPool;
+class TableCache;
 ///
 
 /// Exception
@@ -509,6 +512,9 @@ private:
   // The memory pool, manages small memory allocations.
   class MemoryPool      *m_pPool;
   //
+  // Set if the pool shall be built at all.
+  bool                   m_bUsePool;
+  //
   // In case this environment is a thread-local environment,
   // here's the root.
   class Environ         *m_pParent;
@@ -530,6 +536,27 @@ private:
   // Thread creation, mutex and semaphores.
   struct JPG_Hook       *m_pThreadHook;
   struct JPG_Hook       *m_pMutexHook;
+  //
+  // Number of worker threads the library may use. Zero or one
+  // means that everything runs in the calling thread.
+  ULONG                  m_ulWorkerThreads;
+  //
+  // The pool of worker threads, created on demand.
+  class WorkerPool      *m_pWorkerPool;
+  //
+  // Tables that can be re-used by later images, attached on demand.
+  class TableCache      *m_pTableCache;
+  //
+#ifdef HAVE_WORKER_THREADS
+  // Number of jobs that currently act on objects of this environment
+  // from a worker thread. While non-zero, memory management and warnings
+  // are serialized, and exceptions raised within a worker go to the
+  // exception stack of the worker.
+  volatile ULONG         m_ulConcurrentJobs;
+  //
+  // The (recursive) lock that serializes the above.
+  pthread_mutex_t        m_ConcurrencyLock;
+#endif
   //
   // For optimal performance, we pre-build the tag lists for
   // the allocation and release hooks:
@@ -565,6 +592,21 @@ private:
   // Internal memory allocation functions, not for public use.
   inline void *CoreAllocMem(ULONG bytesize,ULONG reqments);
   inline void CoreFreeMem(void *mem,ULONG bytesize);
+  inline void *RawAllocMem(ULONG bytesize,ULONG reqments);
+  inline void RawFreeMem(void *mem,ULONG bytesize);
+  //
+#ifdef HAVE_WORKER_THREADS
+  // Allocate and release memory while worker threads may do the same.
+  void *SerializedAllocMem(ULONG bytesize,ULONG reqments);
+  void SerializedFreeMem(void *mem,ULONG bytesize);
+#endif
+  //
+  // Create the lock for concurrent jobs, if there is one.
+  void BuildConcurrencyLock(void);
+  //
+  // Find the environment of the calling thread, or return this
+  // environment if the caller is not a worker.
+  class Environ *ThreadEnvironOf(void);
   //
   // Check whether the given warning (at the line and source file) is already
   // in the warning database. In case it is, return false. Otherwise, enter
@@ -584,7 +626,8 @@ public:
   // A copy-constructor: Beware, this makes the copied object unusable!
   Environ(class Environ &env)  
     : m_First(), m_Root(&m_First), m_WarnRoot(&m_First), 
-      m_pParent(NULL), m_bSuppressMultiple(true)
+      m_pPool(NULL), m_pParent(NULL), m_pWorkerPool(NULL), m_pTableCache(NULL),
+      m_bSuppressMultiple(true)
   {
     *this = env;
   }
@@ -597,6 +640,10 @@ public:
   // be called immediately after bootstrapping the environment. May throw.
   void BuildPool(void);
   //
+  // Release the memory pool and all memory it keeps. This must
+  // only be called if no pooled memory is in use anymore.
+  void DisposePool(void);
+  //
   // Destructor
   ~Environ(void);
   //
@@ -709,6 +756,40 @@ public:
   // warning queue of the given environment.
   void MergeWarningQueueFrom(class Environ *p);
   //
+  // Return the pool of worker threads for parallel coding, or NULL
+  // if all work has to be done in the calling thread. Child environments
+  // never provide a pool.
+  class WorkerPool *WorkerPoolOf(void);
+  //
+  // Release the worker pool and terminate its threads.
+  void DisposeWorkerPool(void);
+  //
+  // Return the cache of tables that may be shared between images,
+  // and between all objects of the process if the library is built
+  // for multithreading. Child environments never provide one,
+  // workers get their tables from their master. May return NULL.
+  class TableCache *TableCacheOf(void);
+  //
+  // Detach from the table cache, releasing it if this was its last user.
+  void DisposeTableCache(void);
+  //
+  // Start and end a job that acts on objects of this environment from
+  // a worker thread. Must be called from the thread owning this environment.
+  void BeginConcurrentJob(void);
+  void EndConcurrentJob(void);
+  //
+  // Return the environment exceptions raised on behalf of this
+  // environment have to go to. This is the environment of the worker
+  // if called from a concurrent job, or this environment otherwise.
+  class Environ *DelegateOf(void)
+  {
+#ifdef HAVE_WORKER_THREADS
+    if (unlikely(m_ulConcurrentJobs))
+      return ThreadEnvironOf();
+#endif
+    return this;
+  }
+  //
   // Test whether the exception stack is empty.
 #if CHECK_LEVEL > 0
   void TestExceptionStack(void)
@@ -724,9 +805,12 @@ public:
 
 /// ExceptionStack::ExceptionStack
 ExceptionStack::ExceptionStack(class Environ *env)
-  : m_pPrevious(env->m_Root.m_pActive), m_pRoot(&(env->m_Root))
 {
-  // Make our exception the topmost active one.
+  // Make our exception the topmost active one, in the
+  // environment of the calling thread.
+  env                   = env->DelegateOf();
+  m_pPrevious           = env->m_Root.m_pActive;
+  m_pRoot               = &(env->m_Root);
   env->m_Root.m_pActive = this;
 }
 ///
@@ -734,6 +818,7 @@ ExceptionStack::ExceptionStack(class Environ *env)
 /// ExceptionStack::Link
 void ExceptionStack::Link(class Environ *env)
 {
+  env                   = env->DelegateOf();
   m_pPrevious           = env->m_Root.m_pActive;
   m_pRoot               = &(env->m_Root);
   env->m_Root.m_pActive = this;
@@ -0,0 +1,101 @@
+/*************************************************************************
+
+    This project implements a complete(!) JPEG (Recommendation ITU-T
+    T.81 | ISO/IEC 10918-1) codec, plus a library that can be used to
+    encode and decode JPEG streams. 
+    It also implements ISO/IEC 18477 aka JPEG XT which is an extension
+    towards intermediate, high-dynamic-range lossy and lossless coding
+    of JPEG. In specific, it supports ISO/IEC 18477-3/-6/-7/-8 encoding.
+
+    Note that only Profiles C and D of ISO/IEC 18477-7 are supported
+    here. Check the JPEG XT reference software for a full implementation
+    of ISO/IEC 18477-7.
+
+    Copyright (C) 2012-2018 Thomas Richter, University of Stuttgart and
+    Accusoft. (C) 2019-2020 Thomas Richter, Fraunhofer IIS.
+
+    This program is available under two licenses, GPLv3 and the ITU
+    Software licence Annex A Option 2, RAND conditions.
+
+    For the full text of the GPU license option, see README.license.gpl.
+    For the full text of the ITU license option, see README.license.itu.
+    
+    You may freely select between these two options.
+
+    For the GPL option, please note the following:
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+/*
+**
+** MemoryPool: A size-class allocator that serves small, frequently
+** requested memory blocks from larger slabs on behalf of the 
+** environment.
+** 
+** $Id$
+**
+*/
+
+/// Includes
+#include "tools/memorypool.hpp"
+#include "std/assert.hpp"
+///
+
+/// MemoryPool::MemoryPool
+MemoryPool::MemoryPool(class Environ *env)
+  : JKeeper(env), m_pSlabs(NULL)
+{
+  for(ULONG i = 0;i < SizeClasses;i++) {
+    m_pFree[i] = NULL;
+  }
+}
+///
+
+/// MemoryPool::~MemoryPool
+// Release all slabs at once. Blocks still in use become invalid.
+MemoryPool::~MemoryPool(void)
+{
+  struct Slab *slab;
+
+  while((slab = m_pSlabs)) {
+    m_pSlabs = slab->sl_pNext;
+    m_pEnviron->FreeMem(slab,SlabSize);
+  }
+}
+///
+
+/// MemoryPool::Refill
+// Get a new slab for the given size class and cut it into
+// blocks.
+void MemoryPool::Refill(ULONG idx)
+{
+  ULONG size        = (idx + 1) * ChunkGranularity;
+  // The header is padded to keep the blocks aligned.
+  ULONG header      = ((sizeof(struct Slab) + ChunkGranularity - 1) / ChunkGranularity) * ChunkGranularity;
+  struct Slab *slab = (struct Slab *)m_pEnviron->AllocMem(SlabSize);
+  UBYTE *mem        = ((UBYTE *)slab) + header;
+  UBYTE *end        = ((UBYTE *)slab) + SlabSize;
+
+  slab->sl_pNext    = m_pSlabs;
+  m_pSlabs          = slab;
+
+  while(mem + size <= end) {
+    struct FreeChunk *chunk = (struct FreeChunk *)mem;
+    chunk->fc_pNext = m_pFree[idx];
+    m_pFree[idx]    = chunk;
+    mem            += size;
+  }
+}
+///
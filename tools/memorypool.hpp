@@ -0,0 +1,162 @@
+/*************************************************************************
+
+    This project implements a complete(!) JPEG (Recommendation ITU-T
+    T.81 | ISO/IEC 10918-1) codec, plus a library that can be used to
+    encode and decode JPEG streams. 
+    It also implements ISO/IEC 18477 aka JPEG XT which is an extension
+    towards intermediate, high-dynamic-range lossy and lossless coding
+    of JPEG. In specific, it supports ISO/IEC 18477-3/-6/-7/-8 encoding.
+
+    Note that only Profiles C and D of ISO/IEC 18477-7 are supported
+    here. Check the JPEG XT reference software for a full implementation
+    of ISO/IEC 18477-7.
+
+    Copyright (C) 2012-2018 Thomas Richter, University of Stuttgart and
+    Accusoft. (C) 2019-2020 Thomas Richter, Fraunhofer IIS.
+
+    This program is available under two licenses, GPLv3 and the ITU
+    Software licence Annex A Option 2, RAND conditions.
+
+    For the full text of the GPU license option, see README.license.gpl.
+    For the full text of the ITU license option, see README.license.itu.
+    
+    You may freely select between these two options.
+
+    For the GPL option, please note the following:
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+/*
+**
+** MemoryPool: A size-class allocator that serves small, frequently
+** requested memory blocks from larger slabs on behalf of the 
+** environment.
+** 
+** $Id$
+**
+*/
+
+#ifndef TOOLS_MEMORYPOOL_HPP
+#define TOOLS_MEMORYPOOL_HPP
+
+/// Includes
+#include "tools/environment.hpp"
+#include "std/assert.hpp"
+///
+
+/// Design
+/** Design
+******************************************************************
+** class MemoryPool                                             **
+** Super Class: JKeeper                                         **
+** Sub Classes: none                                            **
+** Friends:     none                                            **
+******************************************************************
+
+The memory pool keeps one free list per size class, where the
+size classes are multiples of the maximal alignment of the
+environment up to MaxChunkSize bytes. Released blocks go back to
+their free list and are handed out again on the next request of the
+same class. If a free list runs dry, a new slab is requested from
+the environment and cut into blocks of this class.
+
+Slabs are never returned individually. They are all released at 
+once when the pool goes away, which happens when the JPEG object
+is destroyed. Hence, the working set of one image remains warm for
+the next image decoded or encoded by the same JPEG object.
+
+The pool is not thread-safe. It is only attached to the root
+environment, worker threads allocate through their own child
+environments which bypass the pool.
+* */
+///
+
+/// class MemoryPool
+// Serves small memory blocks from slabs.
+class MemoryPool : public JKeeper {
+  //
+public:
+  enum {
+    // Granularity of the size classes.
+    ChunkGranularity = sizeof(union Environ::Align),
+    // Largest block served from the pool.
+    MaxChunkSize     = 512,
+    // Number of size classes.
+    SizeClasses      = MaxChunkSize / ChunkGranularity,
+    // Size of a slab, in bytes.
+    SlabSize         = 16384
+  };
+  //
+private:
+  //
+  // A released block, linked into the free list of its class.
+  struct FreeChunk {
+    struct FreeChunk *fc_pNext;
+  };
+  //
+  // A slab, the data follows this header.
+  struct Slab {
+    struct Slab      *sl_pNext;
+  };
+  //
+  // The free lists, one per size class.
+  struct FreeChunk    *m_pFree[SizeClasses];
+  //
+  // All slabs allocated so far.
+  struct Slab         *m_pSlabs;
+  //
+  // Get a new slab for the given size class and cut it into
+  // blocks.
+  void Refill(ULONG idx);
+  //
+public:
+  MemoryPool(class Environ *env);
+  //
+  ~MemoryPool(void);
+  //
+  // Allocate a block of the given size which must not be larger
+  // than MaxChunkSize.
+  void *Alloc(ULONG bytesize)
+  {
+    ULONG idx = (bytesize - 1) / ChunkGranularity;
+    struct FreeChunk *chunk;
+    //
+    assert(bytesize > 0 && bytesize <= MaxChunkSize);
+    //
+    if (m_pFree[idx] == NULL)
+      Refill(idx);
+    //
+    chunk         = m_pFree[idx];
+    m_pFree[idx]  = chunk->fc_pNext;
+    //
+    return chunk;
+  }
+  //
+  // Release a block that was allocated with the given size.
+  void Free(void *mem,ULONG bytesize)
+  {
+    ULONG idx = (bytesize - 1) / ChunkGranularity;
+    struct FreeChunk *chunk = (struct FreeChunk *)mem;
+    //
+    assert(bytesize > 0 && bytesize <= MaxChunkSize);
+    //
+    chunk->fc_pNext = m_pFree[idx];
+    m_pFree[idx]    = chunk;
+  }
+};
+///
+
+///
+#endif
@@ -0,0 +1,320 @@
+/*************************************************************************
+
+    This project implements a complete(!) JPEG (Recommendation ITU-T
+    T.81 | ISO/IEC 10918-1) codec, plus a library that can be used to
+    encode and decode JPEG streams. 
+    It also implements ISO/IEC 18477 aka JPEG XT which is an extension
+    towards intermediate, high-dynamic-range lossy and lossless coding
+    of JPEG. In specific, it supports ISO/IEC 18477-3/-6/-7/-8 encoding.
+
+    Note that only Profiles C and D of ISO/IEC 18477-7 are supported
+    here. Check the JPEG XT reference software for a full implementation
+    of ISO/IEC 18477-7.
+
+    Copyright (C) 2012-2018 Thomas Richter, University of Stuttgart and
+    Accusoft. (C) 2019-2020 Thomas Richter, Fraunhofer IIS.
+
+    This program is available under two licenses, GPLv3 and the ITU
+    Software licence Annex A Option 2, RAND conditions.
+
+    For the full text of the GPU license option, see README.license.gpl.
+    For the full text of the ITU license option, see README.license.itu.
+    
+    You may freely select between these two options.
+
+    For the GPL option, please note the following:
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+/*
+**
+** WorkerPool: A minimal pool of worker threads that runs independent
+** jobs on behalf of the main thread, e.g. restart intervals of the
+** entropy coder.
+** 
+** $Id$
+**
+*/
+
+/// Includes
+#include "tools/workerpool.hpp"
+#include "std/assert.hpp"
+///
+
+/// WorkerPool::WorkerPool
+// Create a pool running the given number of threads.
+WorkerPool::WorkerPool(class Environ *env,ULONG threads)
+  : JKeeper(env), m_ulThreads(0)
+#ifdef HAVE_WORKER_THREADS
+  , m_ppWorkers(NULL), m_ulSlots(0), m_pHead(NULL), m_pTail(NULL), m_ulPending(0),
+    m_bShutdown(false), m_bFailed(false)
+#endif
+{
+#ifdef HAVE_WORKER_THREADS
+  ULONG i;
+  //
+  // A single thread would only add overhead.
+  if (threads <= 1)
+    return;
+  //
+  pthread_mutex_init(&m_Mutex,NULL);
+  pthread_cond_init(&m_WorkAvailable,NULL);
+  pthread_cond_init(&m_WorkDone,NULL);
+  //
+  m_ppWorkers = (struct Worker **)m_pEnviron->AllocMem(sizeof(struct Worker *) * threads);
+  m_ulSlots   = threads;
+  for(i = 0;i < threads;i++)
+    m_ppWorkers[i] = NULL;
+  //
+  // Start the threads. If the system refuses to create more,
+  // continue with those we have.
+  for(i = 0;i < threads;i++) {
+    m_ppWorkers[i] = new(m_pEnviron) struct Worker(this,m_pEnviron);
+    if (pthread_create(&m_ppWorkers[i]->wk_Thread,NULL,&WorkerEntry,m_ppWorkers[i])) {
+      delete m_ppWorkers[i];
+      m_ppWorkers[i] = NULL;
+      break;
+    }
+    m_ulThreads++;
+  }
+#else
+  NOREF(threads);
+#endif
+}
+///
+
+/// WorkerPool::~WorkerPool
+WorkerPool::~WorkerPool(void)
+{
+#ifdef HAVE_WORKER_THREADS
+  if (m_ppWorkers) {
+    ULONG i;
+    //
+    // Make sure nothing is running anymore, then let the
+    // threads terminate.
+    if (m_ulThreads)
+      Wait(false);
+    //
+    pthread_mutex_lock(&m_Mutex);
+    m_bShutdown = true;
+    pthread_cond_broadcast(&m_WorkAvailable);
+    pthread_mutex_unlock(&m_Mutex);
+    //
+    for(i = 0;i < m_ulSlots;i++) {
+      if (m_ppWorkers[i]) {
+        pthread_join(m_ppWorkers[i]->wk_Thread,NULL);
+        // This merges the warnings of the thread into ours.
+        delete m_ppWorkers[i];
+      }
+    }
+    m_pEnviron->FreeMem(m_ppWorkers,sizeof(struct Worker *) * m_ulSlots);
+    //
+    pthread_cond_destroy(&m_WorkDone);
+    pthread_cond_destroy(&m_WorkAvailable);
+    pthread_mutex_destroy(&m_Mutex);
+  }
+#endif
+}
+///
+
+/// WorkerPool::Submit
+// Queue a job. The job remains owned by the caller and must stay
+// alive until Wait() returned.
+void WorkerPool::Submit(class Job *job)
+{
+#ifdef HAVE_WORKER_THREADS
+  if (m_ulThreads) {
+    pthread_mutex_lock(&m_Mutex);
+    job->m_bDetached = false;
+    job->m_pNext     = NULL;
+    if (m_pTail) {
+      m_pTail->m_pNext = job;
+    } else {
+      m_pHead          = job;
+    }
+    m_pTail = job;
+    m_ulPending++;
+    pthread_cond_signal(&m_WorkAvailable);
+    pthread_mutex_unlock(&m_Mutex);
+    return;
+  }
+#endif
+  //
+  // No threads available, just run it here.
+  job->Run(m_pEnviron);
+}
+///
+
+/// WorkerPool::Wait
+// Wait until all jobs completed. Re-throws the first exception
+// of a failed job if rethrow is set, otherwise discards it.
+void WorkerPool::Wait(bool rethrow)
+{
+#ifdef HAVE_WORKER_THREADS
+  if (m_ulThreads) {
+    bool failed;
+    //
+    pthread_mutex_lock(&m_Mutex);
+    while(m_ulPending)
+      pthread_cond_wait(&m_WorkDone,&m_Mutex);
+    failed    = m_bFailed;
+    m_bFailed = false;
+    pthread_mutex_unlock(&m_Mutex);
+    //
+    if (failed && rethrow)
+      m_pEnviron->Throw(m_Error);
+  }
+#else
+  NOREF(rethrow);
+#endif
+}
+///
+
+/// WorkerPool::Launch
+// Start a job that is not waited for by Wait(), but by Join().
+void WorkerPool::Launch(class Job *job)
+{
+  job->m_bDone   = false;
+  job->m_bFailed = false;
+#ifdef HAVE_WORKER_THREADS
+  if (m_ulThreads) {
+    pthread_mutex_lock(&m_Mutex);
+    job->m_bDetached = true;
+    job->m_pNext     = NULL;
+    if (m_pTail) {
+      m_pTail->m_pNext = job;
+    } else {
+      m_pHead          = job;
+    }
+    m_pTail = job;
+    pthread_cond_signal(&m_WorkAvailable);
+    pthread_mutex_unlock(&m_Mutex);
+    return;
+  }
+#endif
+  //
+  // No threads available, just run it here.
+  job->m_bDetached = false;
+  job->Run(m_pEnviron);
+  job->m_bDone     = true;
+}
+///
+
+/// WorkerPool::Join
+// Wait until the given launched job completed. Re-throws its
+// exception if it failed and rethrow is set.
+void WorkerPool::Join(class Job *job,bool rethrow)
+{
+#ifdef HAVE_WORKER_THREADS
+  if (job->m_bDetached) {
+    pthread_mutex_lock(&m_Mutex);
+    while(!job->m_bDone)
+      pthread_cond_wait(&m_WorkDone,&m_Mutex);
+    pthread_mutex_unlock(&m_Mutex);
+  }
+#endif
+  assert(job->m_bDone);
+  //
+  if (job->m_bFailed && rethrow) {
+    job->m_bFailed = false;
+    m_pEnviron->Throw(job->m_Error);
+  }
+}
+///
+
+/// WorkerPool::EnvironOfCaller
+// Return the environment of the worker thread calling this, or
+// NULL if the caller is not a worker of this pool.
+class Environ *WorkerPool::EnvironOfCaller(void) const
+{
+#ifdef HAVE_WORKER_THREADS
+  if (m_ppWorkers) {
+    pthread_t self = pthread_self();
+    ULONG i;
+    //
+    for(i = 0;i < m_ulSlots;i++) {
+      if (m_ppWorkers[i] && pthread_equal(m_ppWorkers[i]->wk_Thread,self))
+        return &m_ppWorkers[i]->wk_Env;
+    }
+  }
+#endif
+  return NULL;
+}
+///
+
+/// WorkerPool::WorkerEntry
+// Entry point of the threads.
+#ifdef HAVE_WORKER_THREADS
+void *WorkerPool::WorkerEntry(void *arg)
+{
+  struct Worker *w = (struct Worker *)arg;
+  
+  w->wk_pPool->WorkerLoop(w);
+
+  return NULL;
+}
+#endif
+///
+
+/// WorkerPool::WorkerLoop
+// The main loop of a worker thread: Pick jobs from the queue
+// until the pool shuts down.
+#ifdef HAVE_WORKER_THREADS
+void WorkerPool::WorkerLoop(struct Worker *w)
+{
+  class Environ *m_pEnviron = &w->wk_Env; // the exception stack of this thread
+  
+  pthread_mutex_lock(&m_Mutex);
+  do {
+    class Job *job;
+    //
+    while(m_pHead == NULL && !m_bShutdown)
+      pthread_cond_wait(&m_WorkAvailable,&m_Mutex);
+    //
+    if ((job = m_pHead) == NULL)
+      break; // Shutdown and nothing left to do.
+    //
+    m_pHead = job->m_pNext;
+    if (m_pHead == NULL)
+      m_pTail = NULL;
+    pthread_mutex_unlock(&m_Mutex);
+    //
+    JPG_TRY {
+      job->Run(m_pEnviron);
+    } JPG_CATCH {
+      pthread_mutex_lock(&m_Mutex);
+      if (job->m_bDetached) {
+        job->m_Error   = m_pEnviron->LastException();
+        job->m_bFailed = true;
+      } else if (!m_bFailed) {
+        m_Error   = m_pEnviron->LastException();
+        m_bFailed = true;
+      }
+      pthread_mutex_unlock(&m_Mutex);
+    } JPG_ENDTRY;
+    //
+    pthread_mutex_lock(&m_Mutex);
+    if (job->m_bDetached) {
+      // The job may go away as soon as this is visible.
+      job->m_bDone = true;
+      pthread_cond_broadcast(&m_WorkDone);
+    } else if (--m_ulPending == 0) {
+      pthread_cond_broadcast(&m_WorkDone);
+    }
+  } while(true);
+  pthread_mutex_unlock(&m_Mutex);
+}
+#endif
+///
@@ -0,0 +1,228 @@
+/*************************************************************************
+
+    This project implements a complete(!) JPEG (Recommendation ITU-T
+    T.81 | ISO/IEC 10918-1) codec, plus a library that can be used to
+    encode and decode JPEG streams. 
+    It also implements ISO/IEC 18477 aka JPEG XT which is an extension
+    towards intermediate, high-dynamic-range lossy and lossless coding
+    of JPEG. In specific, it supports ISO/IEC 18477-3/-6/-7/-8 encoding.
+
+    Note that only Profiles C and D of ISO/IEC 18477-7 are supported
+    here. Check the JPEG XT reference software for a full implementation
+    of ISO/IEC 18477-7.
+
+    Copyright (C) 2012-2018 Thomas Richter, University of Stuttgart and
+    Accusoft. (C) 2019-2020 Thomas Richter, Fraunhofer IIS.
+
+    This program is available under two licenses, GPLv3 and the ITU
+    Software licence Annex A Option 2, RAND conditions.
+
+    For the full text of the GPU license option, see README.license.gpl.
+    For the full text of the ITU license option, see README.license.itu.
+    
+    You may freely select between these two options.
+
+    For the GPL option, please note the following:
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+/*
+**
+** WorkerPool: A minimal pool of worker threads that runs independent
+** jobs on behalf of the main thread, e.g. restart intervals of the
+** entropy coder.
+** 
+** $Id$
+**
+*/
+
+#ifndef TOOLS_WORKERPOOL_HPP
+#define TOOLS_WORKERPOOL_HPP
+
+/// Includes
+#include "tools/environment.hpp"
+#include "std/pthread.hpp"
+///
+
+/// Design
+/** Design
+******************************************************************
+** class WorkerPool                                             **
+** Super Class: JKeeper                                         **
+** Sub Classes: none                                            **
+** Friends:     none                                            **
+******************************************************************
+
+The worker pool keeps a fixed number of threads that execute jobs
+queued by the main thread. Jobs are derived from WorkerPool::Job
+and implement the Run() method. Each thread owns a child environment
+that carries its own exception stack, and Run() receives this
+environment. Everything that may throw or allocate memory within a
+job must therefore use this environment and not the one of the main
+thread. Objects allocated there may be released by the main thread
+as long as the pool exists.
+
+Wait() blocks until all queued jobs have completed. If any of them
+failed, the first exception is re-thrown in the main thread.
+
+Jobs started by Launch() instead run independently of Wait() and
+are waited for individually by Join(), which re-throws their
+exception. Such jobs may also act on objects of the main thread
+if the main environment is informed by BeginConcurrentJob(); it
+then serializes its memory management and forwards exceptions
+raised within the job to the environment of the worker, which it
+finds by EnvironOfCaller().
+
+If the library is not configured for multithreading, or only a
+single thread is requested, jobs run immediately within Submit()
+in the environment of the caller.
+* */
+///
+
+/// class WorkerPool
+// A pool of worker threads executing jobs in the background.
+class WorkerPool : public JKeeper {
+  //
+public:
+  //
+  /// class WorkerPool::Job
+  // A unit of work queued to the pool.
+  class Job : public JObject {
+    friend class WorkerPool;
+    //
+    // The next job in the queue.
+    class Job *m_pNext;
+    //
+    // Set for jobs started by Launch() which are joined individually.
+    bool       m_bDetached;
+    //
+    // Set as soon as a detached job completed, and whether it failed.
+    bool       m_bDone;
+    bool       m_bFailed;
+    //
+    // The exception that caused a detached job to fail.
+    class Exception m_Error;
+    //
+  public:
+    Job(void)
+      : m_pNext(NULL), m_bDetached(false), m_bDone(false), m_bFailed(false)
+    { }
+    //
+    virtual ~Job(void)
+    { }
+    //
+    // Run this job. The argument is the environment of the thread
+    // this job runs in.
+    virtual void Run(class Environ *env) = 0;
+  };
+  ///
+  //
+private:
+  //
+  // Number of threads in the pool. Zero if jobs run in
+  // the calling thread.
+  ULONG                 m_ulThreads;
+  //
+#ifdef HAVE_WORKER_THREADS
+  //
+  // The per-thread data.
+  struct Worker : public JObject {
+    //
+    // The pool this worker belongs to.
+    class WorkerPool   *wk_pPool;
+    //
+    // The environment of this thread.
+    class Environ       wk_Env;
+    //
+    // The thread itself.
+    pthread_t           wk_Thread;
+    //
+    Worker(class WorkerPool *pool,class Environ *parent)
+      : wk_pPool(pool), wk_Env(parent)
+    { }
+  }                   **m_ppWorkers;
+  //
+  // Size of the above array.
+  ULONG                 m_ulSlots;
+  //
+  // Protects the queue and the counters.
+  pthread_mutex_t       m_Mutex;
+  //
+  // Signalled whenever a job is queued or the pool shuts down.
+  pthread_cond_t        m_WorkAvailable;
+  //
+  // Signalled whenever the last job completed.
+  pthread_cond_t        m_WorkDone;
+  //
+  // The job queue.
+  class Job            *m_pHead;
+  class Job            *m_pTail;
+  //
+  // Number of jobs queued or running.
+  ULONG                 m_ulPending;
+  //
+  // Set if the threads shall terminate.
+  bool                  m_bShutdown;
+  //
+  // Set if a job failed, and the exception that caused it.
+  bool                  m_bFailed;
+  class Exception       m_Error;
+  //
+  // Entry point of the threads.
+  static void *WorkerEntry(void *arg);
+  //
+  // The main loop of a worker thread.
+  void WorkerLoop(struct Worker *w);
+#endif
+  //
+public:
+  //
+  // Create a pool running the given number of threads.
+  WorkerPool(class Environ *env,ULONG threads);
+  //
+  ~WorkerPool(void);
+  //
+  // Return the number of threads in the pool, zero if jobs run
+  // in the calling thread.
+  ULONG ThreadsOf(void) const
+  {
+    return m_ulThreads;
+  }
+  //
+  // Queue a job. The job remains owned by the caller and must stay
+  // alive until Wait() returned.
+  void Submit(class Job *job);
+  //
+  // Wait until all jobs completed. Re-throws the first exception
+  // of a failed job if rethrow is set, otherwise discards it.
+  void Wait(bool rethrow = true);
+  //
+  // Start a job that is not waited for by Wait(), but by Join().
+  // The job remains owned by the caller and must stay alive until
+  // Join() returned.
+  void Launch(class Job *job);
+  //
+  // Wait until the given launched job completed. Re-throws its
+  // exception if it failed and rethrow is set.
+  void Join(class Job *job,bool rethrow = true);
+  //
+  // Return the environment of the worker thread calling this, or
+  // NULL if the caller is not a worker of this pool.
+  class Environ *EnvironOfCaller(void) const;
+};
+///
+
+///
+#endif
@@ -53,6 +53,8 @@
 #include "upsampling/downsamplerbase.hpp"
 #include "upsampling/downsampler.hpp"
 #include "upsampling/interdownsampler.hpp"
+#include "upsampling/ssedownsampler.hpp"
+#include "tools/cpufeatures.hpp"
 #include "std/string.hpp"
 ///
 
@@ -60,8 +62,9 @@
 DownsamplerBase::DownsamplerBase(class Environ *env,int sx,int sy,
                                  ULONG width,ULONG height,bool interpolate)
   : JKeeper(env), m_ulWidth(width), m_lTotalLines(height), m_lY(0), m_lHeight(0),
-    m_ucSubX(sx), m_ucSubY(sy), m_pInputBuffer(NULL), m_pLastRow(NULL), m_pFree(NULL),
-    m_bInterpolate(interpolate)
+    m_ucSubX(sx), m_ucSubY(sy), m_pInputBuffer(NULL),
+    m_ulLineSize(width + 2 + (sx << 3)), m_bAccumulate(false),
+    m_pLastRow(NULL), m_pFree(NULL), m_bInterpolate(interpolate)
 {
 }
 ///
@@ -74,13 +77,13 @@ DownsamplerBase::~DownsamplerBase(void)
   while((row = m_pInputBuffer)) {
     m_pInputBuffer = row->m_pNext;
     if (row->m_pData)
-      m_pEnviron->FreeMem(row->m_pData,(m_ulWidth + 2 + (m_ucSubX << 3)) * sizeof(LONG));
+      m_pEnviron->FreeMem(row->m_pData,m_ulLineSize * sizeof(LONG));
     delete row;
   } 
 
   while((row = m_pFree)) {
     m_pFree = row->m_pNext;
-    m_pEnviron->FreeMem(row->m_pData,(m_ulWidth + 2 + (m_ucSubX << 3)) * sizeof(LONG));
+    m_pEnviron->FreeMem(row->m_pData,m_ulLineSize * sizeof(LONG));
     delete row;
   }
 }
@@ -130,8 +133,10 @@ void DownsamplerBase::ExtendBufferedRegion(const RectAngle<LONG> &region)
     //
     // Allocate the memory for it.
     if (alloc) {
-      alloc->m_pData = (LONG *)m_pEnviron->AllocMem((m_ulWidth + 2 + (m_ucSubX << 3)) * sizeof(LONG));
+      alloc->m_pData = (LONG *)m_pEnviron->AllocMem(m_ulLineSize * sizeof(LONG));
     }
+    if (m_bAccumulate)
+      memset(qrow->m_pData,0,m_ulLineSize * sizeof(LONG));
     m_lHeight++;
   }
 }
@@ -253,6 +258,18 @@ void DownsamplerBase::GetCollectedBlocks(RectAngle<LONG> &rect) const
 class DownsamplerBase *DownsamplerBase::CreateDownsampler(class Environ *env,int sx,int sy,
                                                           ULONG width,ULONG height,bool interpolate)
 {
+#ifdef HAVE_SSE2_INTRINSICS
+  // The common factors have vectorized filters that create the same
+  // output as the generic ones.
+  if (!interpolate && sx <= 2 && sy <= 2 && sx * sy > 1 && CPUHasSSE2()) {
+    if (sy == 1)
+      return new(env) SSEDownsampler<2,1>(env,width,height);
+    if (sx == 1)
+      return new(env) SSEDownsampler<1,2>(env,width,height);
+    return new(env) SSEDownsampler<2,2>(env,width,height);
+  }
+#endif
+  
   if (interpolate) {
     switch(sy) {
     case 1:
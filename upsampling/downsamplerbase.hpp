@@ -84,6 +84,14 @@ protected:
   // of the upsampling filter.
   struct Line        *m_pInputBuffer;
   //
+  // Number of LONGs allocated per line. Subclasses that do not keep
+  // the lines at full resolution may set this in their constructor.
+  ULONG               m_ulLineSize;
+  //
+  // If set, lines are cleared when they enter the buffer because the
+  // subclass accumulates into them rather than copying.
+  bool                m_bAccumulate;
+  //
 private:
   //
   // The last row of the buffer.
@@ -124,7 +132,7 @@ public:
   //
   // Define the region to contain the given data, copy it to the line buffers
   // for later downsampling. Coordinates are in 8x8 blocks.
-  void DefineRegion(LONG x,LONG y,const LONG *data);
+  virtual void DefineRegion(LONG x,LONG y,const LONG *data);
   //
   // Remove the blocks of the given block line, given in downsampled
   // block coordinates.
@@ -0,0 +1,246 @@
+/*************************************************************************
+
+    This project implements a complete(!) JPEG (Recommendation ITU-T
+    T.81 | ISO/IEC 10918-1) codec, plus a library that can be used to
+    encode and decode JPEG streams. 
+    It also implements ISO/IEC 18477 aka JPEG XT which is an extension
+    towards intermediate, high-dynamic-range lossy and lossless coding
+    of JPEG. In specific, it supports ISO/IEC 18477-3/-6/-7/-8 encoding.
+
+    Note that only Profiles C and D of ISO/IEC 18477-7 are supported
+    here. Check the JPEG XT reference software for a full implementation
+    of ISO/IEC 18477-7.
+
+    Copyright (C) 2012-2018 Thomas Richter, University of Stuttgart and
+    Accusoft. (C) 2019-2020 Thomas Richter, Fraunhofer IIS.
+
+    This program is available under two licenses, GPLv3 and the ITU
+    Software licence Annex A Option 2, RAND conditions.
+
+    For the full text of the GPU license option, see README.license.gpl.
+    For the full text of the ITU license option, see README.license.itu.
+    
+    You may freely select between these two options.
+
+    For the GPL option, please note the following:
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+/*
+**
+** This file defines the downsamplers for the common 2x1, 1x2 and 2x2
+** subsampling factors that run the filters on SSE2 vectors.
+**
+** $Id$
+**
+*/
+
+/// Includes
+#include "tools/environment.hpp"
+#include "tools/rectangle.hpp"
+#include "upsampling/downsamplerbase.hpp"
+#include "upsampling/ssedownsampler.hpp"
+#include "std/string.hpp"
+#ifdef HAVE_SSE2_INTRINSICS
+#include <emmintrin.h>
+#endif
+///
+
+#ifdef HAVE_SSE2_INTRINSICS
+/// Vector helpers
+// Load and store four samples from unaligned memory.
+static inline __m128i LoadSamples(const LONG *src)
+{
+  return _mm_loadu_si128((const __m128i *)src);
+}
+
+static inline void StoreSamples(LONG *dst,__m128i v)
+{
+  _mm_storeu_si128((__m128i *)dst,v);
+}
+
+// Collect the samples at even and odd positions of the eight
+// samples in lo and hi.
+static inline __m128i EvenSamples(__m128i lo,__m128i hi)
+{
+  return _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(lo),_mm_castsi128_ps(hi),
+                                         _MM_SHUFFLE(2,0,2,0)));
+}
+
+static inline __m128i OddSamples(__m128i lo,__m128i hi)
+{
+  return _mm_castps_si128(_mm_shuffle_ps(_mm_castsi128_ps(lo),_mm_castsi128_ps(hi),
+                                         _MM_SHUFFLE(3,1,3,1)));
+}
+
+// Divide by 2^n, rounding towards zero as the integer division does.
+template<int n>
+static inline __m128i DivideSamples(__m128i v)
+{
+  __m128i bias = _mm_srli_epi32(_mm_srai_epi32(v,31),32 - n);
+  
+  return _mm_srai_epi32(_mm_add_epi32(v,bias),n);
+}
+///
+
+/// SSEDownsampler::SSEDownsampler
+template<int sx,int sy>
+SSEDownsampler<sx,sy>::SSEDownsampler(class Environ *env,ULONG width,ULONG height)
+  : DownsamplerBase(env,sx,sy,width,height,false)
+{
+  // The lines hold one horizontal sum per downsampled sample, up to
+  // the end of the last block.
+  m_ulLineSize  = (((width + sx - 1) / sx + 7) >> 3) << 3;
+  m_bAccumulate = true;
+}
+///
+
+/// SSEDownsampler::~SSEDownsampler
+template<int sx,int sy>
+SSEDownsampler<sx,sy>::~SSEDownsampler(void)
+{
+}
+///
+
+/// SSEDownsampler::DefineRegion
+// Sum the given data horizontally into the line buffers.
+// Coordinates are in 8x8 blocks.
+template<int sx,int sy>
+void SSEDownsampler<sx,sy>::DefineRegion(LONG x,LONG y,const LONG *data)
+{
+  struct Line *line = m_pInputBuffer;
+  LONG topy   = y << 3;
+  LONG yf     = m_lY;
+  LONG ofs    = x << 3;
+  LONG width  = m_ulWidth;
+  LONG ext    = LONG(m_ulLineSize) * sx - width; // number of mirrored samples the filter reads.
+  bool mirror = ofs + 8 > width - ext;          // block contains sources of the mirror extension.
+  LONG cnt    = 8;
+
+  assert(topy >= m_lY && topy < m_lY + m_lHeight);
+
+  while(yf < topy) {
+    line = line->m_pNext;
+    yf++;
+  }
+
+  assert(line);
+  
+  do {
+    LONG *dst = line->m_pData;
+    //
+    if (ofs + 8 <= width) {
+      // All samples are in the image, and no other block contributes
+      // to their sums.
+      __m128i lo = LoadSamples(data);
+      __m128i hi = LoadSamples(data + 4);
+      if (sx == 2) {
+        StoreSamples(dst + (ofs >> 1),_mm_add_epi32(EvenSamples(lo,hi),OddSamples(lo,hi)));
+      } else {
+        StoreSamples(dst + ofs    ,lo);
+        StoreSamples(dst + ofs + 4,hi);
+      }
+    } else {
+      LONG c;
+      for(c = ofs;c < width;c++) {
+        dst[c / sx] += data[c - ofs];
+      }
+    }
+    //
+    // Mirror-extend to the right as DownsamplerBase::DefineRegion does,
+    // but add the mirrored samples directly into the sums they fall into.
+    if (mirror) {
+      LONG i;
+      for(i = 0;i < ext;i++) {
+        LONG c = (width > i)?(width - 1 - i):0;
+        if (c >= ofs && c < ofs + 8)
+          dst[(width + i) / sx] += data[c - ofs];
+      }
+    }
+    line  = line->m_pNext;
+    data += 8;
+  } while(--cnt && line);
+}
+///
+
+/// SSEDownsampler::DownsampleRegion
+// The actual downsampling process. Coordinates are in the downsampled
+// block domain the block indices. Requires an output buffer that
+// will keep the downsampled data.
+template<int sx,int sy>
+void SSEDownsampler<sx,sy>::DownsampleRegion(LONG bx,LONG by,LONG *buffer) const
+{
+  LONG ofs = bx << 3;        // first sum in the line.
+  LONG yfs = (by * sy) << 3; // first line.
+  int cnt  = 8;              // number of output lines to go.
+  struct Line *line = m_pInputBuffer;
+  LONG y = m_lY;
+
+  assert(yfs >= m_lY && yfs < m_lY + m_lHeight);
+
+  //
+  // Get the line.
+  while(y < yfs) {
+    line = line->m_pNext;
+    y++;
+  }
+  assert(line);
+
+  do {
+    //
+    // Still something in the image?
+    if (line) {
+      const LONG *src = line->m_pData + ofs;
+      __m128i lo      = LoadSamples(src);
+      __m128i hi      = LoadSamples(src + 4);
+      int lines       = 1;
+      //
+      line = line->m_pNext;
+      if (sy > 1 && line) {
+        src   = line->m_pData + ofs;
+        lo    = _mm_add_epi32(lo,LoadSamples(src));
+        hi    = _mm_add_epi32(hi,LoadSamples(src + 4));
+        line  = line->m_pNext;
+        lines++;
+      }
+      //
+      // Normalize by the number of summed samples, one, two or four.
+      switch(lines * sx) {
+      case 4:
+        lo = DivideSamples<2>(lo);
+        hi = DivideSamples<2>(hi);
+        break;
+      case 2:
+        lo = DivideSamples<1>(lo);
+        hi = DivideSamples<1>(hi);
+        break;
+      }
+      StoreSamples(buffer    ,lo);
+      StoreSamples(buffer + 4,hi);
+    } else {
+      // Beyond the end of the image, leave it empty.
+      memset(buffer,0,8 * sizeof(LONG));
+    }
+    buffer += 8;
+  } while(--cnt);
+}
+///
+
+/// Explicit instaciations
+template class SSEDownsampler<1,2>;
+template class SSEDownsampler<2,1>;
+template class SSEDownsampler<2,2>;
+///
+#endif
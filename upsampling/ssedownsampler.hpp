@@ -0,0 +1,90 @@
+/*************************************************************************
+
+    This project implements a complete(!) JPEG (Recommendation ITU-T
+    T.81 | ISO/IEC 10918-1) codec, plus a library that can be used to
+    encode and decode JPEG streams. 
+    It also implements ISO/IEC 18477 aka JPEG XT which is an extension
+    towards intermediate, high-dynamic-range lossy and lossless coding
+    of JPEG. In specific, it supports ISO/IEC 18477-3/-6/-7/-8 encoding.
+
+    Note that only Profiles C and D of ISO/IEC 18477-7 are supported
+    here. Check the JPEG XT reference software for a full implementation
+    of ISO/IEC 18477-7.
+
+    Copyright (C) 2012-2018 Thomas Richter, University of Stuttgart and
+    Accusoft. (C) 2019-2020 Thomas Richter, Fraunhofer IIS.
+
+    This program is available under two licenses, GPLv3 and the ITU
+    Software licence Annex A Option 2, RAND conditions.
+
+    For the full text of the GPU license option, see README.license.gpl.
+    For the full text of the ITU license option, see README.license.itu.
+    
+    You may freely select between these two options.
+
+    For the GPL option, please note the following:
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+/*
+**
+** This file defines the downsamplers for the common 2x1, 1x2 and 2x2
+** subsampling factors that run the filters on SSE2 vectors.
+**
+** $Id$
+**
+*/
+
+#ifndef UPSAMPLING_SSEDOWNSAMPLER_HPP
+#define UPSAMPLING_SSEDOWNSAMPLER_HPP
+
+/// Includes
+#include "tools/environment.hpp"
+#include "tools/rectangle.hpp"
+#include "upsampling/downsamplerbase.hpp"
+///
+
+/// Class SSEDownsampler
+// This class implements the box filter of Downsampler<sx,sy> with SSE2
+// kernels. Unlike the generic downsampler, it does not buffer the lines
+// at full resolution: DefineRegion sums the samples horizontally right
+// as they come out of the color transformer, including the mirror
+// extension at the right edge, and the line buffer only holds the
+// horizontal sums. DownsampleRegion then only adds the lines and
+// normalizes. The output is identical to that of Downsampler<sx,sy>
+// provided each block is defined once, which is what the bitmap
+// requesters do. Only available if HAVE_SSE2_INTRINSICS is defined.
+template<int sx,int sy>
+class SSEDownsampler : public DownsamplerBase {
+  //
+public:
+  SSEDownsampler(class Environ *env,ULONG width,ULONG height);
+  //
+  virtual ~SSEDownsampler(void);
+  //
+  // Sum the given data horizontally into the line buffers.
+  // Coordinates are in 8x8 blocks.
+  virtual void DefineRegion(LONG x,LONG y,const LONG *data);
+  //
+  // The actual downsampling process. Coordinates are in the downsampled
+  // block domain the block indices. Requires an output buffer that
+  // will keep the downsampled data.
+  virtual void DownsampleRegion(LONG bx,LONG by,LONG *buffer) const;
+  //
+};
+///
+
+///
+#endif
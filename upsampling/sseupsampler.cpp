@@ -0,0 +1,233 @@
+/*************************************************************************
+
+    This project implements a complete(!) JPEG (Recommendation ITU-T
+    T.81 | ISO/IEC 10918-1) codec, plus a library that can be used to
+    encode and decode JPEG streams. 
+    It also implements ISO/IEC 18477 aka JPEG XT which is an extension
+    towards intermediate, high-dynamic-range lossy and lossless coding
+    of JPEG. In specific, it supports ISO/IEC 18477-3/-6/-7/-8 encoding.
+
+    Note that only Profiles C and D of ISO/IEC 18477-7 are supported
+    here. Check the JPEG XT reference software for a full implementation
+    of ISO/IEC 18477-7.
+
+    Copyright (C) 2012-2018 Thomas Richter, University of Stuttgart and
+    Accusoft. (C) 2019-2020 Thomas Richter, Fraunhofer IIS.
+
+    This program is available under two licenses, GPLv3 and the ITU
+    Software licence Annex A Option 2, RAND conditions.
+
+    For the full text of the GPU license option, see README.license.gpl.
+    For the full text of the ITU license option, see README.license.itu.
+    
+    You may freely select between these two options.
+
+    For the GPL option, please note the following:
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+/*
+**
+** This file defines the centered upsamplers for the common 2x1, 1x2
+** and 2x2 subsampling factors that run the filter cores on SSE2 vectors.
+**
+** $Id$
+**
+*/
+
+
+/// Includes
+#include "upsampling/sseupsampler.hpp"
+#include "std/string.hpp"
+#ifdef HAVE_SSE2_INTRINSICS
+#include <emmintrin.h>
+#endif
+///
+
+#ifdef HAVE_SSE2_INTRINSICS
+/// Vector helpers
+// Load and store four samples from unaligned memory.
+static inline __m128i LoadSamples(const LONG *src)
+{
+  return _mm_loadu_si128((const __m128i *)src);
+}
+
+static inline void StoreSamples(LONG *dst,__m128i v)
+{
+  _mm_storeu_si128((__m128i *)dst,v);
+}
+
+// Compute a + 3 * b.
+static inline __m128i AddTriple(__m128i a,__m128i b)
+{
+  return _mm_add_epi32(_mm_add_epi32(a,b),_mm_slli_epi32(b,1));
+}
+///
+
+/// FindSourceLines
+// Find the line above, the line at and the line below the source line
+// y, duplicating the edge lines at the top and bottom of the buffer.
+static void FindSourceLines(struct Line *first,LONG firsty,LONG y,
+                            struct Line *&top,struct Line *&cur,struct Line *&bot)
+{
+  LONG cy = firsty;
+  
+  // Get the topmost line, one above the current position.
+  top = first;
+  while(cy < y - 1) {
+    top = top->m_pNext;
+    cy++;
+  }
+  //
+  // Get the next line.
+  cur = top;
+  if (y > firsty)
+    cur = cur->m_pNext; // duplicate the top line for the first line.
+
+  bot = cur;
+  if (bot->m_pNext)
+    bot = bot->m_pNext; // duplicate bottom at the last line.
+}
+///
+
+/// SSECopyLines
+// Copy eight lines without vertical filtering, repeating the last line
+// if the buffer ends early.
+static void SSECopyLines(struct Line *cur,LONG offset,LONG *target)
+{
+  int lines = 8;
+  
+  do {
+    const LONG *c = cur->m_pData + offset;
+    StoreSamples(target    ,LoadSamples(c));
+    StoreSamples(target + 4,LoadSamples(c + 4));
+    if (cur->m_pNext)
+      cur = cur->m_pNext;
+    target += 8;
+  } while(--lines);
+}
+///
+
+/// SSEVerticalFilterCore
+// Centered vertical upsampling by two, see VerticalFilterCore<2>.
+static void SSEVerticalFilterCore(int ymod,struct Line *top,struct Line *cur,struct Line *bot,
+                                  LONG offset,LONG *target)
+{
+  // Rounding offsets of even lines are 2,1,2,1..., of odd lines 1,2,1,2...
+  const __m128i reven = _mm_set_epi32(1,2,1,2);
+  const __m128i rodd  = _mm_set_epi32(2,1,2,1);
+  int lines = 8;
+  
+  do {
+    const LONG *c = cur->m_pData + offset;
+    if (ymod == 0) {
+      const LONG *t = top->m_pData + offset;
+      StoreSamples(target    ,_mm_srai_epi32(_mm_add_epi32(AddTriple(LoadSamples(t),
+                                                                     LoadSamples(c)),reven),2));
+      StoreSamples(target + 4,_mm_srai_epi32(_mm_add_epi32(AddTriple(LoadSamples(t + 4),
+                                                                     LoadSamples(c + 4)),reven),2));
+      ymod = 1;
+    } else {
+      const LONG *b = bot->m_pData + offset;
+      StoreSamples(target    ,_mm_srai_epi32(_mm_add_epi32(AddTriple(LoadSamples(b),
+                                                                     LoadSamples(c)),rodd),2));
+      StoreSamples(target + 4,_mm_srai_epi32(_mm_add_epi32(AddTriple(LoadSamples(b + 4),
+                                                                     LoadSamples(c + 4)),rodd),2));
+      ymod = 0;
+      top  = cur;
+      cur  = bot;
+      if (bot->m_pNext) bot = bot->m_pNext;
+    }
+    target += 8; // next line.
+  } while(--lines);
+}
+///
+
+/// SSEHorizontalFilterCore
+// Centered horizontal upsampling by two, see HorizontalFilterCore<2>.
+// The input is offset by one pixel, target[0] is the pixel to the left.
+static void SSEHorizontalFilterCore(LONG *target)
+{
+  const __m128i reven = _mm_set1_epi32(2);
+  const __m128i rodd  = _mm_set1_epi32(1);
+  int lines = 8;
+
+  do {
+    __m128i l = LoadSamples(target);     // src[-1..2]
+    __m128i c = LoadSamples(target + 1); // src[0..3]
+    __m128i r = LoadSamples(target + 2); // src[1..4]
+    __m128i e = _mm_srai_epi32(_mm_add_epi32(AddTriple(l,c),reven),2);
+    __m128i o;
+    //
+    // The scalar core works in place and filters out[1] from the
+    // already computed out[2] instead of src[1]. Do the same.
+    r = _mm_castps_si128(_mm_move_ss(_mm_castsi128_ps(r),_mm_castsi128_ps(_mm_srli_si128(e,4))));
+    o = _mm_srai_epi32(_mm_add_epi32(AddTriple(r,c),rodd),2);
+    
+    StoreSamples(target    ,_mm_unpacklo_epi32(e,o));
+    StoreSamples(target + 4,_mm_unpackhi_epi32(e,o));
+
+    target += 8;
+  } while(--lines);
+}
+///
+
+/// SSEUpsampler::SSEUpsampler
+template<int sx,int sy>
+SSEUpsampler<sx,sy>::SSEUpsampler(class Environ *env,ULONG width,ULONG height)
+  : UpsamplerBase(env,sx,sy,width,height)
+{
+}
+///
+
+/// SSEUpsampler::~SSEUpsampler
+template<int sx,int sy>
+SSEUpsampler<sx,sy>::~SSEUpsampler(void)
+{
+}
+///
+
+/// SSEUpsampler::UpsampleRegion
+// The actual upsampling process.
+template<int sx,int sy>
+void SSEUpsampler<sx,sy>::UpsampleRegion(const RectAngle<LONG> &r,LONG *buffer) const
+{
+  LONG y = (r.ra_MinY / sy);     // The line offset of the current line.
+  LONG x = (r.ra_MinX / sx) + 1; // the data offset such that data + offset + 0 is the pixel at the point
+  struct Line *top,*cur,*bot;    // Line pointers.
+
+  assert(y >= m_lY && y < m_lY + m_lHeight); // Must be in the buffer.
+  assert(r.ra_MinX % sx == 0);   // blocks are aligned by multiples of eight
+
+  FindSourceLines(m_pInputBuffer,m_lY,y,top,cur,bot);
+
+  if (sx > 1)
+    x--; // copy one additional pixel from the left in case we need to expand horizontally.
+  if (sy > 1) {
+    SSEVerticalFilterCore(r.ra_MinY % sy,top,cur,bot,x,buffer);
+  } else {
+    SSECopyLines(cur,x,buffer);
+  }
+  if (sx > 1)
+    SSEHorizontalFilterCore(buffer);
+}
+///
+
+/// Explicit instaciations
+template class SSEUpsampler<1,2>;
+template class SSEUpsampler<2,1>;
+template class SSEUpsampler<2,2>;
+///
+#endif
@@ -0,0 +1,83 @@
+/*************************************************************************
+
+    This project implements a complete(!) JPEG (Recommendation ITU-T
+    T.81 | ISO/IEC 10918-1) codec, plus a library that can be used to
+    encode and decode JPEG streams. 
+    It also implements ISO/IEC 18477 aka JPEG XT which is an extension
+    towards intermediate, high-dynamic-range lossy and lossless coding
+    of JPEG. In specific, it supports ISO/IEC 18477-3/-6/-7/-8 encoding.
+
+    Note that only Profiles C and D of ISO/IEC 18477-7 are supported
+    here. Check the JPEG XT reference software for a full implementation
+    of ISO/IEC 18477-7.
+
+    Copyright (C) 2012-2018 Thomas Richter, University of Stuttgart and
+    Accusoft. (C) 2019-2020 Thomas Richter, Fraunhofer IIS.
+
+    This program is available under two licenses, GPLv3 and the ITU
+    Software licence Annex A Option 2, RAND conditions.
+
+    For the full text of the GPU license option, see README.license.gpl.
+    For the full text of the ITU license option, see README.license.itu.
+    
+    You may freely select between these two options.
+
+    For the GPL option, please note the following:
+
+    This program is free software: you can redistribute it and/or modify
+    it under the terms of the GNU General Public License as published by
+    the Free Software Foundation, either version 3 of the License, or
+    (at your option) any later version.
+
+    This program is distributed in the hope that it will be useful,
+    but WITHOUT ANY WARRANTY; without even the implied warranty of
+    MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+    GNU General Public License for more details.
+
+    You should have received a copy of the GNU General Public License
+    along with this program.  If not, see <http://www.gnu.org/licenses/>.
+
+*************************************************************************/
+/*
+**
+** This file defines the centered upsamplers for the common 2x1, 1x2
+** and 2x2 subsampling factors that run the filter cores on SSE2 vectors.
+**
+** $Id$
+**
+*/
+
+#ifndef UPSAMPLING_SSEUPSAMPLER_HPP
+#define UPSAMPLING_SSEUPSAMPLER_HPP
+
+/// Includes
+#include "tools/environment.hpp"
+#include "tools/rectangle.hpp"
+#include "upsampling/upsamplerbase.hpp"
+///
+
+/// Class SSEUpsampler
+// This class performs the centered upsampling process with SSE2 kernels.
+// It replaces Upsampler<sx,sy> for the factors 2x1, 1x2 and 2x2 if the
+// CPU supports SSE2, see UpsamplerBase::CreateUpsampler. Each row of a
+// block is filtered as two vectors of four samples, using the same
+// filters and rounding offsets as the scalar code, so the output is
+// identical. Only available if HAVE_SSE2_INTRINSICS is defined.
+template<int sx,int sy>
+class SSEUpsampler : public UpsamplerBase {
+  //
+  //
+public:
+  SSEUpsampler(class Environ *env,ULONG width,ULONG height);
+  //
+  virtual ~SSEUpsampler(void);
+  //
+  // The actual upsampling process.
+  virtual void UpsampleRegion(const RectAngle<LONG> &r,LONG *buffer) const;
+  //
+};
+///
+
+
+///
+#endif
@@ -54,6 +54,8 @@
 #include "coding/quantizedrow.hpp"
 #include "upsampling/upsampler.hpp"
 #include "upsampling/cositedupsampler.hpp"
+#include "upsampling/sseupsampler.hpp"
+#include "tools/cpufeatures.hpp"
 #include "std/string.hpp"
 ///
 
@@ -193,7 +195,7 @@ void UpsamplerBase::SetBufferedRegion(RectAngle<LONG> &region)
   if (m_lY > (region.ra_MinY << 3)) {
     if (m_pInputBuffer) {
       assert(m_pLastRow);
-      m_pInputBuffer->m_pNext = m_pFree;
+      m_pLastRow->m_pNext     = m_pFree;
       m_pFree                 = m_pInputBuffer;
       m_lHeight               = 0;
       m_pInputBuffer          = NULL;
@@ -212,6 +214,21 @@ void UpsamplerBase::SetBufferedRegion(RectAngle<LONG> &region)
 }
 ///
 
+/// UpsamplerBase::ResetBufferedRegion
+// Drop all buffered lines such that the next request refills them.
+// Required if the data they were filled from changed.
+void UpsamplerBase::ResetBufferedRegion(void)
+{
+  if (m_pLastRow) {
+    m_pLastRow->m_pNext = m_pFree;
+    m_pFree             = m_pInputBuffer;
+  }
+  m_pInputBuffer = NULL;
+  m_pLastRow     = NULL;
+  m_lHeight      = 0;
+}
+///
+
 /// UpsamplerBase::ExtendBufferedRegion
 // Make the buffered region larger to include at least the given rectangle.
 // The rectangle is given in block indices, not canvas coordinates.
@@ -333,6 +350,17 @@ void UpsamplerBase::DefineRegion(LONG bx,LONG by,const LONG *data)
 class UpsamplerBase *UpsamplerBase::CreateUpsampler(class Environ *env,int sx,int sy,
                                                     ULONG width,ULONG height,bool centered)
 {
+#ifdef HAVE_SSE2_INTRINSICS
+  // The common factors have vectorized filter cores that create the
+  // same output as the generic ones.
+  if (centered && sx <= 2 && sy <= 2 && sx * sy > 1 && CPUHasSSE2()) {
+    if (sy == 1)
+      return new(env) SSEUpsampler<2,1>(env,width,height);
+    if (sx == 1)
+      return new(env) SSEUpsampler<1,2>(env,width,height);
+    return new(env) SSEUpsampler<2,2>(env,width,height);
+  }
+#endif
 
   if (centered) {
     switch(sy) {
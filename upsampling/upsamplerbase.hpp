@@ -134,6 +134,10 @@ public:
   // The rectangle is given in block indices, not in canvas coordinates.
   void ExtendBufferedRegion(const RectAngle<LONG> &region);
   //
+  // Drop all buffered lines such that the next request refills them.
+  // Required if the data they were filled from changed.
+  void ResetBufferedRegion(void);
+  //
   // Define the region to contain the given data, copy it to the line buffers
   // for later upsampling. Coordinates are in blocks.
   void DefineRegion(LONG bx,LONG by,const LONG *data);